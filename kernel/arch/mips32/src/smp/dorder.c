@@ -45,6 +45,12 @@ void ipi_broadcast_arch(int ipi)
 	*((volatile uint32_t *) MSIM_DORDER_ADDRESS) = 0x7fffffff;
 }
 
+void ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	/* Recipients ignore messages which were not meant for them */
+	ipi_broadcast_arch(ipi);
+}
+
 #endif
 
 uint32_t dorder_cpuid(void)
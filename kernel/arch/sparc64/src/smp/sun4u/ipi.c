@@ -189,6 +189,8 @@ void ipi_unicast_arch(unsigned int cpu_id, int ipi)
 	
 	if (ipi == IPI_SMP_CALL) {
 		cross_call(cpus[cpu_id].arch.mid, smp_call_ipi_recv);
+	} else if (ipi == IPI_TLB_SHOOTDOWN) {
+		cross_call(cpus[cpu_id].arch.mid, tlb_shootdown_ipi_recv);
 	} else {
 		panic("Unknown IPI (%d).\n", ipi);
 		return;
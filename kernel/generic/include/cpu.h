@@ -91,6 +91,13 @@ typedef struct cpu {
 	bool active;
 	volatile bool tlb_active;
 	
+	/**
+	 * TLB shootdown accounting. Shootdowns are counted under lock,
+	 * stale flushes are only counted by the processor itself.
+	 */
+	size_t tlb_shootdowns;
+	size_t tlb_stale_flushes;
+	
 	uint16_t frequency_mhz;
 	uint32_t delay_loop_const;
 	
@@ -53,7 +53,8 @@ extern void memsetb(void *, size_t, uint8_t)
 extern void memsetw(void *, size_t, uint16_t)
     __attribute__((nonnull(1)));
 extern void *memmove(void *, const void *, size_t)
-    __attribute__((nonnull(1, 2))) DO_NOT_DISCARD;
+    __attribute__((nonnull(1, 2)))
+    ATTRIBUTE_OPTIMIZE("-fno-tree-loop-distribute-patterns") DO_NOT_DISCARD;
 
 #endif
 
@@ -50,6 +50,8 @@
 
 #define AS                   THE->as
 
+struct cpu_mask;
+
 
 /**
  * Defined to be true if user address space and kernel address space shadow each
@@ -112,6 +114,22 @@ typedef struct as {
 	/** Number of references (i.e. tasks that reference this as). */
 	atomic_t refcount;
 	
+	/**
+	 * TLB shootdown bookkeeping. The CPU masks are NULL for the kernel
+	 * address space, which is always shot down on all processors.
+	 * Protected by tlb_lock.
+	 */
+	SPINLOCK_DECLARE(tlb_lock);
+	
+	/** Processors on which this address space is active. */
+	struct cpu_mask *tlb_active;
+	
+	/** Processors which switched away but may still cache translations. */
+	struct cpu_mask *tlb_lazy;
+	
+	/** Processors which must flush this address space before using it. */
+	struct cpu_mask *tlb_stale;
+	
 	mutex_t lock;
 	
 	/** B+tree of address space areas. */
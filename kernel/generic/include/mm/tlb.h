@@ -37,6 +37,7 @@
 
 #include <arch/mm/asid.h>
 #include <typedefs.h>
+#include <stdbool.h>
 
 /**
  * Number of TLB shootdown messages that can be queued in processor tlb_messages
@@ -64,17 +65,28 @@ typedef struct {
 	size_t count;			/**< Number of pages to invalidate. */
 } tlb_shootdown_msg_t;
 
+struct as;
+
 extern void tlb_init(void);
+extern void tlb_as_init(struct as *, bool);
+extern void tlb_as_fini(struct as *);
 
 #ifdef CONFIG_SMP
 extern ipl_t tlb_shootdown_start(tlb_invalidate_type_t, asid_t, uintptr_t,
     size_t);
+extern ipl_t tlb_shootdown_start_as(struct as *, tlb_invalidate_type_t,
+    uintptr_t, size_t);
 extern void tlb_shootdown_finalize(ipl_t);
 extern void tlb_shootdown_ipi_recv(void);
+extern bool tlb_as_enter(struct as *);
+extern void tlb_as_leave(struct as *);
 #else
 #define tlb_shootdown_start(w, x, y, z)	interrupts_disable()	
+#define tlb_shootdown_start_as(a, w, x, y)	interrupts_disable()
 #define tlb_shootdown_finalize(i)	(interrupts_restore(i));
 #define tlb_shootdown_ipi_recv()
+#define tlb_as_enter(a)	false
+#define tlb_as_leave(a)
 #endif /* CONFIG_SMP */
 
 /* Export TLB interface that each architecture must implement. */
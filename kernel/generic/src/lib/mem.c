@@ -42,6 +42,8 @@
 
 #include <mem.h>
 #include <typedefs.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /** Fill block of memory.
  *
@@ -101,21 +103,66 @@ void *memmove(void *dst, const void *src, size_t cnt)
 	uint8_t *dp;
 	const uint8_t *sp;
 	
+	/*
+	 * Words can be moved in the aligned middle part if the
+	 * addresses are congruent modulo the word size.
+	 */
+	bool words = ((((uintptr_t) dst ^ (uintptr_t) src) &
+	    (sizeof(unsigned long) - 1)) == 0);
+	
 	/* Which direction? */
 	if (src > dst) {
 		/* Forwards. */
 		dp = dst;
 		sp = src;
 		
+		if (words) {
+			while ((cnt != 0) &&
+			    (((uintptr_t) dp & (sizeof(unsigned long) - 1)) != 0)) {
+				*dp++ = *sp++;
+				cnt--;
+			}
+			
+			unsigned long *dw = (unsigned long *) dp;
+			const unsigned long *sw = (const unsigned long *) sp;
+			
+			while (cnt >= sizeof(unsigned long)) {
+				*dw++ = *sw++;
+				cnt -= sizeof(unsigned long);
+			}
+			
+			dp = (uint8_t *) dw;
+			sp = (const uint8_t *) sw;
+		}
+		
 		while (cnt-- != 0)
 			*dp++ = *sp++;
 	} else {
 		/* Backwards. */
-		dp = dst + (cnt - 1);
-		sp = src + (cnt - 1);
+		dp = dst + cnt;
+		sp = src + cnt;
+		
+		if (words) {
+			while ((cnt != 0) &&
+			    (((uintptr_t) dp & (sizeof(unsigned long) - 1)) != 0)) {
+				*--dp = *--sp;
+				cnt--;
+			}
+			
+			unsigned long *dw = (unsigned long *) dp;
+			const unsigned long *sw = (const unsigned long *) sp;
+			
+			while (cnt >= sizeof(unsigned long)) {
+				*--dw = *--sw;
+				cnt -= sizeof(unsigned long);
+			}
+			
+			dp = (uint8_t *) dw;
+			sp = (const uint8_t *) sw;
+		}
 		
 		while (cnt-- != 0)
-			*dp-- = *sp--;
+			*--dp = *--sp;
 	}
 	
 	return dst;
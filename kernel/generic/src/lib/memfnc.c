@@ -41,10 +41,12 @@
 
 #include <lib/memfnc.h>
 #include <typedefs.h>
+#include <stdint.h>
 
 /** Fill block of memory.
  *
- * Fill cnt bytes at dst address with the value val.
+ * Fill cnt bytes at dst address with the value val. The aligned
+ * middle part of the block is filled word by word.
  *
  * @param dst Destination address to fill.
  * @param val Value to fill.
@@ -57,6 +59,27 @@ void *memset(void *dst, int val, size_t cnt)
 {
 	uint8_t *dp = (uint8_t *) dst;
 	
+	/* Fill the initial segment up to the first word boundary. */
+	while ((cnt != 0) && (((uintptr_t) dp & (sizeof(unsigned long) - 1)) != 0)) {
+		*dp++ = val;
+		cnt--;
+	}
+	
+	/* Fill the aligned segment. */
+	unsigned long pattern = (uint8_t) val;
+	for (size_t i = 1; i < sizeof(unsigned long); i++)
+		pattern = (pattern << 8) | (uint8_t) val;
+	
+	unsigned long *dw = (unsigned long *) dp;
+	
+	while (cnt >= sizeof(unsigned long)) {
+		*dw++ = pattern;
+		cnt -= sizeof(unsigned long);
+	}
+	
+	/* Fill the final segment. */
+	dp = (uint8_t *) dw;
+	
 	while (cnt-- != 0)
 		*dp++ = val;
 	
@@ -66,7 +89,9 @@ void *memset(void *dst, int val, size_t cnt)
 /** Move memory block without overlapping.
  *
  * Copy cnt bytes from src address to dst address. The source
- * and destination memory areas cannot overlap.
+ * and destination memory areas cannot overlap. If the addresses
+ * are congruent modulo the word size, the aligned middle part
+ * of the block is copied word by word.
  *
  * @param dst Destination address to copy to.
  * @param src Source address to copy from.
@@ -80,6 +105,29 @@ void *memcpy(void *dst, const void *src, size_t cnt)
 	uint8_t *dp = (uint8_t *) dst;
 	const uint8_t *sp = (uint8_t *) src;
 	
+	if ((((uintptr_t) dp ^ (uintptr_t) sp) &
+	    (sizeof(unsigned long) - 1)) == 0) {
+		/* Copy the initial segment up to the first word boundary. */
+		while ((cnt != 0) &&
+		    (((uintptr_t) dp & (sizeof(unsigned long) - 1)) != 0)) {
+			*dp++ = *sp++;
+			cnt--;
+		}
+		
+		/* Copy the aligned segment. */
+		unsigned long *dw = (unsigned long *) dp;
+		const unsigned long *sw = (const unsigned long *) sp;
+		
+		while (cnt >= sizeof(unsigned long)) {
+			*dw++ = *sw++;
+			cnt -= sizeof(unsigned long);
+		}
+		
+		dp = (uint8_t *) dw;
+		sp = (const uint8_t *) sw;
+	}
+	
+	/* Copy the rest (or everything if the addresses are not congruent). */
 	while (cnt-- != 0)
 		*dp++ = *sp++;
 	
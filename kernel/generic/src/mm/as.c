@@ -116,6 +116,7 @@ NO_TRACE static int as_constructor(void *obj, unsigned int flags)
 	
 	link_initialize(&as->inactive_as_with_asid_link);
 	mutex_initialize(&as->lock, MUTEX_PASSIVE);
+	spinlock_initialize(&as->tlb_lock, "as_tlb_lock");
 	
 	return as_constructor_arch(as, flags);
 }
@@ -165,6 +166,8 @@ as_t *as_create(unsigned int flags)
 	atomic_set(&as->refcount, 0);
 	as->cpu_refcount = 0;
 	
+	tlb_as_init(as, flags & FLAG_AS_KERNEL);
+	
 #ifdef AS_PAGE_TABLE
 	as->genarch.page_table = page_table_create(flags);
 #else
@@ -253,6 +256,8 @@ retry:
 	page_table_destroy(NULL);
 #endif
 	
+	tlb_as_fini(as);
+	
 	slab_free(as_slab, as);
 }
 
@@ -817,11 +822,85 @@ int as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int flags)
 		
 		page_table_lock(as, false);
 		
+		/*
+		 * Start TLB shootdown sequence.
+		 *
+		 * All pages past the new end of the area are unmapped in one
+		 * sequence. The used_space B+tree is trimmed only after the
+		 * sequence is finished as used_space_remove() may use a
+		 * blocking memory allocation for its B+tree. Blocking while
+		 * holding the tlblock spinlock is forbidden and would hit a
+		 * kernel assertion.
+		 */
+		ipl_t ipl = tlb_shootdown_start_as(as, TLB_INVL_PAGES,
+		    start_free, area->pages - pages);
+		
 		/*
 		 * Remove frames belonging to used space starting from
-		 * the highest addresses downwards until an overlap with
-		 * the resized address space area is found. Note that this
-		 * is also the right way to remove part of the used_space
+		 * the highest addresses downwards until an interval that
+		 * ends inside the resized address space area is found.
+		 */
+		bool done = false;
+		list_foreach_rev(area->used_space.leaf_list, leaf_link,
+		    btree_node_t, node) {
+			btree_key_t k;
+			
+			for (k = node->keys; k > 0; k--) {
+				uintptr_t ptr = node->key[k - 1];
+				size_t node_size = (size_t) node->value[k - 1];
+				
+				if (ptr + P2SZ(node_size) <= start_free) {
+					done = true;
+					break;
+				}
+				
+				size_t i = 0;
+				if (ptr < start_free)
+					i = (start_free - ptr) >> PAGE_WIDTH;
+				
+				for (; i < node_size; i++) {
+					pte_t pte;
+					bool found = page_mapping_find(as,
+					    ptr + P2SZ(i), false, &pte);
+					
+					assert(found);
+					assert(PTE_VALID(&pte));
+					assert(PTE_PRESENT(&pte));
+					
+					if ((area->backend) &&
+					    (area->backend->frame_free)) {
+						area->backend->frame_free(area,
+						    ptr + P2SZ(i),
+						    PTE_GET_FRAME(&pte));
+					}
+					
+					page_mapping_remove(as, ptr + P2SZ(i));
+				}
+			}
+			
+			if (done)
+				break;
+		}
+		
+		/*
+		 * Finish TLB shootdown sequence.
+		 */
+		
+		tlb_invalidate_pages(as->asid, start_free,
+		    area->pages - pages);
+		
+		/*
+		 * Invalidate software translation caches
+		 * (e.g. TSB on sparc64, PHT on ppc32).
+		 */
+		as_invalidate_translation_cache(as, start_free,
+		    area->pages - pages);
+		tlb_shootdown_finalize(ipl);
+		
+		/*
+		 * Now remove the unmapped intervals from used space, again
+		 * from the highest addresses downwards. Note that this is
+		 * also the right way to remove part of the used_space
 		 * B+tree leaf list.
 		 */
 		bool cond = true;
@@ -836,7 +915,6 @@ int as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int flags)
 				uintptr_t ptr = node->key[node->keys - 1];
 				size_t node_size =
 				    (size_t) node->value[node->keys - 1];
-				size_t i = 0;
 				
 				if (overlaps(ptr, P2SZ(node_size), area->base,
 				    P2SZ(pages))) {
@@ -858,7 +936,7 @@ int as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int flags)
 					
 					/* We are almost done */
 					cond = false;
-					i = (start_free - ptr) >> PAGE_WIDTH;
+					size_t i = (start_free - ptr) >> PAGE_WIDTH;
 					if (!used_space_remove(area, start_free,
 					    node_size - i))
 						panic("Cannot remove used space.");
@@ -870,58 +948,6 @@ int as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int flags)
 					if (!used_space_remove(area, ptr, node_size))
 						panic("Cannot remove used space.");
 				}
-				
-				/*
-				 * Start TLB shootdown sequence.
-				 *
-				 * The sequence is rather short and can be
-				 * repeated multiple times. The reason is that
-				 * we don't want to have used_space_remove()
-				 * inside the sequence as it may use a blocking
-				 * memory allocation for its B+tree. Blocking
-				 * while holding the tlblock spinlock is
-				 * forbidden and would hit a kernel assertion.
-				 */
-
-				ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES,
-				    as->asid, area->base + P2SZ(pages),
-				    area->pages - pages);
-		
-				for (; i < node_size; i++) {
-					pte_t pte;
-					bool found = page_mapping_find(as,
-					    ptr + P2SZ(i), false, &pte);
-					
-					assert(found);
-					assert(PTE_VALID(&pte));
-					assert(PTE_PRESENT(&pte));
-					
-					if ((area->backend) &&
-					    (area->backend->frame_free)) {
-						area->backend->frame_free(area,
-						    ptr + P2SZ(i),
-						    PTE_GET_FRAME(&pte));
-					}
-					
-					page_mapping_remove(as, ptr + P2SZ(i));
-				}
-		
-				/*
-				 * Finish TLB shootdown sequence.
-				 */
-		
-				tlb_invalidate_pages(as->asid,
-				    area->base + P2SZ(pages),
-				    area->pages - pages);
-		
-				/*
-				 * Invalidate software translation caches
-				 * (e.g. TSB on sparc64, PHT on ppc32).
-				 */
-				as_invalidate_translation_cache(as,
-				    area->base + P2SZ(pages),
-				    area->pages - pages);
-				tlb_shootdown_finalize(ipl);
 			}
 		}
 		page_table_unlock(as, false);
@@ -988,7 +1014,7 @@ int as_area_destroy(as_t *as, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
+	ipl_t ipl = tlb_shootdown_start_as(as, TLB_INVL_PAGES, area->base,
 	    area->pages);
 	
 	/*
@@ -1298,7 +1324,7 @@ int as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
+	ipl_t ipl = tlb_shootdown_start_as(as, TLB_INVL_PAGES, area->base,
 	    area->pages);
 	
 	/*
@@ -1560,6 +1586,7 @@ retry:
 		 * is being removed from the CPU.
 		 */
 		as_deinstall_arch(old_as);
+		tlb_as_leave(old_as);
 	}
 	
 	/*
@@ -1572,6 +1599,13 @@ retry:
 			new_as->asid = asid_get();
 	}
 	
+	/*
+	 * Register with TLB shootdown before the new address space can be
+	 * cached in the TLB. If it was shot down while we were away, flush
+	 * whatever may have been left from the last time.
+	 */
+	bool stale = tlb_as_enter(new_as);
+	
 #ifdef AS_PAGE_TABLE
 	SET_PTL0_ADDRESS(new_as->genarch.page_table);
 #endif
@@ -1582,6 +1616,11 @@ retry:
 	 */
 	as_install_arch(new_as);
 	
+	if (stale) {
+		tlb_invalidate_asid(new_as->asid);
+		CPU->tlb_stale_flushes++;
+	}
+	
 	spinlock_unlock(&asidlock);
 	
 	AS = new_as;
@@ -39,6 +39,10 @@
 #include <mm/as.h>
 #include <mm/page.h>
 #include <mm/frame.h>
+#include <mm/km.h>
+#include <mm/tlb.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
 #include <abi/mm/as.h>
 #include <abi/ipc/methods.h>
 #include <ipc/sysipc.h>
@@ -48,6 +52,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <log.h>
+#include <mem.h>
 
 static bool user_create(as_area_t *);
 static void user_destroy(as_area_t *);
@@ -94,7 +99,45 @@ bool user_is_shareable(as_area_t *area)
 	return false;
 }
 
+/** Release a reference to a frame backing a user-paged area.
+ *
+ * @param frame Frame to be released.
+ */
+static void user_frame_release(uintptr_t frame)
+{
+	pfn_t pfn = ADDR2PFN(frame);
+	if (find_zone(pfn, 1, 0) != (size_t) -1)
+		frame_free(frame, 1);
+}
+
+/** Make a private copy of a frame provided by the pager.
+ *
+ * @param frame Frame provided by the pager.
+ *
+ * @return Newly allocated frame with the same contents or 0 if there is not
+ *     enough memory.
+ */
+static uintptr_t user_frame_copy(uintptr_t frame)
+{
+	uintptr_t copy;
+	uintptr_t kpage = km_temporary_page_get(&copy, FRAME_NONE);
+	if (!kpage)
+		return 0;
+	
+	uintptr_t src = km_map(frame, PAGE_SIZE, PAGE_READ | PAGE_CACHEABLE);
+	memcpy((void *) kpage, (void *) src, PAGE_SIZE);
+	km_unmap(src, PAGE_SIZE);
+	
+	km_temporary_page_put(kpage);
+	return copy;
+}
+
 /** Service a page fault in the user-paged address space area.
+ *
+ * Frames returned by the pager may be shared with other address spaces.
+ * Writable areas are therefore private copy-on-write mappings of the pager
+ * contents: a frame is mapped read-only until the first write to it, which
+ * replaces it with a private copy.
  *
  * The address space area and page tables must be already locked.
  *
@@ -114,6 +157,35 @@ int user_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	if (!as_area_check_access(area, access))
 		return AS_PF_FAULT;
 
+	unsigned int flags = as_area_get_flags(area);
+
+	pte_t pte;
+	bool found = page_mapping_find(AS, upage, false, &pte);
+	if (found && PTE_PRESENT(&pte)) {
+		/*
+		 * The page is mapped read-only in a writable area and is
+		 * written to for the first time.
+		 */
+		if (access != PF_ACCESS_WRITE)
+			return AS_PF_OK;
+
+		uintptr_t shared = PTE_GET_FRAME(&pte);
+		uintptr_t frame = user_frame_copy(shared);
+		if (!frame)
+			return AS_PF_FAULT;
+
+		ipl_t ipl = tlb_shootdown_start_as(AS, TLB_INVL_PAGES, upage, 1);
+		page_mapping_remove(AS, upage);
+		tlb_invalidate_pages(AS->asid, upage, 1);
+		as_invalidate_translation_cache(AS, upage, 1);
+		tlb_shootdown_finalize(ipl);
+
+		page_mapping_insert(AS, upage, frame, flags);
+		user_frame_release(shared);
+
+		return AS_PF_OK;
+	}
+
 	as_area_pager_info_t *pager_info = &area->backend_data.pager_info;
 
 	ipc_data_t data = {};
@@ -144,7 +216,20 @@ int user_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	 */
 
 	uintptr_t frame = IPC_GET_ARG1(data);
-	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
+
+	if (flags & PAGE_WRITE) {
+		if (access == PF_ACCESS_WRITE) {
+			uintptr_t shared = frame;
+			frame = user_frame_copy(shared);
+			user_frame_release(shared);
+			if (!frame)
+				return AS_PF_FAULT;
+		} else {
+			flags &= ~PAGE_WRITE;
+		}
+	}
+
+	page_mapping_insert(AS, upage, frame, flags);
 	if (!used_space_insert(area, upage, 1))
 		panic("Cannot insert used space.");
 
@@ -164,13 +249,7 @@ void user_frame_free(as_area_t *area, uintptr_t page, uintptr_t frame)
 	assert(page_table_locked(area->as));
 	assert(mutex_locked(&area->lock));
 
-	pfn_t pfn = ADDR2PFN(frame);
-	if (find_zone(pfn, 1, 0) != (size_t) -1) {
-		frame_free(frame, 1);
-	} else {
-		/* Nothing to do */
-	}
-		
+	user_frame_release(frame);
 }
 
 /** @}
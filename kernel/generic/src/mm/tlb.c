@@ -35,12 +35,18 @@
  * @brief Generic TLB shootdown algorithm.
  *
  * The algorithm implemented here is based on the CMU TLB shootdown
- * algorithm and is further simplified (e.g. all CPUs receive all TLB
- * shootdown messages).
+ * algorithm and is further simplified. Shootdowns of the kernel address
+ * space are delivered to all CPUs. Shootdowns of user address spaces are
+ * delivered only to CPUs on which the address space is active; CPUs which
+ * merely ran the address space in the past flush it when they switch back
+ * to it.
  */
 
 #include <mm/tlb.h>
 #include <mm/asid.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <mm/slab.h>
 #include <arch/mm/tlb.h>
 #include <assert.h>
 #include <smp/ipi.h>
@@ -51,22 +57,160 @@
 #include <arch.h>
 #include <panic.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
+#include <macros.h>
 
 void tlb_init(void)
 {
 	tlb_arch_init();
 }
 
+/** Initialize TLB shootdown bookkeeping of an address space.
+ *
+ * The kernel address space is created before the number of processors
+ * is known and it is always shot down on all processors, so it does not
+ * track them.
+ *
+ * @param as     Address space.
+ * @param kernel True for the kernel address space.
+ *
+ */
+void tlb_as_init(as_t *as, bool kernel)
+{
+	if (kernel) {
+		as->tlb_active = NULL;
+		as->tlb_lazy = NULL;
+		as->tlb_stale = NULL;
+		return;
+	}
+	
+	size_t mask_size = cpu_mask_size();
+	uint8_t *masks = malloc(3 * mask_size, 0);
+	
+	as->tlb_active = (cpu_mask_t *) masks;
+	as->tlb_lazy = (cpu_mask_t *) (masks + mask_size);
+	as->tlb_stale = (cpu_mask_t *) (masks + 2 * mask_size);
+	cpu_mask_none(as->tlb_active);
+	cpu_mask_none(as->tlb_lazy);
+	cpu_mask_none(as->tlb_stale);
+}
+
+/** Release TLB shootdown bookkeeping of an address space.
+ *
+ * @param as Address space.
+ *
+ */
+void tlb_as_fini(as_t *as)
+{
+	/* All three masks share one allocation. */
+	if (as->tlb_active)
+		free(as->tlb_active);
+}
+
 #ifdef CONFIG_SMP
 
 /**
  * This lock is used for synchronisation between sender and
  * recipients of TLB shootdown message. It must be acquired
- * before CPU structure lock.
+ * before CPU structure lock and before address space tlb_lock.
  *
  */
 IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
 
+/**
+ * Address space whose tlb_lock is held by the running shootdown sequence,
+ * NULL if the sequence involves all CPUs. Protected by tlblock.
+ */
+static as_t *tlb_shootdown_as = NULL;
+
+/** Try to merge a page range into a queued message.
+ *
+ * @param msg   Queued TLB_INVL_PAGES message.
+ * @param page  First page of the new range.
+ * @param count Number of pages in the new range.
+ *
+ * @return True if the ranges overlap or touch and were merged.
+ *
+ */
+static bool tlb_shootdown_merge_pages(tlb_shootdown_msg_t *msg,
+    uintptr_t page, size_t count)
+{
+	uintptr_t msg_end = msg->page + P2SZ(msg->count);
+	uintptr_t end = page + P2SZ(count);
+	
+	if ((page > msg_end) || (msg->page > end))
+		return false;
+	
+	msg->page = min(msg->page, page);
+	msg->count = (max(msg_end, end) - msg->page) >> PAGE_WIDTH;
+	return true;
+}
+
+/** Queue TLB shootdown message on a CPU.
+ *
+ * Invalidations already covered by a queued message are dropped and page
+ * ranges adjacent to a queued range of the same address space are merged
+ * with it, so that a batch of invalidations consumes few queue slots.
+ *
+ * @param cpu   Recipient CPU.
+ * @param type  Type describing scope of shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ */
+static void tlb_shootdown_enqueue(cpu_t *cpu, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
+{
+	irq_spinlock_lock(&cpu->lock, false);
+	
+	size_t i;
+	for (i = 0; i < cpu->tlb_messages_count; i++) {
+		tlb_shootdown_msg_t *msg = &cpu->tlb_messages[i];
+		
+		if (msg->type == TLB_INVL_ALL)
+			goto out;
+		
+		if ((type == TLB_INVL_ALL) || (msg->asid != asid))
+			continue;
+		
+		if (msg->type == TLB_INVL_ASID)
+			goto out;
+		
+		if (type == TLB_INVL_ASID) {
+			msg->type = TLB_INVL_ASID;
+			goto out;
+		}
+		
+		if (tlb_shootdown_merge_pages(msg, page, count))
+			goto out;
+	}
+	
+	if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
+		/*
+		 * The message queue is full.
+		 * Erase the queue and store one TLB_INVL_ALL message.
+		 */
+		cpu->tlb_messages_count = 1;
+		cpu->tlb_messages[0].type = TLB_INVL_ALL;
+		cpu->tlb_messages[0].asid = ASID_INVALID;
+		cpu->tlb_messages[0].page = 0;
+		cpu->tlb_messages[0].count = 0;
+	} else {
+		/*
+		 * Enqueue the message.
+		 */
+		size_t idx = cpu->tlb_messages_count++;
+		cpu->tlb_messages[idx].type = type;
+		cpu->tlb_messages[idx].asid = asid;
+		cpu->tlb_messages[idx].page = page;
+		cpu->tlb_messages[idx].count = count;
+	}
+	
+out:
+	irq_spinlock_unlock(&cpu->lock, false);
+}
+
 /** Send TLB shootdown message.
  *
  * This function attempts to deliver TLB shootdown message
@@ -92,30 +236,7 @@ ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
 		if (i == CPU->id)
 			continue;
 		
-		cpu_t *cpu = &cpus[i];
-		
-		irq_spinlock_lock(&cpu->lock, false);
-		if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
-			/*
-			 * The message queue is full.
-			 * Erase the queue and store one TLB_INVL_ALL message.
-			 */
-			cpu->tlb_messages_count = 1;
-			cpu->tlb_messages[0].type = TLB_INVL_ALL;
-			cpu->tlb_messages[0].asid = ASID_INVALID;
-			cpu->tlb_messages[0].page = 0;
-			cpu->tlb_messages[0].count = 0;
-		} else {
-			/*
-			 * Enqueue the message.
-			 */
-			size_t idx = cpu->tlb_messages_count++;
-			cpu->tlb_messages[idx].type = type;
-			cpu->tlb_messages[idx].asid = asid;
-			cpu->tlb_messages[idx].page = page;
-			cpu->tlb_messages[idx].count = count;
-		}
-		irq_spinlock_unlock(&cpu->lock, false);
+		tlb_shootdown_enqueue(&cpus[i], type, asid, page, count);
 	}
 	
 	tlb_shootdown_ipi_send();
@@ -129,6 +250,60 @@ busy_wait:
 	return ipl;
 }
 
+/** Send TLB shootdown message concerning one address space.
+ *
+ * The message is delivered only to processors on which the address space
+ * is active. Processors which ran the address space before are marked to
+ * flush it once they switch to it again. No processor can activate the
+ * address space until the sequence is finalized.
+ *
+ * @param as    Address space.
+ * @param type  Type describing scope of shootdown.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ * @return The interrupt priority level as it existed prior to this call.
+ *
+ */
+ipl_t tlb_shootdown_start_as(as_t *as, tlb_invalidate_type_t type,
+    uintptr_t page, size_t count)
+{
+	if (!as->tlb_active)
+		return tlb_shootdown_start(type, as->asid, page, count);
+	
+	ipl_t ipl = interrupts_disable();
+	CPU->tlb_active = false;
+	irq_spinlock_lock(&tlblock, false);
+	spinlock_lock(&as->tlb_lock);
+	tlb_shootdown_as = as;
+	
+	DEFINE_CPU_MASK(targets);
+	cpu_mask_none(targets);
+	
+	cpu_mask_for_each(*as->tlb_active, cpu_id) {
+		if (cpu_id == CPU->id)
+			continue;
+		
+		tlb_shootdown_enqueue(&cpus[cpu_id], type, as->asid, page,
+		    count);
+		cpu_mask_set(targets, cpu_id);
+		ipi_unicast(cpu_id, VECTOR_TLB_SHOOTDOWN_IPI);
+	}
+	
+	cpu_mask_for_each(*as->tlb_lazy, cpu_id) {
+		cpu_mask_set(as->tlb_stale, cpu_id);
+	}
+	cpu_mask_none(as->tlb_lazy);
+	
+busy_wait:
+	cpu_mask_for_each(*targets, cpu_id) {
+		if (cpus[cpu_id].tlb_active)
+			goto busy_wait;
+	}
+	
+	return ipl;
+}
+
 /** Finish TLB shootdown sequence.
  *
  * @param ipl Previous interrupt priority level.
@@ -136,6 +311,11 @@ busy_wait:
  */
 void tlb_shootdown_finalize(ipl_t ipl)
 {
+	if (tlb_shootdown_as) {
+		spinlock_unlock(&tlb_shootdown_as->tlb_lock);
+		tlb_shootdown_as = NULL;
+	}
+	
 	irq_spinlock_unlock(&tlblock, false);
 	CPU->tlb_active = true;
 	interrupts_restore(ipl);
@@ -153,6 +333,17 @@ void tlb_shootdown_ipi_recv(void)
 {
 	assert(CPU);
 	
+	/*
+	 * Platforms without unicast IPIs deliver targeted shootdowns
+	 * to everybody. CPUs without queued messages are not part of
+	 * the sequence and need not wait for it.
+	 */
+	irq_spinlock_lock(&CPU->lock, false);
+	size_t pending = CPU->tlb_messages_count;
+	irq_spinlock_unlock(&CPU->lock, false);
+	if (pending == 0)
+		return;
+	
 	CPU->tlb_active = false;
 	irq_spinlock_lock(&tlblock, false);
 	irq_spinlock_unlock(&tlblock, false);
@@ -188,10 +379,65 @@ void tlb_shootdown_ipi_recv(void)
 	}
 	
 	CPU->tlb_messages_count = 0;
+	CPU->tlb_shootdowns++;
 	irq_spinlock_unlock(&CPU->lock, false);
 	CPU->tlb_active = true;
 }
 
+/** Note that the current CPU activates an address space.
+ *
+ * Called from as_switch() with interrupts disabled, before the address
+ * space is installed.
+ *
+ * @param as Address space being activated.
+ *
+ * @return True if the CPU must flush the address space from its TLB
+ *         once it is installed.
+ *
+ */
+bool tlb_as_enter(as_t *as)
+{
+	if (!as->tlb_active)
+		return false;
+	
+	/* Do not hold up shootdowns targeted at this CPU while we spin. */
+	CPU->tlb_active = false;
+	spinlock_lock(&as->tlb_lock);
+	
+	cpu_mask_set(as->tlb_active, CPU->id);
+	cpu_mask_reset(as->tlb_lazy, CPU->id);
+	bool stale = cpu_mask_is_set(as->tlb_stale, CPU->id);
+	cpu_mask_reset(as->tlb_stale, CPU->id);
+	
+	spinlock_unlock(&as->tlb_lock);
+	CPU->tlb_active = true;
+	
+	return stale;
+}
+
+/** Note that the current CPU deactivates an address space.
+ *
+ * The CPU may still cache translations of the address space, so it is
+ * kept in the lazy mask until the next shootdown marks it stale.
+ *
+ * @param as Address space being deactivated.
+ *
+ */
+void tlb_as_leave(as_t *as)
+{
+	if (!as->tlb_active)
+		return;
+	
+	CPU->tlb_active = false;
+	spinlock_lock(&as->tlb_lock);
+	
+	cpu_mask_reset(as->tlb_active, CPU->id);
+	cpu_mask_set(as->tlb_lazy, CPU->id);
+	
+	spinlock_unlock(&as->tlb_lock);
+	CPU->tlb_active = true;
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <print.h>
+#include <test.h>
+#include <mm/as.h>
+#include <mm/asid.h>
+#include <mm/page.h>
+#include <mm/tlb.h>
+#include <cpu/cpu_mask.h>
+#include <proc/thread.h>
+#include <arch/cycle.h>
+#include <preemption.h>
+#include <atomic.h>
+#include <align.h>
+#include <config.h>
+#include <macros.h>
+#include <cpu.h>
+#include <arch.h>
+
+#define MAX_CPUS    16
+#define ITERATIONS  1000
+
+/** Unrelated shootdowns a busy CPU may receive during one measurement. */
+#define NOISE       (ITERATIONS / 100)
+
+/** What the busy threads are asked to do. */
+typedef enum {
+	/** Keep running in the measured address space. */
+	PHASE_ACTIVE,
+	/** Switch to the kernel address space, the measured one goes lazy. */
+	PHASE_LAZY,
+	/** Switch back to the measured address space. */
+	PHASE_RETURN,
+	/** Restore the original address space and exit. */
+	PHASE_STOP
+} phase_t;
+
+static atomic_t phase;
+static atomic_t busy_acked;
+
+static as_t *measured_as;
+
+static void busy_switch(as_t *old_as, as_t *new_as)
+{
+	ipl_t ipl = interrupts_disable();
+	as_switch(old_as, new_as);
+	interrupts_restore(ipl);
+}
+
+static void busy_wait_phase(phase_t current)
+{
+	atomic_inc(&busy_acked);
+	while ((phase_t) atomic_get(&phase) == current)
+		;
+}
+
+/** Keep a CPU busy in the measured address space.
+ *
+ * The thread switches address spaces on its own and does not let the
+ * scheduler switch them behind its back, so that the test knows which
+ * address space each busy CPU uses at any time. Interrupts stay enabled,
+ * so shootdown IPIs are served.
+ *
+ */
+static void busy_thread(void *arg)
+{
+	as_t *old_as = AS;
+	
+	preemption_disable();
+	
+	busy_switch(old_as, measured_as);
+	busy_wait_phase(PHASE_ACTIVE);
+	
+	busy_switch(measured_as, AS_KERNEL);
+	busy_wait_phase(PHASE_LAZY);
+	
+	busy_switch(AS_KERNEL, measured_as);
+	busy_wait_phase(PHASE_RETURN);
+	
+	busy_switch(measured_as, old_as);
+	preemption_enable();
+}
+
+/** Advance the busy threads to the next phase and wait until they switch. */
+static void set_phase(phase_t next, unsigned int busy_count)
+{
+	atomic_set(&busy_acked, 0);
+	atomic_set(&phase, next);
+	
+	while ((unsigned int) atomic_get(&busy_acked) < busy_count)
+		thread_usleep(1000);
+}
+
+/** Snapshot the shootdown counters of all processors. */
+static void count_shootdowns(size_t *count, unsigned int cpu_count)
+{
+	for (unsigned int id = 0; id < cpu_count; id++) {
+		irq_spinlock_lock(&cpus[id].lock, true);
+		count[id] = cpus[id].tlb_shootdowns;
+		irq_spinlock_unlock(&cpus[id].lock, true);
+	}
+}
+
+/** Check which processors the measured address space records. */
+static const char *check_masks(cpu_mask_t *active, cpu_mask_t *lazy,
+    cpu_mask_t *stale, unsigned int cpu_count)
+{
+	const char *err = NULL;
+	
+	ipl_t ipl = interrupts_disable();
+	spinlock_lock(&measured_as->tlb_lock);
+	
+	for (unsigned int id = 0; id < cpu_count; id++) {
+		if (cpu_mask_is_set(measured_as->tlb_active, id) !=
+		    cpu_mask_is_set(active, id))
+			err = "Unexpected active CPUs";
+		else if (cpu_mask_is_set(measured_as->tlb_lazy, id) !=
+		    cpu_mask_is_set(lazy, id))
+			err = "Unexpected lazy CPUs";
+		else if (cpu_mask_is_set(measured_as->tlb_stale, id) !=
+		    cpu_mask_is_set(stale, id))
+			err = "Unexpected stale CPUs";
+		
+		if (err)
+			break;
+	}
+	
+	spinlock_unlock(&measured_as->tlb_lock);
+	interrupts_restore(ipl);
+	
+	return err;
+}
+
+/** Measure address space area destruction.
+ *
+ * Every destruction shoots down the area on the CPUs the measured address
+ * space is active on.
+ *
+ */
+static uint64_t measure_unmap(void)
+{
+	uint64_t start = get_cycle();
+	
+	for (unsigned int i = 0; i < ITERATIONS; i++) {
+		uintptr_t base = (uintptr_t) AS_AREA_ANY;
+		as_area_t *area = as_area_create(measured_as,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    PAGE_SIZE, AS_AREA_ATTR_NONE, &anon_backend, NULL, &base,
+		    0);
+		if (!area)
+			return 0;
+		
+		as_area_destroy(measured_as, base);
+	}
+	
+	return (get_cycle() - start) / ITERATIONS;
+}
+
+/** Check the shootdowns received by the busy CPUs during a measurement. */
+static const char *check_shootdowns(size_t *before, cpu_mask_t *busy,
+    bool expected, unsigned int cpu_count)
+{
+	size_t after[MAX_CPUS];
+	count_shootdowns(after, cpu_count);
+	
+	for (unsigned int id = 0; id < cpu_count; id++) {
+		if (!cpu_mask_is_set(busy, id))
+			continue;
+		
+		size_t received = after[id] - before[id];
+		TPRINTF("cpu%u: %zu shootdowns\n", id, received);
+		
+		if ((expected) && (received <= NOISE))
+			return "Active CPU was not interrupted";
+		if ((!expected) && (received > NOISE))
+			return "Lazy CPU was interrupted";
+	}
+	
+	return NULL;
+}
+
+const char *test_tlb1(void)
+{
+	thread_t *thread[MAX_CPUS] = { NULL };
+	unsigned int cpu_count = min(config.cpu_active, MAX_CPUS);
+	unsigned int busy_count = 0;
+	size_t before[MAX_CPUS];
+	size_t flushes[MAX_CPUS];
+	const char *err = NULL;
+	
+	DEFINE_CPU_MASK(busy);
+	DEFINE_CPU_MASK(none);
+	cpu_mask_none(busy);
+	cpu_mask_none(none);
+	
+	/*
+	 * The busy threads do not give up their CPUs, keep this thread
+	 * from being moved to one of them.
+	 */
+	irq_spinlock_lock(&THREAD->lock, true);
+	bool wired = THREAD->wired;
+	THREAD->wired = true;
+	unsigned int self = CPU->id;
+	irq_spinlock_unlock(&THREAD->lock, true);
+	
+	measured_as = as_create(0);
+	atomic_set(&phase, PHASE_ACTIVE);
+	atomic_set(&busy_acked, 0);
+	
+	/* Run the measured address space on all other CPUs. */
+	for (unsigned int id = 0; id < cpu_count; id++) {
+		if (id == self)
+			continue;
+		
+		thread[id] = thread_create(busy_thread, NULL, TASK,
+		    THREAD_FLAG_NONE, "tlb-busy");
+		if (!thread[id]) {
+			TPRINTF("Failed to create thread on cpu%u.\n", id);
+			continue;
+		}
+		
+		flushes[id] = cpus[id].tlb_stale_flushes;
+		thread_wire(thread[id], &cpus[id]);
+		thread_ready(thread[id]);
+		cpu_mask_set(busy, id);
+		busy_count++;
+	}
+	
+	while ((unsigned int) atomic_get(&busy_acked) < busy_count)
+		thread_usleep(1000);
+	
+	TPRINTF("Running with %u busy CPUs.\n", busy_count);
+	
+	err = check_masks(busy, none, none, cpu_count);
+	
+	/* Active CPUs must be interrupted by every destruction. */
+	count_shootdowns(before, cpu_count);
+	uint64_t active = measure_unmap();
+	if ((!err) && (active == 0))
+		err = "Failed to create address space area";
+	if (!err)
+		err = check_shootdowns(before, busy, true, cpu_count);
+	
+	/* Lazy CPUs must not be interrupted, only marked stale. */
+	set_phase(PHASE_LAZY, busy_count);
+	if (!err)
+		err = check_masks(none, busy, none, cpu_count);
+	
+	count_shootdowns(before, cpu_count);
+	uint64_t lazy = measure_unmap();
+	if ((!err) && (lazy == 0))
+		err = "Failed to create address space area";
+	if (!err)
+		err = check_shootdowns(before, busy, false, cpu_count);
+	if (!err)
+		err = check_masks(none, none, busy, cpu_count);
+	
+	/* Stale CPUs must flush the address space when they return to it. */
+	set_phase(PHASE_RETURN, busy_count);
+	if (!err)
+		err = check_masks(busy, none, none, cpu_count);
+	
+	for (unsigned int id = 0; id < cpu_count; id++) {
+		if ((!err) && (cpu_mask_is_set(busy, id)) &&
+		    (cpus[id].tlb_stale_flushes == flushes[id]))
+			err = "Stale CPU did not flush";
+	}
+	
+	atomic_set(&phase, PHASE_STOP);
+	
+	TPRINTF("Area unmap, active on %u CPUs: %" PRIu64 " cycles\n",
+	    busy_count, active);
+	TPRINTF("Area unmap, lazy on %u CPUs: %" PRIu64 " cycles\n",
+	    busy_count, lazy);
+	
+	for (unsigned int id = 0; id < cpu_count; id++) {
+		if (thread[id] != NULL) {
+			thread_join(thread[id]);
+			thread_detach(thread[id]);
+		}
+	}
+	
+	as_destroy(measured_as);
+	measured_as = NULL;
+	
+	irq_spinlock_lock(&THREAD->lock, true);
+	THREAD->wired = wired;
+	irq_spinlock_unlock(&THREAD->lock, true);
+	
+	return err;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup test
+ * @{
+ */
+
+/**
+ * @file	bdbench.c
+ * Measure random read throughput of a block device while sweeping the
+ * number of outstanding requests.
+ *
+ * Each outstanding request is issued by its own fibril over its own
+ * session, because requests on one block device session are serialized.
+ */
+
+#include <bd.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <loc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+
+#define NAME  "bdbench"
+
+/** Default number of reads issued at every queue depth. */
+#define DEFAULT_READS  4096
+
+/** Largest queue depth of the sweep. */
+#define MAX_DEPTH  32
+
+/** Shared state of one sweep step. */
+typedef struct {
+	service_id_t service_id;
+	aoff64_t blocks;
+	size_t block_size;
+	size_t count;
+	
+	/** Reads not yet claimed by a worker. */
+	size_t remaining;
+	/** Workers still running. */
+	size_t running;
+	/** First error reported by a worker. */
+	int rc;
+	
+	fibril_mutex_t lock;
+	fibril_condvar_t done_cv;
+} bench_t;
+
+static void syntax_print(void)
+{
+	printf("syntax: %s <device> [<blocks per read> [<reads>]]\n", NAME);
+}
+
+static bool bench_claim(bench_t *bench)
+{
+	fibril_mutex_lock(&bench->lock);
+	
+	bool claimed = (bench->remaining > 0) && (bench->rc == EOK);
+	if (claimed)
+		bench->remaining--;
+	
+	fibril_mutex_unlock(&bench->lock);
+	return claimed;
+}
+
+static void bench_finish(bench_t *bench, int rc)
+{
+	fibril_mutex_lock(&bench->lock);
+	
+	if (bench->rc == EOK)
+		bench->rc = rc;
+	
+	bench->running--;
+	if (bench->running == 0)
+		fibril_condvar_broadcast(&bench->done_cv);
+	
+	fibril_mutex_unlock(&bench->lock);
+}
+
+static int bench_worker(void *arg)
+{
+	bench_t *bench = (bench_t *) arg;
+	size_t size = bench->count * bench->block_size;
+	int rc;
+	
+	async_sess_t *sess = loc_service_connect(bench->service_id,
+	    INTERFACE_BLOCK, 0);
+	if (sess == NULL) {
+		bench_finish(bench, EIO);
+		return EIO;
+	}
+	
+	bd_t *bd;
+	rc = bd_open(sess, &bd);
+	if (rc != EOK) {
+		async_hangup(sess);
+		bench_finish(bench, rc);
+		return rc;
+	}
+	
+	void *buf = malloc(size);
+	if (buf == NULL)
+		rc = ENOMEM;
+	
+	aoff64_t span = bench->blocks - bench->count + 1;
+	
+	while ((rc == EOK) && bench_claim(bench)) {
+		aoff64_t ba = (((aoff64_t) rand() * RAND_MAX) + rand()) % span;
+		rc = bd_read_blocks(bd, ba, bench->count, buf, size);
+	}
+	
+	free(buf);
+	bd_close(bd);
+	async_hangup(sess);
+	
+	bench_finish(bench, rc);
+	return rc;
+}
+
+static int bench_run(bench_t *bench, size_t depth, size_t reads)
+{
+	bench->remaining = reads;
+	bench->running = depth;
+	bench->rc = EOK;
+	
+	for (size_t i = 0; i < depth; i++) {
+		fid_t fid = fibril_create(bench_worker, bench);
+		if (fid == 0) {
+			bench_finish(bench, ENOMEM);
+			continue;
+		}
+		
+		fibril_add_ready(fid);
+	}
+	
+	fibril_mutex_lock(&bench->lock);
+	while (bench->running > 0)
+		fibril_condvar_wait(&bench->done_cv, &bench->lock);
+	fibril_mutex_unlock(&bench->lock);
+	
+	return bench->rc;
+}
+
+int main(int argc, char **argv)
+{
+	bench_t bench;
+	size_t reads = DEFAULT_READS;
+	int rc;
+	
+	if (argc < 2 || argc > 4) {
+		syntax_print();
+		return 1;
+	}
+	
+	bench.count = 1;
+	if (argc > 2) {
+		rc = str_size_t(argv[2], NULL, 10, true, &bench.count);
+		if (rc != EOK || bench.count == 0) {
+			syntax_print();
+			return 1;
+		}
+	}
+	
+	if (argc > 3) {
+		rc = str_size_t(argv[3], NULL, 10, true, &reads);
+		if (rc != EOK || reads == 0) {
+			syntax_print();
+			return 1;
+		}
+	}
+	
+	rc = loc_service_get_id(argv[1], &bench.service_id, 0);
+	if (rc != EOK) {
+		printf(NAME ": Cannot resolve device `%s'.\n", argv[1]);
+		return 2;
+	}
+	
+	async_sess_t *sess = loc_service_connect(bench.service_id,
+	    INTERFACE_BLOCK, 0);
+	if (sess == NULL) {
+		printf(NAME ": Cannot connect to device `%s'.\n", argv[1]);
+		return 2;
+	}
+	
+	bd_t *bd;
+	size_t queue_depth;
+	rc = bd_open(sess, &bd);
+	if (rc == EOK) {
+		rc = bd_get_block_size(bd, &bench.block_size);
+		if (rc == EOK)
+			rc = bd_get_num_blocks(bd, &bench.blocks);
+		if (rc == EOK)
+			rc = bd_get_queue_depth(bd, &queue_depth);
+		bd_close(bd);
+	}
+	
+	async_hangup(sess);
+	
+	if (rc != EOK) {
+		printf(NAME ": Cannot query device `%s'.\n", argv[1]);
+		return 2;
+	}
+	
+	if (bench.blocks < bench.count) {
+		printf(NAME ": Device `%s' is too small.\n", argv[1]);
+		return 2;
+	}
+	
+	fibril_mutex_initialize(&bench.lock);
+	fibril_condvar_initialize(&bench.done_cv);
+	
+	printf("%s: %zu reads of %zu bytes, device queue depth %zu\n", argv[1],
+	    reads, bench.count * bench.block_size, queue_depth);
+	
+	for (size_t depth = 1; depth <= MAX_DEPTH; depth *= 2) {
+		struct timeval start;
+		struct timeval end;
+		
+		gettimeofday(&start, NULL);
+		rc = bench_run(&bench, depth, reads);
+		gettimeofday(&end, NULL);
+		
+		if (rc != EOK) {
+			printf(NAME ": Read failed at depth %zu (%d).\n", depth,
+			    rc);
+			return 3;
+		}
+		
+		suseconds_t usec = tv_sub_diff(&end, &start);
+		if (usec == 0)
+			usec = 1;
+		
+		uint64_t iops = (uint64_t) reads * 1000000 / usec;
+		uint64_t kbps = iops * bench.count * bench.block_size / 1024;
+		
+		printf("depth %2zu: %8" PRIu64 " IOPS, %8" PRIu64 " KiB/s\n",
+		    depth, iops, kbps);
+	}
+	
+	return 0;
+}
+
+/**
+ * @}
+ */
@@ -47,10 +47,15 @@
 #include <errno.h>
 #include <time.h>
 #include <dirent.h>
+#include <macros.h>
+#include <vfs/vfs.h>
 
 #define NAME	"bnchmark"
 #define BUFSIZE 8096
 #define MBYTE (1024*1024)
+#define WRITE_SIZE (16*MBYTE)
+#define CREATE_COUNT 1000
+#define CREATE_SIZE 1024
 
 typedef int(*measure_func_t)(void *);
 typedef unsigned long umseconds_t; /* milliseconds */
@@ -107,6 +112,111 @@ static int sequential_read_file(void *data)
 	return EOK;
 }
 
+static int sequential_write_file(void *data)
+{
+	char *path = (char *) data;
+	char *buf = malloc(BUFSIZE);
+	size_t written = 0;
+	
+	if (buf == NULL)
+		return ENOMEM;
+	
+	memset(buf, 0xa5, BUFSIZE);
+	
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Failed opening file: %s\n", path);
+		free(buf);
+		return EIO;
+	}
+	
+	while (written < WRITE_SIZE) {
+		size_t chunk = min(BUFSIZE, WRITE_SIZE - written);
+		if (fwrite(buf, 1, chunk, file) != chunk) {
+			fprintf(stderr, "Failed writing file\n");
+			fclose(file);
+			free(buf);
+			return EIO;
+		}
+		
+		written += chunk;
+	}
+	
+	if (fclose(file) != 0) {
+		fprintf(stderr, "Failed closing file\n");
+		free(buf);
+		return EIO;
+	}
+	
+	free(buf);
+	return EOK;
+}
+
+static int create_files(void *data)
+{
+	char *path = (char *) data;
+	char *buf = malloc(CREATE_SIZE);
+	char *name = NULL;
+	int rc = EOK;
+	unsigned int i;
+	
+	if (buf == NULL)
+		return ENOMEM;
+	
+	memset(buf, 0x5a, CREATE_SIZE);
+	
+	for (i = 0; i < CREATE_COUNT; i++) {
+		if (asprintf(&name, "%s/bnchmark%u", path, i) < 0) {
+			rc = ENOMEM;
+			break;
+		}
+		
+		FILE *file = fopen(name, "w");
+		if (file == NULL) {
+			fprintf(stderr, "Failed creating file: %s\n", name);
+			rc = EIO;
+			break;
+		}
+		
+		if (fwrite(buf, 1, CREATE_SIZE, file) != CREATE_SIZE) {
+			fprintf(stderr, "Failed writing file: %s\n", name);
+			fclose(file);
+			rc = EIO;
+			break;
+		}
+		
+		if (fclose(file) != 0) {
+			fprintf(stderr, "Failed closing file: %s\n", name);
+			rc = EIO;
+			break;
+		}
+		
+		free(name);
+		name = NULL;
+	}
+	
+	free(name);
+	free(buf);
+	return rc;
+}
+
+/** Remove the files left by create_files(), outside of the measured time */
+static int remove_files(void *data)
+{
+	char *path = (char *) data;
+	char *name;
+	
+	for (unsigned int i = 0; i < CREATE_COUNT; i++) {
+		if (asprintf(&name, "%s/bnchmark%u", path, i) < 0)
+			return ENOMEM;
+		
+		(void) remove(name);
+		free(name);
+	}
+	
+	return EOK;
+}
+
 static int sequential_read_dir(void *data)
 {
 	char *path = (char *) data;
@@ -127,12 +237,49 @@ static int sequential_read_dir(void *data)
 	return EOK;
 }
 
+static int tree_read(void *data)
+{
+	char *path = (char *) data;
+	char *name;
+	struct stat st;
+	int rc = EOK;
+	
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "Failed opening directory: %s\n", path);
+		return EIO;
+	}
+	
+	struct dirent *dp;
+	
+	while ((rc == EOK) && (dp = readdir(dir))) {
+		if (asprintf(&name, "%s/%s", path, dp->d_name) < 0) {
+			rc = ENOMEM;
+			break;
+		}
+		
+		rc = vfs_stat_path(name, &st);
+		if (rc != EOK)
+			fprintf(stderr, "Failed to stat: %s\n", name);
+		else if (st.is_directory)
+			rc = tree_read(name);
+		else if (st.is_file)
+			rc = sequential_read_file(name);
+		
+		free(name);
+	}
+	
+	closedir(dir);
+	return rc;
+}
+
 int main(int argc, char **argv)
 {
 	int rc;
 	umseconds_t milliseconds_taken = 0;
 	char *path = NULL;
 	measure_func_t fn = NULL;
+	measure_func_t cleanup = NULL;
 	int iteration;
 	int iterations;
 	char *log_str = NULL;
@@ -173,9 +320,19 @@ int main(int argc, char **argv)
 	if (str_cmp(test_type, "sequential-file-read") == 0) {
 		fn = sequential_read_file;
 	}
+	else if (str_cmp(test_type, "sequential-file-write") == 0) {
+		fn = sequential_write_file;
+	}
+	else if (str_cmp(test_type, "create-files") == 0) {
+		fn = create_files;
+		cleanup = remove_files;
+	}
 	else if (str_cmp(test_type, "sequential-dir-read") == 0) {
 		fn = sequential_read_dir;
 	}
+	else if (str_cmp(test_type, "tree-read") == 0) {
+		fn = tree_read;
+	}
 	else {
 		fprintf(stderr, "Error, unknown test type\n");
 		syntax_print();
@@ -184,6 +341,8 @@ int main(int argc, char **argv)
 
 	for (iteration = 0; iteration < iterations; iteration++) {
 		rc = measure(fn, path, &milliseconds_taken);
+		if (cleanup != NULL)
+			(void) cleanup(path);
 		if (rc != EOK) {
 			fprintf(stderr, "Error %d\n", rc);
 			return 1;
@@ -202,7 +361,12 @@ static void syntax_print(void)
 	fprintf(stderr, "  <iterations>    number of times to run a given test\n");
 	fprintf(stderr, "  <test-type>     one of:\n");
 	fprintf(stderr, "                    sequential-file-read\n");
+	fprintf(stderr, "                    sequential-file-write (%d MiB)\n",
+	    WRITE_SIZE / MBYTE);
+	fprintf(stderr, "                    create-files (%d files of %d bytes)\n",
+	    CREATE_COUNT, CREATE_SIZE);
 	fprintf(stderr, "                    sequential-dir-read\n");
+	fprintf(stderr, "                    tree-read (all files in a directory tree)\n");
 	fprintf(stderr, "  <log-str>       a string to attach to results\n");
 	fprintf(stderr, "  <path>          file/directory to use for testing\n");
 }
@@ -36,10 +36,27 @@
  */
 
 #include <dlfcn.h>
+#include <errno.h>
 #include <libdltest.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+#include <task.h>
+
+/** Default number of program startups measured by the benchmark */
+#define BENCH_STARTUPS  20
+
+/** Number of dlsym() calls measured by the benchmark */
+#define BENCH_LOOKUPS  100000
+
+/** Path used to spawn ourselves if argv[0] is not absolute */
+#ifdef DLTEST_LINKED
+	#define BENCH_PATH  "/app/dltest"
+#else
+	#define BENCH_PATH  "/app/dltests"
+#endif
 
 /** libdltest library handle */
 static void *handle;
@@ -944,14 +961,94 @@ static int test_lnk(void)
 
 #endif /* DLTEST_LINKED */
 
+/** Measure program startup time and symbol lookup speed.
+ *
+ * Startup time covers loading, relocating and running this program
+ * up to the point where it exits with the -s option.
+ *
+ * @param path Path to this program
+ * @param startups Number of program startups to measure
+ * @return Zero on success, non-zero on failure
+ */
+static int bench(const char *path, size_t startups)
+{
+	struct timeval start;
+	struct timeval end;
+	task_wait_t wait;
+	task_exit_t texit;
+	int retval;
+	int rc;
+
+	printf("Benchmarking %zu startups of %s\n", startups, path);
+
+	gettimeofday(&start, NULL);
+
+	for (size_t i = 0; i < startups; i++) {
+		rc = task_spawnl(NULL, &wait, path, path, "-s", NULL);
+		if (rc != EOK) {
+			printf("Error spawning %s (%d)\n", path, rc);
+			return 1;
+		}
+
+		rc = task_wait(&wait, &texit, &retval);
+		if (rc != EOK || texit != TASK_EXIT_NORMAL || retval != 0) {
+			printf("Error waiting for %s\n", path);
+			return 1;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	printf("Startup: %ld us average\n",
+	    (long) (tv_sub_diff(&end, &start) / startups));
+
+	handle = dlopen("libdltest.so.0", 0);
+	if (handle == NULL) {
+		printf("dlopen() failed\n");
+		return 1;
+	}
+
+	gettimeofday(&start, NULL);
+
+	for (size_t i = 0; i < BENCH_LOOKUPS; i++) {
+		if (dlsym(handle, "dl_get_constant") == NULL) {
+			printf("dlsym() failed\n");
+			return 1;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	printf("dlsym(): %ld ns average\n",
+	    (long) (tv_sub_diff(&end, &start) * 1000 / BENCH_LOOKUPS));
+
+	return 0;
+}
+
 static void print_syntax(void)
 {
-	fprintf(stderr, "syntax: dltest [-n]\n");
+	fprintf(stderr, "syntax: dltest [-n | -s | -b [<count>]]\n");
 	fprintf(stderr, "\t-n Do not run dlfcn tests\n");
+	fprintf(stderr, "\t-s Exit immediately (measures startup)\n");
+	fprintf(stderr, "\t-b Benchmark startup and symbol lookup\n");
 }
 
 int main(int argc, char *argv[])
 {
+	size_t startups = BENCH_STARTUPS;
+
+	if (argc > 1 && str_cmp(argv[1], "-s") == 0)
+		return 0;
+
+	if (argc > 1 && str_cmp(argv[1], "-b") == 0) {
+		if (argc > 3 || (argc > 2 && (str_size_t(argv[2], NULL, 10,
+		    true, &startups) != EOK || startups == 0))) {
+			print_syntax();
+			return 1;
+		}
+
+		return bench(argv[0][0] == '/' ? argv[0] : BENCH_PATH,
+		    startups);
+	}
+
 	printf("Dynamic linking test\n");
 
 	if (argc > 1) {
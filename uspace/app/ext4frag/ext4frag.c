@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file	ext4frag.c
+ * @brief	Report fragmentation of files and free space on an ext4 volume.
+ *
+ * The volume should not be mounted, or at least not written to, while
+ * the report is being generated.
+ */
+
+#include <errno.h>
+#include <loc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <block.h>
+#include "ext4/bitmap.h"
+#include "ext4/block_group.h"
+#include "ext4/directory.h"
+#include "ext4/filesystem.h"
+#include "ext4/inode.h"
+#include "ext4/superblock.h"
+
+#define NAME	"ext4frag"
+
+/** Number of free space histogram buckets (powers of two) */
+#define FREE_BUCKETS	16
+
+/** Maximum depth of directories walked */
+#define MAX_DEPTH	64
+
+typedef struct {
+	/** Number of regular files */
+	unsigned files;
+	/** Number of regular files with more than one fragment */
+	unsigned fragmented;
+	/** Number of data blocks in regular files */
+	uint64_t blocks;
+	/** Number of fragments in regular files */
+	uint64_t fragments;
+	/** Most fragmented file */
+	uint32_t worst_inode;
+	uint32_t worst_fragments;
+} frag_stats_t;
+
+static void syntax_print(void)
+{
+	printf("syntax: " NAME " <device>\n");
+}
+
+/** Count fragments of a file.
+ *
+ * A fragment is a maximal run of logical blocks stored in physically
+ * consecutive blocks. Holes are not counted.
+ */
+static int file_fragments(ext4_inode_ref_t *inode_ref, uint64_t *blocks,
+    uint32_t *fragments)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint64_t size = ext4_inode_get_size(sb, inode_ref->inode);
+	uint64_t count = (size + block_size - 1) / block_size;
+	uint32_t prev = 0;
+	int rc;
+
+	*blocks = 0;
+	*fragments = 0;
+
+	for (uint64_t iblock = 0; iblock < count; iblock++) {
+		uint32_t fblock;
+
+		rc = ext4_filesystem_get_inode_data_block_index(inode_ref,
+		    iblock, &fblock);
+		if (rc != EOK)
+			return rc;
+
+		if (fblock == 0) {
+			prev = 0;
+			continue;
+		}
+
+		if ((prev == 0) || (fblock != prev + 1))
+			(*fragments)++;
+
+		(*blocks)++;
+		prev = fblock;
+	}
+
+	return EOK;
+}
+
+/** Walk a directory and account all regular files found in its subtree. */
+static int walk_dir(ext4_filesystem_t *fs, uint32_t index, unsigned depth,
+    frag_stats_t *stats)
+{
+	ext4_inode_ref_t *dir_ref;
+	ext4_directory_iterator_t it;
+	int rc;
+
+	if (depth > MAX_DEPTH)
+		return EOK;
+
+	rc = ext4_filesystem_get_inode_ref(fs, index, &dir_ref);
+	if (rc != EOK)
+		return rc;
+
+	rc = ext4_directory_iterator_init(&it, dir_ref, 0);
+	if (rc != EOK) {
+		ext4_filesystem_put_inode_ref(dir_ref);
+		return rc;
+	}
+
+	while (it.current != NULL) {
+		uint32_t child = ext4_directory_entry_ll_get_inode(it.current);
+		uint16_t name_size = ext4_directory_entry_ll_get_name_length(
+		    fs->superblock, it.current);
+
+		if ((child == 0) ||
+		    ((name_size == 1) && (it.current->name[0] == '.')) ||
+		    ((name_size == 2) && (it.current->name[0] == '.') &&
+		    (it.current->name[1] == '.')))
+			goto next;
+
+		ext4_inode_ref_t *child_ref;
+		rc = ext4_filesystem_get_inode_ref(fs, child, &child_ref);
+		if (rc != EOK)
+			break;
+
+		bool is_dir = ext4_inode_is_type(fs->superblock,
+		    child_ref->inode, EXT4_INODE_MODE_DIRECTORY);
+
+		if (ext4_inode_is_type(fs->superblock, child_ref->inode,
+		    EXT4_INODE_MODE_FILE)) {
+			uint64_t blocks;
+			uint32_t fragments;
+
+			rc = file_fragments(child_ref, &blocks, &fragments);
+			if (rc == EOK) {
+				stats->files++;
+				stats->blocks += blocks;
+				stats->fragments += fragments;
+				if (fragments > 1)
+					stats->fragmented++;
+				if (fragments > stats->worst_fragments) {
+					stats->worst_fragments = fragments;
+					stats->worst_inode = child;
+				}
+			}
+		}
+
+		ext4_filesystem_put_inode_ref(child_ref);
+		if (rc != EOK)
+			break;
+
+		if (is_dir) {
+			rc = walk_dir(fs, child, depth + 1, stats);
+			if (rc != EOK)
+				break;
+		}
+
+next:
+		rc = ext4_directory_iterator_next(&it);
+		if (rc != EOK)
+			break;
+	}
+
+	ext4_directory_iterator_fini(&it);
+	ext4_filesystem_put_inode_ref(dir_ref);
+	return rc;
+}
+
+/** Scan block bitmaps and build histogram of free extent lengths. */
+static int scan_free(ext4_filesystem_t *fs, uint64_t *hist, uint32_t *runs,
+    uint32_t *largest)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t bg_count = ext4_superblock_get_block_group_count(sb);
+	int rc;
+
+	*runs = 0;
+	*largest = 0;
+
+	for (uint32_t bgid = 0; bgid < bg_count; bgid++) {
+		ext4_block_group_ref_t *bg_ref;
+		block_t *bitmap;
+
+		rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+		if (rc != EOK)
+			return rc;
+
+		rc = block_get(&bitmap, fs->device,
+		    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb),
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			ext4_filesystem_put_block_group_ref(bg_ref);
+			return rc;
+		}
+
+		uint32_t blocks_in_group =
+		    ext4_superblock_get_blocks_in_group(sb, bgid);
+		uint32_t run = 0;
+
+		for (uint32_t i = 0; i <= blocks_in_group; i++) {
+			if ((i < blocks_in_group) &&
+			    ext4_bitmap_is_free_bit(bitmap->data, i)) {
+				run++;
+				continue;
+			}
+
+			if (run == 0)
+				continue;
+
+			unsigned bucket = 0;
+			while ((bucket < FREE_BUCKETS - 1) &&
+			    (run >> (bucket + 1)) != 0)
+				bucket++;
+
+			hist[bucket] += run;
+			(*runs)++;
+			if (run > *largest)
+				*largest = run;
+			run = 0;
+		}
+
+		block_put(bitmap);
+		ext4_filesystem_put_block_group_ref(bg_ref);
+	}
+
+	return EOK;
+}
+
+int main(int argc, char **argv)
+{
+	service_id_t service_id;
+	ext4_filesystem_t *fs;
+	frag_stats_t stats;
+	uint64_t hist[FREE_BUCKETS];
+	uint32_t runs;
+	uint32_t largest;
+	int rc;
+
+	if (argc != 2) {
+		printf(NAME ": Error, argument missing.\n");
+		syntax_print();
+		return 1;
+	}
+
+	rc = loc_service_get_id(argv[1], &service_id, 0);
+	if (rc != EOK) {
+		printf(NAME ": Error resolving device `%s'.\n", argv[1]);
+		return 2;
+	}
+
+	fs = calloc(1, sizeof(ext4_filesystem_t));
+	if (fs == NULL) {
+		printf(NAME ": Out of memory.\n");
+		return 2;
+	}
+
+	rc = ext4_filesystem_init(fs, service_id, CACHE_MODE_WT);
+	if (rc != EOK) {
+		printf(NAME ": Error opening ext4 filesystem on `%s'.\n",
+		    argv[1]);
+		free(fs);
+		return 2;
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	rc = walk_dir(fs, EXT4_INODE_ROOT_INDEX, 0, &stats);
+	if (rc != EOK) {
+		printf(NAME ": Error walking directory tree (%s).\n",
+		    str_error(rc));
+		goto out;
+	}
+
+	memset(hist, 0, sizeof(hist));
+	rc = scan_free(fs, hist, &runs, &largest);
+	if (rc != EOK) {
+		printf(NAME ": Error reading block bitmaps (%s).\n",
+		    str_error(rc));
+		goto out;
+	}
+
+	printf("Files:               %u\n", stats.files);
+	printf("Fragmented files:    %u\n", stats.fragmented);
+	printf("Data blocks:         %" PRIu64 "\n", stats.blocks);
+	printf("Fragments:           %" PRIu64 "\n", stats.fragments);
+	if (stats.files > 0) {
+		printf("Fragments per file:  %" PRIu64 ".%02" PRIu64 "\n",
+		    stats.fragments / stats.files,
+		    (stats.fragments * 100 / stats.files) % 100);
+	}
+	if (stats.worst_fragments > 1) {
+		printf("Most fragmented:     i-node %" PRIu32 " (%" PRIu32
+		    " fragments)\n", stats.worst_inode, stats.worst_fragments);
+	}
+
+	printf("\nFree extents:        %" PRIu32 "\n", runs);
+	printf("Largest free extent: %" PRIu32 " blocks\n", largest);
+	printf("Free blocks by extent length:\n");
+	for (unsigned i = 0; i < FREE_BUCKETS; i++) {
+		if (hist[i] == 0)
+			continue;
+		if (i < FREE_BUCKETS - 1) {
+			printf("  %6u - %6u: %" PRIu64 "\n", 1u << i,
+			    (2u << i) - 1, hist[i]);
+		} else {
+			printf("  %6u -       : %" PRIu64 "\n", 1u << i,
+			    hist[i]);
+		}
+	}
+
+out:
+	ext4_filesystem_fini(fs);
+	free(fs);
+	return rc == EOK ? 0 : 1;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup test
+ * @{
+ */
+
+/**
+ * @file	membench.c
+ * Measure the throughput of the libc memory and string primitives for
+ * block sizes from 1 B to 1 MiB at aligned and misaligned addresses.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+
+#define NAME  "membench"
+
+/** Largest block size. */
+#define MAX_SIZE  (1024 * 1024)
+
+/** Default number of bytes processed per measurement. */
+#define DEFAULT_VOLUME  (4 * 1024 * 1024)
+
+/** Smallest number of calls per measurement. */
+#define MIN_CALLS  16
+
+typedef struct {
+	/** Source buffer */
+	char *src;
+	/** Destination buffer */
+	char *dst;
+	/** Block size */
+	size_t size;
+} bench_buf_t;
+
+typedef void (*bench_func_t)(bench_buf_t *);
+
+typedef struct {
+	const char *name;
+	bench_func_t func;
+	/** Whether the function needs a terminated string in the source */
+	bool string;
+} bench_t;
+
+typedef struct {
+	const char *name;
+	size_t src_offset;
+	size_t dst_offset;
+} bench_align_t;
+
+static void bench_memcpy(bench_buf_t *buf)
+{
+	memcpy(buf->dst, buf->src, buf->size);
+}
+
+static void bench_memmove(bench_buf_t *buf)
+{
+	/* Overlapping move backwards by a few bytes */
+	memmove(buf->dst + 3, buf->dst, buf->size);
+}
+
+static void bench_memset(bench_buf_t *buf)
+{
+	memset(buf->dst, 0x5a, buf->size);
+}
+
+static void bench_memcmp(bench_buf_t *buf)
+{
+	if (memcmp(buf->dst, buf->src, buf->size) != 0)
+		printf(NAME ": memcmp() reports a difference.\n");
+}
+
+static void bench_str_size(bench_buf_t *buf)
+{
+	if (str_size(buf->src) != buf->size - 1)
+		printf(NAME ": str_size() reports a wrong size.\n");
+}
+
+static void bench_str_cmp(bench_buf_t *buf)
+{
+	if (str_cmp(buf->dst, buf->src) != 0)
+		printf(NAME ": str_cmp() reports a difference.\n");
+}
+
+static void bench_str_chr(bench_buf_t *buf)
+{
+	if (str_chr(buf->src, 'x') != NULL)
+		printf(NAME ": str_chr() finds a missing character.\n");
+}
+
+static bench_t benchmarks[] = {
+	{ "memcpy", bench_memcpy, false },
+	{ "memmove", bench_memmove, false },
+	{ "memset", bench_memset, false },
+	{ "memcmp", bench_memcmp, false },
+	{ "str_size", bench_str_size, true },
+	{ "str_cmp", bench_str_cmp, true },
+	{ "str_chr", bench_str_chr, true }
+};
+
+static bench_align_t alignments[] = {
+	{ "aligned", 0, 0 },
+	{ "misaligned", 1, 3 }
+};
+
+static void syntax_print(void)
+{
+	printf("syntax: %s [<bytes per measurement>]\n", NAME);
+}
+
+/** Prepare the buffers for a measurement.
+ *
+ * The source holds a string of @a size - 1 characters which does not
+ * contain 'x', the destination holds a copy of it.
+ *
+ */
+static void bench_prepare(bench_buf_t *buf)
+{
+	for (size_t i = 0; i < buf->size; i++)
+		buf->src[i] = 'a' + i % 23;
+	
+	if (buf->size > 0)
+		buf->src[buf->size - 1] = 0;
+	
+	memcpy(buf->dst, buf->src, buf->size);
+}
+
+/** Run one measurement and return the throughput in KiB/s. */
+static uint64_t bench_run(bench_t *bench, bench_buf_t *buf, size_t volume)
+{
+	size_t calls = volume / buf->size;
+	if (calls < MIN_CALLS)
+		calls = MIN_CALLS;
+	
+	struct timeval start;
+	struct timeval end;
+	
+	gettimeofday(&start, NULL);
+	
+	for (size_t i = 0; i < calls; i++)
+		bench->func(buf);
+	
+	gettimeofday(&end, NULL);
+	
+	suseconds_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+	
+	return (uint64_t) calls * buf->size * 1000000 / usec / 1024;
+}
+
+int main(int argc, char **argv)
+{
+	size_t volume = DEFAULT_VOLUME;
+	int rc;
+	
+	if (argc > 2) {
+		syntax_print();
+		return 1;
+	}
+	
+	if (argc > 1) {
+		rc = str_size_t(argv[1], NULL, 10, true, &volume);
+		if (rc != EOK || volume == 0) {
+			syntax_print();
+			return 1;
+		}
+	}
+	
+	/* Room for the misalignment and the overlapping move */
+	char *src = malloc(MAX_SIZE + 16);
+	char *dst = malloc(MAX_SIZE + 16);
+	if (src == NULL || dst == NULL) {
+		printf(NAME ": Out of memory.\n");
+		free(src);
+		free(dst);
+		return 2;
+	}
+	
+	printf("%-10s %-10s %8s %12s\n", "function", "alignment", "size",
+	    "KiB/s");
+	
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]);
+	    i++) {
+		bench_t *bench = &benchmarks[i];
+		
+		for (size_t j = 0; j < sizeof(alignments) / sizeof(alignments[0]);
+		    j++) {
+			bench_align_t *align = &alignments[j];
+			
+			for (size_t size = 1; size <= MAX_SIZE; size *= 4) {
+				/* Strings need at least the terminator. */
+				if (bench->string && size < 2)
+					continue;
+				
+				bench_buf_t buf = {
+					.src = src + align->src_offset,
+					.dst = dst + align->dst_offset,
+					.size = size
+				};
+				
+				bench_prepare(&buf);
+				uint64_t kbps = bench_run(bench, &buf, volume);
+				
+				printf("%-10s %-10s %8zu %12" PRIu64 "\n", bench->name,
+				    align->name, size, kbps);
+			}
+		}
+	}
+	
+	free(src);
+	free(dst);
+	return 0;
+}
+
+/**
+ * @}
+ */
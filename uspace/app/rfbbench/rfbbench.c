@@ -0,0 +1,517 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup rfbbench
+ * @{
+ */
+/**
+ * @file RFB server benchmark.
+ *
+ * A minimal RFB (VNC) client which requests one full and a number of
+ * incremental framebuffer updates using the selected encoding and
+ * records the number of bytes and rectangles of every update. The
+ * pixel data are not decoded, they are only parsed to find the end of
+ * every update.
+ */
+
+#include <byteorder.h>
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <inet/hostport.h>
+#include <inet/tcp.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+
+#define NAME  "rfbbench"
+
+/** Default number of incremental updates */
+#define DEFAULT_FRAMES  100
+
+/** Size of receive buffer */
+#define RECV_BUF_SIZE  16384
+
+#define RFB_VERSION  "RFB 003.008\n"
+#define RFB_VERSION_SIZE  12
+
+#define RFB_SECURITY_NONE  1
+
+#define RFB_CMSG_SET_ENCODINGS  2
+#define RFB_CMSG_FRAMEBUFFER_UPDATE_REQUEST  3
+
+#define RFB_SMSG_FRAMEBUFFER_UPDATE  0
+
+#define RFB_ENCODING_RAW  0
+#define RFB_ENCODING_COPYRECT  1
+#define RFB_ENCODING_TRLE  15
+#define RFB_ENCODING_ZRLE  16
+
+#define RFB_TILE_ENCODING_RAW  0
+#define RFB_TILE_ENCODING_SOLID  1
+
+/** Size of the ServerInit message without the name */
+#define SERVER_INIT_SIZE  24
+
+/** Offset of the name length in the ServerInit message */
+#define SERVER_INIT_NAME_LENGTH  20
+
+static tcp_cb_t conn_cb = {
+	.connected = NULL
+};
+
+static tcp_conn_t *conn;
+
+static uint8_t rbuf[RECV_BUF_SIZE];
+static size_t rbuf_in;
+static size_t rbuf_out;
+
+/** Number of bytes received so far */
+static uint64_t nrecv_total;
+
+/** Framebuffer geometry and pixel size reported by the server */
+static uint16_t fb_width;
+static uint16_t fb_height;
+static size_t pixel_size;
+static size_t cpixel_size;
+
+static void print_syntax(void)
+{
+	printf("Syntax: %s [-e <encoding>] [-n <frames>] [-C] [-v] "
+	    "<host>:<port>\n", NAME);
+	printf("\t-e <encoding> raw, trle or zrle (default zrle)\n");
+	printf("\t-n <frames>   Number of incremental updates (default %d)\n",
+	    DEFAULT_FRAMES);
+	printf("\t-C            Do not offer the CopyRect encoding\n");
+	printf("\t-v            Print every update\n");
+}
+
+/** Receive data, or skip them if @a buf is NULL */
+static int recv_data(void *buf, size_t size)
+{
+	uint8_t *dest = (uint8_t *) buf;
+	
+	while (size > 0) {
+		if (rbuf_out == rbuf_in) {
+			size_t nrecv;
+			int rc = tcp_conn_recv_wait(conn, rbuf, RECV_BUF_SIZE,
+			    &nrecv);
+			if (rc != EOK)
+				return rc;
+			
+			rbuf_in = nrecv;
+			rbuf_out = 0;
+			nrecv_total += nrecv;
+		}
+		
+		size_t now = min(size, rbuf_in - rbuf_out);
+		if (dest != NULL) {
+			memcpy(dest, rbuf + rbuf_out, now);
+			dest += now;
+		}
+		
+		rbuf_out += now;
+		size -= now;
+	}
+	
+	return EOK;
+}
+
+static int recv_uint8(uint8_t *val)
+{
+	return recv_data(val, sizeof(uint8_t));
+}
+
+static int recv_uint32(uint32_t *val)
+{
+	int rc = recv_data(val, sizeof(uint32_t));
+	*val = uint32_t_be2host(*val);
+	return rc;
+}
+
+/** Perform the protocol handshake and initialization */
+static int rfbbench_init(void)
+{
+	char version[RFB_VERSION_SIZE];
+	int rc = recv_data(version, RFB_VERSION_SIZE);
+	if (rc != EOK)
+		return rc;
+	
+	if (memcmp(version, RFB_VERSION, RFB_VERSION_SIZE) != 0) {
+		printf("Server does not speak RFB 3.8.\n");
+		return ENOTSUP;
+	}
+	
+	rc = tcp_conn_send(conn, RFB_VERSION, RFB_VERSION_SIZE);
+	if (rc != EOK)
+		return rc;
+	
+	uint8_t ntypes;
+	rc = recv_uint8(&ntypes);
+	if (rc != EOK)
+		return rc;
+	
+	bool sec_none = false;
+	for (uint8_t i = 0; i < ntypes; i++) {
+		uint8_t type;
+		rc = recv_uint8(&type);
+		if (rc != EOK)
+			return rc;
+		
+		if (type == RFB_SECURITY_NONE)
+			sec_none = true;
+	}
+	
+	if (!sec_none) {
+		printf("Server requires authentication.\n");
+		return ENOTSUP;
+	}
+	
+	uint8_t msg[2] = { RFB_SECURITY_NONE, 1 };
+	rc = tcp_conn_send(conn, &msg[0], 1);
+	if (rc != EOK)
+		return rc;
+	
+	uint32_t result;
+	rc = recv_uint32(&result);
+	if (rc != EOK)
+		return rc;
+	
+	if (result != 0) {
+		printf("Security handshake failed.\n");
+		return EIO;
+	}
+	
+	/* ClientInit (shared) */
+	rc = tcp_conn_send(conn, &msg[1], 1);
+	if (rc != EOK)
+		return rc;
+	
+	uint8_t init[SERVER_INIT_SIZE];
+	rc = recv_data(init, SERVER_INIT_SIZE);
+	if (rc != EOK)
+		return rc;
+	
+	fb_width = (init[0] << 8) | init[1];
+	fb_height = (init[2] << 8) | init[3];
+	
+	uint8_t bpp = init[4];
+	uint8_t depth = init[5];
+	pixel_size = bpp / 8;
+	cpixel_size = (bpp == 32 && depth <= 24) ? 3 : pixel_size;
+	
+	uint32_t name_length;
+	memcpy(&name_length, init + SERVER_INIT_NAME_LENGTH, sizeof(uint32_t));
+	return recv_data(NULL, uint32_t_be2host(name_length));
+}
+
+static int rfbbench_set_encodings(int32_t encoding, bool copyrect)
+{
+	uint8_t msg[4 + 2 * sizeof(int32_t)];
+	uint16_t count = copyrect ? 2 : 1;
+	
+	msg[0] = RFB_CMSG_SET_ENCODINGS;
+	msg[1] = 0;
+	msg[2] = 0;
+	msg[3] = count;
+	
+	uint32_t enc = host2uint32_t_be(encoding);
+	memcpy(msg + 4, &enc, sizeof(uint32_t));
+	
+	enc = host2uint32_t_be(RFB_ENCODING_COPYRECT);
+	memcpy(msg + 8, &enc, sizeof(uint32_t));
+	
+	return tcp_conn_send(conn, msg, 4 + count * sizeof(int32_t));
+}
+
+static int rfbbench_request(bool incremental)
+{
+	uint8_t msg[10] = {
+		RFB_CMSG_FRAMEBUFFER_UPDATE_REQUEST,
+		incremental ? 1 : 0,
+		0, 0, 0, 0,
+		fb_width >> 8, fb_width & 0xff,
+		fb_height >> 8, fb_height & 0xff
+	};
+	
+	return tcp_conn_send(conn, msg, sizeof(msg));
+}
+
+/** Skip TRLE data of a rectangle (only raw and solid tiles are expected) */
+static int rfbbench_skip_trle(uint16_t width, uint16_t height)
+{
+	for (uint16_t y = 0; y < height; y += 16) {
+		for (uint16_t x = 0; x < width; x += 16) {
+			size_t tw = min(16, width - x);
+			size_t th = min(16, height - y);
+			
+			uint8_t type;
+			int rc = recv_uint8(&type);
+			if (rc != EOK)
+				return rc;
+			
+			if (type == RFB_TILE_ENCODING_RAW)
+				rc = recv_data(NULL, tw * th * cpixel_size);
+			else if (type == RFB_TILE_ENCODING_SOLID)
+				rc = recv_data(NULL, cpixel_size);
+			else
+				rc = ENOTSUP;
+			
+			if (rc != EOK)
+				return rc;
+		}
+	}
+	
+	return EOK;
+}
+
+/** Receive one framebuffer update
+ *
+ * @param rects Place to store the number of rectangles.
+ *
+ */
+static int rfbbench_recv_update(uint16_t *rects)
+{
+	uint8_t header[4];
+	int rc = recv_data(header, sizeof(header));
+	if (rc != EOK)
+		return rc;
+	
+	if (header[0] != RFB_SMSG_FRAMEBUFFER_UPDATE) {
+		printf("Unexpected server message %" PRIu8 ".\n", header[0]);
+		return EIO;
+	}
+	
+	*rects = (header[2] << 8) | header[3];
+	
+	for (uint16_t i = 0; i < *rects; i++) {
+		uint8_t rect[12];
+		rc = recv_data(rect, sizeof(rect));
+		if (rc != EOK)
+			return rc;
+		
+		uint16_t width = (rect[4] << 8) | rect[5];
+		uint16_t height = (rect[6] << 8) | rect[7];
+		int32_t encoding = (rect[8] << 24) | (rect[9] << 16) |
+		    (rect[10] << 8) | rect[11];
+		
+		uint32_t length;
+		switch (encoding) {
+		case RFB_ENCODING_RAW:
+			rc = recv_data(NULL, width * height * pixel_size);
+			break;
+		case RFB_ENCODING_COPYRECT:
+			rc = recv_data(NULL, 2 * sizeof(uint16_t));
+			break;
+		case RFB_ENCODING_TRLE:
+			rc = rfbbench_skip_trle(width, height);
+			break;
+		case RFB_ENCODING_ZRLE:
+			rc = recv_uint32(&length);
+			if (rc == EOK)
+				rc = recv_data(NULL, length);
+			break;
+		default:
+			printf("Unexpected encoding %" PRId32 ".\n", encoding);
+			rc = ENOTSUP;
+		}
+		
+		if (rc != EOK)
+			return rc;
+	}
+	
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	int32_t encoding = RFB_ENCODING_ZRLE;
+	unsigned long frames = DEFAULT_FRAMES;
+	bool copyrect = true;
+	bool verbose = false;
+	inet_ep2_t epp;
+	const char *errmsg;
+	char *endptr;
+	tcp_t *tcp;
+	int rc;
+	
+	argc--;
+	argv++;
+	
+	while (argc > 0 && argv[0][0] == '-') {
+		if (str_cmp(argv[0], "-C") == 0) {
+			copyrect = false;
+			argc--;
+			argv++;
+			continue;
+		}
+		
+		if (str_cmp(argv[0], "-v") == 0) {
+			verbose = true;
+			argc--;
+			argv++;
+			continue;
+		}
+		
+		if (argc < 2) {
+			print_syntax();
+			return 1;
+		}
+		
+		if (str_cmp(argv[0], "-e") == 0) {
+			if (str_cmp(argv[1], "raw") == 0) {
+				encoding = RFB_ENCODING_RAW;
+			} else if (str_cmp(argv[1], "trle") == 0) {
+				encoding = RFB_ENCODING_TRLE;
+			} else if (str_cmp(argv[1], "zrle") == 0) {
+				encoding = RFB_ENCODING_ZRLE;
+			} else {
+				printf("Unknown encoding '%s'.\n", argv[1]);
+				return 1;
+			}
+		} else if (str_cmp(argv[0], "-n") == 0) {
+			frames = strtoul(argv[1], &endptr, 10);
+			if (*endptr != '\0') {
+				printf("Invalid number of frames '%s'.\n",
+				    argv[1]);
+				return 1;
+			}
+		} else {
+			print_syntax();
+			return 1;
+		}
+		
+		argc -= 2;
+		argv += 2;
+	}
+	
+	if (argc != 1) {
+		print_syntax();
+		return 1;
+	}
+	
+	inet_ep2_init(&epp);
+	rc = inet_hostport_plookup_one(argv[0], ip_any, &epp.remote, NULL,
+	    &errmsg);
+	if (rc != EOK) {
+		printf("Error: %s (host:port %s).\n", errmsg, argv[0]);
+		return 1;
+	}
+	
+	rc = tcp_create(&tcp);
+	if (rc != EOK) {
+		printf("Error initializing TCP.\n");
+		return 1;
+	}
+	
+	rc = tcp_conn_create(tcp, &epp, &conn_cb, NULL, &conn);
+	if (rc == EOK)
+		rc = tcp_conn_wait_connected(conn);
+	if (rc != EOK) {
+		printf("Error connecting to %s (%s).\n", argv[0],
+		    str_error(rc));
+		return 2;
+	}
+	
+	rc = rfbbench_init();
+	if (rc == EOK)
+		rc = rfbbench_set_encodings(encoding, copyrect);
+	if (rc != EOK) {
+		printf("Error initializing session (%s).\n", str_error(rc));
+		return 2;
+	}
+	
+	printf("%" PRIu16 "x%" PRIu16 ", %zu bytes per pixel\n", fb_width,
+	    fb_height, pixel_size);
+	
+	uint64_t total_bytes = 0;
+	uint64_t total_rects = 0;
+	uint64_t max_bytes = 0;
+	uint64_t full_bytes = 0;
+	struct timeval start;
+	struct timeval end;
+	
+	gettimeofday(&start, NULL);
+	
+	for (unsigned long frame = 0; frame <= frames; frame++) {
+		uint64_t start_bytes = nrecv_total - (rbuf_in - rbuf_out);
+		uint16_t rects;
+		
+		rc = rfbbench_request(frame > 0);
+		if (rc == EOK)
+			rc = rfbbench_recv_update(&rects);
+		if (rc != EOK) {
+			printf("Error receiving update %lu (%s).\n", frame,
+			    str_error(rc));
+			return 3;
+		}
+		
+		uint64_t bytes = nrecv_total - (rbuf_in - rbuf_out) -
+		    start_bytes;
+		
+		if (verbose) {
+			printf("Update %lu: %" PRIu16 " rectangles, %" PRIu64
+			    " bytes\n", frame, rects, bytes);
+		}
+		
+		if (frame == 0) {
+			full_bytes = bytes;
+			gettimeofday(&start, NULL);
+			continue;
+		}
+		
+		total_bytes += bytes;
+		total_rects += rects;
+		max_bytes = max(max_bytes, bytes);
+	}
+	
+	gettimeofday(&end, NULL);
+	
+	unsigned long msec = tv_sub_diff(&end, &start) / 1000;
+	
+	printf("Full update: %" PRIu64 " bytes\n", full_bytes);
+	if (frames > 0) {
+		printf("%lu incremental updates: %" PRIu64 " bytes, %" PRIu64
+		    " rectangles in %lu.%03lu s\n", frames, total_bytes,
+		    total_rects, msec / 1000, msec % 1000);
+		printf("Bytes per update: %" PRIu64 " average, %" PRIu64
+		    " maximum\n", total_bytes / frames, max_bytes);
+	}
+	
+	tcp_conn_destroy(conn);
+	tcp_destroy(tcp);
+	return 0;
+}
+
+/** @}
+ */
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup test
+ * @{
+ */
+
+/**
+ * @file	spawnbench.c
+ * Spawn many instances of a program, measure the spawn latency and the
+ * memory used by the running instances.
+ */
+
+#include <async.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stats.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <sys/time.h>
+#include <task.h>
+
+#define NAME  "spawnbench"
+
+/** Default program to spawn. */
+#define DEFAULT_PATH  "/app/bdsh"
+
+/** Default number of instances. */
+#define DEFAULT_COUNT  50
+
+static void syntax_print(void)
+{
+	printf("syntax: %s [<count> [<path>]]\n", NAME);
+}
+
+static uint64_t physmem_used(void)
+{
+	stats_physmem_t *physmem = stats_get_physmem();
+	if (physmem == NULL)
+		return 0;
+	
+	uint64_t used = physmem->used;
+	free(physmem);
+	
+	return used;
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = DEFAULT_COUNT;
+	const char *path = DEFAULT_PATH;
+	int rc;
+	
+	if (argc > 3) {
+		syntax_print();
+		return 1;
+	}
+	
+	if (argc > 1) {
+		rc = str_size_t(argv[1], NULL, 10, true, &count);
+		if (rc != EOK || count == 0) {
+			syntax_print();
+			return 1;
+		}
+	}
+	
+	if (argc > 2)
+		path = argv[2];
+	
+	task_id_t *ids = calloc(count, sizeof(task_id_t));
+	task_wait_t *waits = calloc(count, sizeof(task_wait_t));
+	if (ids == NULL || waits == NULL) {
+		printf(NAME ": Out of memory.\n");
+		return 2;
+	}
+	
+	uint64_t used_before = physmem_used();
+	suseconds_t total = 0;
+	suseconds_t worst = 0;
+	size_t spawned;
+	
+	for (spawned = 0; spawned < count; spawned++) {
+		const char *args[] = { path, NULL };
+		struct timeval start;
+		struct timeval end;
+		
+		gettimeofday(&start, NULL);
+		rc = task_spawnv(&ids[spawned], &waits[spawned], path, args);
+		gettimeofday(&end, NULL);
+		
+		if (rc != EOK) {
+			printf(NAME ": Cannot spawn `%s' (%d).\n", path, rc);
+			break;
+		}
+		
+		suseconds_t usec = tv_sub_diff(&end, &start);
+		total += usec;
+		if (usec > worst)
+			worst = usec;
+	}
+	
+	if (spawned > 0) {
+		/* Let the instances finish their initialization. */
+		async_usleep(1000000);
+		
+		uint64_t used_after = physmem_used();
+		uint64_t resmem = 0;
+		
+		for (size_t i = 0; i < spawned; i++) {
+			stats_task_t *stats = stats_get_task(ids[i]);
+			if (stats != NULL) {
+				resmem += stats->resmem;
+				free(stats);
+			}
+		}
+		
+		printf("%zu instances of %s\n", spawned, path);
+		printf("spawn latency: average %" PRIu64 " us, worst %" PRIu64
+		    " us\n", (uint64_t) (total / spawned), (uint64_t) worst);
+		printf("resident memory: %" PRIu64 " KiB total, %" PRIu64
+		    " KiB per instance\n", resmem / 1024,
+		    resmem / spawned / 1024);
+		printf("physical memory used: %" PRIu64 " KiB more, %" PRIu64
+		    " KiB per instance\n", (used_after - used_before) / 1024,
+		    (used_after - used_before) / spawned / 1024);
+	}
+	
+	for (size_t i = 0; i < spawned; i++) {
+		task_exit_t texit;
+		int retval;
+		
+		task_kill(ids[i]);
+		task_wait(&waits[i], &texit, &retval);
+	}
+	
+	free(ids);
+	free(waits);
+	
+	return (spawned == count) ? 0 : 3;
+}
+
+/**
+ * @}
+ */
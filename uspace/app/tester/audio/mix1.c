@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <pcm/format.h>
+#include "../tester.h"
+
+/** Number of mixed streams */
+#define STREAMS  8
+
+/** Length of mixed audio in seconds */
+#define SECONDS  4
+
+#define RATE      44100
+#define CHANNELS  2
+
+typedef struct {
+	const char *name;
+	pcm_sample_format_t src;
+	pcm_sample_format_t dst;
+} mix_bench_t;
+
+static mix_bench_t benches[] = {
+	{ "s16 -> s16", PCM_SAMPLE_SINT16_LE, PCM_SAMPLE_SINT16_LE },
+	{ "s16 -> f32", PCM_SAMPLE_SINT16_LE, PCM_SAMPLE_FLOAT32 },
+	{ "f32 -> s16", PCM_SAMPLE_FLOAT32, PCM_SAMPLE_SINT16_LE },
+	{ "u8 -> s16 (generic)", PCM_SAMPLE_UINT8, PCM_SAMPLE_SINT16_LE }
+};
+
+static const char *mix1_check(void)
+{
+	const pcm_format_t s16 = {
+		.channels = 1,
+		.sampling_rate = RATE,
+		.sample_format = PCM_SAMPLE_SINT16_LE
+	};
+	const pcm_format_t f32 = {
+		.channels = 1,
+		.sampling_rate = RATE,
+		.sample_format = PCM_SAMPLE_FLOAT32
+	};
+	int16_t a[4] = { 30000, -30000, 100, 0 };
+	int16_t b[4] = { 10000, -10000, -50, 0 };
+	float f[4] = { 0.5f, -2.0f, 0.0f, 0.0f };
+
+	int rc = pcm_format_mix(a, b, sizeof(a), &s16);
+	if (rc != EOK)
+		return "Mixing s16 samples failed";
+
+	if (a[0] != INT16_MAX || a[1] != INT16_MIN || a[2] != 50)
+		return "Mixing s16 samples gave wrong result";
+
+	rc = pcm_format_convert_and_mix(a + 3, sizeof(int16_t), f,
+	    sizeof(float), &f32, &s16);
+	if (rc != EOK || a[3] != 16384)
+		return "Mixing f32 into s16 samples gave wrong result";
+
+	rc = pcm_format_convert_and_mix(b + 3, sizeof(int16_t), f + 1,
+	    sizeof(float), &f32, &s16);
+	if (rc != EOK || b[3] != INT16_MIN)
+		return "Mixing f32 into s16 samples did not saturate";
+
+	return NULL;
+}
+
+static const char *mix1_bench(mix_bench_t *bench)
+{
+	const pcm_format_t sf = {
+		.channels = CHANNELS,
+		.sampling_rate = RATE,
+		.sample_format = bench->src
+	};
+	const pcm_format_t df = {
+		.channels = CHANNELS,
+		.sampling_rate = RATE,
+		.sample_format = bench->dst
+	};
+	const size_t src_size = RATE * pcm_format_frame_size(&sf);
+	const size_t dst_size = RATE * pcm_format_frame_size(&df);
+	const char *err = NULL;
+	struct timeval t0, t1;
+	void *src[STREAMS];
+	void *dst;
+	unsigned i, s;
+
+	dst = calloc(1, dst_size);
+	for (s = 0; s < STREAMS; s++)
+		src[s] = calloc(1, src_size);
+
+	for (s = 0; s < STREAMS; s++) {
+		if (src[s] == NULL || dst == NULL) {
+			err = "Out of memory";
+			goto out;
+		}
+	}
+
+	/* Some non-trivial signal */
+	for (s = 0; s < STREAMS; s++) {
+		uint8_t *p = src[s];
+		for (i = 0; i < src_size; i++)
+			p[i] = (i * (s + 3)) & 0x3f;
+	}
+
+	pcm_mix_func_t func = pcm_format_mix_func(&sf, &df);
+
+	getuptime(&t0);
+
+	for (i = 0; i < SECONDS; i++) {
+		pcm_format_silence(dst, dst_size, &df);
+		for (s = 0; s < STREAMS; s++) {
+			if (pcm_format_convert_and_mix_func(dst, dst_size,
+			    src[s], src_size, &sf, &df, func) != EOK) {
+				err = "Mixing failed";
+				goto out;
+			}
+		}
+	}
+
+	getuptime(&t1);
+
+	useconds_t usec = tv_sub_diff(&t1, &t0);
+	TPRINTF("%s: %u streams, %u us of CPU per second of audio\n",
+	    bench->name, STREAMS, (unsigned) (usec / SECONDS));
+out:
+	for (s = 0; s < STREAMS; s++)
+		free(src[s]);
+	free(dst);
+	return err;
+}
+
+const char *test_mix1(void)
+{
+	const char *err = mix1_check();
+	if (err != NULL)
+		return err;
+
+	for (unsigned i = 0; i < sizeof_array(benches); i++) {
+		err = mix1_bench(&benches[i]);
+		if (err != NULL)
+			return err;
+	}
+
+	return NULL;
+}
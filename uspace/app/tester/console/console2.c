@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "../tester.h"
+
+/** Amount of text written to the console (in bytes) */
+#define TOTAL_BYTES  (1024 * 1024)
+
+/** Length of a single line including the newline */
+#define LINE_LENGTH  80
+
+const char *test_console2(void)
+{
+	char line[LINE_LENGTH];
+	
+	for (size_t i = 0; i < LINE_LENGTH - 1; i++)
+		line[i] = 'a' + (i % 26);
+	line[LINE_LENGTH - 1] = '\n';
+	
+	struct timeval start;
+	struct timeval end;
+	
+	gettimeofday(&start, NULL);
+	
+	/* Flush every line like line-buffered output to a terminal does. */
+	for (size_t written = 0; written < TOTAL_BYTES;
+	    written += LINE_LENGTH) {
+		fwrite(line, 1, LINE_LENGTH, stdout);
+		fflush(stdout);
+	}
+	
+	gettimeofday(&end, NULL);
+	
+	suseconds_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+	
+	printf("Wrote %u KiB in %ld us (%" PRIu64 " KiB/s)\n",
+	    TOTAL_BYTES / 1024, (long) usec,
+	    (uint64_t) TOTAL_BYTES * 1000000 / 1024 / usec);
+	
+	return NULL;
+}
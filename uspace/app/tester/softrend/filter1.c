@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Compare the fixed-point filters and transform stepping of libsoftrend
+ * with the floating-point reference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <filter.h>
+#include <transform.h>
+#include "../tester.h"
+
+#define MAP_WIDTH   32
+#define MAP_HEIGHT  32
+
+/** Number of sampled positions per filter */
+#define SAMPLES  20000
+
+/** Number of pixels of the stepped row (as in drawctx_transfer()) */
+#define ROW_LENGTH  256
+
+/** Largest tolerated deviation of the stepped coordinates (1/256 pixel) */
+#define STEP_TOLERANCE  (FIXED_ONE / 256)
+
+typedef struct {
+	const char *name;
+	filter_t filter;
+	unsigned int tolerance;
+} filter_test_t;
+
+static filter_test_t filter_tests[] = {
+	{ "nearest", filter_nearest, 0 },
+	{ "bilinear", filter_bilinear, 3 },
+	{ "bicubic", filter_bicubic, 3 }
+};
+
+static unsigned int channel_diff(uint8_t a, uint8_t b)
+{
+	return (a > b) ? (a - b) : (b - a);
+}
+
+static unsigned int pixel_diff(pixel_t a, pixel_t b)
+{
+	unsigned int diff = channel_diff(ALPHA(a), ALPHA(b));
+	unsigned int cur = channel_diff(RED(a), RED(b));
+	if (cur > diff)
+		diff = cur;
+	
+	cur = channel_diff(GREEN(a), GREEN(b));
+	if (cur > diff)
+		diff = cur;
+	
+	cur = channel_diff(BLUE(a), BLUE(b));
+	if (cur > diff)
+		diff = cur;
+	
+	return diff;
+}
+
+/** Random coordinate exactly representable in 16.16 fixed point. */
+static double random_coord(sysarg_t limit)
+{
+	long units = rand() % ((limit + 4) * FIXED_ONE);
+	return (double) units / FIXED_ONE - 2;
+}
+
+static const char *test_filters(pixelmap_t *pixmap)
+{
+	for (size_t i = 0; i < sizeof(filter_tests) / sizeof(filter_tests[0]);
+	    i++) {
+		filter_test_t *test = &filter_tests[i];
+		filter_fixed_t filter_fixed = filter_get_fixed(test->filter);
+		if (filter_fixed == NULL)
+			return "Missing fixed-point filter";
+		
+		unsigned int max_diff = 0;
+		
+		for (unsigned int j = 0; j < SAMPLES; j++) {
+			double x = random_coord(pixmap->width);
+			double y = random_coord(pixmap->height);
+			
+			pixel_t ref = test->filter(pixmap, x, y,
+			    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+			pixel_t res = filter_fixed(pixmap, fixed_from_double(x),
+			    fixed_from_double(y), PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+			
+			unsigned int diff = pixel_diff(ref, res);
+			if (diff > max_diff)
+				max_diff = diff;
+		}
+		
+		TPRINTF("%s: largest channel deviation %u\n", test->name, max_diff);
+		
+		if (max_diff > test->tolerance)
+			return "Fixed-point filter deviates from the reference";
+	}
+	
+	return NULL;
+}
+
+static const char *test_stepping(void)
+{
+	transform_t transform;
+	transform_t rotate;
+	transform_t scale;
+	transform_t temp;
+	
+	transform_identity(&transform);
+	transform_translate(&transform, -37.25, 1021.5);
+	transform_identity(&rotate);
+	transform_rotate(&rotate, 0.3);
+	transform_identity(&scale);
+	transform_scale(&scale, 1.3, 0.7);
+	
+	temp = transform;
+	transform_product(&transform, &temp, &rotate);
+	temp = transform;
+	transform_product(&transform, &temp, &scale);
+	transform_invert(&transform);
+	
+	fixed_t fx, fy, dx, dy;
+	if (!transform_span_fixed(&transform, 100, 200, ROW_LENGTH,
+	    &fx, &fy, &dx, &dy))
+		return "Row unexpectedly out of the fixed-point range";
+	
+	fixed_t max_diff = 0;
+	
+	for (unsigned int i = 0; i < ROW_LENGTH; i++) {
+		double x = 100 + i;
+		double y = 200;
+		transform_apply_affine(&transform, &x, &y);
+		
+		fixed_t diff_x = fx - fixed_from_double(x);
+		fixed_t diff_y = fy - fixed_from_double(y);
+		if (diff_x < 0)
+			diff_x = -diff_x;
+		if (diff_y < 0)
+			diff_y = -diff_y;
+		
+		if (diff_x > max_diff)
+			max_diff = diff_x;
+		if (diff_y > max_diff)
+			max_diff = diff_y;
+		
+		fx += dx;
+		fy += dy;
+	}
+	
+	TPRINTF("stepping: largest deviation %d/65536 pixel\n", max_diff);
+	
+	if (max_diff > STEP_TOLERANCE)
+		return "Stepped coordinates deviate from the transform";
+	
+	if (transform_span_fixed(&transform, 1e6, 0, 1, &fx, &fy, &dx, &dy))
+		return "Row unexpectedly in the fixed-point range";
+	
+	return NULL;
+}
+
+const char *test_filter1(void)
+{
+	pixel_t data[MAP_WIDTH * MAP_HEIGHT];
+	pixelmap_t pixmap = {
+		.width = MAP_WIDTH,
+		.height = MAP_HEIGHT,
+		.data = data
+	};
+	
+	srand(1);
+	
+	/* Mix smooth gradients with random noise and hard edges. */
+	for (unsigned int y = 0; y < MAP_HEIGHT; y++) {
+		for (unsigned int x = 0; x < MAP_WIDTH; x++) {
+			pixel_t pixel;
+			
+			if ((x + y) % 7 == 0)
+				pixel = (pixel_t) rand() ^ ((pixel_t) rand() << 16);
+			else if (x < MAP_WIDTH / 2)
+				pixel = PIXEL(255, x * 8, y * 8, (x + y) * 4);
+			else
+				pixel = (y % 2) ? PIXEL(255, 255, 255, 255) :
+				    PIXEL(128, 0, 0, 0);
+			
+			data[y * MAP_WIDTH + x] = pixel;
+		}
+	}
+	
+	const char *err = test_filters(&pixmap);
+	if (err != NULL)
+		return err;
+	
+	return test_stepping();
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Check the row conversion functions of libsoftrend against the per-pixel
+ * ones and measure their throughput.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mem.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include <pixconv.h>
+#include "../tester.h"
+
+/** Size of the rectangle used for measuring the throughput */
+#define RECT_WIDTH   640
+#define RECT_HEIGHT  480
+
+/** Number of conversions of the rectangle per measurement */
+#define ROUNDS  8
+
+/** Longest row used for checking the conversions */
+#define CHECK_LENGTH  67
+
+typedef struct {
+	const char *name;
+	visual_t visual;
+} visual_test_t;
+
+static visual_test_t visual_tests[] = {
+	{ "indirect 8", VISUAL_INDIRECT_8 },
+	{ "RGB 555 LE", VISUAL_RGB_5_5_5_LE },
+	{ "RGB 555 BE", VISUAL_RGB_5_5_5_BE },
+	{ "RGB 565 LE", VISUAL_RGB_5_6_5_LE },
+	{ "RGB 565 BE", VISUAL_RGB_5_6_5_BE },
+	{ "BGR 888", VISUAL_BGR_8_8_8 },
+	{ "BGR 0888", VISUAL_BGR_0_8_8_8 },
+	{ "BGR 8880", VISUAL_BGR_8_8_8_0 },
+	{ "ABGR 8888", VISUAL_ABGR_8_8_8_8 },
+	{ "BGRA 8888", VISUAL_BGRA_8_8_8_8 },
+	{ "RGB 888", VISUAL_RGB_8_8_8 },
+	{ "RGB 0888", VISUAL_RGB_0_8_8_8 },
+	{ "RGB 8880", VISUAL_RGB_8_8_8_0 },
+	{ "ARGB 8888", VISUAL_ARGB_8_8_8_8 },
+	{ "RGBA 8888", VISUAL_RGBA_8_8_8_8 }
+};
+
+/** Compare the row conversion with the per-pixel one.
+ *
+ * All row lengths up to CHECK_LENGTH are tried at every alignment
+ * of the destination. The per-pixel functions need an aligned
+ * destination, so the reference pixels are converted into a word
+ * and copied.
+ *
+ */
+static const char *test_check(const pixconv_t *conv, const pixel_t *src)
+{
+	uint8_t row[CHECK_LENGTH * 4 + 4];
+	uint8_t ref[CHECK_LENGTH * 4 + 4];
+	
+	for (size_t offset = 0; offset < 4; offset++) {
+		for (size_t count = 0; count <= CHECK_LENGTH; count++) {
+			memset(row, 0x5a, sizeof(row));
+			memset(ref, 0x5a, sizeof(ref));
+			
+			conv->pixel2visual_row(row + offset, src, count);
+			
+			for (size_t i = 0; i < count; i++) {
+				uint32_t word;
+				conv->pixel2visual(&word, src[i]);
+				memcpy(ref + offset + i * conv->pixel_bytes, &word,
+				    conv->pixel_bytes);
+			}
+			
+			if (memcmp(row, ref, sizeof(row)) != 0)
+				return "Row conversion differs from per-pixel conversion";
+		}
+	}
+	
+	return NULL;
+}
+
+/** Convert the rectangle ROUNDS times and return the pixel rate. */
+static uint64_t test_rate(const pixconv_t *conv, const pixel_t *src,
+    uint8_t *dst, bool rows)
+{
+	size_t scanline = RECT_WIDTH * conv->pixel_bytes;
+	struct timeval start;
+	struct timeval end;
+	
+	gettimeofday(&start, NULL);
+	
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		if (rows) {
+			pixconv_rect(conv, dst, scanline, src, RECT_WIDTH,
+			    RECT_WIDTH, RECT_HEIGHT);
+			continue;
+		}
+		
+		for (size_t y = 0; y < RECT_HEIGHT; y++) {
+			for (size_t x = 0; x < RECT_WIDTH; x++) {
+				conv->pixel2visual(dst + y * scanline +
+				    x * conv->pixel_bytes, src[y * RECT_WIDTH + x]);
+			}
+		}
+	}
+	
+	gettimeofday(&end, NULL);
+	
+	suseconds_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+	
+	return (uint64_t) ROUNDS * RECT_WIDTH * RECT_HEIGHT * 1000000 / usec;
+}
+
+const char *test_pixconv1(void)
+{
+	pixel_t *src = malloc(RECT_WIDTH * RECT_HEIGHT * sizeof(pixel_t));
+	uint8_t *dst = malloc(RECT_WIDTH * RECT_HEIGHT * 4);
+	if ((src == NULL) || (dst == NULL)) {
+		free(src);
+		free(dst);
+		return "Out of memory";
+	}
+	
+	srand(1);
+	
+	for (size_t i = 0; i < RECT_WIDTH * RECT_HEIGHT; i++)
+		src[i] = PIXEL(rand() % 256, rand() % 256, rand() % 256,
+		    rand() % 256);
+	
+	const char *err = NULL;
+	
+	for (size_t i = 0; i < sizeof(visual_tests) / sizeof(visual_tests[0]);
+	    i++) {
+		visual_test_t *test = &visual_tests[i];
+		const pixconv_t *conv = pixconv_get(test->visual);
+		if (conv == NULL) {
+			err = "Missing conversion functions";
+			break;
+		}
+		
+		err = test_check(conv, src);
+		if (err != NULL)
+			break;
+		
+		uint64_t pixel_rate = test_rate(conv, src, dst, false);
+		uint64_t row_rate = test_rate(conv, src, dst, true);
+		
+		TPRINTF("%-10s: per pixel %8" PRIu64 " kpx/s, rows %8" PRIu64
+		    " kpx/s\n", test->name, pixel_rate / 1000, row_rate / 1000);
+	}
+	
+	if ((err == NULL) && (pixconv_get(VISUAL_UNKNOWN) != NULL))
+		err = "Conversion functions for an unknown visual";
+	
+	free(src);
+	free(dst);
+	return err;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <io/log.h>
+#include "../tester.h"
+
+/** Number of messages logged at every level */
+#define MESSAGE_COUNT  2000
+
+static void log_burst(log_t log, log_level_t level)
+{
+	struct timeval start;
+	struct timeval end;
+
+	gettimeofday(&start, NULL);
+
+	for (unsigned int i = 0; i < MESSAGE_COUNT; i++) {
+		log_msg(log, level, "Benchmark message %u at level %s.", i,
+		    log_level_str(level));
+	}
+
+	gettimeofday(&end, NULL);
+
+	suseconds_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+
+	TPRINTF("%-6s: %u messages in %ld us (%" PRIu64 " messages/s)\n",
+	    log_level_str(level), MESSAGE_COUNT, (long) usec,
+	    (uint64_t) MESSAGE_COUNT * 1000000 / usec);
+}
+
+const char *test_logger3(void)
+{
+	log_t log = log_create("bench", LOG_DEFAULT);
+
+	/*
+	 * Debug messages are normally filtered out, notes are normally
+	 * logged. Use logset to change the level of tester/bench.
+	 */
+	log_burst(log, LVL_DEBUG2);
+	log_burst(log, LVL_DEBUG);
+	log_burst(log, LVL_NOTE);
+
+	return NULL;
+}
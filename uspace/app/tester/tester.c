@@ -55,17 +55,22 @@ test_t tests[] = {
 #include "print/print5.def"
 #include "print/print6.def"
 #include "console/console1.def"
+#include "console/console2.def"
 #include "stdio/stdio1.def"
 #include "stdio/stdio2.def"
 #include "stdio/logger1.def"
 #include "stdio/logger2.def"
+#include "stdio/logger3.def"
 #include "fault/fault1.def"
 #include "fault/fault2.def"
 #include "fault/fault3.def"
 #include "float/float1.def"
 #include "float/float2.def"
 #include "float/softfloat1.def"
+#include "softrend/filter1.def"
+#include "softrend/pixconv1.def"
 #include "vfs/vfs1.def"
+#include "vfs/vfs2.def"
 #include "ipc/ping_pong.def"
 #include "ipc/starve.def"
 #include "loop/loop1.def"
@@ -76,6 +81,7 @@ test_t tests[] = {
 #include "mm/pager1.def"
 #include "hw/serial/serial1.def"
 #include "hw/misc/virtchar1.def"
+#include "audio/mix1.def"
 	{NULL, NULL, NULL, false}
 };
 
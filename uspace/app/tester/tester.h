@@ -87,17 +87,22 @@ extern const char *test_print4(void);
 extern const char *test_print5(void);
 extern const char *test_print6(void);
 extern const char *test_console1(void);
+extern const char *test_console2(void);
 extern const char *test_stdio1(void);
 extern const char *test_stdio2(void);
 extern const char *test_logger1(void);
 extern const char *test_logger2(void);
+extern const char *test_logger3(void);
 extern const char *test_fault1(void);
 extern const char *test_fault2(void);
 extern const char *test_fault3(void);
 extern const char *test_float1(void);
 extern const char *test_float2(void);
 extern const char *test_softfloat1(void);
+extern const char *test_filter1(void);
+extern const char *test_pixconv1(void);
 extern const char *test_vfs1(void);
+extern const char *test_vfs2(void);
 extern const char *test_ping_pong(void);
 extern const char *test_starve_ipc(void);
 extern const char *test_loop1(void);
@@ -108,6 +113,7 @@ extern const char *test_mapping1(void);
 extern const char *test_pager1(void);
 extern const char *test_serial1(void);
 extern const char *test_virtchar1(void);
+extern const char *test_mix1(void);
 extern const char *test_devman1(void);
 extern const char *test_devman2(void);
 
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <vfs/vfs.h>
+#include <vfs/vfs_mtab.h>
+#include "../tester.h"
+
+#define WRITERS     4
+#define CHUNK_SIZE  512
+#define CHUNKS      64
+
+/*
+ * Writes of different files are only served concurrently by file system
+ * servers declaring LIBFS_CONCURRENT_WRITE, prefer a mounted one.
+ */
+#define CONCURRENT_FS   "fat"
+#define FALLBACK_DIR    "/tmp"
+
+typedef struct {
+	char path[MAX_PATH_LEN];
+	unsigned int id;
+	const char *err;
+} writer_t;
+
+static writer_t writers[WRITERS];
+static char dir[MAX_PATH_LEN];
+static unsigned int running;
+
+static FIBRIL_MUTEX_INITIALIZE(running_lock);
+static FIBRIL_CONDVAR_INITIALIZE(running_cv);
+
+static void fill_chunk(uint8_t *buf, unsigned int id, unsigned int chunk)
+{
+	for (size_t i = 0; i < CHUNK_SIZE; i++)
+		buf[i] = (uint8_t) (id * 131 + chunk * 7 + i);
+}
+
+static const char *write_file(writer_t *writer)
+{
+	uint8_t buf[CHUNK_SIZE];
+	aoff64_t pos = 0;
+	
+	int fd = vfs_lookup_open(writer->path, WALK_REGULAR | WALK_MAY_CREATE,
+	    MODE_WRITE);
+	if (fd < 0)
+		return "vfs_lookup_open() failed";
+	
+	for (unsigned int chunk = 0; chunk < CHUNKS; chunk++) {
+		fill_chunk(buf, writer->id, chunk);
+		
+		ssize_t cnt = vfs_write(fd, &pos, buf, CHUNK_SIZE);
+		if (cnt != CHUNK_SIZE) {
+			vfs_put(fd);
+			return "vfs_write() failed";
+		}
+		
+		/* Let the other writers issue their requests. */
+		fibril_yield();
+	}
+	
+	vfs_put(fd);
+	return NULL;
+}
+
+static const char *check_file(writer_t *writer)
+{
+	uint8_t buf[CHUNK_SIZE];
+	uint8_t expected[CHUNK_SIZE];
+	aoff64_t pos = 0;
+	const char *err = NULL;
+	
+	int fd = vfs_lookup_open(writer->path, WALK_REGULAR, MODE_READ);
+	if (fd < 0)
+		return "vfs_lookup_open() failed";
+	
+	for (unsigned int chunk = 0; chunk < CHUNKS; chunk++) {
+		ssize_t cnt = vfs_read(fd, &pos, buf, CHUNK_SIZE);
+		if (cnt != CHUNK_SIZE) {
+			err = "vfs_read() failed";
+			break;
+		}
+		
+		fill_chunk(expected, writer->id, chunk);
+		if (memcmp(buf, expected, CHUNK_SIZE) != 0) {
+			TPRINTF("%s: chunk %u differs\n", writer->path, chunk);
+			err = "File contents differ";
+			break;
+		}
+	}
+	
+	vfs_put(fd);
+	return err;
+}
+
+static int writer_fibril(void *arg)
+{
+	writer_t *writer = (writer_t *) arg;
+	
+	writer->err = write_file(writer);
+	
+	fibril_mutex_lock(&running_lock);
+	running--;
+	fibril_condvar_broadcast(&running_cv);
+	fibril_mutex_unlock(&running_lock);
+	
+	return 0;
+}
+
+/** Find the mount point of a file system serving concurrent writes. */
+static void find_directory(void)
+{
+	LIST_INITIALIZE(mtab_list);
+	
+	str_cpy(dir, MAX_PATH_LEN, FALLBACK_DIR);
+	
+	if (vfs_get_mtab_list(&mtab_list) != EOK)
+		return;
+	
+	bool found = false;
+	while (!list_empty(&mtab_list)) {
+		mtab_ent_t *ent = list_get_instance(list_first(&mtab_list),
+		    mtab_ent_t, link);
+		list_remove(&ent->link);
+		
+		if ((!found) && (str_cmp(ent->fs_name, CONCURRENT_FS) == 0)) {
+			str_cpy(dir, MAX_PATH_LEN, ent->mp);
+			found = true;
+		}
+		
+		free(ent);
+	}
+}
+
+const char *test_vfs2(void)
+{
+	const char *err = NULL;
+	
+	find_directory();
+	TPRINTF("Writing %u files in %s concurrently\n", WRITERS, dir);
+	
+	running = 0;
+	for (unsigned int i = 0; i < WRITERS; i++) {
+		writer_t *writer = &writers[i];
+		
+		snprintf(writer->path, MAX_PATH_LEN, "%s%svfs2-%u", dir,
+		    str_cmp(dir, "/") == 0 ? "" : "/", i);
+		writer->id = i;
+		writer->err = NULL;
+		
+		fid_t fid = fibril_create(writer_fibril, writer);
+		if (fid == 0) {
+			writer->err = "fibril_create() failed";
+			continue;
+		}
+		
+		fibril_mutex_lock(&running_lock);
+		running++;
+		fibril_mutex_unlock(&running_lock);
+		fibril_add_ready(fid);
+	}
+	
+	fibril_mutex_lock(&running_lock);
+	while (running > 0)
+		fibril_condvar_wait(&running_cv, &running_lock);
+	fibril_mutex_unlock(&running_lock);
+	
+	for (unsigned int i = 0; i < WRITERS; i++) {
+		writer_t *writer = &writers[i];
+		
+		if ((err == NULL) && (writer->err != NULL))
+			err = writer->err;
+		if (err == NULL)
+			err = check_file(writer);
+		
+		(void) vfs_unlink_path(writer->path);
+	}
+	
+	if (err == NULL)
+		TPRINTF("All files have the expected contents\n");
+	
+	return err;
+}
@@ -35,7 +35,13 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <malloc.h>
+#include <errno.h>
+#include <fibril.h>
+#include <inttypes.h>
+#include <str.h>
 #include <io/pixel.h>
+#include <io/window.h>
+#include <sys/time.h>
 #include <task.h>
 
 #include <window.h>
@@ -45,6 +51,12 @@
 
 #define NAME "vdemo"
 
+/** Default number of label updates done by the benchmark. */
+#define BENCH_UPDATES  1000
+
+/** Time given to the window to obtain its surface before benchmarking. */
+#define BENCH_DELAY  500000
+
 typedef struct my_label {
 	label_t label;
 	slot_t confirm;
@@ -79,6 +91,61 @@ static void on_cancel(widget_t *widget, void *data)
 	lbl->label.rewrite(&lbl->label.widget, (void *) cancelled);
 }
 
+typedef struct {
+	window_t *window;
+	my_label_t *label;
+	size_t updates;
+} bench_t;
+
+/** Rewrite the label repeatedly and report each change to the compositor.
+ *
+ * The throughput of the damage reports is printed when done. Frame
+ * statistics of the compositor can be printed by pressing Alt+U.
+ *
+ */
+static int bench_fibril(void *arg)
+{
+	bench_t *bench = (bench_t *) arg;
+	char caption[32];
+	
+	fibril_usleep(BENCH_DELAY);
+	
+	sysarg_t width = 0;
+	sysarg_t height = 0;
+	surface_t *surface = window_claim(bench->window);
+	if (surface)
+		surface_get_resolution(surface, &width, &height);
+	window_yield(bench->window);
+	
+	struct timeval start;
+	gettimeofday(&start, NULL);
+	
+	for (size_t i = 0; i < bench->updates; i++) {
+		snprintf(caption, sizeof(caption), "Update %zu", i);
+		bench->label->label.rewrite(&bench->label->label.widget,
+		    (void *) caption);
+		
+		int rc = win_damage(bench->window->osess, 0, 0, width, height);
+		if (rc != EOK) {
+			printf("%s: Damage report failed (%d).\n", NAME, rc);
+			return rc;
+		}
+	}
+	
+	struct timeval end;
+	gettimeofday(&end, NULL);
+	
+	suseconds_t usec = tv_sub_diff(&end, &start);
+	if (usec == 0)
+		usec = 1;
+	
+	printf("%s: %zu updates in %ld ms, %" PRIu64 " updates/s\n", NAME,
+	    bench->updates, usec / 1000,
+	    (uint64_t) bench->updates * 1000000 / usec);
+	
+	return EOK;
+}
+
 static bool init_my_label(my_label_t *lbl, widget_t *parent,
     const char *caption, uint16_t points, pixel_t background, pixel_t foreground)
 {
@@ -108,9 +175,24 @@ static my_label_t *create_my_label(widget_t *parent,
 
 int main(int argc, char *argv[])
 {
+	bench_t bench;
+	bool benchmark = false;
+	
+	bench.updates = BENCH_UPDATES;
+	if ((argc >= 3) && (str_cmp(argv[2], "-b") == 0)) {
+		benchmark = true;
+		if ((argc >= 4) &&
+		    ((str_size_t(argv[3], NULL, 10, true, &bench.updates) != EOK) ||
+		    (bench.updates == 0))) {
+			printf("Usage: %s <compositor> [-b [<updates>]]\n", NAME);
+			return 1;
+		}
+	}
+	
 	if (argc >= 2) {
 		window_t *main_window = window_open(argv[1], NULL,
-		    WINDOW_MAIN | WINDOW_DECORATED | WINDOW_RESIZEABLE, "vdemo");
+		    WINDOW_MAIN | WINDOW_DECORATED | WINDOW_RESIZEABLE | WINDOW_OPAQUE,
+		    "vdemo");
 		if (!main_window) {
 			printf("Cannot open main window.\n");
 			return 1;
@@ -155,6 +237,16 @@ int main(int argc, char *argv[])
 		    WINDOW_PLACEMENT_CENTER);
 
 		window_exec(main_window);
+		
+		if (benchmark) {
+			bench.window = main_window;
+			bench.label = lbl_action;
+			
+			fid_t fid = fibril_create(bench_fibril, &bench);
+			if (fid)
+				fibril_add_ready(fid);
+		}
+		
 		task_retval(0);
 		async_manager();
 		return 1;
@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup webbench
+ * @{
+ */
+/**
+ * @file Web server benchmark.
+ *
+ * Fetches one URI from a web server repeatedly, optionally over several
+ * concurrent and/or persistent connections, and reports the number of
+ * requests per second, the transfer rate and the request latency
+ * distribution.
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <http/errno.h>
+#include <http/http.h>
+#include <http/receive-buffer.h>
+#include <inet/endpoint.h>
+#include <inet/hostport.h>
+#include <inet/tcp.h>
+#include <macros.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <sys/time.h>
+
+#define NAME  "webbench"
+
+/** Default number of requests */
+#define DEFAULT_COUNT  100
+
+/** Maximum number of concurrent connections */
+#define CONC_MAX  64
+
+/** Size of receive buffer */
+#define RECV_BUF_SIZE  16384
+
+/** Maximum total size of response headers */
+#define HEADERS_SIZE_MAX  4096
+
+/** Maximum number of response headers */
+#define HEADERS_COUNT_MAX  32
+
+/** Benchmark client (one connection at a time) */
+typedef struct {
+	/** TCP connection */
+	tcp_conn_t *conn;
+	/** Buffer for receiving responses */
+	receive_buffer_t rbuf;
+	/** Buffer for receiving response body */
+	char *body;
+	/** Number of received bytes */
+	uint64_t nbytes;
+} webbench_client_t;
+
+static tcp_cb_t conn_cb = {
+	.connected = NULL
+};
+
+static tcp_t *tcp;
+static inet_ep2_t epp;
+static char *req;
+static bool keep_alive = false;
+
+/** Number of requests to perform */
+static unsigned long count;
+/** Number of requests started so far */
+static unsigned long started;
+/** Number of running client fibrils */
+static unsigned long running;
+/** First error encountered or EOK */
+static int result = EOK;
+/** Total number of received bytes */
+static uint64_t total_bytes = 0;
+/** Request latencies in microseconds */
+static useconds_t *latency;
+
+static FIBRIL_MUTEX_INITIALIZE(bench_lock);
+static FIBRIL_CONDVAR_INITIALIZE(bench_cv);
+
+static void print_syntax(void)
+{
+	printf("Syntax: %s [-n <count>] [-c <conc>] [-k] <host>:<port> "
+	    "[<uri>]\n", NAME);
+	printf("\t-n <count> Number of requests (default %d)\n",
+	    DEFAULT_COUNT);
+	printf("\t-c <conc>  Number of concurrent connections (default 1)\n");
+	printf("\t-k         Keep connections open between requests\n");
+}
+
+static ssize_t webbench_recv(void *arg, void *buf, size_t bsize)
+{
+	webbench_client_t *client = (webbench_client_t *) arg;
+	size_t nrecv;
+	int rc;
+
+	rc = tcp_conn_recv_wait(client->conn, buf, bsize, &nrecv);
+	if (rc != EOK)
+		return rc;
+
+	return nrecv;
+}
+
+/** Open connection to the server. */
+static int webbench_connect(webbench_client_t *client)
+{
+	int rc;
+
+	rc = tcp_conn_create(tcp, &epp, &conn_cb, NULL, &client->conn);
+	if (rc != EOK)
+		return rc;
+
+	rc = tcp_conn_wait_connected(client->conn);
+	if (rc != EOK) {
+		tcp_conn_destroy(client->conn);
+		client->conn = NULL;
+		return rc;
+	}
+
+	recv_reset(&client->rbuf);
+	return EOK;
+}
+
+/** Close connection to the server. */
+static void webbench_disconnect(webbench_client_t *client)
+{
+	tcp_conn_destroy(client->conn);
+	client->conn = NULL;
+}
+
+/** Receive one response with its body. */
+static int webbench_recv_response(webbench_client_t *client)
+{
+	http_response_t *resp = NULL;
+	char *value;
+	char *endptr;
+	uint64_t clen;
+	ssize_t nr;
+	int rc;
+
+	rc = http_receive_response(&client->rbuf, &resp, HEADERS_SIZE_MAX,
+	    HEADERS_COUNT_MAX);
+	if (rc != EOK)
+		return rc;
+
+	if (resp->status != 200) {
+		rc = EIO;
+		goto out;
+	}
+
+	rc = http_headers_get(&resp->headers, "Content-Length", &value);
+	if (rc != EOK)
+		goto out;
+
+	http_header_normalize_value(value);
+	clen = strtoul(value, &endptr, 10);
+	if (*endptr != '\0') {
+		rc = HTTP_EPARSE;
+		goto out;
+	}
+
+	while (clen > 0) {
+		nr = recv_buffer(&client->rbuf, client->body,
+		    min(clen, RECV_BUF_SIZE));
+		if (nr < 0) {
+			rc = nr;
+			goto out;
+		}
+
+		if (nr == 0) {
+			rc = EIO;
+			goto out;
+		}
+
+		clen -= nr;
+		client->nbytes += nr;
+	}
+
+	rc = EOK;
+out:
+	http_response_destroy(resp);
+	return rc;
+}
+
+/** Fetch URI once.
+ *
+ * Without keep-alive a new connection is opened for the request and
+ * the response is read until the server closes the connection.
+ *
+ * @param client Benchmark client
+ * @return EOK on success or negative error code
+ */
+static int webbench_fetch(webbench_client_t *client)
+{
+	size_t nrecv;
+	int rc;
+
+	if (client->conn == NULL) {
+		rc = webbench_connect(client);
+		if (rc != EOK)
+			return rc;
+	}
+
+	rc = tcp_conn_send(client->conn, req, str_size(req));
+	if (rc != EOK)
+		goto error;
+
+	if (keep_alive) {
+		rc = webbench_recv_response(client);
+		if (rc != EOK)
+			goto error;
+
+		return EOK;
+	}
+
+	/* Read until the server closes the connection */
+	while (true) {
+		rc = tcp_conn_recv_wait(client->conn, client->body,
+		    RECV_BUF_SIZE, &nrecv);
+		if (rc != EOK)
+			goto error;
+
+		if (nrecv == 0)
+			break;
+
+		client->nbytes += nrecv;
+	}
+
+	webbench_disconnect(client);
+	return EOK;
+error:
+	webbench_disconnect(client);
+	return rc;
+}
+
+/** Benchmark client fibril.
+ *
+ * Performs requests until the requested total count has been started.
+ */
+static int webbench_fibril(void *arg)
+{
+	webbench_client_t client;
+	struct timeval t0, t1;
+	unsigned long idx;
+	int rc;
+
+	(void) arg;
+
+	client.conn = NULL;
+	client.nbytes = 0;
+	client.body = malloc(RECV_BUF_SIZE);
+	if (client.body == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = recv_buffer_init(&client.rbuf, RECV_BUF_SIZE, webbench_recv,
+	    &client);
+	if (rc != EOK) {
+		free(client.body);
+		goto out;
+	}
+
+	while (true) {
+		fibril_mutex_lock(&bench_lock);
+		if (started >= count || result != EOK) {
+			fibril_mutex_unlock(&bench_lock);
+			break;
+		}
+
+		idx = started++;
+		fibril_mutex_unlock(&bench_lock);
+
+		getuptime(&t0);
+		rc = webbench_fetch(&client);
+		getuptime(&t1);
+
+		if (rc != EOK) {
+			printf("Request %lu failed (%s).\n", idx, str_error(rc));
+			break;
+		}
+
+		latency[idx] = tv_sub_diff(&t1, &t0);
+	}
+
+	if (client.conn != NULL)
+		webbench_disconnect(&client);
+
+	recv_buffer_fini(&client.rbuf);
+	free(client.body);
+out:
+	fibril_mutex_lock(&bench_lock);
+	if (rc != EOK && result == EOK)
+		result = rc;
+	total_bytes += client.nbytes;
+	running--;
+	fibril_condvar_broadcast(&bench_cv);
+	fibril_mutex_unlock(&bench_lock);
+
+	return EOK;
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+	useconds_t la = *(const useconds_t *) a;
+	useconds_t lb = *(const useconds_t *) b;
+
+	if (la < lb)
+		return -1;
+	if (la > lb)
+		return 1;
+	return 0;
+}
+
+/** Print latency percentile. */
+static void print_percentile(const char *label, unsigned pct)
+{
+	unsigned long idx = (count * pct + 99) / 100;
+
+	if (idx > 0)
+		idx--;
+
+	printf("  %s %lu.%03lu ms\n", label,
+	    (unsigned long) (latency[idx] / 1000),
+	    (unsigned long) (latency[idx] % 1000));
+}
+
+int main(int argc, char *argv[])
+{
+	struct timeval t0, t1;
+	const char *errmsg;
+	const char *uri;
+	char *endptr;
+	unsigned long conc;
+	unsigned long i;
+	useconds_t usec;
+	fid_t fid;
+	int rc;
+
+	count = DEFAULT_COUNT;
+	conc = 1;
+
+	argc--;
+	argv++;
+
+	while (argc > 0 && argv[0][0] == '-') {
+		if (str_cmp(argv[0], "-k") == 0) {
+			keep_alive = true;
+			argc--;
+			argv++;
+			continue;
+		}
+
+		if (argc < 2) {
+			print_syntax();
+			return 1;
+		}
+
+		if (str_cmp(argv[0], "-n") == 0) {
+			count = strtoul(argv[1], &endptr, 10);
+			if (*endptr != '\0' || count == 0) {
+				printf("Invalid request count '%s'.\n",
+				    argv[1]);
+				return 1;
+			}
+		} else if (str_cmp(argv[0], "-c") == 0) {
+			conc = strtoul(argv[1], &endptr, 10);
+			if (*endptr != '\0' || conc == 0 || conc > CONC_MAX) {
+				printf("Invalid concurrency '%s'.\n", argv[1]);
+				return 1;
+			}
+		} else {
+			print_syntax();
+			return 1;
+		}
+
+		argc -= 2;
+		argv += 2;
+	}
+
+	if (argc < 1 || argc > 2) {
+		print_syntax();
+		return 1;
+	}
+
+	uri = (argc == 2) ? argv[1] : "/";
+
+	inet_ep2_init(&epp);
+	rc = inet_hostport_plookup_one(argv[0], ip_any, &epp.remote, NULL,
+	    &errmsg);
+	if (rc != EOK) {
+		printf("Error: %s (host:port %s).\n", errmsg, argv[0]);
+		return 1;
+	}
+
+	if (keep_alive)
+		rc = asprintf(&req, "GET %s HTTP/1.1\r\n\r\n", uri);
+	else
+		rc = asprintf(&req, "GET %s HTTP/1.0\r\n\r\n", uri);
+	if (rc < 0) {
+		printf("Out of memory.\n");
+		return 1;
+	}
+
+	latency = calloc(count, sizeof(useconds_t));
+	if (latency == NULL) {
+		printf("Out of memory.\n");
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = tcp_create(&tcp);
+	if (rc != EOK) {
+		printf("Error initializing TCP.\n");
+		goto out;
+	}
+
+	getuptime(&t0);
+
+	fibril_mutex_lock(&bench_lock);
+
+	for (i = 0; i < conc; i++) {
+		fid = fibril_create(webbench_fibril, NULL);
+		if (fid == 0) {
+			printf("Out of memory.\n");
+			result = ENOMEM;
+			break;
+		}
+
+		running++;
+		fibril_add_ready(fid);
+	}
+
+	while (running > 0)
+		fibril_condvar_wait(&bench_cv, &bench_lock);
+
+	fibril_mutex_unlock(&bench_lock);
+
+	getuptime(&t1);
+
+	rc = result;
+	if (rc != EOK)
+		goto out;
+
+	usec = tv_sub_diff(&t1, &t0);
+	if (usec == 0)
+		usec = 1;
+
+	printf("%lu requests, %" PRIu64 " bytes in %lu.%03lu s\n", count,
+	    total_bytes, (unsigned long) (usec / 1000000),
+	    (unsigned long) (usec / 1000 % 1000));
+	printf("%" PRIu64 " requests/s, %" PRIu64 " KiB/s\n",
+	    (uint64_t) count * 1000000 / usec,
+	    total_bytes * 1000000 / usec / 1024);
+
+	qsort(latency, count, sizeof(useconds_t), latency_cmp);
+
+	printf("Latency:\n");
+	print_percentile("50%", 50);
+	print_percentile("90%", 90);
+	print_percentile("99%", 99);
+	print_percentile("max", 100);
+out:
+	tcp_destroy(tcp);
+	free(latency);
+	free(req);
+	return (rc == EOK) ? 0 : 1;
+}
+
+/** @}
+ */
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup websrv
+ * @{
+ */
+/**
+ * @file Static file cache.
+ *
+ * Small files are kept in memory together with their precomputed response
+ * headers so that serving them does not require any file system requests.
+ * Entries expire after a fixed time so that changes to the files are
+ * eventually picked up. When the cache is full, the least recently used
+ * entries are evicted.
+ */
+
+#include <adt/list.h>
+#include <assert.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <macros.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <vfs/vfs.h>
+
+#include "cache.h"
+
+/** Maximum size of a file that is cached */
+#define CACHE_FILE_MAX  (32 * 1024)
+
+/** Maximum total size of cached file data */
+#define CACHE_SIZE_MAX  (1024 * 1024)
+
+/** Time in seconds for which a cached file is used */
+#define CACHE_TTL_SEC  5
+
+/** Status line for cached responses */
+static const char *cache_status = "HTTP/1.1 200 OK\r\n";
+
+static FIBRIL_MUTEX_INITIALIZE(cache_lock);
+
+/** Cached files, most recently used first */
+static LIST_INITIALIZE(cache_list);
+
+/** Total size of cached file data */
+static size_t cache_size = 0;
+
+static void cache_entry_destroy(cache_entry_t *entry)
+{
+	free(entry->fname);
+	free(entry->hdr);
+	free(entry->data);
+	free(entry);
+}
+
+/** Remove entry from cache.
+ *
+ * The entry is freed once the last reference is dropped.
+ * Must be called with cache_lock held.
+ *
+ * @param entry Cache entry
+ */
+static void cache_evict(cache_entry_t *entry)
+{
+	assert(fibril_mutex_is_locked(&cache_lock));
+
+	list_remove(&entry->lcache);
+	cache_size -= entry->size;
+	entry->evicted = true;
+
+	if (entry->refcnt == 0)
+		cache_entry_destroy(entry);
+}
+
+/** Find file in cache and take a reference to it.
+ *
+ * Expired entries are evicted instead of being returned.
+ * Must be called with cache_lock held.
+ *
+ * @param fname Full path of the file
+ * @param now   Current time
+ *
+ * @return Cache entry or @c NULL if the file is not cached
+ */
+static cache_entry_t *cache_find(const char *fname, struct timeval *now)
+{
+	assert(fibril_mutex_is_locked(&cache_lock));
+
+	list_foreach(cache_list, lcache, cache_entry_t, entry) {
+		if (str_cmp(entry->fname, fname) != 0)
+			continue;
+
+		if (tv_gt(now, &entry->expires)) {
+			cache_evict(entry);
+			return NULL;
+		}
+
+		/* Move to the front of the LRU list */
+		list_remove(&entry->lcache);
+		list_prepend(&entry->lcache, &cache_list);
+
+		entry->refcnt++;
+		return entry;
+	}
+
+	return NULL;
+}
+
+/** Look up file in cache.
+ *
+ * @param fname  Full path of the file
+ * @param rentry Place to store pointer to the cache entry. The caller
+ *               must release it using cache_put().
+ *
+ * @return EOK on success, ENOENT if the file is not cached
+ */
+int cache_get(const char *fname, cache_entry_t **rentry)
+{
+	cache_entry_t *entry;
+	struct timeval now;
+
+	getuptime(&now);
+
+	fibril_mutex_lock(&cache_lock);
+	entry = cache_find(fname, &now);
+	fibril_mutex_unlock(&cache_lock);
+
+	if (entry == NULL)
+		return ENOENT;
+
+	*rentry = entry;
+	return EOK;
+}
+
+/** Read file into cache.
+ *
+ * @param fname  Full path of the file
+ * @param fd     Open file handle
+ * @param size   File size
+ * @param rentry Place to store pointer to the cache entry. The caller
+ *               must release it using cache_put().
+ *
+ * @return EOK on success, EINVAL if the file is too large to be cached,
+ *         ENOMEM if out of memory or EIO if reading the file failed
+ */
+int cache_load(const char *fname, int fd, aoff64_t size,
+    cache_entry_t **rentry)
+{
+	cache_entry_t *entry;
+	cache_entry_t *cached;
+	struct timeval now;
+	aoff64_t pos;
+	size_t nread;
+	ssize_t nr;
+	int rc;
+
+	if (size > CACHE_FILE_MAX)
+		return EINVAL;
+
+	entry = calloc(1, sizeof(cache_entry_t));
+	if (entry == NULL)
+		return ENOMEM;
+
+	link_initialize(&entry->lcache);
+	entry->size = size;
+
+	entry->fname = str_dup(fname);
+	entry->data = malloc(max(size, 1));
+	if (entry->fname == NULL || entry->data == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	rc = asprintf(&entry->hdr, "%sContent-Length: %zu\r\n", cache_status,
+	    entry->size);
+	if (rc < 0) {
+		entry->hdr = NULL;
+		rc = ENOMEM;
+		goto error;
+	}
+
+	entry->hdr_size = str_size(entry->hdr);
+
+	pos = 0;
+	nread = 0;
+	while (nread < entry->size) {
+		nr = vfs_read(fd, &pos, entry->data + nread,
+		    entry->size - nread);
+		if (nr <= 0) {
+			rc = EIO;
+			goto error;
+		}
+
+		nread += nr;
+	}
+
+	getuptime(&now);
+	entry->expires = now;
+	entry->expires.tv_sec += CACHE_TTL_SEC;
+	entry->refcnt = 1;
+
+	fibril_mutex_lock(&cache_lock);
+
+	/*
+	 * Another connection might have loaded the same file while we were
+	 * reading it. Use its entry so that the file is cached only once.
+	 */
+	cached = cache_find(fname, &now);
+	if (cached != NULL) {
+		fibril_mutex_unlock(&cache_lock);
+		cache_entry_destroy(entry);
+		*rentry = cached;
+		return EOK;
+	}
+
+	/* Make room by evicting least recently used files */
+	while (cache_size + entry->size > CACHE_SIZE_MAX &&
+	    !list_empty(&cache_list)) {
+		cache_evict(list_get_instance(list_last(&cache_list),
+		    cache_entry_t, lcache));
+	}
+
+	list_prepend(&entry->lcache, &cache_list);
+	cache_size += entry->size;
+
+	fibril_mutex_unlock(&cache_lock);
+
+	*rentry = entry;
+	return EOK;
+error:
+	cache_entry_destroy(entry);
+	return rc;
+}
+
+/** Release reference to cache entry.
+ *
+ * @param entry Cache entry
+ */
+void cache_put(cache_entry_t *entry)
+{
+	fibril_mutex_lock(&cache_lock);
+
+	assert(entry->refcnt > 0);
+	entry->refcnt--;
+
+	if (entry->refcnt == 0 && entry->evicted)
+		cache_entry_destroy(entry);
+
+	fibril_mutex_unlock(&cache_lock);
+}
+
+/** @}
+ */
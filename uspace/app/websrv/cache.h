@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup websrv
+ * @{
+ */
+/**
+ * @file Static file cache.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <adt/list.h>
+#include <offset.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+/** Cached file */
+typedef struct {
+	/** Link to list of cached files (in LRU order) */
+	link_t lcache;
+	/** Full path of the file */
+	char *fname;
+	/** Precomputed status line and entity headers */
+	char *hdr;
+	/** Size of @c hdr in bytes */
+	size_t hdr_size;
+	/** File contents */
+	void *data;
+	/** Size of @c data in bytes */
+	size_t size;
+	/** Time after which the entry must not be used */
+	struct timeval expires;
+	/** Number of references */
+	unsigned refcnt;
+	/** @c true if the entry has been evicted from the cache */
+	bool evicted;
+} cache_entry_t;
+
+extern int cache_get(const char *, cache_entry_t **);
+extern int cache_load(const char *, int, aoff64_t, cache_entry_t **);
+extern void cache_put(cache_entry_t *);
+
+#endif
+
+/** @}
+ */
@@ -48,19 +48,34 @@
 #include <inet/endpoint.h>
 #include <inet/tcp.h>
 
+#include <http/http.h>
+#include <http/errno.h>
+#include <http/receive-buffer.h>
+
 #include <arg_parse.h>
 #include <macros.h>
 #include <str.h>
 #include <str_error.h>
 
+#include "cache.h"
+
 #define NAME  "websrv"
 
 #define DEFAULT_PORT  8080
 
 #define WEB_ROOT  "/data/web"
 
-/** Buffer for receiving the request. */
-#define BUFFER_SIZE  1024
+/** Size of buffer for receiving requests. */
+#define BUFFER_SIZE  4096
+
+/** Maximum length of request line. */
+#define REQLINE_MAX  1024
+
+/** Maximum total size of request headers. */
+#define HEADERS_SIZE_MAX  4096
+
+/** Maximum number of request headers. */
+#define HEADERS_COUNT_MAX  32
 
 static void websrv_new_conn(tcp_listener_t *, tcp_conn_t *);
 
@@ -74,138 +89,130 @@ static tcp_cb_t conn_cb = {
 
 static uint16_t port = DEFAULT_PORT;
 
+/** Client connection */
 typedef struct {
 	tcp_conn_t *conn;
-
-	char rbuf[BUFFER_SIZE];
-	size_t rbuf_out;
-	size_t rbuf_in;
-
-	char lbuf[BUFFER_SIZE + 1];
-	size_t lbuf_used;
-} recv_t;
+	/** Buffer for receiving requests */
+	receive_buffer_t rbuf;
+	/** @c true if the client has closed its side of the connection */
+	bool eof;
+	/** Request line */
+	char reqline[REQLINE_MAX];
+} websrv_conn_t;
+
+/** Response with a fixed body */
+typedef struct {
+	/** Status line */
+	const char *status;
+	/** Response body */
+	const char *body;
+} websrv_msg_t;
 
 static bool verbose = false;
 
+/** Send files by copying them through a local buffer instead of sendfile */
+static bool copy_mode = false;
+
 /** Responses to send to client. */
 
-static const char *msg_ok =
-    "HTTP/1.0 200 OK\r\n"
-    "\r\n";
-
-static const char *msg_bad_request =
-    "HTTP/1.0 400 Bad Request\r\n"
-    "\r\n"
-    "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
-    "<html><head>\r\n"
-    "<title>400 Bad Request</title>\r\n"
-    "</head>\r\n"
-    "<body>\r\n"
-    "<h1>Bad Request</h1>\r\n"
-    "<p>The requested URL has bad syntax.</p>\r\n"
-    "</body>\r\n"
-    "</html>\r\n";
-
-static const char *msg_not_found =
-    "HTTP/1.0 404 Not Found\r\n"
-    "\r\n"
-    "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
-    "<html><head>\r\n"
-    "<title>404 Not Found</title>\r\n"
-    "</head>\r\n"
-    "<body>\r\n"
-    "<h1>Not Found</h1>\r\n"
-    "<p>The requested URL was not found on this server.</p>\r\n"
-    "</body>\r\n"
-    "</html>\r\n";
-
-static const char *msg_not_implemented =
-    "HTTP/1.0 501 Not Implemented\r\n"
-    "\r\n"
-    "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
-    "<html><head>\r\n"
-    "<title>501 Not Implemented</title>\r\n"
-    "</head>\r\n"
-    "<body>\r\n"
-    "<h1>Not Implemented</h1>\r\n"
-    "<p>The requested method is not implemented on this server.</p>\r\n"
-    "</body>\r\n"
-    "</html>\r\n";
-
-
-static int recv_create(tcp_conn_t *conn, recv_t **rrecv)
-{
-	recv_t *recv;
-	
-	recv = calloc(1, sizeof(recv_t));
-	if (recv == NULL)
-		return ENOMEM;
-	
-	recv->conn = conn;
-	recv->rbuf_out = 0;
-	recv->rbuf_in = 0;
-	recv->lbuf_used = 0;
-	
-	*rrecv = recv;
-	return EOK;
-}
+static const char *msg_ok = "HTTP/1.1 200 OK\r\n";
 
-static void recv_destroy(recv_t *recv)
-{
-	free(recv);
-}
+static const char *hdr_end = "\r\n";
 
-/** Receive one character (with buffering) */
-static int recv_char(recv_t *recv, char *c)
+static const char *hdr_end_close = "Connection: close\r\n\r\n";
+
+static websrv_msg_t msg_bad_request = {
+	.status = "HTTP/1.1 400 Bad Request\r\n",
+	.body =
+	    "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
+	    "<html><head>\r\n"
+	    "<title>400 Bad Request</title>\r\n"
+	    "</head>\r\n"
+	    "<body>\r\n"
+	    "<h1>Bad Request</h1>\r\n"
+	    "<p>The requested URL has bad syntax.</p>\r\n"
+	    "</body>\r\n"
+	    "</html>\r\n"
+};
+
+static websrv_msg_t msg_not_found = {
+	.status = "HTTP/1.1 404 Not Found\r\n",
+	.body =
+	    "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
+	    "<html><head>\r\n"
+	    "<title>404 Not Found</title>\r\n"
+	    "</head>\r\n"
+	    "<body>\r\n"
+	    "<h1>Not Found</h1>\r\n"
+	    "<p>The requested URL was not found on this server.</p>\r\n"
+	    "</body>\r\n"
+	    "</html>\r\n"
+};
+
+static websrv_msg_t msg_not_implemented = {
+	.status = "HTTP/1.1 501 Not Implemented\r\n",
+	.body =
+	    "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
+	    "<html><head>\r\n"
+	    "<title>501 Not Implemented</title>\r\n"
+	    "</head>\r\n"
+	    "<body>\r\n"
+	    "<h1>Not Implemented</h1>\r\n"
+	    "<p>The requested method is not implemented on this server.</p>\r\n"
+	    "</body>\r\n"
+	    "</html>\r\n"
+};
+
+/** Receive function for the request buffer */
+static ssize_t websrv_recv(void *arg, void *buf, size_t bsize)
 {
+	websrv_conn_t *wconn = (websrv_conn_t *) arg;
 	size_t nrecv;
 	int rc;
 	
-	if (recv->rbuf_out == recv->rbuf_in) {
-		recv->rbuf_out = 0;
-		recv->rbuf_in = 0;
-		
-		rc = tcp_conn_recv_wait(recv->conn, recv->rbuf, BUFFER_SIZE, &nrecv);
-		if (rc != EOK) {
-			fprintf(stderr, "tcp_conn_recv() failed (%d)\n", rc);
-			return rc;
-		}
-		
-		recv->rbuf_in = nrecv;
+	rc = tcp_conn_recv_wait(wconn->conn, buf, bsize, &nrecv);
+	if (rc != EOK) {
+		fprintf(stderr, "tcp_conn_recv() failed (%d)\n", rc);
+		return rc;
 	}
 	
-	*c = recv->rbuf[recv->rbuf_out++];
-	return EOK;
+	if (nrecv == 0)
+		wconn->eof = true;
+	
+	return nrecv;
 }
 
-/** Receive one line with length limit */
-static int recv_line(recv_t *recv, char **rbuf)
+static int websrv_conn_create(tcp_conn_t *conn, websrv_conn_t **rwconn)
 {
-	char *bp = recv->lbuf;
-	char c = '\0';
+	websrv_conn_t *wconn;
+	int rc;
 	
-	while (bp < recv->lbuf + BUFFER_SIZE) {
-		char prev = c;
-		int rc = recv_char(recv, &c);
-		
-		if (rc != EOK)
-			return rc;
-		
-		*bp++ = c;
-		if ((prev == '\r') && (c == '\n'))
-			break;
-	}
+	wconn = calloc(1, sizeof(websrv_conn_t));
+	if (wconn == NULL)
+		return ENOMEM;
 	
-	recv->lbuf_used = bp - recv->lbuf;
-	*bp = '\0';
+	wconn->conn = conn;
+	wconn->eof = false;
 	
-	if (bp == recv->lbuf + BUFFER_SIZE)
-		return ELIMIT;
+	rc = recv_buffer_init(&wconn->rbuf, BUFFER_SIZE, websrv_recv, wconn);
+	if (rc != EOK) {
+		free(wconn);
+		return rc;
+	}
 	
-	*rbuf = recv->lbuf;
+	*rwconn = wconn;
 	return EOK;
 }
 
+static void websrv_conn_destroy(websrv_conn_t *wconn)
+{
+	if (wconn == NULL)
+		return;
+	
+	recv_buffer_fini(&wconn->rbuf);
+	free(wconn);
+}
+
 static bool uri_is_valid(char *uri)
 {
 	if (uri[0] != '/')
@@ -225,35 +232,126 @@ static bool uri_is_valid(char *uri)
 	return true;
 }
 
-static int send_response(tcp_conn_t *conn, const char *msg)
+/** Send response with a fixed body. */
+static int send_response(tcp_conn_t *conn, websrv_msg_t *msg,
+    bool keep_alive)
 {
-	size_t response_size = str_size(msg);
+	tcp_iovec_t iov[4];
+	char clen[32];
+	int rc;
 	
 	if (verbose)
 	    fprintf(stderr, "Sending response\n");
 	
-	int rc = tcp_conn_send(conn, (void *) msg, response_size);
+	snprintf(clen, sizeof(clen), "Content-Length: %zu\r\n",
+	    str_size(msg->body));
+	
+	iov[0].data = msg->status;
+	iov[0].size = str_size(msg->status);
+	iov[1].data = clen;
+	iov[1].size = str_size(clen);
+	iov[2].data = keep_alive ? hdr_end : hdr_end_close;
+	iov[2].size = str_size(iov[2].data);
+	iov[3].data = msg->body;
+	iov[3].size = str_size(msg->body);
+	
+	rc = tcp_conn_sendv(conn, iov, 4);
 	if (rc != EOK) {
-		fprintf(stderr, "tcp_conn_send() failed\n");
+		fprintf(stderr, "tcp_conn_sendv() failed\n");
 		return rc;
 	}
 	
 	return EOK;
 }
 
-static int uri_get(const char *uri, tcp_conn_t *conn)
+/** Send file contents by reading them into a buffer. */
+static int send_file_copy(tcp_conn_t *conn, int fd)
 {
-	char *fbuf = NULL;
-	char *fname = NULL;
+	char *fbuf;
 	int rc;
-	int fd = -1;
 	
 	fbuf = calloc(BUFFER_SIZE, 1);
-	if (fbuf == NULL) {
-		rc = ENOMEM;
-		goto out;
+	if (fbuf == NULL)
+		return ENOMEM;
+	
+	aoff64_t pos = 0;
+	while (true) {
+		ssize_t nr = vfs_read(fd, &pos, fbuf, BUFFER_SIZE);
+		if (nr == 0)
+			break;
+		
+		if (nr < 0) {
+			rc = EIO;
+			goto out;
+		}
+		
+		rc = tcp_conn_send(conn, fbuf, nr);
+		if (rc != EOK) {
+			fprintf(stderr, "tcp_conn_send() failed\n");
+			goto out;
+		}
 	}
 	
+	rc = EOK;
+out:
+	free(fbuf);
+	return rc;
+}
+
+/** Send file contents by passing the file to the TCP service. */
+static int send_file(tcp_conn_t *conn, int fd, aoff64_t size)
+{
+	aoff64_t nsent;
+	int rc;
+	
+	if (copy_mode)
+		return send_file_copy(conn, fd);
+	
+	rc = tcp_conn_sendfile(conn, fd, 0, size, &nsent);
+	if (rc != EOK) {
+		fprintf(stderr, "tcp_conn_sendfile() failed\n");
+		return rc;
+	}
+	
+	if (nsent != size)
+		return EIO;
+	
+	return EOK;
+}
+
+/** Send file from cache. */
+static int send_cached(tcp_conn_t *conn, cache_entry_t *entry,
+    bool keep_alive)
+{
+	tcp_iovec_t iov[3];
+	int rc;
+	
+	iov[0].data = entry->hdr;
+	iov[0].size = entry->hdr_size;
+	iov[1].data = keep_alive ? hdr_end : hdr_end_close;
+	iov[1].size = str_size(iov[1].data);
+	iov[2].data = entry->data;
+	iov[2].size = entry->size;
+	
+	rc = tcp_conn_sendv(conn, iov, 3);
+	if (rc != EOK) {
+		fprintf(stderr, "tcp_conn_sendv() failed\n");
+		return rc;
+	}
+	
+	return EOK;
+}
+
+static int uri_get(const char *uri, tcp_conn_t *conn, bool keep_alive)
+{
+	cache_entry_t *entry;
+	char *fname = NULL;
+	char *clen = NULL;
+	tcp_iovec_t hdr[3];
+	struct stat st;
+	int rc;
+	int fd = -1;
+	
 	if (str_cmp(uri, "/") == 0)
 		uri = "/index.html";
 	
@@ -263,81 +361,154 @@ static int uri_get(const char *uri, tcp_conn_t *conn)
 		goto out;
 	}
 	
+	if (!copy_mode && cache_get(fname, &entry) == EOK) {
+		rc = send_cached(conn, entry, keep_alive);
+		cache_put(entry);
+		goto out;
+	}
+	
 	fd = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ);
 	if (fd < 0) {
-		rc = send_response(conn, msg_not_found);
+		rc = send_response(conn, &msg_not_found, keep_alive);
 		goto out;
 	}
 	
-	free(fname);
-	fname = NULL;
-	
-	rc = send_response(conn, msg_ok);
+	rc = vfs_stat(fd, &st);
 	if (rc != EOK)
 		goto out;
 	
-	aoff64_t pos = 0;
-	while (true) {
-		ssize_t nr = vfs_read(fd, &pos, fbuf, BUFFER_SIZE);
-		if (nr == 0)
-			break;
-		
-		if (nr < 0) {
-			rc = EIO;
-			goto out;
-		}
-		
-		rc = tcp_conn_send(conn, fbuf, nr);
-		if (rc != EOK) {
-			fprintf(stderr, "tcp_conn_send() failed\n");
-			goto out;
-		}
+	if (!copy_mode && cache_load(fname, fd, st.size, &entry) == EOK) {
+		rc = send_cached(conn, entry, keep_alive);
+		cache_put(entry);
+		goto out;
 	}
 	
-	rc = EOK;
+	rc = asprintf(&clen, "Content-Length: %" PRIu64 "\r\n", st.size);
+	if (rc < 0) {
+		rc = ENOMEM;
+		goto out;
+	}
+	
+	/* Status line and headers go out together in one request */
+	hdr[0].data = msg_ok;
+	hdr[0].size = str_size(msg_ok);
+	hdr[1].data = clen;
+	hdr[1].size = str_size(clen);
+	hdr[2].data = keep_alive ? hdr_end : hdr_end_close;
+	hdr[2].size = str_size(hdr[2].data);
+	
+	if (verbose)
+		fprintf(stderr, "Sending response\n");
+	
+	rc = tcp_conn_sendv(conn, hdr, 3);
+	if (rc != EOK) {
+		fprintf(stderr, "tcp_conn_sendv() failed\n");
+		goto out;
+	}
+	
+	rc = send_file(conn, fd, st.size);
 out:
 	if (fd >= 0)
 		vfs_put(fd);
 	free(fname);
-	free(fbuf);
+	free(clen);
 	return rc;
 }
 
-static int req_process(tcp_conn_t *conn, recv_t *recv)
+/** Determine whether connection should be kept open after the response.
+ *
+ * HTTP/1.1 connections are persistent unless the client asks otherwise,
+ * HTTP/1.0 connections only if the client asks for it.
+ *
+ * @param version HTTP version string from the request line
+ * @param headers Request headers
+ * @return @c true if the connection should be kept open
+ */
+static bool req_keep_alive(const char *version, http_headers_t *headers)
 {
-	char *reqline = NULL;
+	char *value;
+	bool http11;
+	
+	http11 = str_cmp(version, "HTTP/1.1") == 0;
+	
+	if (http_headers_get(headers, "Connection", &value) != EOK)
+		return http11;
+	
+	http_header_normalize_value(value);
+	
+	if (str_casecmp(value, "close") == 0)
+		return false;
+	
+	if (str_casecmp(value, "keep-alive") == 0)
+		return true;
+	
+	return http11;
+}
 
-	int rc = recv_line(recv, &reqline);
-	if (rc != EOK) {
+/** Receive and process one request.
+ *
+ * @param wconn      Client connection
+ * @param keep_alive Place to store @c true if the connection should be
+ *                   kept open for further requests
+ * @return EOK on success or negative error code
+ */
+static int req_process(websrv_conn_t *wconn, bool *keep_alive)
+{
+	http_headers_t headers;
+	char *reqline = wconn->reqline;
+	char *version;
+	ssize_t nr;
+	int rc;
+	
+	*keep_alive = false;
+	http_headers_init(&headers);
+	
+	nr = recv_line(&wconn->rbuf, reqline, REQLINE_MAX);
+	if (nr == ELIMIT)
+		return send_response(wconn->conn, &msg_bad_request, false);
+	
+	if (nr < 0) {
 		fprintf(stderr, "recv_line() failed\n");
-		return rc;
+		return nr;
 	}
 	
 	if (verbose)
-		fprintf(stderr, "Request: %s", reqline);
+		fprintf(stderr, "Request: %s\n", reqline);
+	
+	rc = http_headers_receive(&wconn->rbuf, &headers, HEADERS_SIZE_MAX,
+	    HEADERS_COUNT_MAX);
+	if (rc == EOK && recv_eol(&wconn->rbuf) <= 0)
+		rc = HTTP_EPARSE;
+	
+	if (rc != EOK) {
+		rc = send_response(wconn->conn, &msg_bad_request, false);
+		goto out;
+	}
 	
 	if (str_lcmp(reqline, "GET ", 4) != 0) {
-		rc = send_response(conn, msg_not_implemented);
-		return rc;
+		rc = send_response(wconn->conn, &msg_not_implemented, false);
+		goto out;
 	}
 	
 	char *uri = reqline + 4;
-	char *end_uri = str_chr(uri, ' ');
-	if (end_uri == NULL) {
-		end_uri = reqline + str_size(reqline) - 2;
-		assert(*end_uri == '\r');
+	version = str_chr(uri, ' ');
+	if (version != NULL) {
+		*version++ = '\0';
+		*keep_alive = req_keep_alive(version, &headers);
 	}
 	
-	*end_uri = '\0';
 	if (verbose)
 		fprintf(stderr, "Requested URI: %s\n", uri);
 	
 	if (!uri_is_valid(uri)) {
-		rc = send_response(conn, msg_bad_request);
-		return rc;
+		rc = send_response(wconn->conn, &msg_bad_request, *keep_alive);
+		goto out;
 	}
 	
-	return uri_get(uri, conn);
+	rc = uri_get(uri, wconn->conn, *keep_alive);
+out:
+	http_headers_clear(&headers);
+	return rc;
 }
 
 static void usage(void)
@@ -347,6 +518,9 @@ static void usage(void)
 	    "Usage: " NAME " [options]\n"
 	    "\n"
 	    "Where options are:\n"
+	    "-c | --copy\n"
+	    "\tRead files into a buffer and send them (no sendfile).\n"
+	    "\n"
 	    "-p port_number | --port=port_number\n"
 	    "\tListening port (default " STRING(DEFAULT_PORT) ").\n"
 	    "\n"
@@ -362,6 +536,9 @@ static int parse_option(int argc, char *argv[], int *index)
 	int rc;
 	
 	switch (argv[*index][1]) {
+	case 'c':
+		copy_mode = true;
+		break;
 	case 'h':
 		usage();
 		exit(0);
@@ -378,7 +555,9 @@ static int parse_option(int argc, char *argv[], int *index)
 		break;
 	/* Long options with double dash */
 	case '-':
-		if (str_lcmp(argv[*index] + 2, "help", 5) == 0) {
+		if (str_cmp(argv[*index] + 2, "copy") == 0) {
+			copy_mode = true;
+		} else if (str_lcmp(argv[*index] + 2, "help", 5) == 0) {
 			usage();
 			exit(0);
 		} else if (str_lcmp(argv[*index] + 2, "port=", 5) == 0) {
@@ -405,23 +584,38 @@ static int parse_option(int argc, char *argv[], int *index)
 static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 {
 	int rc;
-	recv_t *recv = NULL;
+	websrv_conn_t *wconn = NULL;
+	bool keep_alive;
+	char c;
 	
 	if (verbose)
 		fprintf(stderr, "New connection, waiting for request\n");
 	
-	rc = recv_create(conn, &recv);
+	rc = websrv_conn_create(conn, &wconn);
 	if (rc != EOK) {
 		fprintf(stderr, "Out of memory.\n");
 		goto error;
 	}
 	
-	rc = req_process(conn, recv);
-	if (rc != EOK) {
-		fprintf(stderr, "Error processing request (%s)\n",
-		    str_error(rc));
-		goto error;
-	}
+	/*
+	 * Requests are processed as long as the client keeps the connection
+	 * open. Pipelined requests simply wait in the receive buffer.
+	 */
+	do {
+		rc = recv_char(&wconn->rbuf, &c, false);
+		if (rc != EOK) {
+			if (wconn->eof)
+				break;
+			goto error;
+		}
+		
+		rc = req_process(wconn, &keep_alive);
+		if (rc != EOK) {
+			fprintf(stderr, "Error processing request (%s)\n",
+			    str_error(rc));
+			goto error;
+		}
+	} while (keep_alive);
 	
 	rc = tcp_conn_send_fin(conn);
 	if (rc != EOK) {
@@ -429,14 +623,14 @@ static void websrv_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
 		goto error;
 	}
 
-	recv_destroy(recv);
+	websrv_conn_destroy(wconn);
 	return;
 error:
 	rc = tcp_conn_reset(conn);
 	if (rc != EOK)
 		fprintf(stderr, "Error resetting connection.\n");
 	
-	recv_destroy(recv);
+	websrv_conn_destroy(wconn);
 }
 
 int main(int argc, char *argv[])
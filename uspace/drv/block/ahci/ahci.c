@@ -32,6 +32,7 @@
 
 #include <as.h>
 #include <errno.h>
+#include <macros.h>
 #include <stdio.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -51,6 +52,15 @@
 #define HI(ptr) \
 	((uint32_t) (((uint64_t) ((uintptr_t) (ptr))) >> 32))
 
+/** Number of command slots of an AHCI port. */
+#define AHCI_MAX_SLOTS  32
+
+/** Size of command table of one slot (command FIS area and one PRD). */
+#define AHCI_CMD_TABLE_SIZE  256
+
+/** Maximal number of blocks transferred by one queued command. */
+#define AHCI_MAX_CMD_BLOCKS  128
+
 /** Interrupt pseudocode for a single port
  *
  * The interrupt handling works as follows:
@@ -113,11 +123,11 @@ static int get_num_blocks(ddf_fun_t *, uint64_t *);
 static int get_block_size(ddf_fun_t *, size_t *);
 static int read_blocks(ddf_fun_t *, uint64_t, size_t, void *);
 static int write_blocks(ddf_fun_t *, uint64_t, size_t, void *);
+static int get_queue_depth(ddf_fun_t *, size_t *);
 
 static int ahci_identify_device(sata_dev_t *);
 static int ahci_set_highest_ultra_dma_mode(sata_dev_t *);
-static int ahci_rb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
-static int ahci_wb_fpdma(sata_dev_t *, uintptr_t, uint64_t);
+static int ahci_rw_fpdma(sata_dev_t *, uint64_t, size_t, void *, bool);
 
 static void ahci_sata_devices_create(ahci_dev_t *, ddf_dev_t *);
 static ahci_dev_t *ahci_ahci_create(ddf_dev_t *);
@@ -139,7 +149,8 @@ static ahci_iface_t ahci_interface = {
 	.get_num_blocks = &get_num_blocks,
 	.get_block_size = &get_block_size,
 	.read_blocks = &read_blocks,
-	.write_blocks = &write_blocks
+	.write_blocks = &write_blocks,
+	.get_queue_depth = &get_queue_depth
 };
 
 static ddf_dev_ops_t ahci_ops = {
@@ -228,33 +239,7 @@ static int read_blocks(ddf_fun_t *fun, uint64_t blocknum,
     size_t count, void *buf)
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
-	
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	int rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate read buffer.");
-		return rc;
-	}
-	
-	memset(buf, 0, sata->block_size);
-	
-	fibril_mutex_lock(&sata->lock);
-	
-	for (size_t cur = 0; cur < count; cur++) {
-		rc = ahci_rb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-		
-		memcpy((void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    ibuf, sata->block_size);
-	}
-	
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-	
-	return rc;
+	return ahci_rw_fpdma(sata, blocknum, count, buf, false);
 }
 
 /** Write data blocks into SATA device.
@@ -271,30 +256,22 @@ static int write_blocks(ddf_fun_t *fun, uint64_t blocknum,
     size_t count, void *buf)
 {
 	sata_dev_t *sata = fun_sata_dev(fun);
-	
-	uintptr_t phys;
-	void *ibuf = AS_AREA_ANY;
-	int rc = dmamem_map_anonymous(sata->block_size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
-	if (rc != EOK) {
-		ddf_msg(LVL_ERROR, "Cannot allocate write buffer.");
-		return rc;
-	}
-	
-	fibril_mutex_lock(&sata->lock);
-	
-	for (size_t cur = 0; cur < count; cur++) {
-		memcpy(ibuf, (void *) (((uint8_t *) buf) + (sata->block_size * cur)),
-		    sata->block_size);
-		rc = ahci_wb_fpdma(sata, phys, blocknum + cur);
-		if (rc != EOK)
-			break;
-	}
-	
-	fibril_mutex_unlock(&sata->lock);
-	dmamem_unmap_anonymous(ibuf);
-	
-	return rc;
+	return ahci_rw_fpdma(sata, blocknum, count, buf, true);
+}
+
+/** Get number of commands the device can have outstanding.
+ *
+ * @param fun         Device function handling the call.
+ * @param queue_depth Queue depth.
+ *
+ * @return EOK.
+ *
+ */
+static int get_queue_depth(ddf_fun_t *fun, size_t *queue_depth)
+{
+	sata_dev_t *sata = fun_sata_dev(fun);
+	*queue_depth = sata->queue_depth;
+	return EOK;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -478,6 +455,9 @@ static int ahci_identify_device(sata_dev_t *sata)
 		goto error;
 	}
 	
+	/* Maximum queue depth minus one is reported in bits 4:0. */
+	sata->queue_depth = (idata->queue_depth & 0x1f) + 1;
+	
 	uint16_t logsec = idata->physical_logic_sector_size;
 	if ((logsec & 0xc000) == 0x4000) {
 		/* Length of sector may be larger than 512 B */
@@ -668,110 +648,89 @@ error:
 	return EINTR;
 }
 
-/** Set AHCI registers for reading one sector from the SATA device using FPDMA.
+/** Allocate a command slot for a queued command.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param sata SATA device structure.
+ * @param wait Wait until a slot is released if all are in use.
+ *
+ * @return Number of the slot or -1 if there is no slot available
+ *         or the device is invalid.
  *
  */
-static void ahci_rb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static int ahci_slot_get(sata_dev_t *sata, bool wait)
 {
-	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
-	
-	cmd->fis_type = SATA_CMD_FIS_TYPE;
-	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x60;
-	cmd->tag = 0;
-	cmd->control = 0;
+	uint32_t mask = (sata->queue_depth >= AHCI_MAX_SLOTS) ? 0xffffffff :
+	    ((1U << sata->queue_depth) - 1);
 	
-	cmd->reserved1 = 0;
-	cmd->reserved2 = 0;
-	cmd->reserved3 = 0;
-	cmd->reserved4 = 0;
-	cmd->reserved5 = 0;
-	cmd->reserved6 = 0;
-	
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
-	
-	cmd->lba0 = blocknum & 0xff;
-	cmd->lba1 = (blocknum >> 8) & 0xff;
-	cmd->lba2 = (blocknum >> 16) & 0xff;
-	cmd->lba3 = (blocknum >> 24) & 0xff;
-	cmd->lba4 = (blocknum >> 32) & 0xff;
-	cmd->lba5 = (blocknum >> 40) & 0xff;
-	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
-	
-	prdt->data_address_low = LO(phys);
-	prdt->data_address_upper = HI(phys);
-	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
-	prdt->reserved2 = 0;
-	prdt->ioc = 0;
+	fibril_mutex_lock(&sata->event_lock);
 	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	while (!sata->is_invalid_device) {
+		uint32_t free = ~sata->slots_alloc & mask;
+		if (free != 0) {
+			int slot = __builtin_ctz(free);
+			sata->slots_alloc |= 1U << slot;
+			fibril_mutex_unlock(&sata->event_lock);
+			return slot;
+		}
+		
+		if (!wait)
+			break;
+		
+		fibril_condvar_wait(&sata->slot_condvar, &sata->event_lock);
+	}
 	
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	fibril_mutex_unlock(&sata->event_lock);
+	return -1;
 }
 
-/** Read one sector from the SATA device using FPDMA.
+/** Wait for completion of queued commands and release their slots.
  *
- * @param sata     SATA device structure.
- * @param phys     Physical address of buffer for sector data.
- * @param blocknum Block number to read.
+ * @param sata  SATA device structure.
+ * @param slots Mask of the command slots.
  *
- * @return EOK if succeed, error code otherwise
+ * @return EOK if all commands succeeded, EINTR otherwise.
  *
  */
-static int ahci_rb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static int ahci_slots_wait(sata_dev_t *sata, uint32_t slots)
 {
-	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA read from invalid device", sata->model);
-		return EINTR;
-	}
+	fibril_mutex_lock(&sata->event_lock);
 	
-	ahci_rb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	while ((sata->slots_issued & slots) != 0)
+		fibril_condvar_wait(&sata->event_condvar, &sata->event_lock);
 	
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA read", sata->model);
-		return EINTR;
-	}
+	int rc = ((sata->slots_failed & slots) != 0) ? EINTR : EOK;
 	
-	return EOK;
+	sata->slots_failed &= ~slots;
+	sata->slots_alloc &= ~slots;
+	fibril_condvar_broadcast(&sata->slot_condvar);
+	
+	fibril_mutex_unlock(&sata->event_lock);
+	
+	return rc;
 }
 
-/** Set AHCI registers for writing one sector to the SATA device, use FPDMA.
+/** Set AHCI registers for a queued FPDMA transfer and issue the command.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical address of buffer with sector data.
- * @param blocknum Block number to write.
- *
- * @return EOK if succeed, error code otherwise
+ * @param slot     Command slot, also used as the NCQ tag.
+ * @param phys     Physical address of buffer for sector data.
+ * @param blocknum First block to transfer.
+ * @param count    Number of blocks to transfer.
+ * @param write    Write data to the device instead of reading.
  *
  */
-static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
-    uint64_t blocknum)
+static void ahci_fpdma_cmd(sata_dev_t *sata, unsigned int slot,
+    uintptr_t phys, uint64_t blocknum, size_t count, bool write)
 {
+	volatile uint32_t *table =
+	    sata->cmd_table + slot * AHCI_CMD_TABLE_SIZE / sizeof(uint32_t);
 	volatile sata_ncq_command_frame_t *cmd =
-	    (sata_ncq_command_frame_t *) sata->cmd_table;
+	    (sata_ncq_command_frame_t *) table;
 	
 	cmd->fis_type = SATA_CMD_FIS_TYPE;
 	cmd->c = SATA_CMD_FIS_COMMAND_INDICATOR;
-	cmd->command = 0x61;
-	cmd->tag = 0;
+	cmd->command = write ? 0x61 : 0x60;
+	cmd->tag = slot << 3;
 	cmd->control = 0;
 	
 	cmd->reserved1 = 0;
@@ -781,8 +740,8 @@ static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->reserved5 = 0;
 	cmd->reserved6 = 0;
 	
-	cmd->sector_count_low = 1;
-	cmd->sector_count_high = 0;
+	cmd->sector_count_low = count & 0xff;
+	cmd->sector_count_high = (count >> 8) & 0xff;
 	
 	cmd->lba0 = blocknum & 0xff;
 	cmd->lba1 = (blocknum >> 8) & 0xff;
@@ -791,54 +750,128 @@ static void ahci_wb_fpdma_cmd(sata_dev_t *sata, uintptr_t phys,
 	cmd->lba4 = (blocknum >> 32) & 0xff;
 	cmd->lba5 = (blocknum >> 40) & 0xff;
 	
-	volatile ahci_cmd_prdt_t *prdt =
-	    (ahci_cmd_prdt_t *) (&sata->cmd_table[0x20]);
+	volatile ahci_cmd_prdt_t *prdt = (ahci_cmd_prdt_t *) (&table[0x20]);
 	
 	prdt->data_address_low = LO(phys);
 	prdt->data_address_upper = HI(phys);
 	prdt->reserved1 = 0;
-	prdt->dbc = sata->block_size - 1;
+	prdt->dbc = count * sata->block_size - 1;
 	prdt->reserved2 = 0;
 	prdt->ioc = 0;
 	
-	sata->cmd_header->prdtl = 1;
-	sata->cmd_header->flags =
-	    AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
-	    AHCI_CMDHDR_FLAGS_WRITE |
+	volatile ahci_cmdhdr_t *hdr = &sata->cmd_header[slot];
+	
+	hdr->prdtl = 1;
+	hdr->flags = AHCI_CMDHDR_FLAGS_CLEAR_BUSY_UPON_OK |
 	    AHCI_CMDHDR_FLAGS_5DWCMD;
-	sata->cmd_header->bytesprocessed = 0;
+	if (write)
+		hdr->flags |= AHCI_CMDHDR_FLAGS_WRITE;
+	hdr->bytesprocessed = 0;
 	
-	sata->port->pxsact |= 1;
-	sata->port->pxci |= 1;
+	/*
+	 * Mark the slot as issued before the device can complete it,
+	 * the interrupt handler clears it under the same lock.
+	 */
+	fibril_mutex_lock(&sata->event_lock);
+	sata->slots_issued |= 1U << slot;
+	sata->port->pxsact = 1U << slot;
+	sata->port->pxci = 1U << slot;
+	fibril_mutex_unlock(&sata->event_lock);
 }
 
-/** Write one sector into the SATA device, use FPDMA.
+/** Transfer blocks using queued FPDMA commands.
+ *
+ * The transfer is split into commands of at most AHCI_MAX_CMD_BLOCKS
+ * blocks which are issued in as many command slots as available, so that
+ * the device can work on up to queue depth commands at once. Requests
+ * of other fibrils share the slots.
  *
  * @param sata     SATA device structure.
- * @param phys     Physical addres of buffer with sector data.
- * @param blocknum Block number to write.
+ * @param blocknum Number of first block.
+ * @param count    Number of blocks to transfer.
+ * @param buf      Buffer for data.
+ * @param write    Write data to the device instead of reading.
  *
  * @return EOK if succeed, error code otherwise
  *
  */
-static int ahci_wb_fpdma(sata_dev_t *sata, uintptr_t phys, uint64_t blocknum)
+static int ahci_rw_fpdma(sata_dev_t *sata, uint64_t blocknum, size_t count,
+    void *buf, bool write)
 {
 	if (sata->is_invalid_device) {
-		ddf_msg(LVL_ERROR,
-		    "%s: FPDMA write to invalid device", sata->model);
+		ddf_msg(LVL_ERROR, "%s: FPDMA %s invalid device", sata->model,
+		    write ? "write to" : "read from");
 		return EINTR;
 	}
 	
-	ahci_wb_fpdma_cmd(sata, phys, blocknum);
-	ahci_port_is_t pxis = ahci_wait_event(sata);
+	if (count == 0)
+		return EOK;
 	
-	if ((sata->is_invalid_device) || (ahci_port_is_error(pxis))) {
-		ddf_msg(LVL_ERROR,
-		    "%s: Unrecoverable error during FPDMA write", sata->model);
-		return EINTR;
+	size_t window = min(count, AHCI_MAX_CMD_BLOCKS * sata->queue_depth);
+	
+	uintptr_t phys;
+	void *ibuf = AS_AREA_ANY;
+	int rc = dmamem_map_anonymous(window * sata->block_size, DMAMEM_4GiB,
+	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &ibuf);
+	if (rc != EOK) {
+		ddf_msg(LVL_ERROR, "Cannot allocate %s buffer.",
+		    write ? "write" : "read");
+		return rc;
 	}
 	
-	return EOK;
+	for (size_t done = 0; done < count; ) {
+		size_t cnt = min(count - done, window);
+		uint8_t *data = (uint8_t *) buf + done * sata->block_size;
+		
+		if (write)
+			memcpy(ibuf, data, cnt * sata->block_size);
+		
+		size_t next = 0;
+		while (next < cnt) {
+			uint32_t slots = 0;
+			
+			/*
+			 * Issue as many commands as there are free slots. Block
+			 * only while holding no slot, otherwise two requests
+			 * could wait for each other's slots.
+			 */
+			while (next < cnt) {
+				int slot = ahci_slot_get(sata, slots == 0);
+				if (slot < 0)
+					break;
+				
+				size_t n = min(cnt - next, AHCI_MAX_CMD_BLOCKS);
+				ahci_fpdma_cmd(sata, slot,
+				    phys + next * sata->block_size,
+				    blocknum + done + next, n, write);
+				slots |= 1U << slot;
+				next += n;
+			}
+			
+			if (slots == 0) {
+				rc = EINTR;
+				break;
+			}
+			
+			rc = ahci_slots_wait(sata, slots);
+			if (rc != EOK)
+				break;
+		}
+		
+		if (rc != EOK) {
+			ddf_msg(LVL_ERROR, "%s: Unrecoverable error during FPDMA %s",
+			    sata->model, write ? "write" : "read");
+			break;
+		}
+		
+		if (!write)
+			memcpy(data, ibuf, cnt * sata->block_size);
+		
+		done += cnt;
+	}
+	
+	dmamem_unmap_anonymous(ibuf);
+	return rc;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -913,7 +946,26 @@ static void ahci_interrupt(ipc_callid_t iid, ipc_call_t *icall, ddf_dev_t *dev)
 		fibril_mutex_lock(&sata->event_lock);
 		
 		sata->event_pxis = pxis;
-		fibril_condvar_signal(&sata->event_condvar);
+		
+		/*
+		 * Match completed queued commands by their tags. A command
+		 * is complete once the device cleared its bit in PxSACT.
+		 * An error fails all outstanding commands.
+		 */
+		if (sata->slots_issued != 0) {
+			if (ahci_port_is_error(pxis)) {
+				if (ahci_port_is_permanent_error(pxis))
+					sata->is_invalid_device = true;
+				
+				sata->slots_failed |= sata->slots_issued;
+				sata->slots_issued = 0;
+			} else {
+				sata->slots_issued &=
+				    sata->port->pxsact | sata->port->pxci;
+			}
+		}
+		
+		fibril_condvar_broadcast(&sata->event_condvar);
 		
 		fibril_mutex_unlock(&sata->event_lock);
 	}
@@ -969,15 +1021,18 @@ static sata_dev_t *ahci_sata_allocate(ahci_dev_t *ahci, volatile ahci_port_t *po
 	sata->port->pxclb = LO(phys);
 	sata->cmd_header = (ahci_cmdhdr_t *) virt_cmd;
 	
-	/* Allocate and init command table structure. */
-	rc = dmamem_map_anonymous(size, DMAMEM_4GiB,
-	    AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
+	/* Allocate and init command tables of all command slots. */
+	rc = dmamem_map_anonymous(AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE,
+	    DMAMEM_4GiB, AS_AREA_READ | AS_AREA_WRITE, 0, &phys, &virt_table);
 	if (rc != EOK)
 		goto error_table;
 	
-	memset(virt_table, 0, size);
-	sata->cmd_header->cmdtableu = HI(phys);
-	sata->cmd_header->cmdtable = LO(phys);
+	memset(virt_table, 0, AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE);
+	for (unsigned int slot = 0; slot < AHCI_MAX_SLOTS; slot++) {
+		uintptr_t table = phys + slot * AHCI_CMD_TABLE_SIZE;
+		sata->cmd_header[slot].cmdtableu = HI(table);
+		sata->cmd_header[slot].cmdtable = LO(table);
+	}
 	sata->cmd_table = (uint32_t*) virt_table;
 	
 	return sata;
@@ -1057,6 +1112,7 @@ static int ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	fibril_mutex_initialize(&sata->lock);
 	fibril_mutex_initialize(&sata->event_lock);
 	fibril_condvar_initialize(&sata->event_condvar);
+	fibril_condvar_initialize(&sata->slot_condvar);
 	
 	ahci_sata_hw_start(sata);
 	
@@ -1064,6 +1120,17 @@ static int ahci_sata_create(ahci_dev_t *ahci, ddf_dev_t *dev,
 	if (ahci_identify_device(sata) != EOK)
 		goto error;
 	
+	/* Use as many command slots as both the HBA and the device allow. */
+	ahci_ghc_cap_t cap;
+	cap.u32 = ahci->memregs->ghc.cap;
+	if (cap.sncq)
+		sata->queue_depth = min(sata->queue_depth, cap.ncs + 1U);
+	else
+		sata->queue_depth = 1;
+	
+	ddf_msg(LVL_NOTE, "%s: NCQ queue depth %u", sata->model,
+	    sata->queue_depth);
+	
 	/* Set required UDMA mode */
 	if (ahci_set_highest_ultra_dma_mode(sata) != EOK)
 		goto error;
@@ -75,13 +75,13 @@ typedef struct {
 	/** Pointer to command header. */
 	volatile ahci_cmdhdr_t *cmd_header;
 	
-	/** Pointer to command table. */
+	/** Pointer to command table of the first command slot. */
 	volatile uint32_t *cmd_table;
 	
-	/** Mutex for single operation on device. */
+	/** Mutex for single non-queued operation on device. */
 	fibril_mutex_t lock;
 	
-	/** Mutex for event signaling condition variable. */
+	/** Mutex for event signaling condition variable and command slots. */
 	fibril_mutex_t event_lock;
 	
 	/** Event signaling condition variable. */
@@ -90,6 +90,21 @@ typedef struct {
 	/** Event interrupt state. */
 	ahci_port_is_t event_pxis;
 	
+	/** Number of command slots used for queued commands. */
+	unsigned int queue_depth;
+	
+	/** Command slots owned by a request. */
+	uint32_t slots_alloc;
+	
+	/** Command slots issued to the device and not completed yet. */
+	uint32_t slots_issued;
+	
+	/** Command slots which completed with an error. */
+	uint32_t slots_failed;
+	
+	/** Signalled when command slots are released. */
+	fibril_condvar_t slot_condvar;
+	
 	/** Number of device data blocks. */
 	uint64_t blocks;
 	
@@ -73,29 +73,6 @@ static const visualizer_ops_t amdm37x_dispc_vis_ops = {
 	.wakeup = dummy,
 };
 
-static const struct {
-	unsigned bpp;
-	pixel2visual_t func;
-} pixel2visual_table[] = {
-	[VISUAL_INDIRECT_8] = { .bpp = 1, .func = pixel2bgr_323 },
-	[VISUAL_RGB_5_5_5_LE] = { .bpp = 2, .func = pixel2rgb_555_le },
-	[VISUAL_RGB_5_5_5_BE] = { .bpp = 2, .func = pixel2rgb_555_be },
-	[VISUAL_RGB_5_6_5_LE] = { .bpp = 2, .func = pixel2rgb_565_le },
-	[VISUAL_RGB_5_6_5_BE] = { .bpp = 2, .func = pixel2rgb_565_be },
-	[VISUAL_BGR_8_8_8] = { .bpp = 3, .func = pixel2bgr_888 },
-	[VISUAL_RGB_8_8_8] = { .bpp = 3, .func = pixel2rgb_888 },
-	[VISUAL_BGR_0_8_8_8] = { .bpp = 4, .func = pixel2rgb_0888 },
-	[VISUAL_BGR_8_8_8_0] = { .bpp = 4, .func = pixel2bgr_8880 },
-	[VISUAL_ABGR_8_8_8_8] = { .bpp = 4, .func = pixel2abgr_8888 },
-	[VISUAL_BGRA_8_8_8_8] = { .bpp = 4, .func = pixel2bgra_8888 },
-	[VISUAL_RGB_0_8_8_8] = { .bpp = 4, .func = pixel2rgb_0888 },
-	[VISUAL_RGB_8_8_8_0] = { .bpp = 4, .func = pixel2rgb_8880 },
-	[VISUAL_ARGB_8_8_8_8] = { .bpp = 4, .func = pixel2argb_8888 },
-	[VISUAL_RGBA_8_8_8_8] = { .bpp = 4, .func = pixel2rgba_8888 },
-};
-
-
-
 static void mode_init(vslmode_list_element_t *mode,
     unsigned width, unsigned height, visual_t visual)
 {
@@ -266,9 +243,9 @@ static int change_mode(visualizer_t *vis, vslmode_t mode)
 
 	amdm37x_dispc_t *dispc = vis->dev_ctx;
 	const visual_t visual = mode.cell_visual.pixel_visual;
-	assert((size_t)visual < sizeof(pixel2visual_table) / sizeof(pixel2visual_table[0]));
-	const unsigned bpp = pixel2visual_table[visual].bpp;
-	pixel2visual_t p2v = pixel2visual_table[visual].func;
+	const pixconv_t *conv = pixconv_get(visual);
+	assert(conv);
+	const unsigned bpp = conv->pixel_bytes;
 	const unsigned x = mode.screen_width;
 	const unsigned y = mode.screen_height;
 	ddf_log_note("Setting mode: %ux%ux%u\n", x, y, bpp*8);
@@ -291,7 +268,7 @@ static int change_mode(visualizer_t *vis, vslmode_t mode)
 	dispc->active_fb.height = y;
 	dispc->active_fb.pitch = 0;
 	dispc->active_fb.bpp = bpp;
-	dispc->active_fb.pixel2visual = p2v;
+	dispc->active_fb.conv = conv;
 	dispc->size = size;
 	assert(mode.index < 1);
 
@@ -312,17 +289,13 @@ static int handle_damage(visualizer_t *vs,
 	    * dispc->active_fb.bpp)
 	if (x_offset == 0 && y_offset == 0) {
 		/* Faster damage routine ignoring offsets. */
-		for (sysarg_t y = y0; y < height + y0; ++y) {
-			pixel_t *pixel = pixelmap_pixel_at(map, x0, y);
-			for (sysarg_t x = x0; x < width + x0; ++x) {
-				dispc->active_fb.pixel2visual(
-				    dispc->fb_data + FB_POS(x, y), *pixel++);
-			}
-		}
+		pixconv_rect(dispc->active_fb.conv, dispc->fb_data + FB_POS(x0, y0),
+		    FB_POS(0, 1), pixelmap_pixel_at(map, x0, y0), map->width,
+		    width, height);
 	} else {
 		for (sysarg_t y = y0; y < height + y0; ++y) {
 			for (sysarg_t x = x0; x < width + x0; ++x) {
-				dispc->active_fb.pixel2visual(
+				dispc->active_fb.conv->pixel2visual(
 				    dispc->fb_data + FB_POS(x, y),
 				    *pixelmap_pixel_at(map,
 				        (x + x_offset) % map->width,
@@ -47,7 +47,7 @@ typedef struct {
 	amdm37x_dispc_regs_t *regs;
 
 	struct {
-		pixel2visual_t pixel2visual;
+		const pixconv_t *conv;
 		unsigned width;
 		unsigned height;
 		unsigned pitch;
@@ -45,6 +45,7 @@
 #include <mem.h>
 #include <as.h>
 #include <align.h>
+#include <macros.h>
 
 #include <sysinfo.h>
 #include <ddi.h>
@@ -72,9 +73,7 @@ typedef struct {
 	size_t scanline;
 	visual_t visual;
 	
-	pixel2visual_t pixel2visual;
-	visual2pixel_t visual2pixel;
-	visual_mask_t visual_mask;
+	const pixconv_t *conv;
 	size_t pixel_bytes;
 	
 	size_t size;
@@ -116,19 +115,24 @@ static int kfb_handle_damage_pixels(visualizer_t *vs,
 
 	if (x_offset == 0 && y_offset == 0) {
 		/* Faster damage routine ignoring offsets. */
-		for (sysarg_t y = y0; y < height + y0; ++y) {
-			pixel_t *pixel = pixelmap_pixel_at(map, x0, y);
-			for (sysarg_t x = x0; x < width + x0; ++x) {
-				kfb.pixel2visual(kfb.addr + FB_POS(x, y), *pixel++);
-			}
-		}
+		pixconv_rect(kfb.conv, kfb.addr + FB_POS(x0, y0), kfb.scanline,
+		    pixelmap_pixel_at(map, x0, y0), map->width, width, height);
 	} else {
+		/*
+		 * Convert the source rows in spans which do not wrap
+		 * around the right edge of the pixel map.
+		 */
 		for (sysarg_t y = y0; y < height + y0; ++y) {
-			for (sysarg_t x = x0; x < width + x0; ++x) {
-				kfb.pixel2visual(kfb.addr + FB_POS(x, y),
-				    *pixelmap_pixel_at(map,
-				    (x + x_offset) % map->width,
-				    (y + y_offset) % map->height));
+			sysarg_t sy = (y + y_offset) % map->height;
+			sysarg_t x = x0;
+			
+			while (x < width + x0) {
+				sysarg_t sx = (x + x_offset) % map->width;
+				sysarg_t count = min(width + x0 - x, map->width - sx);
+				
+				kfb.conv->pixel2visual_row(kfb.addr + FB_POS(x, y),
+				    pixelmap_pixel_at(map, sx, sy), count);
+				x += count;
 			}
 		}
 	}
@@ -231,76 +235,11 @@ int port_init(ddf_dev_t *dev)
 	kfb.scanline = scanline;
 	kfb.visual = visual;
 
-	switch (visual) {
-	case VISUAL_INDIRECT_8:
-		kfb.pixel2visual = pixel2bgr_323;
-		kfb.visual2pixel = bgr_323_2pixel;
-		kfb.visual_mask = visual_mask_323;
-		kfb.pixel_bytes = 1;
-		break;
-	case VISUAL_RGB_5_5_5_LE:
-		kfb.pixel2visual = pixel2rgb_555_le;
-		kfb.visual2pixel = rgb_555_le_2pixel;
-		kfb.visual_mask = visual_mask_555;
-		kfb.pixel_bytes = 2;
-		break;
-	case VISUAL_RGB_5_5_5_BE:
-		kfb.pixel2visual = pixel2rgb_555_be;
-		kfb.visual2pixel = rgb_555_be_2pixel;
-		kfb.visual_mask = visual_mask_555;
-		kfb.pixel_bytes = 2;
-		break;
-	case VISUAL_RGB_5_6_5_LE:
-		kfb.pixel2visual = pixel2rgb_565_le;
-		kfb.visual2pixel = rgb_565_le_2pixel;
-		kfb.visual_mask = visual_mask_565;
-		kfb.pixel_bytes = 2;
-		break;
-	case VISUAL_RGB_5_6_5_BE:
-		kfb.pixel2visual = pixel2rgb_565_be;
-		kfb.visual2pixel = rgb_565_be_2pixel;
-		kfb.visual_mask = visual_mask_565;
-		kfb.pixel_bytes = 2;
-		break;
-	case VISUAL_RGB_8_8_8:
-		kfb.pixel2visual = pixel2rgb_888;
-		kfb.visual2pixel = rgb_888_2pixel;
-		kfb.visual_mask = visual_mask_888;
-		kfb.pixel_bytes = 3;
-		break;
-	case VISUAL_BGR_8_8_8:
-		kfb.pixel2visual = pixel2bgr_888;
-		kfb.visual2pixel = bgr_888_2pixel;
-		kfb.visual_mask = visual_mask_888;
-		kfb.pixel_bytes = 3;
-		break;
-	case VISUAL_RGB_8_8_8_0:
-		kfb.pixel2visual = pixel2rgb_8880;
-		kfb.visual2pixel = rgb_8880_2pixel;
-		kfb.visual_mask = visual_mask_8880;
-		kfb.pixel_bytes = 4;
-		break;
-	case VISUAL_RGB_0_8_8_8:
-		kfb.pixel2visual = pixel2rgb_0888;
-		kfb.visual2pixel = rgb_0888_2pixel;
-		kfb.visual_mask = visual_mask_0888;
-		kfb.pixel_bytes = 4;
-		break;
-	case VISUAL_BGR_0_8_8_8:
-		kfb.pixel2visual = pixel2bgr_0888;
-		kfb.visual2pixel = bgr_0888_2pixel;
-		kfb.visual_mask = visual_mask_0888;
-		kfb.pixel_bytes = 4;
-		break;
-	case VISUAL_BGR_8_8_8_0:
-		kfb.pixel2visual = pixel2bgr_8880;
-		kfb.visual2pixel = bgr_8880_2pixel;
-		kfb.visual_mask = visual_mask_8880;
-		kfb.pixel_bytes = 4;
-		break;
-	default:
+	kfb.conv = pixconv_get(visual);
+	if (kfb.conv == NULL)
 		return EINVAL;
-	}
+	
+	kfb.pixel_bytes = kfb.conv->pixel_bytes;
 	
 	kfb.size = scanline * height;
 	kfb.addr = AS_AREA_ANY;
@@ -768,6 +768,78 @@ int block_read_direct(service_id_t service_id, aoff64_t ba, size_t cnt, void *bu
 	return read_blocks(devcon, ba, cnt, buf, devcon->pblock_size * cnt);
 }
 
+/** Read a range of logical blocks.
+ *
+ * Blocks present in the cache are copied from it, so that modifications
+ * not yet written back are seen. Each run of blocks which are not cached
+ * is read from the device with a single request and is not added to the
+ * cache.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (logical).
+ * @param cnt		Number of blocks.
+ * @param buf		Buffer for storing the data.
+ *
+ * @return		EOK on success or negative error code on failure.
+ */
+int block_read_range(service_id_t service_id, aoff64_t ba, size_t cnt,
+    void *buf)
+{
+	devcon_t *devcon;
+	cache_t *cache;
+	size_t i = 0;
+	int rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+	assert(devcon->cache);
+
+	cache = devcon->cache;
+
+	while (i < cnt) {
+		aoff64_t key = ba + i;
+		uint8_t *dst = (uint8_t *) buf + i * cache->lblock_size;
+
+		fibril_mutex_lock(&cache->lock);
+		ht_link_t *hlink = hash_table_find(&cache->block_hash, &key);
+		if (hlink) {
+			block_t *b = hash_table_get_inst(hlink, block_t,
+			    hash_link);
+
+			fibril_mutex_lock(&b->lock);
+			fibril_mutex_unlock(&cache->lock);
+			rc = b->toxic ? EIO : EOK;
+			if (rc == EOK)
+				memcpy(dst, b->data, cache->lblock_size);
+			fibril_mutex_unlock(&b->lock);
+			if (rc != EOK)
+				return rc;
+
+			i++;
+			continue;
+		}
+
+		/* Find the end of the run of blocks which are not cached. */
+		size_t n = 1;
+		while (i + n < cnt) {
+			key = ba + i + n;
+			if (hash_table_find(&cache->block_hash, &key))
+				break;
+			n++;
+		}
+		fibril_mutex_unlock(&cache->lock);
+
+		rc = read_blocks(devcon, ba_ltop(devcon, ba + i),
+		    n * cache->blocks_cluster, dst, n * cache->lblock_size);
+		if (rc != EOK)
+			return rc;
+
+		i += n;
+	}
+
+	return EOK;
+}
+
 /** Write blocks directly to device (bypass cache).
  *
  * @param service_id	Service ID of the block device.
@@ -838,6 +910,24 @@ int block_get_nblocks(service_id_t service_id, aoff64_t *nblocks)
 	return bd_get_num_blocks(devcon->bd, nblocks);
 }
 
+/** Get number of requests the device serves concurrently.
+ *
+ * Requests issued by different fibrils are served concurrently up to this
+ * number, so readers can keep the device busy by submitting that many.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param depth		Output queue depth.
+ *
+ * @return		EOK on success or negative error code on failure.
+ */
+int block_get_queue_depth(service_id_t service_id, size_t *depth)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_get_queue_depth(devcon->bd, depth);
+}
+
 /** Read bytes directly from the device (bypass cache)
  * 
  * @param service_id	Service ID of the block device.
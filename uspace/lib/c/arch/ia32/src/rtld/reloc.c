@@ -208,5 +208,92 @@ void rela_table_process(module_t *m, elf_rela_t *rt, size_t rt_size)
 	(void)m; (void)rt; (void)rt_size;
 }
 
+/** Resolve a PLT entry on its first call.
+ *
+ * Called from the __rtld_plt_bind trampoline, which gets control from
+ * PLT0 with the module (GOT[1]) and the offset of the relocation in the
+ * PLT relocation table on the stack.
+ *
+ * @param m      Module whose PLT entry is being called
+ * @param reloff Offset of the relocation in the PLT relocation table
+ *
+ * @return Address of the called function
+ */
+void *_rtld_plt_resolve(module_t *m, size_t reloff)
+{
+	elf_rel_t *rel;
+	elf_symbol_t *sym;
+	elf_symbol_t *sym_def;
+	module_t *dest;
+	uint32_t *r_ptr;
+	void *sym_addr;
+	char *name;
+
+	rel = (elf_rel_t *) ((uint8_t *) m->dyn.jmp_rel + reloff);
+	sym = &((elf_symbol_t *) m->dyn.sym_tab)[ELF32_R_SYM(rel->r_info)];
+	name = m->dyn.str_tab + sym->st_name;
+
+	sym_def = symbol_def_find(name, m, ssf_none, &dest);
+	if (sym_def == NULL) {
+		printf("Definition of '%s' not found.\n", name);
+		exit(1);
+	}
+
+	sym_addr = symbol_get_addr(sym_def, dest, NULL);
+
+	r_ptr = (uint32_t *) (rel->r_offset + m->bias);
+	*r_ptr = (uint32_t) sym_addr;
+
+	return sym_addr;
+}
+
+/** Prepare the PLT of a module for lazy binding.
+ *
+ * Make PLT0 jump to the __rtld_plt_bind trampoline and relocate the
+ * GOT entries of the PLT so that they point back to the PLT stubs.
+ * The module defining the trampoline is always bound immediately
+ * so that resolving a symbol never goes through an unresolved PLT entry.
+ *
+ * @param m Module
+ * @return @c true if the PLT was set up for lazy binding, @c false if
+ *         the PLT relocations need to be processed immediately
+ */
+bool plt_lazy_setup(module_t *m)
+{
+	elf_rel_t *rt;
+	elf_symbol_t *sym_def;
+	module_t *dest;
+	uint32_t *got;
+	uint32_t *r_ptr;
+	size_t rt_entries;
+	size_t i;
+
+	if (m->dyn.plt_got == NULL || m->dyn.plt_rel != DT_REL)
+		return false;
+
+	sym_def = symbol_def_find("__rtld_plt_bind", m, ssf_noexec, &dest);
+	if (sym_def == NULL || dest == m)
+		return false;
+
+	got = (uint32_t *) m->dyn.plt_got;
+	got[1] = (uint32_t) m;
+	got[2] = (uint32_t) symbol_get_addr(sym_def, dest, NULL);
+
+	rt = (elf_rel_t *) m->dyn.jmp_rel;
+	rt_entries = m->dyn.plt_rel_sz / sizeof(elf_rel_t);
+
+	for (i = 0; i < rt_entries; ++i) {
+		if (ELF32_R_TYPE(rt[i].r_info) == R_386_JUMP_SLOT) {
+			/* GOT entry initially points to the PLT stub */
+			r_ptr = (uint32_t *) (rt[i].r_offset + m->bias);
+			*r_ptr += m->bias;
+		} else {
+			rel_table_process(m, &rt[i], sizeof(elf_rel_t));
+		}
+	}
+
+	return true;
+}
+
 /** @}
  */
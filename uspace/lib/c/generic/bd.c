@@ -86,12 +86,24 @@ int bd_read_blocks(bd_t *bd, aoff64_t ba, size_t cnt, void *data, size_t size)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
+	/*
+	 * The exchange is released before the data arrives, so that other
+	 * fibrils can submit requests to servers which serve them concurrently.
+	 */
 	ipc_call_t answer;
 	aid_t req = async_send_3(exch, BD_READ_BLOCKS, LOWER32(ba),
 	    UPPER32(ba), cnt, &answer);
-	int rc = async_data_read_start(exch, data, size);
+	ipc_call_t danswer;
+	aid_t dreq = async_data_read(exch, data, size, &danswer);
 	async_exchange_end(exch);
 
+	if (dreq == 0) {
+		async_forget(req);
+		return ENOMEM;
+	}
+
+	sysarg_t rc;
+	async_wait_for(dreq, &rc);
 	if (rc != EOK) {
 		async_forget(req);
 		return rc;
@@ -195,6 +207,35 @@ int bd_get_num_blocks(bd_t *bd, aoff64_t *rnb)
 	return EOK;
 }
 
+/** Get number of requests the device can serve concurrently.
+ *
+ * Devices which do not report it serve requests one at a time.
+ *
+ * @param bd     Block device
+ * @param rdepth Place to store the queue depth
+ *
+ * @return EOK on success or negative error code
+ */
+int bd_get_queue_depth(bd_t *bd, size_t *rdepth)
+{
+	sysarg_t depth;
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	int rc = async_req_0_1(exch, BD_GET_QUEUE_DEPTH, &depth);
+	async_exchange_end(exch);
+
+	if (rc == ENOTSUP) {
+		*rdepth = 1;
+		return EOK;
+	}
+
+	if (rc != EOK)
+		return rc;
+
+	*rdepth = depth;
+	return EOK;
+}
+
 static void bd_cb_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 {
 	bd_t *bd = (bd_t *)arg;
@@ -34,6 +34,8 @@
  * @brief Block device server stub
  */
 #include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
 #include <ipc/bd.h>
 #include <macros.h>
 #include <stdlib.h>
@@ -42,26 +44,138 @@
 
 #include <bd_srv.h>
 
-static void bd_read_blocks_srv(bd_srv_t *srv, ipc_callid_t callid,
-    ipc_call_t *call)
-{
+/** Read or write request being served. */
+typedef struct {
+	bd_srv_t *srv;
+	/** Request call */
+	ipc_callid_t callid;
+	/** Data read call (reads only) */
+	ipc_callid_t rcallid;
 	aoff64_t ba;
 	size_t cnt;
 	void *buf;
 	size_t size;
+	bool write;
+} bd_req_t;
+
+static void bd_req_serve(bd_req_t *req)
+{
+	bd_srv_t *srv = req->srv;
 	int rc;
+
+	if (req->write) {
+		rc = srv->srvs->ops->write_blocks(srv, req->ba, req->cnt,
+		    req->buf, req->size);
+		free(req->buf);
+		async_answer_0(req->callid, rc);
+		return;
+	}
+
+	rc = srv->srvs->ops->read_blocks(srv, req->ba, req->cnt, req->buf,
+	    req->size);
+	if (rc != EOK) {
+		async_answer_0(req->rcallid, ENOMEM);
+		async_answer_0(req->callid, ENOMEM);
+		free(req->buf);
+		return;
+	}
+
+	async_data_read_finalize(req->rcallid, req->buf, req->size);
+
+	free(req->buf);
+	async_answer_0(req->callid, EOK);
+}
+
+static int bd_req_fibril(void *arg)
+{
+	bd_req_t *req = (bd_req_t *) arg;
+	bd_srv_t *srv = req->srv;
+
+	bd_req_serve(req);
+	free(req);
+
+	fibril_mutex_lock(&srv->lock);
+	srv->outstanding--;
+	fibril_condvar_broadcast(&srv->outstanding_cv);
+	fibril_mutex_unlock(&srv->lock);
+
+	return EOK;
+}
+
+/** Serve read or write request.
+ *
+ * If the server can serve several requests at once, the request is served
+ * by a new fibril, so that the connection fibril can receive the next one.
+ * At most queue_depth requests are outstanding per connection.
+ *
+ * @param req Request, copied if needed.
+ */
+static void bd_req_submit(bd_req_t *req)
+{
+	bd_srv_t *srv = req->srv;
+
+	if (srv->queue_depth <= 1) {
+		bd_req_serve(req);
+		return;
+	}
+
+	bd_req_t *areq = malloc(sizeof(bd_req_t));
+	if (areq == NULL) {
+		bd_req_serve(req);
+		return;
+	}
+
+	*areq = *req;
+
+	fibril_mutex_lock(&srv->lock);
+	while (srv->outstanding >= srv->queue_depth)
+		fibril_condvar_wait(&srv->outstanding_cv, &srv->lock);
+	srv->outstanding++;
+	fibril_mutex_unlock(&srv->lock);
+
+	fid_t fid = fibril_create(bd_req_fibril, areq);
+	if (fid == 0) {
+		(void) bd_req_fibril(areq);
+		return;
+	}
+
+	fibril_add_ready(fid);
+}
+
+/** Wait until all outstanding read and write requests are served.
+ *
+ * @param srv Server structure
+ */
+static void bd_req_drain(bd_srv_t *srv)
+{
+	fibril_mutex_lock(&srv->lock);
+	while (srv->outstanding > 0)
+		fibril_condvar_wait(&srv->outstanding_cv, &srv->lock);
+	fibril_mutex_unlock(&srv->lock);
+}
+
+static void bd_read_blocks_srv(bd_srv_t *srv, ipc_callid_t callid,
+    ipc_call_t *call)
+{
+	bd_req_t req;
 	ipc_callid_t rcallid;
+	size_t size;
 
-	ba = MERGE_LOUP32(IPC_GET_ARG1(*call), IPC_GET_ARG2(*call));
-	cnt = IPC_GET_ARG3(*call);
+	req.srv = srv;
+	req.callid = callid;
+	req.ba = MERGE_LOUP32(IPC_GET_ARG1(*call), IPC_GET_ARG2(*call));
+	req.cnt = IPC_GET_ARG3(*call);
+	req.write = false;
 
 	if (!async_data_read_receive(&rcallid, &size)) {
 		async_answer_0(callid, EINVAL);
 		return;
 	}
 
-	buf = malloc(size);
-	if (buf == NULL) {
+	req.rcallid = rcallid;
+	req.size = size;
+	req.buf = malloc(size);
+	if (req.buf == NULL) {
 		async_answer_0(rcallid, ENOMEM);
 		async_answer_0(callid, ENOMEM);
 		return;
@@ -70,22 +184,11 @@ static void bd_read_blocks_srv(bd_srv_t *srv, ipc_callid_t callid,
 	if (srv->srvs->ops->read_blocks == NULL) {
 		async_answer_0(rcallid, ENOTSUP);
 		async_answer_0(callid, ENOTSUP);
-		free(buf);
-		return;
-	}
-
-	rc = srv->srvs->ops->read_blocks(srv, ba, cnt, buf, size);
-	if (rc != EOK) {
-		async_answer_0(rcallid, ENOMEM);
-		async_answer_0(callid, ENOMEM);
-		free(buf);
+		free(req.buf);
 		return;
 	}
 
-	async_data_read_finalize(rcallid, buf, size);
-
-	free(buf);
-	async_answer_0(callid, EOK);
+	bd_req_submit(&req);
 }
 
 static void bd_read_toc_srv(bd_srv_t *srv, ipc_callid_t callid,
@@ -154,14 +257,16 @@ static void bd_sync_cache_srv(bd_srv_t *srv, ipc_callid_t callid,
 static void bd_write_blocks_srv(bd_srv_t *srv, ipc_callid_t callid,
     ipc_call_t *call)
 {
-	aoff64_t ba;
-	size_t cnt;
+	bd_req_t req;
 	void *data;
 	size_t size;
 	int rc;
 
-	ba = MERGE_LOUP32(IPC_GET_ARG1(*call), IPC_GET_ARG2(*call));
-	cnt = IPC_GET_ARG3(*call);
+	req.srv = srv;
+	req.callid = callid;
+	req.ba = MERGE_LOUP32(IPC_GET_ARG1(*call), IPC_GET_ARG2(*call));
+	req.cnt = IPC_GET_ARG3(*call);
+	req.write = true;
 
 	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
 	if (rc != EOK) {
@@ -170,13 +275,14 @@ static void bd_write_blocks_srv(bd_srv_t *srv, ipc_callid_t callid,
 	}
 
 	if (srv->srvs->ops->write_blocks == NULL) {
+		free(data);
 		async_answer_0(callid, ENOTSUP);
 		return;
 	}
 
-	rc = srv->srvs->ops->write_blocks(srv, ba, cnt, data, size);
-	free(data);
-	async_answer_0(callid, rc);
+	req.buf = data;
+	req.size = size;
+	bd_req_submit(&req);
 }
 
 static void bd_get_block_size_srv(bd_srv_t *srv, ipc_callid_t callid,
@@ -209,6 +315,12 @@ static void bd_get_num_blocks_srv(bd_srv_t *srv, ipc_callid_t callid,
 	async_answer_2(callid, rc, LOWER32(num_blocks), UPPER32(num_blocks));
 }
 
+static void bd_get_queue_depth_srv(bd_srv_t *srv, ipc_callid_t callid,
+    ipc_call_t *call)
+{
+	async_answer_1(callid, EOK, srv->queue_depth);
+}
+
 static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 {
 	bd_srv_t *srv;
@@ -218,6 +330,10 @@ static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 		return NULL;
 
 	srv->srvs = srvs;
+	srv->queue_depth = 1;
+	srv->outstanding = 0;
+	fibril_mutex_initialize(&srv->lock);
+	fibril_condvar_initialize(&srv->outstanding_cv);
 	return srv;
 }
 
@@ -249,6 +365,14 @@ int bd_conn(ipc_callid_t iid, ipc_call_t *icall, bd_srvs_t *srvs)
 	if (rc != EOK)
 		return rc;
 
+	if (srvs->ops->get_queue_depth != NULL) {
+		size_t depth;
+
+		rc = srvs->ops->get_queue_depth(srv, &depth);
+		if ((rc == EOK) && (depth > 1))
+			srv->queue_depth = depth;
+	}
+
 	while (true) {
 		ipc_call_t call;
 		ipc_callid_t callid = async_get_call(&call);
@@ -268,6 +392,8 @@ int bd_conn(ipc_callid_t iid, ipc_call_t *icall, bd_srvs_t *srvs)
 			bd_read_toc_srv(srv, callid, &call);
 			break;
 		case BD_SYNC_CACHE:
+			/* Flush only after the outstanding writes are done */
+			bd_req_drain(srv);
 			bd_sync_cache_srv(srv, callid, &call);
 			break;
 		case BD_WRITE_BLOCKS:
@@ -279,11 +405,16 @@ int bd_conn(ipc_callid_t iid, ipc_call_t *icall, bd_srvs_t *srvs)
 		case BD_GET_NUM_BLOCKS:
 			bd_get_num_blocks_srv(srv, callid, &call);
 			break;
+		case BD_GET_QUEUE_DEPTH:
+			bd_get_queue_depth_srv(srv, callid, &call);
+			break;
 		default:
 			async_answer_0(callid, EINVAL);
 		}
 	}
 
+	bd_req_drain(srv);
+
 	rc = srvs->ops->close(srv);
 	free(srv);
 
@@ -37,15 +37,21 @@
  * @brief	Userspace ELF module loader.
  *
  * This module allows loading ELF binaries (both executables and
- * shared objects) from VFS. The current implementation allocates
- * anonymous memory, fills it with segment data and then adjusts
- * the memory areas' flags to the final value. In the future,
- * the segments will be mapped directly from the file.
+ * shared objects) from VFS. Whole pages of segment data are mapped
+ * from the file through the VFS pager and paged in on demand, so that
+ * tasks running the same binary share the pages until they write to
+ * them. The rest of a segment (the page holding the end of the file
+ * data and the zero-initialized part) is allocated as anonymous memory,
+ * filled with segment data and then its flags are adjusted to the final
+ * value.
  */
 
 #include <errno.h>
 #include <stdio.h>
 #include <vfs/vfs.h>
+#include <async.h>
+#include <ns.h>
+#include <ipc/services.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <align.h>
@@ -71,6 +77,9 @@ static const char *error_codes[] = {
 	"irrecoverable error"
 };
 
+/** Session to the VFS pager */
+static async_sess_t *pager_sess = NULL;
+
 static unsigned int elf_load_module(elf_ld_t *elf, size_t so_bias);
 static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry);
 static int section_header(elf_ld_t *elf, elf_section_header_t *entry);
@@ -103,6 +112,7 @@ int elf_load_file(int file, size_t so_bias, eld_flags_t flags, elf_finfo_t *info
 	}
 
 	elf.fd = ofile;
+	elf.pager_fd = -1;
 	elf.info = info;
 	elf.flags = flags;
 
@@ -312,6 +322,75 @@ static int segment_header(elf_ld_t *elf, elf_segment_header_t *entry)
 	return EE_OK;
 }
 
+/** Map whole pages of segment data from the file.
+ *
+ * The pages are paged in on demand by the VFS pager. The page holding
+ * the end of the file data is only mapped if the segment has no
+ * zero-initialized part, because the pager fills it from the file.
+ *
+ * @param elf	Loader state.
+ * @param entry Program header entry describing segment to be loaded.
+ * @param base	Page-aligned start of the segment.
+ * @param mem_sz Size of the segment starting at @a base.
+ * @param flags	Flags of the memory area.
+ *
+ * @return Number of bytes mapped starting at @a base, zero if the segment
+ *         cannot be mapped and has to be read.
+ */
+static size_t map_segment(elf_ld_t *elf, elf_segment_header_t *entry,
+    uintptr_t base, size_t mem_sz, int flags)
+{
+	size_t pad = entry->p_vaddr - base;
+	
+	if ((entry->p_offset % PAGE_SIZE) != pad)
+		return 0;
+	
+	size_t map_sz;
+	if (entry->p_filesz == entry->p_memsz)
+		map_sz = ALIGN_UP(mem_sz, PAGE_SIZE);
+	else
+		map_sz = ALIGN_DOWN(pad + entry->p_filesz, PAGE_SIZE);
+	
+	if (map_sz == 0)
+		return 0;
+	
+	if (pager_sess == NULL) {
+		pager_sess = service_connect_blocking(SERVICE_VFS,
+		    INTERFACE_PAGER, 0);
+		if (pager_sess == NULL)
+			return 0;
+	}
+	
+	/*
+	 * The pager reads through a separate file handle which VFS hides
+	 * from the task and keeps open for its lifetime. The file cannot
+	 * be modified under the running task.
+	 */
+	if (elf->pager_fd < 0) {
+		int fd = vfs_clone(elf->fd, -1, true);
+		if (fd < 0)
+			return 0;
+		
+		if ((vfs_open(fd, MODE_READ) != EOK) ||
+		    (vfs_map(fd) != EOK)) {
+			vfs_put(fd);
+			return 0;
+		}
+		
+		elf->pager_fd = fd;
+	}
+	
+	void *a = async_as_area_create((uint8_t *) base + elf->bias, map_sz,
+	    flags, pager_sess, elf->pager_fd, entry->p_offset - pad, 0);
+	if (a == AS_MAP_FAILED) {
+		DPRINTF("paged mapping failed (%p, %zu)\n",
+		    (void *) (base + elf->bias), map_sz);
+		return 0;
+	}
+	
+	return map_sz;
+}
+
 /** Load segment described by program header entry.
  *
  * @param elf	Loader state.
@@ -328,6 +407,8 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	void *seg_ptr;
 	uintptr_t seg_addr;
 	size_t mem_sz;
+	size_t map_sz;
+	size_t skip;
 	aoff64_t pos;
 	ssize_t rc;
 
@@ -367,27 +448,43 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	    (void *) (entry->p_vaddr + bias +
 	    ALIGN_UP(entry->p_memsz, PAGE_SIZE)));
 
+	/*
+	 * Map as much of the segment from the file as possible. Writable
+	 * pages are copied on first write, so the caller may still modify
+	 * them if it asked for ELDF_RW.
+	 */
+	map_sz = map_segment(elf, entry, base, mem_sz,
+	    ((elf->flags & ELDF_RW) != 0) ?
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE : flags);
+	if (map_sz >= mem_sz)
+		return EE_OK;
+
+	/* Part of the segment already mapped from the file */
+	skip = (map_sz > 0) ? map_sz - (entry->p_vaddr - base) : 0;
+
 	/*
 	 * For the course of loading, the area needs to be readable
 	 * and writeable.
 	 */
-	a = as_area_create((uint8_t *) base + bias, mem_sz,
+	a = as_area_create((uint8_t *) base + bias + map_sz, mem_sz - map_sz,
 	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
 	    AS_AREA_UNPAGED);
 	if (a == AS_MAP_FAILED) {
 		DPRINTF("memory mapping failed (%p, %zu)\n",
-		    (void *) (base + bias), mem_sz);
+		    (void *) (base + bias + map_sz), mem_sz - map_sz);
 		return EE_MEMORY;
 	}
 
 	DPRINTF("as_area_create(%p, %#zx, %d) -> %p\n",
-	    (void *) (base + bias), mem_sz, flags, (void *) a);
+	    (void *) (base + bias + map_sz), mem_sz - map_sz, flags,
+	    (void *) a);
 
 	/*
 	 * Load segment data
 	 */
-	pos = entry->p_offset;
-	rc = vfs_read(elf->fd, &pos, seg_ptr, entry->p_filesz);
+	pos = entry->p_offset + skip;
+	rc = vfs_read(elf->fd, &pos, (uint8_t *) seg_ptr + skip,
+	    entry->p_filesz - skip);
 	if (rc < 0) {
 		DPRINTF("read error\n");
 		return EE_INVALID;
@@ -400,7 +497,7 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	if ((elf->flags & ELDF_RW) != 0) return EE_OK;
 
 //	printf("set area flags to %d\n", flags);
-	rc = as_area_change_flags(seg_ptr, flags);
+	rc = as_area_change_flags(a, flags);
 	if (rc != 0) {
 		DPRINTF("Failed to set memory area flags.\n");
 		return EE_MEMORY;
@@ -408,7 +505,8 @@ int load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 
 	if (flags & AS_AREA_EXEC) {
 		/* Enforce SMC coherence for the segment */
-		if (smc_coherence(seg_ptr, entry->p_filesz))
+		if (smc_coherence((uint8_t *) seg_ptr + skip,
+		    entry->p_filesz - skip))
 			return EE_MEMORY;
 	}
 
@@ -114,8 +114,8 @@ int inet_send(inet_dgram_t *dgram, uint8_t ttl, inet_df_t df)
 	async_exch_t *exch = async_exchange_begin(inet_sess);
 	
 	ipc_call_t answer;
-	aid_t req = async_send_4(exch, INET_SEND, dgram->iplink, dgram->tos,
-	    ttl, df, &answer);
+	aid_t req = async_send_5(exch, INET_SEND, dgram->iplink, dgram->tos,
+	    ttl, df, dgram->mss, &answer);
 	
 	int rc = async_data_write_start(exch, &dgram->src, sizeof(inet_addr_t));
 	if (rc != EOK) {
@@ -181,6 +181,7 @@ static void inet_ev_recv(ipc_callid_t iid, ipc_call_t *icall)
 	
 	dgram.tos = IPC_GET_ARG1(*icall);
 	dgram.iplink = IPC_GET_ARG2(*icall);
+	dgram.mss = 0;
 	
 	ipc_callid_t callid;
 	size_t size;
@@ -38,7 +38,9 @@
 #include <inet/tcp.h>
 #include <ipc/services.h>
 #include <ipc/tcp.h>
+#include <macros.h>
 #include <stdlib.h>
+#include <vfs/vfs.h>
 
 static void tcp_cb_conn(ipc_callid_t, ipc_call_t *, void *);
 static int tcp_conn_fibril(void *);
@@ -472,6 +474,94 @@ int tcp_conn_send(tcp_conn_t *conn, const void *data, size_t bytes)
 	return rc;
 }
 
+/** Send data gathered from multiple buffers.
+ *
+ * Send data from @a cnt buffers over the connection as if they were a single
+ * contiguous buffer. The TCP service only starts transmitting once all
+ * the data has been queued, so e.g. a protocol header and its payload
+ * can share segments.
+ *
+ * @param conn Connection
+ * @param iov  Array of buffers
+ * @param cnt  Number of buffers in @a iov
+ *
+ * @return EOK on success, ELIMIT if the total size exceeds
+ *         @c DATA_XFER_LIMIT or negative error code
+ */
+int tcp_conn_sendv(tcp_conn_t *conn, const tcp_iovec_t *iov, size_t cnt)
+{
+	async_exch_t *exch;
+	sysarg_t rc;
+	size_t total;
+	size_t i;
+
+	total = 0;
+	for (i = 0; i < cnt; i++) {
+		if (iov[i].size > DATA_XFER_LIMIT - total)
+			return ELIMIT;
+		total += iov[i].size;
+	}
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_3(exch, TCP_CONN_SENDV, conn->id, cnt, total,
+	    NULL);
+
+	for (i = 0; i < cnt; i++) {
+		rc = async_data_write_start(exch, iov[i].data, iov[i].size);
+		if (rc != EOK) {
+			async_exchange_end(exch);
+			async_forget(req);
+			return rc;
+		}
+	}
+
+	async_exchange_end(exch);
+
+	async_wait_for(req, &rc);
+	return rc;
+}
+
+/** Send data from file.
+ *
+ * The file handle is passed to the TCP service which reads the file
+ * and queues the data for sending directly, without copying the data
+ * through the caller. Sending stops early when the end of file is reached.
+ *
+ * @param conn  Connection
+ * @param file  File handle
+ * @param pos   Position in file where to start reading
+ * @param size  Maximum number of bytes to send
+ * @param nsent Place to store number of bytes actually sent
+ *
+ * @return EOK on success or negative error code
+ */
+int tcp_conn_sendfile(tcp_conn_t *conn, int file, aoff64_t pos, aoff64_t size,
+    aoff64_t *nsent)
+{
+	async_exch_t *exch;
+	ipc_call_t answer;
+	sysarg_t rc;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_5(exch, TCP_CONN_SENDFILE, conn->id,
+	    LOWER32(pos), UPPER32(pos), LOWER32(size), UPPER32(size), &answer);
+
+	async_exch_t *vfs_exch = vfs_exchange_begin();
+	rc = vfs_pass_handle(vfs_exch, file, exch);
+	vfs_exchange_end(vfs_exch);
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	async_wait_for(req, &rc);
+	*nsent = MERGE_LOUP32(IPC_GET_ARG1(answer), IPC_GET_ARG2(answer));
+	return rc;
+}
+
 /** Send FIN.
  *
  * Send FIN, indicating no more data will be send over the connection.
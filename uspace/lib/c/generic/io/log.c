@@ -31,9 +31,13 @@
  * @{
  */
 
+#include <align.h>
+#include <as.h>
 #include <assert.h>
 #include <errno.h>
 #include <fibril_synch.h>
+#include <libarch/barrier.h>
+#include <mem.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -65,6 +69,29 @@ static async_sess_t *logger_session;
 /** Maximum length of a single log message (in bytes). */
 #define MESSAGE_BUFFER_SIZE 4096
 
+/** Number of entries in the log level cache. */
+#define LEVEL_CACHE_SIZE 16
+
+/** Cached effective logging level of a log. */
+typedef struct {
+	/** Log the entry belongs to (zero if the entry is unused). */
+	log_t log;
+	/** Effective logging level of the log. */
+	log_level_t level;
+} level_cache_entry_t;
+
+/** Record ring shared with the logger (NULL if not available). */
+static logger_ring_t *log_ring;
+
+/** Guards the record ring and the level cache. Never held across IPC. */
+static FIBRIL_MUTEX_INITIALIZE(log_guard);
+
+/** Effective logging levels of recently used logs. */
+static level_cache_entry_t level_cache[LEVEL_CACHE_SIZE];
+
+/** Level generation the level cache is valid for. */
+static uint32_t level_cache_gen;
+
 /** Send formatted message to the logger service.
  *
  * @param session Initialized IPC session with the logger.
@@ -107,6 +134,217 @@ static int logger_message(async_sess_t *session, log_t log, log_level_t level, c
 	return reg_msg_rc;
 }
 
+/** Share a record ring with the logger service.
+ *
+ * @param session Initialized IPC session with the logger.
+ * @return Error code or EOK on success.
+ */
+static int logger_ring_create(async_sess_t *session)
+{
+	logger_ring_t *ring = as_area_create(AS_AREA_ANY, LOGGER_RING_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (ring == AS_MAP_FAILED)
+		return ENOMEM;
+
+	memset(ring, 0, sizeof(logger_ring_t));
+	ring->size = LOGGER_RING_SIZE - sizeof(logger_ring_t);
+
+	async_exch_t *exchange = async_exchange_begin(session);
+	if (exchange == NULL) {
+		as_area_destroy(ring);
+		return ENOMEM;
+	}
+
+	aid_t reg_msg = async_send_0(exchange, LOGGER_WRITER_SET_RING, NULL);
+	int rc = async_share_out_start(exchange, ring,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	sysarg_t reg_msg_rc;
+	async_wait_for(reg_msg, &reg_msg_rc);
+
+	async_exchange_end(exchange);
+
+	if (rc == EOK)
+		rc = reg_msg_rc;
+
+	if (rc != EOK) {
+		as_area_destroy(ring);
+		return rc;
+	}
+
+	level_cache_gen = ring->level_gen;
+	log_ring = ring;
+	return EOK;
+}
+
+/** Ask the logger to drain the record ring.
+ *
+ * @param session Initialized IPC session with the logger.
+ * @param wait Wait until the logger has drained the ring.
+ * @return Error code or EOK on success.
+ */
+static int logger_ring_kick(async_sess_t *session, bool wait)
+{
+	async_exch_t *exchange = async_exchange_begin(session);
+	if (exchange == NULL)
+		return ENOMEM;
+
+	log_ring->kick = 1;
+	memory_barrier();
+
+	int rc = EOK;
+	if (wait)
+		rc = async_req_0_0(exchange, LOGGER_WRITER_DRAIN);
+	else
+		async_msg_0(exchange, LOGGER_WRITER_DRAIN);
+
+	async_exchange_end(exchange);
+	return rc;
+}
+
+/** Append a message to the record ring.
+ *
+ * The logger is only notified if it is not already going to drain the
+ * ring, so a burst of messages costs a single IPC message. If the ring
+ * is full, wait for the logger to make space.
+ *
+ * @param session Initialized IPC session with the logger.
+ * @param log Log to use.
+ * @param level Verbosity level of the message.
+ * @param message The actual message.
+ * @return @c true if the message was queued, @c false if it does not fit
+ *         into the ring.
+ */
+static bool logger_ring_write(async_sess_t *session, log_t log,
+    log_level_t level, const char *message)
+{
+	logger_ring_t *ring = log_ring;
+	size_t length = str_size(message);
+
+	/* Trailing newlines are dropped as in logger_message(). */
+	while (length > 0 && message[length - 1] == '\n')
+		length--;
+
+	uint32_t rec_size = ALIGN_UP(sizeof(logger_record_t) + length,
+	    sizeof(sysarg_t));
+
+	if (rec_size > ring->size / 2)
+		return false;
+
+	fibril_mutex_lock(&log_guard);
+
+	uint32_t head;
+	uint32_t offset;
+
+	while (true) {
+		head = ring->head;
+		offset = head % ring->size;
+
+		/* Records never wrap, pad the rest of the data area if needed. */
+		uint32_t needed = rec_size;
+		if (offset + rec_size > ring->size)
+			needed += ring->size - offset;
+
+		if (ring->size - (head - ring->tail) >= needed)
+			break;
+
+		fibril_mutex_unlock(&log_guard);
+		int rc = logger_ring_kick(session, true);
+		if (rc != EOK)
+			return false;
+		fibril_mutex_lock(&log_guard);
+	}
+
+	uint8_t *data = (uint8_t *) (ring + 1);
+	logger_record_t *rec;
+
+	if (offset + rec_size > ring->size) {
+		rec = (logger_record_t *) (data + offset);
+		rec->log = 0;
+		head += ring->size - offset;
+		offset = 0;
+	}
+
+	rec = (logger_record_t *) (data + offset);
+	rec->log = log;
+	rec->level = level;
+	rec->length = length;
+	memcpy(rec + 1, message, length);
+
+	/* Publish the record before checking whether to notify the logger. */
+	write_barrier();
+	ring->head = head + rec_size;
+	memory_barrier();
+
+	bool kick = (ring->kick == 0);
+
+	fibril_mutex_unlock(&log_guard);
+
+	if (kick)
+		(void) logger_ring_kick(session, false);
+
+	return true;
+}
+
+/** Determine whether a message would be logged.
+ *
+ * Effective levels are queried from the logger once and cached until
+ * the logger signals a level change through the shared ring.
+ *
+ * @param session Initialized IPC session with the logger.
+ * @param log Log to use.
+ * @param level Verbosity level of the message.
+ * @return @c false if the logger would discard the message.
+ */
+static bool logger_shall_log(async_sess_t *session, log_t log,
+    log_level_t level)
+{
+	if (log_ring == NULL)
+		return true;
+
+	fibril_mutex_lock(&log_guard);
+
+	uint32_t gen = log_ring->level_gen;
+	if (gen != level_cache_gen) {
+		memset(level_cache, 0, sizeof(level_cache));
+		level_cache_gen = gen;
+	}
+
+	level_cache_entry_t *entry =
+	    &level_cache[(log / sizeof(sysarg_t)) % LEVEL_CACHE_SIZE];
+
+	if (entry->log == log) {
+		bool shall_log = level <= entry->level;
+		fibril_mutex_unlock(&log_guard);
+		return shall_log;
+	}
+
+	fibril_mutex_unlock(&log_guard);
+
+	async_exch_t *exchange = async_exchange_begin(session);
+	if (exchange == NULL)
+		return true;
+
+	sysarg_t log_level;
+	int rc = async_req_1_1(exchange, LOGGER_WRITER_GET_LEVEL,
+	    log, &log_level);
+
+	async_exchange_end(exchange);
+
+	if (rc != EOK)
+		return true;
+
+	/* Do not cache the level if the levels changed meanwhile. */
+	fibril_mutex_lock(&log_guard);
+	if (log_ring->level_gen == gen && level_cache_gen == gen) {
+		entry->log = log;
+		entry->level = log_level;
+	}
+	fibril_mutex_unlock(&log_guard);
+
+	return level <= (log_level_t) log_level;
+}
+
 /** Get name of the log level.
  *
  * @param level The log level.
@@ -173,6 +411,9 @@ int log_init(const char *prog_name)
 
 	default_log_id = log_create(prog_name, LOG_NO_PARENT);
 
+	/* Without the ring, messages are sent one by one. */
+	(void) logger_ring_create(logger_session);
+
 	return EOK;
 }
 
@@ -212,7 +453,8 @@ log_t log_create(const char *name, log_t parent)
 /** Write an entry to the log.
  *
  * The message is printed only if the verbosity level is less than or
- * equal to currently set reporting level of the log.
+ * equal to currently set reporting level of the log. Messages that
+ * would be discarded are filtered out without contacting the logger.
  *
  * @param ctx Log to use (use LOG_DEFAULT if you have no idea what it means).
  * @param level Severity level of the message.
@@ -238,12 +480,27 @@ void log_msgv(log_t ctx, log_level_t level, const char *fmt, va_list args)
 {
 	assert(level < LVL_LIMIT);
 
+	if (ctx == LOG_DEFAULT)
+		ctx = default_log_id;
+
+	if (!logger_shall_log(logger_session, ctx, level))
+		return;
+
 	char *message_buffer = malloc(MESSAGE_BUFFER_SIZE);
 	if (message_buffer == NULL)
 		return;
 
 	vsnprintf(message_buffer, MESSAGE_BUFFER_SIZE, fmt, args);
-	logger_message(logger_session, ctx, level, message_buffer);
+
+	if (log_ring == NULL ||
+	    !logger_ring_write(logger_session, ctx, level, message_buffer)) {
+		/* Keep messages ordered, flush the ring first. */
+		if (log_ring != NULL)
+			(void) logger_ring_kick(logger_session, true);
+
+		logger_message(logger_session, ctx, level, message_buffer);
+	}
+
 	free(message_buffer);
 }
 
@@ -89,8 +89,8 @@ int iplink_send(iplink_t *iplink, iplink_sdu_t *sdu)
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 	
 	ipc_call_t answer;
-	aid_t req = async_send_2(exch, IPLINK_SEND, (sysarg_t) sdu->src,
-	    (sysarg_t) sdu->dest, &answer);
+	aid_t req = async_send_3(exch, IPLINK_SEND, (sysarg_t) sdu->src,
+	    (sysarg_t) sdu->dest, (sysarg_t) sdu->mss, &answer);
 	
 	int rc = async_data_write_start(exch, sdu->data, sdu->size);
 	
@@ -152,6 +152,34 @@ int iplink_get_mtu(iplink_t *iplink, size_t *rmtu)
 	return EOK;
 }
 
+/** Get maximum size of a packet accepted for segmentation offload.
+ *
+ * Links that support segmentation offload accept TCP packets larger
+ * than the MTU (with @c mss set in the SDU) and split them into
+ * MTU-sized segments themselves.
+ *
+ * @param iplink IP link
+ * @param rsize  Place to store maximum packet size
+ *
+ * @return EOK on success
+ * @return ENOTSUP if the link does not support segmentation offload
+ */
+int iplink_get_gso_max(iplink_t *iplink, size_t *rsize)
+{
+	async_exch_t *exch = async_exchange_begin(iplink->sess);
+	
+	sysarg_t size;
+	int rc = async_req_0_1(exch, IPLINK_GET_GSO_MAX, &size);
+	
+	async_exchange_end(exch);
+	
+	if (rc != EOK)
+		return rc;
+	
+	*rsize = size;
+	return EOK;
+}
+
 int iplink_get_mac48(iplink_t *iplink, addr48_t *mac)
 {
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
@@ -49,6 +49,19 @@ static void iplink_get_mtu_srv(iplink_srv_t *srv, ipc_callid_t callid,
 	async_answer_1(callid, rc, mtu);
 }
 
+static void iplink_get_gso_max_srv(iplink_srv_t *srv, ipc_callid_t callid,
+    ipc_call_t *call)
+{
+	if (srv->ops->get_gso_max == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		return;
+	}
+	
+	size_t size;
+	int rc = srv->ops->get_gso_max(srv, &size);
+	async_answer_1(callid, rc, size);
+}
+
 static void iplink_get_mac48_srv(iplink_srv_t *srv, ipc_callid_t iid,
     ipc_call_t *icall)
 {
@@ -170,6 +183,7 @@ static void iplink_send_srv(iplink_srv_t *srv, ipc_callid_t iid,
 	
 	sdu.src = IPC_GET_ARG1(*icall);
 	sdu.dest = IPC_GET_ARG2(*icall);
+	sdu.mss = IPC_GET_ARG3(*icall);
 	
 	int rc = async_data_write_accept(&sdu.data, false, 0, 0, 0,
 	    &sdu.size);
@@ -275,6 +289,9 @@ int iplink_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case IPLINK_GET_MTU:
 			iplink_get_mtu_srv(srv, callid, &call);
 			break;
+		case IPLINK_GET_GSO_MAX:
+			iplink_get_gso_max_srv(srv, callid, &call);
+			break;
 		case IPLINK_GET_MAC48:
 			iplink_get_mac48_srv(srv, callid, &call);
 			break;
@@ -34,9 +34,13 @@
  */
 
 #include <mem.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <libarch/config.h>
+
+#ifndef LIBARCH_MEMSET
 
 /** Fill memory block with a constant value. */
 void *memset(void *dest, int b, size_t n)
@@ -90,6 +94,10 @@ void *memset(void *dest, int b, size_t n)
 	return dest;
 }
 
+#endif
+
+#ifndef LIBARCH_MEMCPY
+
 struct along {
 	unsigned long n;
 } __attribute__ ((packed));
@@ -185,11 +193,14 @@ void *memcpy(void *dst, const void *src, size_t n)
 	return dst;
 }
 
+#endif
+
 /** Move memory block with possible overlapping. */
 void *memmove(void *dst, const void *src, size_t n)
 {
 	const uint8_t *sp;
 	uint8_t *dp;
+	size_t word_size = sizeof(unsigned long);
 
 	/* Nothing to do? */
 	if (src == dst)
@@ -200,27 +211,74 @@ void *memmove(void *dst, const void *src, size_t n)
 		return memcpy(dst, src, n);
 	}
 
+	/*
+	 * Words can be moved in the aligned middle part if the
+	 * addresses are congruent modulo word_size.
+	 */
+	bool words = (((uintptr_t) dst & (word_size - 1)) ==
+	    ((uintptr_t) src & (word_size - 1)));
+
 	/* Which direction? */
 	if (src > dst) {
 		/* Forwards. */
 		sp = src;
 		dp = dst;
 
+		if (words) {
+			while (n != 0 && ((uintptr_t) dp & (word_size - 1)) != 0) {
+				*dp++ = *sp++;
+				n--;
+			}
+
+			const unsigned long *sw = (const unsigned long *) sp;
+			unsigned long *dw = (unsigned long *) dp;
+
+			while (n >= word_size) {
+				*dw++ = *sw++;
+				n -= word_size;
+			}
+
+			sp = (const uint8_t *) sw;
+			dp = (uint8_t *) dw;
+		}
+
 		while (n-- != 0)
 			*dp++ = *sp++;
 	} else {
 		/* Backwards. */
-		sp = src + (n - 1);
-		dp = dst + (n - 1);
+		sp = src + n;
+		dp = dst + n;
+
+		if (words) {
+			while (n != 0 && ((uintptr_t) dp & (word_size - 1)) != 0) {
+				*--dp = *--sp;
+				n--;
+			}
+
+			const unsigned long *sw = (const unsigned long *) sp;
+			unsigned long *dw = (unsigned long *) dp;
+
+			while (n >= word_size) {
+				*--dw = *--sw;
+				n -= word_size;
+			}
+
+			sp = (const uint8_t *) sw;
+			dp = (uint8_t *) dw;
+		}
 
 		while (n-- != 0)
-			*dp-- = *sp--;
+			*--dp = *--sp;
 	}
 
 	return dst;
 }
 
 /** Compare two memory areas.
+ *
+ * If the areas are congruent modulo the word size, equal words
+ * are skipped and only the first differing word is compared
+ * byte by byte.
  *
  * @param s1  Pointer to the first area to compare.
  * @param s2  Pointer to the second area to compare.
@@ -233,11 +291,34 @@ void *memmove(void *dst, const void *src, size_t n)
  */
 int memcmp(const void *s1, const void *s2, size_t len)
 {
-	uint8_t *u1 = (uint8_t *) s1;
-	uint8_t *u2 = (uint8_t *) s2;
-	size_t i;
+	const uint8_t *u1 = (const uint8_t *) s1;
+	const uint8_t *u2 = (const uint8_t *) s2;
+	size_t word_size = sizeof(unsigned long);
+
+	if (((uintptr_t) u1 & (word_size - 1)) ==
+	    ((uintptr_t) u2 & (word_size - 1))) {
+		while (len != 0 && ((uintptr_t) u1 & (word_size - 1)) != 0) {
+			if (*u1 != *u2)
+				return (int)(*u1) - (int)(*u2);
+			++u1;
+			++u2;
+			len--;
+		}
+
+		const unsigned long *w1 = (const unsigned long *) u1;
+		const unsigned long *w2 = (const unsigned long *) u2;
+
+		while (len >= word_size && *w1 == *w2) {
+			++w1;
+			++w2;
+			len -= word_size;
+		}
+
+		u1 = (const uint8_t *) w1;
+		u2 = (const uint8_t *) w2;
+	}
 
-	for (i = 0; i < len; i++) {
+	for (size_t i = 0; i < len; i++) {
 		if (*u1 != *u2)
 			return (int)(*u1) - (int)(*u2);
 		++u1;
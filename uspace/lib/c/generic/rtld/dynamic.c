@@ -70,6 +70,7 @@ void dynamic_parse(elf_dyn_t *dyn_ptr, size_t bias, dyn_info_t *info)
 		case DT_PLTRELSZ:	info->plt_rel_sz = d_val; break;
 		case DT_PLTGOT:		info->plt_got = d_ptr; break;
 		case DT_HASH:		info->hash = d_ptr; break;
+		case DT_GNU_HASH:	info->gnu_hash = d_ptr; break;
 		case DT_STRTAB:		info->str_tab = d_ptr; break;
 		case DT_SYMTAB:		info->sym_tab = d_ptr; break;
 		case DT_RELA:		info->rela = d_ptr; break;
@@ -89,6 +90,10 @@ void dynamic_parse(elf_dyn_t *dyn_ptr, size_t bias, dyn_info_t *info)
 		case DT_TEXTREL:	info->text_rel = true; break;
 		case DT_JMPREL:		info->jmp_rel = d_ptr; break;
 		case DT_BIND_NOW:	info->bind_now = true; break;
+		case DT_FLAGS:
+			if ((d_val & DF_BIND_NOW) != 0)
+				info->bind_now = true;
+			break;
 
 		default:
 			if (dp->d_tag >= DT_LOPROC && dp->d_tag <= DT_HIPROC)
@@ -80,9 +80,11 @@ int module_create_static_exec(rtld_t *rtld, module_t **rmodule)
 	return EOK;
 }
 
-/** (Eagerly) process all relocation tables in a module.
+/** Process all relocation tables in a module.
  *
- * Currently works as if LD_BIND_NOW was specified.
+ * PLT relocations are resolved lazily on first call if the architecture
+ * supports it, unless the module requests immediate binding (DT_BIND_NOW
+ * or DF_BIND_NOW). All other relocations are processed eagerly.
  */
 void module_process_relocs(module_t *m)
 {
@@ -94,7 +96,9 @@ void module_process_relocs(module_t *m)
 	module_process_pre_arch(m);
 
 	/* jmp_rel table */
-	if (m->dyn.jmp_rel != NULL) {
+	if (m->dyn.jmp_rel != NULL && !m->dyn.bind_now && plt_lazy_setup(m)) {
+		DPRINTF("jmp_rel table set up for lazy binding\n");
+	} else if (m->dyn.jmp_rel != NULL) {
 		DPRINTF("jmp_rel table\n");
 		if (m->dyn.plt_rel == DT_REL) {
 			DPRINTF("jmp_rel table type DT_REL\n");
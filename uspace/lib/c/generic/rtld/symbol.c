@@ -34,6 +34,7 @@
  * @file
  */
 
+#include <futex.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -43,6 +44,39 @@
 #include <rtld/rtld_debug.h>
 #include <rtld/symbol.h>
 
+/** Number of entries in the symbol lookup cache (must be a power of two) */
+#define SYM_CACHE_SIZE  256
+
+/** Symbol lookup cache entry */
+typedef struct {
+	/** Runtime environment the entry belongs to */
+	rtld_t *rtld;
+	/** GNU hash of the symbol name */
+	elf_word hash;
+	/** Search flags used for the lookup */
+	symbol_search_flags_t flags;
+	/** Symbol definition */
+	elf_symbol_t *sym;
+	/** Module containing the definition */
+	module_t *mod;
+} sym_cache_entry_t;
+
+/** Symbol hash values, computed once per lookup */
+typedef struct {
+	elf_word sysv;
+	elf_word gnu;
+} sym_hash_t;
+
+/*
+ * Direct-mapped cache of symbols found among the global modules.
+ *
+ * Modules are only ever appended to the module list, so a definition
+ * found once stays the first one in the search order and the entries
+ * never need to be invalidated.
+ */
+static sym_cache_entry_t sym_cache[SYM_CACHE_SIZE];
+static futex_t sym_cache_futex = FUTEX_INITIALIZER;
+
 /*
  * Hash tables are 32-bit (elf_word) even for 64-bit ELF files.
  */
@@ -60,38 +94,131 @@ static elf_word elf_hash(const unsigned char *name)
 	return h;
 }
 
-static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
+/** Hash function used by DT_GNU_HASH tables. */
+static elf_word gnu_hash(const unsigned char *name)
+{
+	elf_word h = 5381;
+
+	while (*name)
+		h = (h << 5) + h + *name++;
+
+	return h;
+}
+
+static void sym_hash_compute(const char *name, sym_hash_t *hash)
+{
+	hash->sysv = elf_hash((const unsigned char *) name);
+	hash->gnu = gnu_hash((const unsigned char *) name);
+}
+
+/** Look up a symbol using the System V hash table of a module. */
+static elf_symbol_t *sysv_find_in_module(const char *name, elf_word hash,
+    module_t *m)
 {
 	elf_symbol_t *sym_table;
-	elf_symbol_t *s, *sym;
+	elf_symbol_t *s;
 	elf_word nbucket;
 	/*elf_word nchain;*/
 	elf_word i;
 	char *s_name;
 	elf_word bucket;
 
-	DPRINTF("def_find_in_module('%s', %s)\n", name, m->dyn.soname);
-
 	sym_table = m->dyn.sym_tab;
 	nbucket = m->dyn.hash[0];
 	/*nchain = m->dyn.hash[1]; XXX Use to check HT range*/
 
-	bucket = elf_hash((unsigned char *)name) % nbucket;
+	bucket = hash % nbucket;
 	i = m->dyn.hash[2 + bucket];
 
-	sym = NULL;
 	while (i != STN_UNDEF) {
 		s = &sym_table[i];
 		s_name = m->dyn.str_tab + s->st_name;
 
-		if (str_cmp(name, s_name) == 0) {
-			sym = s;
-			break;
-		}
+		if (str_cmp(name, s_name) == 0)
+			return s;
 
 		i = m->dyn.hash[2 + nbucket + i];
 	}
 
+	return NULL;
+}
+
+/** Look up a symbol using the GNU hash table of a module.
+ *
+ * The Bloom filter rejects most names not defined in the module
+ * without touching the buckets or the symbol table at all.
+ */
+static elf_symbol_t *gnu_find_in_module(const char *name, elf_word hash,
+    module_t *m)
+{
+	const unsigned bloom_bits = sizeof(uintptr_t) * 8;
+	elf_symbol_t *sym_table;
+	elf_symbol_t *s;
+	elf_word nbuckets;
+	elf_word symoffset;
+	elf_word bloom_size;
+	elf_word bloom_shift;
+	const uintptr_t *bloom;
+	const elf_word *buckets;
+	const elf_word *chain;
+	uintptr_t word;
+	elf_word i;
+	elf_word h2;
+
+	nbuckets = m->dyn.gnu_hash[0];
+	symoffset = m->dyn.gnu_hash[1];
+	bloom_size = m->dyn.gnu_hash[2];
+	bloom_shift = m->dyn.gnu_hash[3];
+
+	bloom = (const uintptr_t *) &m->dyn.gnu_hash[4];
+	buckets = (const elf_word *) &bloom[bloom_size];
+	chain = &buckets[nbuckets];
+
+	if (nbuckets == 0 || bloom_size == 0)
+		return NULL;
+
+	word = bloom[(hash / bloom_bits) % bloom_size];
+	if ((word & ((uintptr_t) 1 << (hash % bloom_bits))) == 0)
+		return NULL;
+	if ((word & ((uintptr_t) 1 << ((hash >> bloom_shift) % bloom_bits))) == 0)
+		return NULL;
+
+	i = buckets[hash % nbuckets];
+	if (i < symoffset)
+		return NULL;
+
+	sym_table = m->dyn.sym_tab;
+
+	while (true) {
+		h2 = chain[i - symoffset];
+		if ((hash | 1) == (h2 | 1)) {
+			s = &sym_table[i];
+			if (str_cmp(name, m->dyn.str_tab + s->st_name) == 0)
+				return s;
+		}
+
+		/* Lowest bit marks the end of the chain */
+		if ((h2 & 1) != 0)
+			break;
+
+		++i;
+	}
+
+	return NULL;
+}
+
+static elf_symbol_t *def_find_in_module(const char *name,
+    const sym_hash_t *hash, module_t *m)
+{
+	elf_symbol_t *sym;
+
+	DPRINTF("def_find_in_module('%s', %s)\n", name, m->dyn.soname);
+
+	if (m->dyn.gnu_hash != NULL)
+		sym = gnu_find_in_module(name, hash->gnu, m);
+	else
+		sym = sysv_find_in_module(name, hash->sysv, m);
+
 	if (!sym)
 		return NULL;	/* Not found */
 
@@ -103,6 +230,47 @@ static elf_symbol_t *def_find_in_module(const char *name, module_t *m)
 	return sym; /* Found */
 }
 
+static sym_cache_entry_t *sym_cache_entry(const sym_hash_t *hash)
+{
+	return &sym_cache[hash->gnu & (SYM_CACHE_SIZE - 1)];
+}
+
+/** Look up a global definition in the symbol lookup cache. */
+static elf_symbol_t *sym_cache_find(const char *name, const sym_hash_t *hash,
+    rtld_t *rtld, symbol_search_flags_t flags, module_t **mod)
+{
+	sym_cache_entry_t *e = sym_cache_entry(hash);
+	elf_symbol_t *sym = NULL;
+
+	futex_down(&sym_cache_futex);
+
+	if (e->rtld == rtld && e->hash == hash->gnu && e->flags == flags &&
+	    str_cmp(name, e->mod->dyn.str_tab + e->sym->st_name) == 0) {
+		sym = e->sym;
+		*mod = e->mod;
+	}
+
+	futex_up(&sym_cache_futex);
+	return sym;
+}
+
+/** Remember a global definition in the symbol lookup cache. */
+static void sym_cache_insert(const sym_hash_t *hash, rtld_t *rtld,
+    symbol_search_flags_t flags, elf_symbol_t *sym, module_t *mod)
+{
+	sym_cache_entry_t *e = sym_cache_entry(hash);
+
+	futex_down(&sym_cache_futex);
+
+	e->rtld = rtld;
+	e->hash = hash->gnu;
+	e->flags = flags;
+	e->sym = sym;
+	e->mod = mod;
+
+	futex_up(&sym_cache_futex);
+}
+
 /** Find the definition of a symbol in a module and its deps.
  *
  * Search the module dependency graph is breadth-first, beginning
@@ -120,6 +288,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 	module_t *m, *dm;
 	elf_symbol_t *sym, *s;
 	list_t queue;
+	sym_hash_t hash;
 	size_t i;
 
 	/*
@@ -139,6 +308,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 
 	/* If the symbol is found, it will be stored in 'sym' */
 	sym = NULL;
+	sym_hash_compute(name, &hash);
 
 	/* While queue is not empty */
 	while (!list_empty(&queue)) {
@@ -147,7 +317,7 @@ elf_symbol_t *symbol_bfs_find(const char *name, module_t *start,
 		list_remove(&m->queue_link);
 
 		/* If ssf_noroot is specified, do not look in start module */
-		s = def_find_in_module(name, m);
+		s = def_find_in_module(name, &hash, m);
 		if (s != NULL) {
 			/* Symbol found */
 			sym = s;
@@ -198,16 +368,20 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
     symbol_search_flags_t flags, module_t **mod)
 {
 	elf_symbol_t *s;
+	sym_hash_t hash;
 
 	DPRINTF("symbol_def_find('%s', origin='%s'\n",
 	    name, origin->dyn.soname);
+
+	sym_hash_compute(name, &hash);
+
 	if (origin->dyn.symbolic && (!origin->exec || (flags & ssf_noexec) == 0)) {
 		DPRINTF("symbolic->find '%s' in module '%s'\n", name, origin->dyn.soname);
 		/*
 		 * Origin module has a DT_SYMBOLIC flag.
 		 * Try this module first
 		 */
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(name, &hash, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -217,13 +391,19 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 
 	/* Not DT_SYMBOLIC or no match. Now try other locations. */
 
+	s = sym_cache_find(name, &hash, origin->rtld, flags, mod);
+	if (s != NULL)
+		return s;
+
 	list_foreach(origin->rtld->modules, modules_link, module_t, m) {
 		DPRINTF("module '%s' local?\n", m->dyn.soname);
 		if (!m->local && (!m->exec || (flags & ssf_noexec) == 0)) {
 			DPRINTF("!local->find '%s' in module '%s'\n", name, m->dyn.soname);
-			s = def_find_in_module(name, m);
+			s = def_find_in_module(name, &hash, m);
 			if (s != NULL) {
 				/* Found */
+				sym_cache_insert(&hash, origin->rtld, flags,
+				    s, m);
 				*mod = m;
 				return s;
 			}
@@ -236,7 +416,7 @@ elf_symbol_t *symbol_def_find(const char *name, module_t *origin,
 	    origin->dyn.soname);
 
 	if (!origin->exec || (flags & ssf_noexec) == 0) {
-		s = def_find_in_module(name, origin);
+		s = def_find_in_module(name, &hash, origin);
 		if (s != NULL) {
 			/* Found */
 			*mod = origin;
@@ -66,6 +66,12 @@
 /** Number of data bits in a UTF-8 continuation byte */
 #define CONT_BITS  6
 
+/** Word with all bytes equal to one */
+#define ONES_WORD  (~0UL / 0xff)
+
+/** Non-zero iff one of the bytes of word @w is zero */
+#define HAS_ZERO_BYTE(w)  (((w) - ONES_WORD) & ~(w) & (ONES_WORD << 7))
+
 /** Decode a single character from a string.
  *
  * Decode a single character from a string of size @a size. Decoding starts
@@ -262,12 +268,29 @@ int chr_encode(const wchar_t ch, char *str, size_t *offset, size_t size)
  */
 size_t str_size(const char *str)
 {
-	size_t size = 0;
+	const char *pos = str;
 	
-	while (*str++ != 0)
-		size++;
+	/* Scan byte by byte up to the first word boundary. */
+	while (((uintptr_t) pos & (sizeof(unsigned long) - 1)) != 0) {
+		if (*pos == 0)
+			return pos - str;
+		
+		pos++;
+	}
 	
-	return size;
+	/*
+	 * Scan word by word. An aligned word never crosses a page
+	 * boundary, thus reading past the terminator is harmless.
+	 */
+	const unsigned long *word = (const unsigned long *) pos;
+	while (!HAS_ZERO_BYTE(*word))
+		word++;
+	
+	pos = (const char *) word;
+	while (*pos != 0)
+		pos++;
+	
+	return pos - str;
 }
 
 /** Get size of wide string.
@@ -524,6 +547,14 @@ int str_cmp(const char *s1, const char *s2)
 	size_t off2 = 0;
 
 	while (true) {
+		/* Equal ASCII characters do not need to be decoded. */
+		uint8_t b1 = (uint8_t) s1[off1];
+		if ((b1 == (uint8_t) s2[off2]) && (b1 != 0) && (b1 < 0x80)) {
+			off1++;
+			off2++;
+			continue;
+		}
+
 		c1 = str_decode(s1, &off1, STR_NO_LIMIT);
 		c2 = str_decode(s2, &off2, STR_NO_LIMIT);
 
@@ -1127,14 +1158,30 @@ wchar_t *str_to_awstr(const char *str)
  */
 char *str_chr(const char *str, wchar_t ch)
 {
-	wchar_t acc;
 	size_t off = 0;
-	size_t last = 0;
 	
-	while ((acc = str_decode(str, &off, STR_NO_LIMIT)) != 0) {
+	while (true) {
+		size_t last = off;
+		
+		/* ASCII characters do not need to be decoded. */
+		uint8_t b = (uint8_t) str[off];
+		if (b < 0x80) {
+			if (b == 0)
+				break;
+			
+			off++;
+			if (b == ch)
+				return (char *) (str + last);
+			
+			continue;
+		}
+		
+		wchar_t acc = str_decode(str, &off, STR_NO_LIMIT);
+		if (acc == 0)
+			break;
+		
 		if (acc == ch)
 			return (char *) (str + last);
-		last = off;
 	}
 	
 	return NULL;
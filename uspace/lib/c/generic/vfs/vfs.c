@@ -724,6 +724,25 @@ int vfs_mount_path(const char *mp, const char *fs_name, const char *fqsn,
 }
 
 
+/** Reserve a file handle for pager mappings
+ *
+ * Afterwards the file handle can only be used as the pager identifier of
+ * address space areas and it stays open until the task terminates. The
+ * file cannot be written or truncated while it is reserved.
+ *
+ * @param file  File handle opened for reading only
+ *
+ * @return      EOK on success or a negative error code
+ */
+int vfs_map(int file)
+{
+	async_exch_t *exch = vfs_exchange_begin();
+	int rc = async_req_1_0(exch, VFS_IN_MAP, file);
+	vfs_exchange_end(exch);
+	
+	return rc;
+}
+
 /** Open a file handle for I/O
  *
  * @param file  File handle to enable I/O on
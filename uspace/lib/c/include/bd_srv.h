@@ -54,6 +54,12 @@ typedef struct {
 	bd_srvs_t *srvs;
 	async_sess_t *client_sess;
 	void *carg;
+	/** Maximum number of read and write requests served at once */
+	size_t queue_depth;
+	/** Number of read and write requests being served */
+	size_t outstanding;
+	fibril_mutex_t lock;
+	fibril_condvar_t outstanding_cv;
 } bd_srv_t;
 
 struct bd_ops {
@@ -65,6 +71,7 @@ struct bd_ops {
 	int (*write_blocks)(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 	int (*get_block_size)(bd_srv_t *, size_t *);
 	int (*get_num_blocks)(bd_srv_t *, aoff64_t *);
+	int (*get_queue_depth)(bd_srv_t *, size_t *);
 };
 
 extern void bd_srvs_init(bd_srvs_t *);
@@ -105,6 +105,9 @@ typedef struct {
 
 	/** Store extracted info here */
 	elf_finfo_t *info;
+
+	/** File handle reserved for paged segments or -1 */
+	int pager_fd;
 } elf_ld_t;
 
 extern const char *elf_error(unsigned int);
@@ -56,6 +56,8 @@ typedef struct {
 	void *data;
 	/** Size of @c data in bytes */
 	size_t size;
+	/** Maximum segment size for segmentation offload (0 if not used) */
+	size_t mss;
 } iplink_sdu_t;
 
 /** IPv6 link Service Data Unit */
@@ -88,6 +90,7 @@ extern int iplink_send6(iplink_t *, iplink_sdu6_t *);
 extern int iplink_addr_add(iplink_t *, inet_addr_t *);
 extern int iplink_addr_remove(iplink_t *, inet_addr_t *);
 extern int iplink_get_mtu(iplink_t *, size_t *);
+extern int iplink_get_gso_max(iplink_t *, size_t *);
 extern int iplink_get_mac48(iplink_t *, addr48_t *);
 extern int iplink_set_mac48(iplink_t *, addr48_t);
 extern void *iplink_get_userptr(iplink_t *);
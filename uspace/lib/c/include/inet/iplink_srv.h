@@ -57,6 +57,7 @@ typedef struct iplink_ops {
 	int (*send)(iplink_srv_t *, iplink_sdu_t *);
 	int (*send6)(iplink_srv_t *, iplink_sdu6_t *);
 	int (*get_mtu)(iplink_srv_t *, size_t *);
+	int (*get_gso_max)(iplink_srv_t *, size_t *);
 	int (*get_mac48)(iplink_srv_t *, addr48_t *);
 	int (*set_mac48)(iplink_srv_t *, addr48_t *);
 	int (*addr_add)(iplink_srv_t *, inet_addr_t *);
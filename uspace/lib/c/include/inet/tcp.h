@@ -39,6 +39,7 @@
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 #include <inet/inet.h>
+#include <offset.h>
 
 /** TCP connection */
 typedef struct {
@@ -81,6 +82,14 @@ typedef struct tcp_listen_cb {
 	void (*new_conn)(tcp_listener_t *, tcp_conn_t *);
 } tcp_listen_cb_t;
 
+/** Buffer for gathered send */
+typedef struct {
+	/** Data */
+	const void *data;
+	/** Size of data in bytes */
+	size_t size;
+} tcp_iovec_t;
+
 /** TCP service */
 typedef struct tcp {
 	/** TCP session */
@@ -110,6 +119,9 @@ extern void *tcp_listener_userptr(tcp_listener_t *);
 
 extern int tcp_conn_wait_connected(tcp_conn_t *);
 extern int tcp_conn_send(tcp_conn_t *, const void *, size_t);
+extern int tcp_conn_sendv(tcp_conn_t *, const tcp_iovec_t *, size_t);
+extern int tcp_conn_sendfile(tcp_conn_t *, int, aoff64_t, aoff64_t,
+    aoff64_t *);
 extern int tcp_conn_send_fin(tcp_conn_t *);
 extern int tcp_conn_push(tcp_conn_t *);
 extern int tcp_conn_reset(tcp_conn_t *);
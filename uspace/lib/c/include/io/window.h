@@ -44,7 +44,8 @@
 typedef enum {
 	WINDOW_MAIN = 1,
 	WINDOW_DECORATED = 2,
-	WINDOW_RESIZEABLE = 4
+	WINDOW_RESIZEABLE = 4,
+	WINDOW_OPAQUE = 8
 } window_flags_t;
 
 typedef enum {
@@ -43,7 +43,8 @@ typedef enum {
 	BD_READ_BLOCKS,
 	BD_SYNC_CACHE,
 	BD_WRITE_BLOCKS,
-	BD_READ_TOC
+	BD_READ_TOC,
+	BD_GET_QUEUE_DEPTH
 } bd_request_t;
 
 #endif
@@ -34,6 +34,46 @@
 #define LIBC_IPC_LOGGER_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
+
+/** Size of the record ring shared by a writer with the logger (in bytes). */
+#define LOGGER_RING_SIZE  (64 * 1024)
+
+/** Header of the record ring shared by a writer with the logger.
+ *
+ * The ring is a single-producer single-consumer queue. The writer
+ * appends records at @c head, the logger consumes them from @c tail.
+ * Both are free-running byte counters, reduced modulo @c size when
+ * used as offsets into the data area that follows the header.
+ */
+typedef struct {
+	/** Generation of logging levels, bumped by the logger on any change. */
+	volatile uint32_t level_gen;
+	/** Set by the writer when it asks the logger to drain the ring. */
+	volatile uint32_t kick;
+	/** Number of bytes written by the writer. */
+	volatile uint32_t head;
+	/** Number of bytes consumed by the logger. */
+	volatile uint32_t tail;
+	/** Size of the data area. */
+	uint32_t size;
+	uint32_t reserved;
+} logger_ring_t;
+
+/** Record in the shared ring.
+ *
+ * The record header is followed by the message (without the terminating
+ * zero). Records never wrap around the end of the data area; a record
+ * with @c log set to zero pads the rest of the data area instead.
+ */
+typedef struct {
+	/** Log id, zero for padding. */
+	sysarg_t log;
+	/** Message severity level (log_level_t). */
+	uint32_t level;
+	/** Length of the message in bytes. */
+	uint32_t length;
+} logger_record_t;
 
 typedef enum {
 	/** Set (global) default displayed logging level.
@@ -71,7 +111,24 @@ typedef enum {
 	 * Returns: error code
 	 * Followed by: string with the message.
 	 */
-	LOGGER_WRITER_MESSAGE
+	LOGGER_WRITER_MESSAGE,
+	/** Get the effective logging level of a given log.
+	 *
+	 * Arguments: log id.
+	 * Returns: error code, log level
+	 */
+	LOGGER_WRITER_GET_LEVEL,
+	/** Set up the shared record ring.
+	 *
+	 * Returns: error code
+	 * Followed by: sharing of an area starting with logger_ring_t.
+	 */
+	LOGGER_WRITER_SET_RING,
+	/** Process all records queued in the shared ring.
+	 *
+	 * Returns: error code (once the ring is empty)
+	 */
+	LOGGER_WRITER_DRAIN
 } logger_writer_request_t;
 
 #endif
@@ -44,6 +44,8 @@ typedef enum {
 	TCP_LISTENER_CREATE,
 	TCP_LISTENER_DESTROY,
 	TCP_CONN_SEND,
+	TCP_CONN_SENDV,
+	TCP_CONN_SENDFILE,
 	TCP_CONN_SEND_FIN,
 	TCP_CONN_PUSH,
 	TCP_CONN_RESET,
@@ -45,7 +45,8 @@ extern void *memcpy(void *, const void *, size_t)
     __attribute__((nonnull(1, 2)))
     ATTRIBUTE_OPTIMIZE("-fno-tree-loop-distribute-patterns");
 extern void *memmove(void *, const void *, size_t)
-    __attribute__((nonnull(1, 2)));
+    __attribute__((nonnull(1, 2)))
+    ATTRIBUTE_OPTIMIZE("-fno-tree-loop-distribute-patterns");
 extern int memcmp(const void *, const void *, size_t)
     __attribute__((nonnull(1, 2)));
 
@@ -69,6 +69,9 @@ typedef struct dyn_info {
 	/** Hash table */
 	elf_word *hash;
 
+	/** GNU hash table */
+	elf_word *gnu_hash;
+
 	/** String table */
 	char *str_tab;
 	size_t str_sz;
@@ -42,6 +42,8 @@ void module_process_pre_arch(module_t *m);
 
 void rel_table_process(module_t *m, elf_rel_t *rt, size_t rt_size);
 void rela_table_process(module_t *m, elf_rela_t *rt, size_t rt_size);
+bool plt_lazy_setup(module_t *m);
+void *_rtld_plt_resolve(module_t *m, size_t reloff);
 
 void program_run(void *entry, pcb_t *pcb);
 
@@ -50,6 +50,8 @@ typedef struct {
 	uint8_t tos;
 	void *data;
 	size_t size;
+	/** Maximum segment size for segmentation offload (0 if not used) */
+	size_t mss;
 } inet_dgram_t;
 
 typedef struct {
@@ -96,6 +96,7 @@ extern int vfs_link(int, const char *, vfs_file_kind_t, int *);
 extern int vfs_link_path(const char *, vfs_file_kind_t, int *);
 extern int vfs_lookup(const char *, int);
 extern int vfs_lookup_open(const char *, int, int);
+extern int vfs_map(int);
 extern int vfs_mount_path(const char *, const char *, const char *,
     const char *, unsigned int, unsigned int);
 extern int vfs_mount(int, const char *, service_id_t, const char *, unsigned,
@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file
+ * @brief Implementation of deflate compression
+ *
+ * A simple deflate compressor (RFC 1951) meant for compressing data on
+ * the fly, e.g. for network protocols. Matches are found greedily using
+ * hash chains over a 32 KiB window and are emitted using the fixed
+ * Huffman codes, so no code tables need to be built or transmitted.
+ * Input which does not compress is emitted in stored blocks.
+ *
+ * Every call compresses one self-contained piece of data. Unless the
+ * final block is requested, the output is terminated by an empty stored
+ * block (a sync flush in zlib parlance), so consecutive outputs can be
+ * concatenated into a single deflate stream.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <malloc.h>
+#include <mem.h>
+#include "deflate.h"
+
+/** Window size (maximal match distance) */
+#define WINDOW_SIZE  32768
+#define WINDOW_MASK  (WINDOW_SIZE - 1)
+
+/** Hash table size for match searching */
+#define HASH_BITS  12
+#define HASH_SIZE  (1 << HASH_BITS)
+
+/** Maximal number of hash chain entries examined per match */
+#define MAX_CHAIN  32
+
+/** Minimal and maximal match length */
+#define MIN_MATCH  3
+#define MAX_MATCH  258
+
+/** Maximal size of stored block */
+#define MAX_STORED  65535
+
+/** Size of stored block header (including alignment) */
+#define STORED_HEADER  5
+
+/** End of block symbol */
+#define END_OF_BLOCK  256
+
+/** Empty hash chain */
+#define NIL  UINT32_MAX
+
+/** Deflate block types */
+#define BTYPE_STORED  0
+#define BTYPE_FIXED   1
+
+/** Deflate algorithm state
+ *
+ */
+typedef struct {
+	uint8_t *dest;    /**< Output buffer */
+	size_t destlen;   /**< Output buffer size */
+	size_t destcnt;   /**< Position in the output buffer */
+	
+	uint32_t bitbuf;  /**< Bit buffer */
+	size_t bitlen;    /**< Number of bits in the bit buffer */
+	
+	bool overrun;     /**< Overrun condition */
+} deflate_state_t;
+
+/** Base for length codes 257..285 */
+static const uint16_t len_base[] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/** Extra bits for length codes 257..285 */
+static const uint16_t len_ext[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Base for distance codes 0..29 */
+static const uint16_t dist_base[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+/** Extra bits for distance codes 0..29 */
+static const uint16_t dist_ext[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/** Append bits to the output
+ *
+ * The bits are stored starting with the least significant bit.
+ *
+ * @param state Deflate state.
+ * @param value Bits to append.
+ * @param count Number of bits to append (at most 16).
+ *
+ */
+static void put_bits(deflate_state_t *state, uint32_t value, size_t count)
+{
+	state->bitbuf |= value << state->bitlen;
+	state->bitlen += count;
+	
+	while (state->bitlen >= 8) {
+		if (state->destcnt == state->destlen) {
+			state->overrun = true;
+			state->bitbuf = 0;
+			state->bitlen = 0;
+			return;
+		}
+		
+		state->dest[state->destcnt++] = state->bitbuf & 0xff;
+		state->bitbuf >>= 8;
+		state->bitlen -= 8;
+	}
+}
+
+/** Pad the output to a byte boundary
+ *
+ * @param state Deflate state.
+ *
+ */
+static void put_align(deflate_state_t *state)
+{
+	if (state->bitlen > 0)
+		put_bits(state, 0, 8 - state->bitlen);
+}
+
+/** Append a Huffman code to the output
+ *
+ * Huffman codes are stored starting with the most significant bit.
+ *
+ * @param state Deflate state.
+ * @param code  Huffman code.
+ * @param len   Huffman code length.
+ *
+ */
+static void put_code(deflate_state_t *state, uint16_t code, size_t len)
+{
+	uint16_t rev = 0;
+	
+	for (size_t i = 0; i < len; i++) {
+		rev = (rev << 1) | (code & 1);
+		code >>= 1;
+	}
+	
+	put_bits(state, rev, len);
+}
+
+/** Append a literal/length symbol using the fixed Huffman code
+ *
+ * @param state  Deflate state.
+ * @param symbol Literal/length symbol (0..287).
+ *
+ */
+static void put_fixed_symbol(deflate_state_t *state, uint16_t symbol)
+{
+	if (symbol < 144)
+		put_code(state, 0x30 + symbol, 8);
+	else if (symbol < 256)
+		put_code(state, 0x190 + (symbol - 144), 9);
+	else if (symbol < 280)
+		put_code(state, symbol - 256, 7);
+	else
+		put_code(state, 0xc0 + (symbol - 280), 8);
+}
+
+/** Append a match using the fixed Huffman code
+ *
+ * @param state Deflate state.
+ * @param len   Match length (MIN_MATCH..MAX_MATCH).
+ * @param dist  Match distance (1..WINDOW_SIZE).
+ *
+ */
+static void put_fixed_match(deflate_state_t *state, size_t len, size_t dist)
+{
+	size_t lcode = sizeof(len_base) / sizeof(len_base[0]) - 1;
+	while (len_base[lcode] > len)
+		lcode--;
+	
+	put_fixed_symbol(state, 257 + lcode);
+	put_bits(state, len - len_base[lcode], len_ext[lcode]);
+	
+	size_t dcode = sizeof(dist_base) / sizeof(dist_base[0]) - 1;
+	while (dist_base[dcode] > dist)
+		dcode--;
+	
+	put_code(state, dcode, 5);
+	put_bits(state, dist - dist_base[dcode], dist_ext[dcode]);
+}
+
+/** Append a block header
+ *
+ * @param state Deflate state.
+ * @param last  Last block of the stream.
+ * @param type  Block type.
+ *
+ */
+static void put_block_header(deflate_state_t *state, bool last, uint32_t type)
+{
+	put_bits(state, last ? 1 : 0, 1);
+	put_bits(state, type, 2);
+}
+
+/** Append a stored block
+ *
+ * @param state  Deflate state.
+ * @param data   Block data.
+ * @param length Block data length (at most MAX_STORED).
+ * @param last   Last block of the stream.
+ *
+ */
+static void put_stored_block(deflate_state_t *state, const uint8_t *data,
+    size_t length, bool last)
+{
+	put_block_header(state, last, BTYPE_STORED);
+	put_align(state);
+	
+	put_bits(state, length, 16);
+	put_bits(state, length ^ 0xffff, 16);
+	
+	if (state->destlen - state->destcnt < length) {
+		state->overrun = true;
+		return;
+	}
+	
+	if (length > 0) {
+		memcpy(state->dest + state->destcnt, data, length);
+		state->destcnt += length;
+	}
+}
+
+/** Terminate the output
+ *
+ * @param state Deflate state.
+ * @param final The output ends the stream.
+ *
+ */
+static void put_flush(deflate_state_t *state, bool final)
+{
+	if (final)
+		put_align(state);
+	else
+		put_stored_block(state, NULL, 0, false);
+}
+
+static uint32_t hash_bytes(const uint8_t *data)
+{
+	uint32_t val = data[0] | (data[1] << 8) | (data[2] << 16);
+	return (val * UINT32_C(2654435761)) >> (32 - HASH_BITS);
+}
+
+static size_t match_length(const uint8_t *a, const uint8_t *b, size_t max_len)
+{
+	size_t len = 0;
+	while ((len < max_len) && (a[len] == b[len]))
+		len++;
+	
+	return len;
+}
+
+/** Compress data into a single block using the fixed Huffman code
+ *
+ * @param state  Deflate state.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ * @param final  Compressed data end the stream.
+ * @param head   Hash table (HASH_SIZE entries).
+ * @param prev   Hash chains (WINDOW_SIZE entries).
+ *
+ */
+static void deflate_fixed(deflate_state_t *state, const uint8_t *src,
+    size_t srclen, bool final, uint32_t *head, uint32_t *prev)
+{
+	for (size_t i = 0; i < HASH_SIZE; i++)
+		head[i] = NIL;
+	
+	put_block_header(state, final, BTYPE_FIXED);
+	
+	size_t pos = 0;
+	while ((pos < srclen) && (!state->overrun)) {
+		size_t best_len = 0;
+		size_t best_dist = 0;
+		
+		if (pos + MIN_MATCH <= srclen) {
+			uint32_t hash = hash_bytes(src + pos);
+			uint32_t cand = head[hash];
+			size_t max_len = srclen - pos;
+			if (max_len > MAX_MATCH)
+				max_len = MAX_MATCH;
+			
+			for (size_t chain = 0; (chain < MAX_CHAIN) && (cand != NIL);
+			    chain++) {
+				size_t dist = pos - cand;
+				if (dist > WINDOW_SIZE)
+					break;
+				
+				/* Skip candidates which cannot beat the best match */
+				if (src[cand + best_len] == src[pos + best_len]) {
+					size_t len = match_length(src + cand, src + pos,
+					    max_len);
+					
+					if (len > best_len) {
+						best_len = len;
+						best_dist = dist;
+						if (len == max_len)
+							break;
+					}
+				}
+				
+				uint32_t next = prev[cand & WINDOW_MASK];
+				if ((next == NIL) || (next >= cand))
+					break;
+				
+				cand = next;
+			}
+			
+			prev[pos & WINDOW_MASK] = head[hash];
+			head[hash] = pos;
+		}
+		
+		if (best_len >= MIN_MATCH) {
+			put_fixed_match(state, best_len, best_dist);
+			
+			/* Hash the positions covered by the match */
+			for (size_t i = pos + 1; i < pos + best_len; i++) {
+				if (i + MIN_MATCH > srclen)
+					break;
+				
+				uint32_t hash = hash_bytes(src + i);
+				prev[i & WINDOW_MASK] = head[hash];
+				head[hash] = i;
+			}
+			
+			pos += best_len;
+		} else {
+			put_fixed_symbol(state, src[pos]);
+			pos++;
+		}
+	}
+	
+	put_fixed_symbol(state, END_OF_BLOCK);
+	put_flush(state, final);
+}
+
+/** Store data without compression
+ *
+ * @param state  Deflate state.
+ * @param src    Source data buffer.
+ * @param srclen Source buffer size (bytes).
+ * @param final  Stored data end the stream.
+ *
+ */
+static void deflate_stored(deflate_state_t *state, const uint8_t *src,
+    size_t srclen, bool final)
+{
+	size_t pos = 0;
+	
+	do {
+		size_t length = srclen - pos;
+		if (length > MAX_STORED)
+			length = MAX_STORED;
+		
+		bool last = (pos + length == srclen);
+		put_stored_block(state, src + pos, length, final && last);
+		pos += length;
+	} while ((pos < srclen) && (!state->overrun));
+	
+	if (!final)
+		put_flush(state, false);
+}
+
+/** Get the maximal size of deflated data
+ *
+ * @param srclen Source data size (bytes).
+ *
+ * @return Size of the output buffer sufficient for deflating
+ *         any data of the given size.
+ *
+ */
+size_t deflate_bound(size_t srclen)
+{
+	return srclen + (srclen / MAX_STORED + 2) * STORED_HEADER;
+}
+
+/** Deflate data
+ *
+ * The output is a sequence of complete deflate blocks. If @a final
+ * is false, the output is terminated by an empty stored block and
+ * further data can be appended to the stream by subsequent calls.
+ * Matches never refer to data of previous calls.
+ *
+ * @param src      Source data buffer.
+ * @param srclen   Source buffer size (bytes).
+ * @param dest     Destination data buffer.
+ * @param destlen  Destination buffer size (bytes).
+ * @param destused Number of bytes stored into the destination buffer.
+ * @param final    The output ends the deflate stream.
+ *
+ * @return EOK on success.
+ * @return EINVAL if the source data is too large.
+ * @return ENOMEM on output buffer overrun or if out of memory.
+ *
+ */
+int deflate(const void *src, size_t srclen, void *dest, size_t destlen,
+    size_t *destused, bool final)
+{
+	if (srclen >= NIL)
+		return EINVAL;
+	
+	uint32_t *tables = malloc((HASH_SIZE + WINDOW_SIZE) * sizeof(uint32_t));
+	if (tables == NULL)
+		return ENOMEM;
+	
+	/*
+	 * Do not let the compressed data grow over the size
+	 * of the stored data, store the data instead.
+	 */
+	size_t limit = deflate_bound(srclen);
+	
+	deflate_state_t state;
+	state.dest = (uint8_t *) dest;
+	state.destlen = (destlen < limit) ? destlen : limit;
+	state.destcnt = 0;
+	state.bitbuf = 0;
+	state.bitlen = 0;
+	state.overrun = false;
+	
+	deflate_fixed(&state, (const uint8_t *) src, srclen, final, tables,
+	    tables + HASH_SIZE);
+	free(tables);
+	
+	if (state.overrun) {
+		state.destlen = destlen;
+		state.destcnt = 0;
+		state.bitbuf = 0;
+		state.bitlen = 0;
+		state.overrun = false;
+		
+		deflate_stored(&state, (const uint8_t *) src, srclen, final);
+		if (state.overrun)
+			return ENOMEM;
+	}
+	
+	*destused = state.destcnt;
+	return EOK;
+}
@@ -39,6 +39,9 @@
 
 #include "drawctx.h"
 
+/** Number of source pixels determined at once by drawctx_transfer(). */
+#define TRANSFER_CHUNK  256
+
 void drawctx_init(drawctx_t *context, surface_t *surface)
 {
 	assert(surface);
@@ -147,6 +150,26 @@ void drawctx_transfer(drawctx_t *context,
 		}
 		surface_add_damaged_region(context->surface, x, y, width, height);
 
+	} else if ((context->shall_clip == false) && (context->mask == NULL)) {
+
+		/* Sample the source a row chunk at a time. */
+		pixel_t row[TRANSFER_CHUNK];
+		for (sysarg_t _y = y; _y < y + height; ++_y) {
+			for (sysarg_t _x = x; _x < x + width; _x += TRANSFER_CHUNK) {
+				sysarg_t count = x + width - _x;
+				if (count > TRANSFER_CHUNK)
+					count = TRANSFER_CHUNK;
+
+				source_determine_row(context->source, _x, _y, count, row);
+
+				for (sysarg_t i = 0; i < count; ++i) {
+					pixel_t p_dst = surface_get_pixel(context->surface, _x + i, _y);
+					pixel_t p_res = context->compose(row[i], p_dst);
+					surface_put_pixel(context->surface, _x + i, _y, p_res);
+				}
+			}
+		}
+
 	} else {
 
 		bool clipped = false;
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup draw
+ * @{
+ */
+/**
+ * @file
+ * Cache of rendered glyphs of the built-in 8x16 font.
+ *
+ * Rendering a character cell from the font bitmap costs a test and a
+ * store per pixel. Text usually uses only a few color combinations, so
+ * cells are rendered once for each (glyph, foreground, background)
+ * triple and then copied to the target one scanline at a time. The
+ * least recently used glyphs are evicted once the budget is exceeded.
+ *
+ * The cache is not synchronized, callers are expected to serialize
+ * access to it (e.g. by the lock protecting the drawing surface).
+ */
+
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <malloc.h>
+#include <mem.h>
+#include "gfx/font-8x16.h"
+#include "glyph_cache.h"
+
+typedef struct {
+	uint16_t glyph;
+	pixel_t fgcolor;
+	pixel_t bgcolor;
+} glyph_key_t;
+
+typedef struct {
+	ht_link_t link;
+	link_t lru_link;
+	glyph_key_t key;
+	pixel_t pixels[FONT_SCANLINES * FONT_WIDTH];
+} glyph_entry_t;
+
+struct glyph_cache {
+	hash_table_t entries;
+	/** Least recently used entries first */
+	list_t lru;
+	size_t count;
+	size_t budget;
+};
+
+static size_t glyph_key_hash_key(const glyph_key_t *key)
+{
+	return key->glyph ^ (key->fgcolor * 31) ^ (key->bgcolor * 1021);
+}
+
+static size_t glyph_hash(const ht_link_t *item)
+{
+	glyph_entry_t *entry = hash_table_get_inst(item, glyph_entry_t, link);
+	return glyph_key_hash_key(&entry->key);
+}
+
+static size_t glyph_key_hash(void *key)
+{
+	return glyph_key_hash_key((glyph_key_t *) key);
+}
+
+static bool glyph_key_equal(void *key, const ht_link_t *item)
+{
+	glyph_key_t *k = (glyph_key_t *) key;
+	glyph_entry_t *entry = hash_table_get_inst(item, glyph_entry_t, link);
+	
+	return ((entry->key.glyph == k->glyph) &&
+	    (entry->key.fgcolor == k->fgcolor) &&
+	    (entry->key.bgcolor == k->bgcolor));
+}
+
+static bool glyph_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	glyph_entry_t *entry = hash_table_get_inst(item1, glyph_entry_t, link);
+	return glyph_key_equal(&entry->key, item2);
+}
+
+static void glyph_remove_callback(ht_link_t *item)
+{
+	glyph_entry_t *entry = hash_table_get_inst(item, glyph_entry_t, link);
+	
+	list_remove(&entry->lru_link);
+	free(entry);
+}
+
+static hash_table_ops_t glyph_cache_ops = {
+	.hash = glyph_hash,
+	.key_hash = glyph_key_hash,
+	.key_equal = glyph_key_equal,
+	.equal = glyph_equal,
+	.remove_callback = glyph_remove_callback
+};
+
+/** Create a glyph cache.
+ *
+ * @param budget Maximal number of glyphs kept in the cache.
+ *
+ * @return New glyph cache or NULL if out of memory.
+ *
+ */
+glyph_cache_t *glyph_cache_create(size_t budget)
+{
+	glyph_cache_t *cache = (glyph_cache_t *) malloc(sizeof(glyph_cache_t));
+	if (cache == NULL)
+		return NULL;
+	
+	if (!hash_table_create(&cache->entries, 0, 0, &glyph_cache_ops)) {
+		free(cache);
+		return NULL;
+	}
+	
+	list_initialize(&cache->lru);
+	cache->count = 0;
+	cache->budget = (budget > 0) ? budget : 1;
+	
+	return cache;
+}
+
+void glyph_cache_destroy(glyph_cache_t *cache)
+{
+	hash_table_destroy(&cache->entries);
+	free(cache);
+}
+
+static void glyph_render(glyph_entry_t *entry)
+{
+	pixel_t *dst = entry->pixels;
+	
+	for (unsigned int y = 0; y < FONT_SCANLINES; y++) {
+		uint8_t bits = fb_font[entry->key.glyph][y];
+		
+		for (unsigned int x = 0; x < FONT_WIDTH; x++) {
+			*dst++ = (bits & (1 << (FONT_WIDTH - 1 - x))) ?
+			    entry->key.fgcolor : entry->key.bgcolor;
+		}
+	}
+}
+
+/** Find a rendered glyph, render it if it is not cached yet.
+ *
+ * @return Rendered glyph or NULL if out of memory.
+ *
+ */
+static glyph_entry_t *glyph_cache_get(glyph_cache_t *cache, uint16_t glyph,
+    pixel_t fgcolor, pixel_t bgcolor)
+{
+	glyph_key_t key = {
+		.glyph = glyph,
+		.fgcolor = fgcolor,
+		.bgcolor = bgcolor
+	};
+	
+	ht_link_t *item = hash_table_find(&cache->entries, &key);
+	if (item != NULL) {
+		glyph_entry_t *entry =
+		    hash_table_get_inst(item, glyph_entry_t, link);
+		
+		list_remove(&entry->lru_link);
+		list_append(&entry->lru_link, &cache->lru);
+		return entry;
+	}
+	
+	if (cache->count >= cache->budget) {
+		/* Evict the least recently used entry. */
+		glyph_entry_t *victim = list_get_instance(list_first(&cache->lru),
+		    glyph_entry_t, lru_link);
+		hash_table_remove_item(&cache->entries, &victim->link);
+		cache->count--;
+	}
+	
+	glyph_entry_t *entry = (glyph_entry_t *) malloc(sizeof(glyph_entry_t));
+	if (entry == NULL)
+		return NULL;
+	
+	entry->key = key;
+	glyph_render(entry);
+	
+	link_initialize(&entry->lru_link);
+	list_append(&entry->lru_link, &cache->lru);
+	hash_table_insert(&cache->entries, &entry->link);
+	cache->count++;
+	
+	return entry;
+}
+
+/** Draw a glyph of the built-in font.
+ *
+ * @param cache   Glyph cache.
+ * @param pixmap  Target pixel map.
+ * @param x       Horizontal position of the character cell.
+ * @param y       Vertical position of the character cell.
+ * @param glyph   Glyph index.
+ * @param fgcolor Foreground color.
+ * @param bgcolor Background color.
+ *
+ */
+void glyph_cache_draw(glyph_cache_t *cache, pixelmap_t *pixmap,
+    sysarg_t x, sysarg_t y, uint16_t glyph, pixel_t fgcolor, pixel_t bgcolor)
+{
+	if ((x >= pixmap->width) || (y >= pixmap->height))
+		return;
+	
+	if (glyph >= FONT_GLYPHS)
+		glyph = 0;
+	
+	glyph_entry_t *entry = glyph_cache_get(cache, glyph, fgcolor, bgcolor);
+	if (entry == NULL)
+		return;
+	
+	/* Clip the character cell against the pixel map. */
+	sysarg_t width = pixmap->width - x;
+	if (width > FONT_WIDTH)
+		width = FONT_WIDTH;
+	
+	sysarg_t height = pixmap->height - y;
+	if (height > FONT_SCANLINES)
+		height = FONT_SCANLINES;
+	
+	const pixel_t *src = entry->pixels;
+	pixel_t *dst = pixmap->data + y * pixmap->width + x;
+	
+	for (sysarg_t row = 0; row < height; row++) {
+		memcpy(dst, src, width * sizeof(pixel_t));
+		src += FONT_WIDTH;
+		dst += pixmap->width;
+	}
+}
+
+/** @}
+ */
@@ -148,5 +148,51 @@ pixel_t source_determine_pixel(source_t *source, double x, double y)
 	}
 }
 
+/** Determine a row of pixels of the source.
+ *
+ * Sources with a texture and no mask are sampled by the fixed-point
+ * counterpart of the filter, stepping the transformed coordinates along
+ * the row incrementally. Other sources are evaluated pixel by pixel.
+ *
+ * @param source Source to evaluate.
+ * @param x      Horizontal coordinate of the first pixel.
+ * @param y      Vertical coordinate of the row.
+ * @param count  Number of pixels to determine.
+ * @param row    Buffer for the pixels.
+ *
+ */
+void source_determine_row(source_t *source, sysarg_t x, sysarg_t y,
+    sysarg_t count, pixel_t *row)
+{
+	filter_fixed_t filter = filter_get_fixed(source->filter);
+	fixed_t fx, fy, dx, dy;
+	
+	if ((source->mask != NULL) || (source->texture == NULL) ||
+	    (filter == NULL) || (ALPHA(source->alpha) == 0) ||
+	    (!transform_span_fixed(&source->transform, x, y, count,
+	    &fx, &fy, &dx, &dy))) {
+		for (sysarg_t i = 0; i < count; i++)
+			row[i] = source_determine_pixel(source, x + i, y);
+		
+		return;
+	}
+	
+	pixelmap_t *pixmap = surface_pixmap_access(source->texture);
+	unsigned int alpha = ALPHA(source->alpha);
+	
+	for (sysarg_t i = 0; i < count; i++) {
+		pixel_t pixel = filter(pixmap, fx, fy, source->texture_extend);
+		
+		if (alpha < 255) {
+			pixel = PIXEL(alpha * ALPHA(pixel) / 255,
+			    RED(pixel), GREEN(pixel), BLUE(pixel));
+		}
+		
+		row[i] = pixel;
+		fx += dx;
+		fy += dy;
+	}
+}
+
 /** @}
  */
@@ -46,7 +46,8 @@ typedef enum {
 	IPC_M_AHCI_GET_NUM_BLOCKS,
 	IPC_M_AHCI_GET_BLOCK_SIZE,
 	IPC_M_AHCI_READ_BLOCKS,
-	IPC_M_AHCI_WRITE_BLOCKS
+	IPC_M_AHCI_WRITE_BLOCKS,
+	IPC_M_AHCI_GET_QUEUE_DEPTH
 } ahci_iface_funcs_t;
 
 #define MAX_NAME_LENGTH  1024
@@ -180,6 +181,24 @@ int ahci_write_blocks(async_sess_t *sess, uint64_t blocknum, size_t count,
 	return rc;
 }
 
+int ahci_get_queue_depth(async_sess_t *sess, size_t *queue_depth)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	if (!exch)
+		return EINVAL;
+	
+	sysarg_t depth;
+	int rc = async_req_1_1(exch, DEV_IFACE_ID(AHCI_DEV_IFACE),
+	    IPC_M_AHCI_GET_QUEUE_DEPTH, &depth);
+	
+	async_exchange_end(exch);
+	
+	if (rc == EOK)
+		*queue_depth = (size_t) depth;
+	
+	return rc;
+}
+
 static void remote_ahci_get_sata_device_name(ddf_fun_t *, void *, ipc_callid_t,
     ipc_call_t *);
 static void remote_ahci_get_num_blocks(ddf_fun_t *, void *, ipc_callid_t,
@@ -190,6 +209,8 @@ static void remote_ahci_read_blocks(ddf_fun_t *, void *, ipc_callid_t,
     ipc_call_t *);
 static void remote_ahci_write_blocks(ddf_fun_t *, void *, ipc_callid_t,
     ipc_call_t *);
+static void remote_ahci_get_queue_depth(ddf_fun_t *, void *, ipc_callid_t,
+    ipc_call_t *);
 
 /** Remote AHCI interface operations. */
 static const remote_iface_func_ptr_t remote_ahci_iface_ops [] = {
@@ -197,7 +218,8 @@ static const remote_iface_func_ptr_t remote_ahci_iface_ops [] = {
 	[IPC_M_AHCI_GET_NUM_BLOCKS] = remote_ahci_get_num_blocks,
 	[IPC_M_AHCI_GET_BLOCK_SIZE] = remote_ahci_get_block_size,
 	[IPC_M_AHCI_READ_BLOCKS] = remote_ahci_read_blocks,
-	[IPC_M_AHCI_WRITE_BLOCKS] = remote_ahci_write_blocks
+	[IPC_M_AHCI_WRITE_BLOCKS] = remote_ahci_write_blocks,
+	[IPC_M_AHCI_GET_QUEUE_DEPTH] = remote_ahci_get_queue_depth
 };
 
 /** Remote AHCI interface structure.
@@ -302,6 +324,7 @@ void remote_ahci_read_blocks(ddf_fun_t *fun, void *iface,
 	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
 	
 	const int ret = ahci_iface->read_blocks(fun, blocknum, cnt, buf);
+	as_area_destroy(buf);
 	
 	async_answer_0(callid, ret);
 }
@@ -331,10 +354,30 @@ void remote_ahci_write_blocks(ddf_fun_t *fun, void *iface, ipc_callid_t callid,
 	const size_t cnt = (size_t) DEV_IPC_GET_ARG3(*call);
 	
 	const int ret = ahci_iface->write_blocks(fun, blocknum, cnt, buf);
+	as_area_destroy(buf);
 	
 	async_answer_0(callid, ret);
 }
 
+static void remote_ahci_get_queue_depth(ddf_fun_t *fun, void *iface,
+    ipc_callid_t callid, ipc_call_t *call)
+{
+	const ahci_iface_t *ahci_iface = (ahci_iface_t *) iface;
+	
+	if (ahci_iface->get_queue_depth == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		return;
+	}
+	
+	size_t depth;
+	const int ret = ahci_iface->get_queue_depth(fun, &depth);
+	
+	if (ret != EOK)
+		async_answer_0(callid, ret);
+	else
+		async_answer_1(callid, EOK, depth);
+}
+
 /**
  * @}
  */
@@ -47,6 +47,7 @@ extern int ahci_get_num_blocks(async_sess_t *, uint64_t *);
 extern int ahci_get_block_size(async_sess_t *, size_t *);
 extern int ahci_read_blocks(async_sess_t *, uint64_t, size_t, void *);
 extern int ahci_write_blocks(async_sess_t *, uint64_t, size_t, void *);
+extern int ahci_get_queue_depth(async_sess_t *, size_t *);
 
 /** AHCI device communication interface. */
 typedef struct {
@@ -55,6 +56,7 @@ typedef struct {
 	int (*get_block_size)(ddf_fun_t *, size_t *);
 	int (*read_blocks)(ddf_fun_t *, uint64_t, size_t, void *);
 	int (*write_blocks)(ddf_fun_t *, uint64_t, size_t, void *);
+	int (*get_queue_depth)(ddf_fun_t *, size_t *);
 } ahci_iface_t;
 
 #endif
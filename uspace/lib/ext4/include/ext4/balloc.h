@@ -42,6 +42,9 @@ extern uint32_t ext4_balloc_get_first_data_block_in_group(ext4_superblock_t *,
     ext4_block_group_ref_t *);
 extern int ext4_balloc_alloc_block(ext4_inode_ref_t *, uint32_t *);
 extern int ext4_balloc_try_alloc_block(ext4_inode_ref_t *, uint32_t, bool *);
+extern int ext4_balloc_alloc_blocks(ext4_inode_ref_t *, uint32_t, uint32_t,
+    uint32_t *, uint32_t *);
+extern void ext4_balloc_prealloc_discard(ext4_filesystem_t *, uint32_t);
 
 #endif
 
@@ -54,6 +54,8 @@ extern void ext4_directory_entry_ll_set_inode_type(ext4_superblock_t *,
 
 extern int ext4_directory_iterator_init(ext4_directory_iterator_t *,
     ext4_inode_ref_t *, aoff64_t);
+extern int ext4_directory_iterator_resume(ext4_directory_iterator_t *,
+    ext4_inode_ref_t *, aoff64_t, uint32_t);
 extern int ext4_directory_iterator_next(ext4_directory_iterator_t *);
 extern int ext4_directory_iterator_fini(ext4_directory_iterator_t *);
 
@@ -38,6 +38,9 @@
 #include "ext4/fstypes.h"
 #include "ext4/types.h"
 
+extern int ext4_filesystem_init(ext4_filesystem_t *, service_id_t,
+    enum cache_mode);
+extern void ext4_filesystem_fini(ext4_filesystem_t *);
 extern int ext4_filesystem_probe(service_id_t);
 extern int ext4_filesystem_open(ext4_instance_t *, service_id_t,
     enum cache_mode, aoff64_t *, ext4_filesystem_t **);
@@ -59,6 +62,8 @@ extern int ext4_filesystem_free_inode(ext4_inode_ref_t *);
 extern int ext4_filesystem_truncate_inode(ext4_inode_ref_t *, aoff64_t);
 extern int ext4_filesystem_get_inode_data_block_index(ext4_inode_ref_t *,
     aoff64_t iblock, uint32_t *);
+extern int ext4_filesystem_get_inode_data_block_run(ext4_inode_ref_t *,
+    aoff64_t, uint32_t *, uint32_t *);
 extern int ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *,
     aoff64_t, uint32_t);
 extern int ext4_filesystem_release_inode_block(ext4_inode_ref_t *, uint32_t);
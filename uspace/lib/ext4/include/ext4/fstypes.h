@@ -35,10 +35,40 @@
 #define LIBEXT4_FSTYPES_H_
 
 #include <adt/list.h>
+#include <fibril_synch.h>
 #include <libfs.h>
 #include <loc.h>
 #include "ext4/types.h"
 
+/** Maximum number of blocks buffered by delayed allocation */
+#define EXT4_DELALLOC_BLOCKS  64
+
+/**
+ * Blocks appended to a file, whose allocation is delayed until they are
+ * flushed. Space for them is reserved at write time.
+ */
+typedef struct ext4_delalloc {
+	fibril_mutex_t lock;
+	uint32_t index;   /* I-node the blocks belong to, 0 if none */
+	uint32_t first;   /* Logical number of the first buffered block */
+	uint32_t count;   /* Number of buffered blocks */
+	uint32_t allocated; /* Leading blocks allocated but not written yet */
+	uint32_t fblock;  /* Physical block of the first allocated block */
+	aoff64_t size;    /* Size of the i-node including buffered data */
+	uint8_t *data;    /* Buffered data */
+} ext4_delalloc_t;
+
+/**
+ * Position where the last directory read stopped. A read continuing from
+ * there resumes without mapping the directory block again.
+ */
+typedef struct ext4_readdir_cursor {
+	fibril_mutex_t lock;
+	uint32_t index;   /* Directory i-node, 0 if none */
+	aoff64_t pos;     /* Offset of the next entry */
+	uint32_t fblock;  /* Physical block containing pos, 0 if unknown */
+} ext4_readdir_cursor_t;
+
 /**
  * Type for holding an instance of mounted partition.
  */
@@ -47,6 +77,8 @@ typedef struct ext4_instance {
 	service_id_t service_id;
 	ext4_filesystem_t *filesystem;
 	unsigned int open_nodes_count;
+	ext4_delalloc_t delalloc;
+	ext4_readdir_cursor_t cursor;
 } ext4_instance_t;
 
 /**
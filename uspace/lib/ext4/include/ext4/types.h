@@ -224,11 +224,43 @@ typedef struct ext4_superblock {
 	EXT4_FEATURE_RO_COMPAT_GDT_CSUM | \
 	EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE)
 
+/** Number of per-inode preallocation windows kept by a filesystem */
+#define EXT4_PREALLOC_WINDOWS  8
+/** Maximum number of blocks kept in a preallocation window */
+#define EXT4_PREALLOC_BLOCKS   64
+
+/** Blocks following the last allocation of an i-node.
+ *
+ * The window is not marked in the block bitmap, the allocator only avoids
+ * handing its blocks out to other i-nodes.
+ */
+typedef struct ext4_prealloc {
+	uint32_t inode;  /* I-node owning the window, 0 if unused */
+	uint32_t start;  /* First block of the window */
+	uint32_t count;  /* Number of blocks in the window */
+} ext4_prealloc_t;
+
+/** Number of extents remembered by the extent lookup cache */
+#define EXT4_EXTENT_CACHE_SIZE  32
+
+/** Extent of an i-node remembered by the extent lookup cache. */
+typedef struct ext4_extent_cache_entry {
+	uint32_t inode;   /* I-node owning the extent, 0 if unused */
+	uint32_t iblock;  /* First logical block of the extent */
+	uint32_t fblock;  /* First physical block of the extent */
+	uint32_t count;   /* Number of blocks in the extent */
+} ext4_extent_cache_entry_t;
+
 typedef struct ext4_filesystem {
 	service_id_t device;
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+	ext4_prealloc_t prealloc[EXT4_PREALLOC_WINDOWS];
+	unsigned int prealloc_next;
+	uint32_t reserved_blocks;  /* Blocks reserved by delayed allocation */
+	ext4_extent_cache_entry_t extent_cache[EXT4_EXTENT_CACHE_SIZE];
+	unsigned int extent_cache_next;
 } ext4_filesystem_t;
 
 
@@ -414,6 +446,7 @@ typedef struct ext4_directory_entry_ll {
 typedef struct ext4_directory_iterator {
 	ext4_inode_ref_t *inode_ref;
 	block_t *current_block;
+	uint32_t current_fblock;  /* Physical address of current_block */
 	aoff64_t current_offset;
 	ext4_directory_entry_ll_t *current;
 } ext4_directory_iterator_t;
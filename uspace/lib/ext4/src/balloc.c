@@ -311,7 +311,7 @@ static int ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal)
 		if (rc != EOK)
 			return rc;
 
-		if (goal != 0) {
+		if (*goal != 0) {
 			(*goal)++;
 			return EOK;
 		}
@@ -334,6 +334,28 @@ static int ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal)
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+/** Get number of free blocks not reserved by delayed allocation.
+ *
+ * Blocks reserved for data buffered by delayed allocation must not be
+ * handed out to other allocations, otherwise the buffered data could not
+ * be written out later.
+ *
+ * @param fs Filesystem
+ *
+ * @return Number of blocks available for allocation
+ *
+ */
+static uint64_t ext4_balloc_unreserved(ext4_filesystem_t *fs)
+{
+	uint64_t free_blocks =
+	    ext4_superblock_get_free_blocks_count(fs->superblock);
+	
+	if (free_blocks <= fs->reserved_blocks)
+		return 0;
+	
+	return free_blocks - fs->reserved_blocks;
+}
+
 /** Data block allocation algorithm.
  *
  * @param inode_ref Inode to allocate block for
@@ -352,6 +374,9 @@ int ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	uint32_t free_blocks;
 	uint32_t goal;
 	
+	if (ext4_balloc_unreserved(inode_ref->fs) == 0)
+		return ENOSPC;
+	
 	/* Find GOAL */
 	int rc = ext4_balloc_find_goal(inode_ref, &goal);
 	if (rc != EOK)
@@ -632,6 +657,11 @@ int ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock,
 	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 	
+	if (ext4_balloc_unreserved(fs) == 0) {
+		*free = false;
+		return EOK;
+	}
+	
 	/* Compute indexes */
 	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, fblock);
 	uint32_t index_in_group =
@@ -700,6 +730,343 @@ terminate:
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+/** Find preallocation window of an i-node.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ *
+ * @return Window of the i-node or NULL if it has none
+ *
+ */
+static ext4_prealloc_t *ext4_balloc_prealloc_find(ext4_filesystem_t *fs,
+    uint32_t inode)
+{
+	for (unsigned int i = 0; i < EXT4_PREALLOC_WINDOWS; i++) {
+		if (fs->prealloc[i].inode == inode)
+			return &fs->prealloc[i];
+	}
+	
+	return NULL;
+}
+
+/** Discard preallocation window of an i-node.
+ *
+ * Must be called whenever the i-node's block map changes other than
+ * by appending, e.g. on truncation or when the i-node is released.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ *
+ */
+void ext4_balloc_prealloc_discard(ext4_filesystem_t *fs, uint32_t inode)
+{
+	ext4_prealloc_t *win = ext4_balloc_prealloc_find(fs, inode);
+	if (win != NULL) {
+		win->inode = 0;
+		win->count = 0;
+	}
+}
+
+/** Set preallocation window of an i-node, replacing the previous one.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ * @param start First block of the window
+ * @param count Number of blocks in the window
+ *
+ */
+static void ext4_balloc_prealloc_set(ext4_filesystem_t *fs, uint32_t inode,
+    uint32_t start, uint32_t count)
+{
+	ext4_prealloc_t *win = ext4_balloc_prealloc_find(fs, inode);
+	
+	if (count == 0) {
+		if (win != NULL)
+			win->inode = 0;
+		return;
+	}
+	
+	if (win == NULL)
+		win = ext4_balloc_prealloc_find(fs, 0);
+	
+	if (win == NULL) {
+		/* Recycle windows in round robin fashion */
+		win = &fs->prealloc[fs->prealloc_next];
+		fs->prealloc_next = (fs->prealloc_next + 1) %
+		    EXT4_PREALLOC_WINDOWS;
+	}
+	
+	win->inode = inode;
+	win->start = start;
+	win->count = count;
+}
+
+/** Check whether blocks overlap a window of another i-node.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node the blocks are allocated for
+ * @param start First block of the range
+ * @param count Number of blocks in the range
+ *
+ * @return First block after the conflicting window or 0 if there is none
+ *
+ */
+static uint32_t ext4_balloc_prealloc_conflict(ext4_filesystem_t *fs,
+    uint32_t inode, uint32_t start, uint32_t count)
+{
+	for (unsigned int i = 0; i < EXT4_PREALLOC_WINDOWS; i++) {
+		ext4_prealloc_t *win = &fs->prealloc[i];
+		
+		if ((win->inode == 0) || (win->inode == inode))
+			continue;
+		
+		if ((start < win->start + win->count) &&
+		    (win->start < start + count))
+			return win->start + win->count;
+	}
+	
+	return 0;
+}
+
+/** Allocate run of blocks in one block group.
+ *
+ * @param inode_ref I-node to allocate blocks for
+ * @param bgid      Block group to allocate from
+ * @param start     Index in group where the search starts
+ * @param count     Requested number of blocks
+ * @param exact     Only allocate a run beginning exactly at @a start
+ * @param fblock    Output value - first allocated block
+ * @param allocated Output value - number of allocated blocks
+ * @param extra     Output value - number of free blocks following the run
+ *                  (at most EXT4_PREALLOC_BLOCKS)
+ *
+ * @return Error code, ENOSPC if no suitable run was found
+ *
+ */
+static int ext4_balloc_alloc_run(ext4_inode_ref_t *inode_ref, uint32_t bgid,
+    uint32_t start, uint32_t count, bool exact, uint32_t *fblock,
+    uint32_t *allocated, uint32_t *extra)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	
+	ext4_block_group_ref_t *bg_ref;
+	int rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+	if (rc != EOK)
+		return rc;
+	
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+	if (free_blocks == 0) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return ENOSPC;
+	}
+	
+	uint32_t first_in_group =
+	    ext4_balloc_get_first_data_block_in_group(sb, bg_ref);
+	uint32_t first_in_group_index =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
+	uint32_t blocks_in_group = ext4_superblock_get_blocks_in_group(sb, bgid);
+	
+	uint32_t index = start;
+	if (index < first_in_group_index) {
+		if (exact) {
+			ext4_filesystem_put_block_group_ref(bg_ref);
+			return ENOSPC;
+		}
+		index = first_in_group_index;
+	}
+	
+	uint32_t bitmap_block_addr =
+	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+	block_t *bitmap_block;
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+	
+	uint32_t run_idx = 0;
+	uint32_t run_len = 0;
+	
+	while (index < blocks_in_group) {
+		if (exact) {
+			run_idx = index;
+			run_len = 0;
+			while ((run_len < count) &&
+			    (index + run_len < blocks_in_group) &&
+			    ext4_bitmap_is_free_bit(bitmap_block->data,
+			    index + run_len))
+				run_len++;
+		} else {
+			rc = ext4_bitmap_find_free_run(bitmap_block->data, index,
+			    blocks_in_group, count, &run_idx, &run_len);
+			if (rc != EOK) {
+				run_len = 0;
+				break;
+			}
+		}
+		
+		if (run_len == 0)
+			break;
+		
+		if (run_len > count)
+			run_len = count;
+		
+		uint32_t addr = ext4_filesystem_index_in_group2blockaddr(sb,
+		    run_idx, bgid);
+		uint32_t next = ext4_balloc_prealloc_conflict(fs,
+		    inode_ref->index, addr, run_len);
+		if (next == 0)
+			break;
+		
+		/* The run belongs to another i-node's window, skip it */
+		run_len = 0;
+		if (exact || ext4_filesystem_blockaddr2group(sb, next) != bgid)
+			break;
+		index = ext4_filesystem_blockaddr2_index_in_group(sb, next);
+	}
+	
+	if (run_len == 0) {
+		rc = block_put(bitmap_block);
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc == EOK ? ENOSPC : rc;
+	}
+	
+	/* Allocate the run */
+	ext4_bitmap_set_bits(bitmap_block->data, run_idx, run_len);
+	bitmap_block->dirty = true;
+	
+	/* Measure free space following the run for the preallocation window */
+	uint32_t after = run_idx + run_len;
+	*extra = 0;
+	while ((*extra < EXT4_PREALLOC_BLOCKS) &&
+	    (after + *extra < blocks_in_group) &&
+	    ext4_bitmap_is_free_bit(bitmap_block->data, after + *extra))
+		(*extra)++;
+	
+	rc = block_put(bitmap_block);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+	
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	
+	/* Update superblock free blocks count */
+	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
+	sb_free_blocks -= run_len;
+	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
+	
+	/* Update inode blocks (different block size!) count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks += run_len * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+	
+	/* Update block group free blocks count */
+	free_blocks -= run_len;
+	ext4_block_group_set_free_blocks_count(bg_ref->block_group, sb,
+	    free_blocks);
+	bg_ref->dirty = true;
+	
+	*fblock = ext4_filesystem_index_in_group2blockaddr(sb, run_idx, bgid);
+	*allocated = run_len;
+	
+	return ext4_filesystem_put_block_group_ref(bg_ref);
+}
+
+/** Allocate a contiguous run of data blocks.
+ *
+ * The run starts at the goal if the goal is free, otherwise the block
+ * groups are searched for a run of the requested length, starting with
+ * the goal's group. A group without such a run yields its longest free
+ * run and the caller is expected to ask again for the rest. Free blocks
+ * following the run are remembered as the i-node's preallocation window
+ * and are not handed out to other i-nodes, so that subsequent appends
+ * stay contiguous. Blocks reserved by delayed allocation are not used.
+ *
+ * @param inode_ref I-node to allocate blocks for
+ * @param goal      Preferred first block, 0 to compute it from the i-node
+ * @param count     Requested number of blocks
+ * @param fblock    Output value - first allocated block
+ * @param allocated Output value - number of allocated blocks (at least 1)
+ *
+ * @return Error code
+ *
+ */
+int ext4_balloc_alloc_blocks(ext4_inode_ref_t *inode_ref, uint32_t goal,
+    uint32_t count, uint32_t *fblock, uint32_t *allocated)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t extra = 0;
+	int rc;
+	
+	if (count == 0)
+		return EINVAL;
+	
+	uint64_t unreserved = ext4_balloc_unreserved(fs);
+	if (unreserved == 0)
+		return ENOSPC;
+	if (count > unreserved)
+		count = unreserved;
+	
+	if (goal == 0) {
+		rc = ext4_balloc_find_goal(inode_ref, &goal);
+		if (rc != EOK)
+			return rc;
+	}
+	
+	/* The window is only useful if the allocation continues there */
+	ext4_prealloc_t *win = ext4_balloc_prealloc_find(fs, inode_ref->index);
+	if ((win != NULL) && (win->start != goal))
+		ext4_balloc_prealloc_discard(fs, inode_ref->index);
+	
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, goal);
+	uint32_t index_in_group =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, goal);
+	
+	if (block_group >= block_group_count) {
+		/* Goal past the end of the filesystem */
+		block_group = 0;
+		index_in_group = 0;
+	}
+	
+	/* Try to continue exactly at the goal */
+	rc = ext4_balloc_alloc_run(inode_ref, block_group, index_in_group,
+	    count, true, fblock, allocated, &extra);
+	if (rc == EOK)
+		goto success;
+	if (rc != ENOSPC)
+		return rc;
+	
+	/* Try to find a long enough run anywhere, starting near the goal */
+	uint32_t bgid = block_group;
+	
+	for (uint32_t i = 0; i < block_group_count; i++) {
+		rc = ext4_balloc_alloc_run(inode_ref, bgid,
+		    bgid == block_group ? index_in_group : 0, count, false,
+		    fblock, allocated, &extra);
+		if (rc == EOK)
+			goto success;
+		if (rc != ENOSPC)
+			return rc;
+		
+		bgid = (bgid + 1) % block_group_count;
+	}
+	
+	return ENOSPC;
+	
+success:
+	ext4_balloc_prealloc_set(fs, inode_ref->index, *fblock + *allocated,
+	    extra);
+	return EOK;
+}
+
 /**
  * @}
  */
@@ -134,6 +134,42 @@ void ext4_bitmap_set_bit(uint8_t *bitmap, uint32_t index)
 	*target |= 1 << bit_index;
 }
 
+/** Set continuous set of bits to 1 (used).
+ *
+ * Index and count must be checked by caller, if they aren't out of bounds.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param index  Index of first bit to set
+ * @param count  Number of bits to set
+ *
+ */
+void ext4_bitmap_set_bits(uint8_t *bitmap, uint32_t index, uint32_t count)
+{
+	uint32_t idx = index;
+	uint32_t remaining = count;
+	
+	/* Align index to multiple of 8 */
+	while (((idx % 8) != 0) && (remaining > 0)) {
+		bitmap[idx / 8] |= 1 << (idx % 8);
+		idx++;
+		remaining--;
+	}
+	
+	/* Set the whole bytes */
+	while (remaining >= 8) {
+		bitmap[idx / 8] = 255;
+		idx += 8;
+		remaining -= 8;
+	}
+	
+	/* Set remaining bits */
+	while (remaining != 0) {
+		bitmap[idx / 8] |= 1 << (idx % 8);
+		idx++;
+		remaining--;
+	}
+}
+
 /** Check if requested bit is free.
  *
  * @param bitmap Pointer to bitmap
@@ -264,6 +300,72 @@ int ext4_bitmap_find_free_bit_and_set(uint8_t *bitmap, uint32_t start_idx,
 	return ENOSPC;
 }
 
+/** Find run of free bits.
+ *
+ * Walk through bitmap and find the first run of at least @a want free bits.
+ * If there is no such run, the longest run seen is returned. Bits are not
+ * modified.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param start  Index of bit, where the algorithm will begin
+ * @param max    Maximum index of bit in bitmap
+ * @param want   Requested length of the run
+ * @param index  Output value - index of the first bit of the run
+ * @param len    Output value - length of the run
+ *
+ * @return EOK if some free bit was found, ENOSPC otherwise
+ *
+ */
+int ext4_bitmap_find_free_run(uint8_t *bitmap, uint32_t start, uint32_t max,
+    uint32_t want, uint32_t *index, uint32_t *len)
+{
+	uint32_t best_idx = 0;
+	uint32_t best_len = 0;
+	uint32_t run_idx = 0;
+	uint32_t run_len = 0;
+	uint32_t idx = start;
+	
+	while (idx < max) {
+		/* Skip fully used bytes quickly */
+		if (((idx % 8) == 0) && (run_len == 0) && (bitmap[idx / 8] == 255)) {
+			idx += 8;
+			continue;
+		}
+		
+		if ((bitmap[idx / 8] & (1 << (idx % 8))) == 0) {
+			if (run_len == 0)
+				run_idx = idx;
+			run_len++;
+			
+			if (run_len >= want) {
+				*index = run_idx;
+				*len = run_len;
+				return EOK;
+			}
+		} else {
+			if (run_len > best_len) {
+				best_idx = run_idx;
+				best_len = run_len;
+			}
+			run_len = 0;
+		}
+		
+		idx++;
+	}
+	
+	if (run_len > best_len) {
+		best_idx = run_idx;
+		best_len = run_len;
+	}
+	
+	if (best_len == 0)
+		return ENOSPC;
+	
+	*index = best_idx;
+	*len = best_len;
+	return EOK;
+}
+
 /**
  * @}
  */
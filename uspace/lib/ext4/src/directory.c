@@ -189,10 +189,53 @@ int ext4_directory_iterator_init(ext4_directory_iterator_t *it,
 	it->current = NULL;
 	it->current_offset = 0;
 	it->current_block = NULL;
+	it->current_fblock = 0;
 	
 	return ext4_directory_iterator_seek(it, pos);
 }
 
+/** Initialize directory iterator from a previously saved position.
+ *
+ * The caller supplies the physical address of the data block containing
+ * @a pos (as found in current_fblock of an earlier iterator), so that
+ * the block mapping of the directory does not need to be looked up
+ * again. Zero @a fblock means the address is not known.
+ *
+ * @param it        Pointer to iterator to be initialized
+ * @param inode_ref Directory i-node
+ * @param pos       Position to start reading entries from
+ * @param fblock    Physical address of the block containing @a pos
+ *
+ * @return Error code
+ *
+ */
+int ext4_directory_iterator_resume(ext4_directory_iterator_t *it,
+    ext4_inode_ref_t *inode_ref, aoff64_t pos, uint32_t fblock)
+{
+	uint64_t size = ext4_inode_get_size(inode_ref->fs->superblock,
+	    inode_ref->inode);
+	
+	if ((fblock == 0) || (pos >= size))
+		return ext4_directory_iterator_init(it, inode_ref, pos);
+	
+	it->inode_ref = inode_ref;
+	it->current = NULL;
+	it->current_offset = pos;
+	it->current_fblock = fblock;
+	
+	int rc = block_get(&it->current_block, inode_ref->fs->device, fblock,
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		it->current_block = NULL;
+		return rc;
+	}
+	
+	uint32_t block_size =
+	    ext4_superblock_get_block_size(inode_ref->fs->superblock);
+	
+	return ext4_directory_iterator_set(it, block_size);
+}
+
 /** Jump to the next valid entry
  *
  * @param it Initialized iterator
@@ -237,6 +280,7 @@ int ext4_directory_iterator_seek(ext4_directory_iterator_t *it, aoff64_t pos)
 				return rc;
 		}
 		
+		it->current_fblock = 0;
 		it->current_offset = pos;
 		return EOK;
 	}
@@ -273,6 +317,8 @@ int ext4_directory_iterator_seek(ext4_directory_iterator_t *it, aoff64_t pos)
 			it->current_block = NULL;
 			return rc;
 		}
+		
+		it->current_fblock = next_block_phys_idx;
 	}
 	
 	it->current_offset = pos;
@@ -366,8 +366,11 @@ static int ext4_directory_hinfo_init(ext4_hash_info_t *hinfo,
 	hinfo->seed = ext4_superblock_get_hash_seed(sb);
 	
 	/* Compute hash value of name */
-	if (name)
-		ext4_hash_string(hinfo, name_len, name);
+	if (name) {
+		int rc = ext4_hash_string(hinfo, name_len, name);
+		if (rc != EOK)
+			return EXT4_ERR_BAD_DX_DIR;
+	}
 	
 	return EOK;
 }
@@ -360,35 +360,116 @@ static void ext4_extent_binsearch(ext4_extent_header_t *header,
 	*extent = l - 1;
 }
 
-/** Find physical block in the extent tree by logical block number.
+/** Look up a logical block in the extent lookup cache.
+ *
+ * @param fs     Filesystem
+ * @param inode  I-node number
+ * @param iblock Logical block number
+ * @param fblock Output value for physical block number
+ * @param count  Output value for number of blocks following @a iblock
+ *               in the same extent (including @a iblock)
+ *
+ * @return True if the block was found in the cache
+ *
+ */
+static bool ext4_extent_cache_lookup(ext4_filesystem_t *fs, uint32_t inode,
+    uint32_t iblock, uint32_t *fblock, uint32_t *count)
+{
+	for (unsigned int i = 0; i < EXT4_EXTENT_CACHE_SIZE; i++) {
+		ext4_extent_cache_entry_t *entry = &fs->extent_cache[i];
+		
+		if ((entry->inode == inode) && (iblock >= entry->iblock) &&
+		    (iblock - entry->iblock < entry->count)) {
+			*fblock = entry->fblock + (iblock - entry->iblock);
+			*count = entry->count - (iblock - entry->iblock);
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/** Remember an extent in the extent lookup cache.
+ *
+ * @param fs     Filesystem
+ * @param inode  I-node number
+ * @param iblock First logical block of the extent
+ * @param fblock First physical block of the extent
+ * @param count  Number of blocks in the extent
+ *
+ */
+static void ext4_extent_cache_insert(ext4_filesystem_t *fs, uint32_t inode,
+    uint32_t iblock, uint32_t fblock, uint32_t count)
+{
+	ext4_extent_cache_entry_t *entry =
+	    &fs->extent_cache[fs->extent_cache_next];
+	
+	fs->extent_cache_next = (fs->extent_cache_next + 1) %
+	    EXT4_EXTENT_CACHE_SIZE;
+	
+	entry->inode = inode;
+	entry->iblock = iblock;
+	entry->fblock = fblock;
+	entry->count = count;
+}
+
+/** Forget all cached extents of an i-node.
  *
- * There is no need to save path in the tree during this algorithm.
+ * Must be called whenever the extent tree of the i-node is modified.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ *
+ */
+void ext4_extent_cache_invalidate(ext4_filesystem_t *fs, uint32_t inode)
+{
+	for (unsigned int i = 0; i < EXT4_EXTENT_CACHE_SIZE; i++) {
+		if (fs->extent_cache[i].inode == inode)
+			fs->extent_cache[i].inode = 0;
+	}
+}
+
+/** Map logical block to a run of physical blocks.
+ *
+ * The extent lookup cache is consulted first, the extent tree is only
+ * walked on a miss. There is no need to save path in the tree during
+ * this algorithm.
  *
  * @param inode_ref I-node to load block from
  * @param iblock    Logical block number to find
- * @param fblock    Output value for physical block number
+ * @param fblock    Output value for physical block number, 0 if the
+ *                  block is not allocated
+ * @param count     Output value for number of physically contiguous
+ *                  blocks starting at @a iblock (1 for holes)
  *
  * @return Error code
  *
  */
-int ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
-    uint32_t *fblock)
+int ext4_extent_map_blocks(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t *fblock, uint32_t *count)
 {
+	ext4_filesystem_t *fs = inode_ref->fs;
 	int rc = EOK;
+	
 	/* Compute bound defined by i-node size */
 	uint64_t inode_size =
-	    ext4_inode_get_size(inode_ref->fs->superblock, inode_ref->inode);
+	    ext4_inode_get_size(fs->superblock, inode_ref->inode);
 	
 	uint32_t block_size =
-	    ext4_superblock_get_block_size(inode_ref->fs->superblock);
+	    ext4_superblock_get_block_size(fs->superblock);
 	
 	uint32_t last_idx = (inode_size - 1) / block_size;
 	
+	*fblock = 0;
+	*count = 1;
+	
 	/* Check if requested iblock is not over size of i-node */
-	if (iblock > last_idx) {
-		*fblock = 0;
+	if (iblock > last_idx)
+		return EOK;
+	
+	if (ext4_extent_cache_lookup(fs, inode_ref->index, iblock, fblock,
+	    count))
 		return EOK;
-	}
 	
 	block_t *block = NULL;
 	
@@ -410,8 +491,7 @@ int ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 				return rc;
 		}
 		
-		rc = block_get(&block, inode_ref->fs->device, child,
-		    BLOCK_FLAGS_NONE);
+		rc = block_get(&block, fs->device, child, BLOCK_FLAGS_NONE);
 		if (rc != EOK)
 			return rc;
 		
@@ -423,15 +503,22 @@ int ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 	ext4_extent_binsearch(header, &extent, iblock);
 	
 	/* Prevent empty leaf */
-	if (extent == NULL) {
-		*fblock = 0;
-	} else {
-		/* Compute requested physical block address */
-		uint32_t phys_block;
+	if (extent != NULL) {
 		uint32_t first = ext4_extent_get_first_block(extent);
-		phys_block = ext4_extent_get_start(extent) + iblock - first;
+		uint32_t length = ext4_extent_get_block_count(extent);
+		uint32_t start = ext4_extent_get_start(extent);
 		
-		*fblock = phys_block;
+		/* Uninitialized extents have the length offset */
+		if (length > (1 << 15))
+			length -= (1 << 15);
+		
+		if ((iblock >= first) && (iblock - first < length)) {
+			ext4_extent_cache_insert(fs, inode_ref->index, first,
+			    start, length);
+			
+			*fblock = start + (iblock - first);
+			*count = length - (iblock - first);
+		}
 	}
 	
 	/* Cleanup */
@@ -441,6 +528,23 @@ int ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 	return rc;
 }
 
+/** Find physical block in the extent tree by logical block number.
+ *
+ * @param inode_ref I-node to load block from
+ * @param iblock    Logical block number to find
+ * @param fblock    Output value for physical block number
+ *
+ * @return Error code
+ *
+ */
+int ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t *fblock)
+{
+	uint32_t count;
+	
+	return ext4_extent_map_blocks(inode_ref, iblock, fblock, &count);
+}
+
 /** Find extent for specified iblock.
  *
  * This function is used for finding block in the extent tree with
@@ -620,6 +724,8 @@ static int ext4_extent_release_branch(ext4_inode_ref_t *inode_ref,
 int ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
     uint32_t iblock_from)
 {
+	ext4_extent_cache_invalidate(inode_ref->fs, inode_ref->index);
+	
 	/* Find the first extent to modify */
 	ext4_extent_path_t *path;
 	int rc = ext4_extent_find_extent(inode_ref, iblock_from, &path);
@@ -950,38 +1056,38 @@ static int ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 	return EOK;
 }
 
-/** Append data block to the i-node.
- *
- * This function allocates data block, tries to append it
- * to some existing extent or creates new extents.
- * It includes possible extent tree modifications (splitting).
- *<
- * @param inode_ref I-node to append block to
- * @param iblock    Output logical number of newly allocated block
- * @param fblock    Output physical block address of newly allocated block
+/** Append run of data blocks to the i-node.
+ *
+ * This function allocates a contiguous run of data blocks for the logical
+ * blocks starting at @a iblock, tries to append it to the last extent
+ * or creates a new extent. It includes possible extent tree modifications
+ * (splitting). Fewer blocks than requested may be appended if there is no
+ * long enough free run; the caller should call the function again for
+ * the rest.
+ *
+ * @param inode_ref I-node to append blocks to
+ * @param iblock    Logical number of the first block to append, must
+ *                  follow the last mapped block of the i-node
+ * @param count     Requested number of blocks
+ * @param fblock    Output physical block address of the first appended block
+ * @param appended  Output number of appended blocks
  *
  * @return Error code
  *
  */
-int ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
-    uint32_t *fblock, bool update_size)
+int ext4_extent_append_blocks(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t count, uint32_t *fblock, uint32_t *appended)
 {
-	ext4_superblock_t *sb = inode_ref->fs->superblock;
-	uint64_t inode_size = ext4_inode_get_size(sb, inode_ref->inode);
-	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint32_t block_limit = (1 << 15);
 	
-	/* Calculate number of new logical block */
-	uint32_t new_block_idx = 0;
-	if (inode_size > 0) {
-		if ((inode_size % block_size) != 0)
-			inode_size += block_size - (inode_size % block_size);
-		
-		new_block_idx = inode_size / block_size;
-	}
+	if (count > block_limit)
+		count = block_limit;
+	
+	ext4_extent_cache_invalidate(inode_ref->fs, inode_ref->index);
 	
 	/* Load the nearest leaf (with extent) */
 	ext4_extent_path_t *path;
-	int rc = ext4_extent_find_extent(inode_ref, new_block_idx, &path);
+	int rc = ext4_extent_find_extent(inode_ref, iblock, &path);
 	if (rc != EOK)
 		return rc;
 	
@@ -990,81 +1096,54 @@ int ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 	while (path_ptr->depth != 0)
 		path_ptr++;
 	
-	/* Add new extent to the node if not present */
-	if (path_ptr->extent == NULL)
-		goto append_extent;
+	uint32_t block_count = 0;
+	uint32_t goal = 0;
+	bool can_extend = false;
 	
-	uint16_t block_count = ext4_extent_get_block_count(path_ptr->extent);
-	uint16_t block_limit = (1 << 15);
-	
-	uint32_t phys_block = 0;
-	if (block_count < block_limit) {
-		/* There is space for new block in the extent */
-		if (block_count == 0) {
-			/* Existing extent is empty */
-			rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
-			if (rc != EOK)
-				goto finish;
-			
-			/* Initialize extent */
-			ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
-			ext4_extent_set_start(path_ptr->extent, phys_block);
-			ext4_extent_set_block_count(path_ptr->extent, 1);
-			
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
-			
-			path_ptr->block->dirty = true;
-			
-			goto finish;
-		} else {
-			/* Existing extent contains some blocks */
-			phys_block = ext4_extent_get_start(path_ptr->extent);
-			phys_block += ext4_extent_get_block_count(path_ptr->extent);
+	if (path_ptr->extent != NULL) {
+		block_count = ext4_extent_get_block_count(path_ptr->extent);
+		if (block_count > 0) {
+			goal = ext4_extent_get_start(path_ptr->extent) +
+			    block_count;
 			
-			/* Check if the following block is free for allocation */
-			bool free;
-			rc = ext4_balloc_try_alloc_block(inode_ref, phys_block, &free);
-			if (rc != EOK)
-				goto finish;
-			
-			if (!free) {
-				/* Target is not free, new block must be appended to new extent */
-				goto append_extent;
-			}
-			
-			/* Update extent */
-			ext4_extent_set_block_count(path_ptr->extent, block_count + 1);
-			
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
+			/* The run may only extend a logically adjacent extent */
+			if ((ext4_extent_get_first_block(path_ptr->extent) +
+			    block_count == iblock) && (block_count < block_limit)) {
+				can_extend = true;
+				if (count > block_limit - block_count)
+					count = block_limit - block_count;
 			}
-			
-			path_ptr->block->dirty = true;
-			
-			goto finish;
 		}
 	}
 	
+	uint32_t phys_block = 0;
+	uint32_t allocated = 0;
+	rc = ext4_balloc_alloc_blocks(inode_ref, goal, count, &phys_block,
+	    &allocated);
+	if (rc != EOK)
+		goto finish;
 	
-append_extent:
-	/* Append new extent to the tree */
-	phys_block = 0;
+	if ((path_ptr->extent != NULL) && (block_count == 0)) {
+		/* Existing extent is empty, initialize it */
+		ext4_extent_set_first_block(path_ptr->extent, iblock);
+		ext4_extent_set_start(path_ptr->extent, phys_block);
+		ext4_extent_set_block_count(path_ptr->extent, allocated);
+		path_ptr->block->dirty = true;
+		goto finish;
+	}
 	
-	/* Allocate new data block */
-	rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
-	if (rc != EOK)
+	if (can_extend && (phys_block == goal)) {
+		/* The run directly follows the last extent */
+		ext4_extent_set_block_count(path_ptr->extent,
+		    block_count + allocated);
+		path_ptr->block->dirty = true;
 		goto finish;
+	}
 	
-	/* Append extent for new block (includes tree splitting if needed) */
-	rc = ext4_extent_append_extent(inode_ref, path, new_block_idx);
+	/* Append extent for new blocks (includes tree splitting if needed) */
+	rc = ext4_extent_append_extent(inode_ref, path, iblock);
 	if (rc != EOK) {
-		ext4_balloc_free_block(inode_ref, phys_block);
+		ext4_balloc_free_blocks(inode_ref, phys_block, allocated);
 		goto finish;
 	}
 	
@@ -1072,26 +1151,20 @@ append_extent:
 	path_ptr = path + tree_depth;
 	
 	/* Initialize newly created extent */
-	ext4_extent_set_block_count(path_ptr->extent, 1);
-	ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
+	ext4_extent_set_block_count(path_ptr->extent, allocated);
+	ext4_extent_set_first_block(path_ptr->extent, iblock);
 	ext4_extent_set_start(path_ptr->extent, phys_block);
 	
-	/* Update i-node */
-	if (update_size) {
-		ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-		inode_ref->dirty = true;
-	}
-	
 	path_ptr->block->dirty = true;
 	
 finish:
 	;
-
+	
 	int rc2 = EOK;
-
+	
 	/* Set return values */
-	*iblock = new_block_idx;
 	*fblock = phys_block;
+	*appended = (rc == EOK) ? allocated : 0;
 	
 	/*
 	 * Put loaded blocks
@@ -1111,6 +1184,52 @@ finish:
 	return rc;
 }
 
+/** Append data block to the i-node.
+ *
+ * This function allocates data block, tries to append it
+ * to some existing extent or creates new extents.
+ * It includes possible extent tree modifications (splitting).
+ *
+ * @param inode_ref   I-node to append block to
+ * @param iblock      Output logical number of newly allocated block
+ * @param fblock      Output physical block address of newly allocated block
+ * @param update_size Update i-node size to cover the new block
+ *
+ * @return Error code
+ *
+ */
+int ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
+    uint32_t *fblock, bool update_size)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+	uint64_t inode_size = ext4_inode_get_size(sb, inode_ref->inode);
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	
+	/* Calculate number of new logical block */
+	uint32_t new_block_idx = 0;
+	if (inode_size > 0) {
+		if ((inode_size % block_size) != 0)
+			inode_size += block_size - (inode_size % block_size);
+		
+		new_block_idx = inode_size / block_size;
+	}
+	
+	uint32_t appended;
+	int rc = ext4_extent_append_blocks(inode_ref, new_block_idx, 1,
+	    fblock, &appended);
+	if (rc != EOK)
+		return rc;
+	
+	/* Update i-node */
+	if (update_size) {
+		ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
+		inode_ref->dirty = true;
+	}
+	
+	*iblock = new_block_idx;
+	return EOK;
+}
+
 /**
  * @}
  */
@@ -66,7 +66,7 @@ static int ext4_filesystem_check_features(ext4_filesystem_t *, bool *);
  * @return Error code
  *
  */
-static int ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_id,
+int ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_id,
     enum cache_mode cmode)
 {
 	int rc;
@@ -146,7 +146,7 @@ err:
  * @param fs Filesystem to be finalized
  *
  */
-static void ext4_filesystem_fini(ext4_filesystem_t *fs)
+void ext4_filesystem_fini(ext4_filesystem_t *fs)
 {
 	/* Release memory space for superblock */
 	free(fs->superblock);
@@ -1028,6 +1028,9 @@ int ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 {
 	ext4_filesystem_t *fs = inode_ref->fs;
 	
+	ext4_balloc_prealloc_discard(fs, inode_ref->index);
+	ext4_extent_cache_invalidate(fs, inode_ref->index);
+	
 	/* For extents must be data block destroyed by other way */
 	if ((ext4_superblock_has_feature_incompatible(fs->superblock,
 	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
@@ -1192,6 +1195,9 @@ int ext4_filesystem_truncate_inode(ext4_inode_ref_t *inode_ref,
 	if (old_size == new_size)
 		return EOK;
 	
+	/* Blocks after the new end of the i-node are no longer a good goal */
+	ext4_balloc_prealloc_discard(inode_ref->fs, inode_ref->index);
+	
 	/* It's not suppported to make the larger file by truncate operation */
 	if (old_size < new_size)
 		return EINVAL;
@@ -1347,6 +1353,38 @@ int ext4_filesystem_get_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 	return EOK;
 }
 
+/** Get physical address of a run of i-node data blocks.
+ *
+ * For i-nodes using extents, the whole physically contiguous rest of the
+ * extent containing @a iblock is returned. Otherwise the run is always one
+ * block long.
+ *
+ * @param inode_ref I-node to read block address from
+ * @param iblock    Logical index of block
+ * @param fblock    Output pointer for return physical address,
+ *                  0 if the block is not allocated
+ * @param count     Output pointer for number of physically contiguous
+ *                  blocks starting at @a iblock
+ *
+ * @return Error code
+ *
+ */
+int ext4_filesystem_get_inode_data_block_run(ext4_inode_ref_t *inode_ref,
+    aoff64_t iblock, uint32_t *fblock, uint32_t *count)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	
+	if ((ext4_superblock_has_feature_incompatible(fs->superblock,
+	    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
+	    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS)) &&
+	    (ext4_inode_get_size(fs->superblock, inode_ref->inode) != 0))
+		return ext4_extent_map_blocks(inode_ref, iblock, fblock, count);
+	
+	*count = 1;
+	return ext4_filesystem_get_inode_data_block_index(inode_ref, iblock,
+	    fblock);
+}
+
 /** Set physical block address for the block logical address into the i-node.
  *
  * @param inode_ref I-node to set block address to
@@ -34,14 +34,261 @@
  * @brief Hashing algorithms for ext4 HTree.
  */
 
+#include <byteorder.h>
 #include <errno.h>
 #include "ext4/hash.h"
 
+/** Largest hash value usable in the index (end of directory marker) */
+#define EXT4_HTREE_EOF  0x7fffffffU
+
+/** TEA key schedule constant */
+#define TEA_DELTA  0x9e3779b9
+
+/* Half MD4 round constants and helpers */
+#define HALF_MD4_K1  0
+#define HALF_MD4_K2  013240474631U
+#define HALF_MD4_K3  015666365641U
+
+#define HALF_MD4_F(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define HALF_MD4_G(x, y, z)  (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define HALF_MD4_H(x, y, z)  ((x) ^ (y) ^ (z))
+
+#define HALF_MD4_ROUND(f, a, b, c, d, x, s) \
+	do { \
+		(a) += f((b), (c), (d)) + (x); \
+		(a) = ((a) << (s)) | ((a) >> (32 - (s))); \
+	} while (0)
+
+/** Mix one 16-byte chunk of the name into the hash buffer using TEA.
+ *
+ * @param buf Hash buffer (4 words)
+ * @param in  Input data (4 words)
+ *
+ */
+static void ext4_hash_tea_transform(uint32_t buf[4], const uint32_t in[4])
+{
+	uint32_t sum = 0;
+	uint32_t b0 = buf[0];
+	uint32_t b1 = buf[1];
+	uint32_t a = in[0];
+	uint32_t b = in[1];
+	uint32_t c = in[2];
+	uint32_t d = in[3];
+	
+	for (unsigned int n = 0; n < 16; n++) {
+		sum += TEA_DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	}
+	
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/** Mix one 32-byte chunk of the name into the hash buffer using half MD4.
+ *
+ * @param buf Hash buffer (4 words)
+ * @param in  Input data (8 words)
+ *
+ */
+static void ext4_hash_half_md4_transform(uint32_t buf[4],
+    const uint32_t in[8])
+{
+	uint32_t a = buf[0];
+	uint32_t b = buf[1];
+	uint32_t c = buf[2];
+	uint32_t d = buf[3];
+	
+	/* Round 1 */
+	HALF_MD4_ROUND(HALF_MD4_F, a, b, c, d, in[0] + HALF_MD4_K1, 3);
+	HALF_MD4_ROUND(HALF_MD4_F, d, a, b, c, in[1] + HALF_MD4_K1, 7);
+	HALF_MD4_ROUND(HALF_MD4_F, c, d, a, b, in[2] + HALF_MD4_K1, 11);
+	HALF_MD4_ROUND(HALF_MD4_F, b, c, d, a, in[3] + HALF_MD4_K1, 19);
+	HALF_MD4_ROUND(HALF_MD4_F, a, b, c, d, in[4] + HALF_MD4_K1, 3);
+	HALF_MD4_ROUND(HALF_MD4_F, d, a, b, c, in[5] + HALF_MD4_K1, 7);
+	HALF_MD4_ROUND(HALF_MD4_F, c, d, a, b, in[6] + HALF_MD4_K1, 11);
+	HALF_MD4_ROUND(HALF_MD4_F, b, c, d, a, in[7] + HALF_MD4_K1, 19);
+	
+	/* Round 2 */
+	HALF_MD4_ROUND(HALF_MD4_G, a, b, c, d, in[1] + HALF_MD4_K2, 3);
+	HALF_MD4_ROUND(HALF_MD4_G, d, a, b, c, in[3] + HALF_MD4_K2, 5);
+	HALF_MD4_ROUND(HALF_MD4_G, c, d, a, b, in[5] + HALF_MD4_K2, 9);
+	HALF_MD4_ROUND(HALF_MD4_G, b, c, d, a, in[7] + HALF_MD4_K2, 13);
+	HALF_MD4_ROUND(HALF_MD4_G, a, b, c, d, in[0] + HALF_MD4_K2, 3);
+	HALF_MD4_ROUND(HALF_MD4_G, d, a, b, c, in[2] + HALF_MD4_K2, 5);
+	HALF_MD4_ROUND(HALF_MD4_G, c, d, a, b, in[4] + HALF_MD4_K2, 9);
+	HALF_MD4_ROUND(HALF_MD4_G, b, c, d, a, in[6] + HALF_MD4_K2, 13);
+	
+	/* Round 3 */
+	HALF_MD4_ROUND(HALF_MD4_H, a, b, c, d, in[3] + HALF_MD4_K3, 3);
+	HALF_MD4_ROUND(HALF_MD4_H, d, a, b, c, in[7] + HALF_MD4_K3, 9);
+	HALF_MD4_ROUND(HALF_MD4_H, c, d, a, b, in[2] + HALF_MD4_K3, 11);
+	HALF_MD4_ROUND(HALF_MD4_H, b, c, d, a, in[6] + HALF_MD4_K3, 15);
+	HALF_MD4_ROUND(HALF_MD4_H, a, b, c, d, in[1] + HALF_MD4_K3, 3);
+	HALF_MD4_ROUND(HALF_MD4_H, d, a, b, c, in[5] + HALF_MD4_K3, 9);
+	HALF_MD4_ROUND(HALF_MD4_H, c, d, a, b, in[0] + HALF_MD4_K3, 11);
+	HALF_MD4_ROUND(HALF_MD4_H, b, c, d, a, in[4] + HALF_MD4_K3, 15);
+	
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/** Legacy (pre dir_index v2) hash of the name.
+ *
+ * @param name        Name to be hashed
+ * @param len         Length of the name
+ * @param is_unsigned Treat name characters as unsigned
+ *
+ * @return Hash value
+ *
+ */
+static uint32_t ext4_hash_legacy(const char *name, int len, bool is_unsigned)
+{
+	uint32_t hash;
+	uint32_t hash0 = 0x12a3fe2d;
+	uint32_t hash1 = 0x37abe8f9;
+	
+	for (int i = 0; i < len; i++) {
+		int c = is_unsigned ? (int) (unsigned char) name[i] :
+		    (int) (signed char) name[i];
+		
+		hash = hash1 + (hash0 ^ (uint32_t) (c * 7152373));
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	
+	return hash0 << 1;
+}
+
+/** Pack part of the name into input words for the block transforms.
+ *
+ * Missing input is padded with a pattern derived from the name length.
+ *
+ * @param name        Name chunk
+ * @param len         Remaining length of the name
+ * @param buf         Output words
+ * @param num         Number of output words
+ * @param is_unsigned Treat name characters as unsigned
+ *
+ */
+static void ext4_hash_str2hashbuf(const char *name, int len, uint32_t *buf,
+    int num, bool is_unsigned)
+{
+	uint32_t pad = (uint32_t) len | ((uint32_t) len << 8);
+	pad |= pad << 16;
+	
+	uint32_t val = pad;
+	
+	if (len > num * 4)
+		len = num * 4;
+	
+	for (int i = 0; i < len; i++) {
+		int c = is_unsigned ? (int) (unsigned char) name[i] :
+		    (int) (signed char) name[i];
+		
+		val = (uint32_t) c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	
+	if (--num >= 0)
+		*buf++ = val;
+	
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/** Compute directory index hash of a name.
+ *
+ * Hash version and seed must be set in @a hinfo; hash and minor hash
+ * are filled in on success.
+ *
+ * @param hinfo Hash info structure
+ * @param len   Length of the name
+ * @param name  Name to be hashed
+ *
+ * @return Error code
+ *
+ */
 int ext4_hash_string(ext4_hash_info_t *hinfo, int len, const char *name)
 {
-	// TODO
-	hinfo->hash = 0;
-	return ENOTSUP;
+	uint32_t buf[4] = {
+		0x67452301,
+		0xefcdab89,
+		0x98badcfe,
+		0x10325476
+	};
+	uint32_t in[8];
+	uint32_t hash;
+	uint32_t minor_hash = 0;
+	bool is_unsigned = false;
+	const char *p;
+	
+	/* Use superblock seed unless it is all zeros */
+	if (hinfo->seed != NULL) {
+		for (unsigned int i = 0; i < 4; i++) {
+			if (hinfo->seed[i] != 0) {
+				for (unsigned int j = 0; j < 4; j++)
+					buf[j] = uint32_t_le2host(hinfo->seed[j]);
+				
+				break;
+			}
+		}
+	}
+	
+	switch (hinfo->hash_version) {
+	case EXT4_HASH_VERSION_LEGACY_UNSIGNED:
+		is_unsigned = true;
+		/* Fallthrough */
+	case EXT4_HASH_VERSION_LEGACY:
+		hash = ext4_hash_legacy(name, len, is_unsigned);
+		break;
+	case EXT4_HASH_VERSION_HALF_MD4_UNSIGNED:
+		is_unsigned = true;
+		/* Fallthrough */
+	case EXT4_HASH_VERSION_HALF_MD4:
+		for (p = name; len > 0; len -= 32, p += 32) {
+			ext4_hash_str2hashbuf(p, len, in, 8, is_unsigned);
+			ext4_hash_half_md4_transform(buf, in);
+		}
+		
+		hash = buf[1];
+		minor_hash = buf[2];
+		break;
+	case EXT4_HASH_VERSION_TEA_UNSIGNED:
+		is_unsigned = true;
+		/* Fallthrough */
+	case EXT4_HASH_VERSION_TEA:
+		for (p = name; len > 0; len -= 16, p += 16) {
+			ext4_hash_str2hashbuf(p, len, in, 4, is_unsigned);
+			ext4_hash_tea_transform(buf, in);
+		}
+		
+		hash = buf[0];
+		minor_hash = buf[1];
+		break;
+	default:
+		hinfo->hash = 0;
+		return EINVAL;
+	}
+	
+	/* The lowest bit is reserved for hash collision marking */
+	hash &= ~1;
+	if (hash == (EXT4_HTREE_EOF << 1))
+		hash = (EXT4_HTREE_EOF - 1) << 1;
+	
+	hinfo->hash = hash;
+	hinfo->minor_hash = minor_hash;
+	
+	return EOK;
 }
 
 /**
@@ -55,6 +55,9 @@
 #include "ext4/fstypes.h"
 #include "ext4/superblock.h"
 
+/** Maximum number of bytes read from a physical run at once */
+#define EXT4_READ_RUN_MAX  (64 * 1024)
+
 /* Forward declarations of auxiliary functions */
 
 static int ext4_read_directory(ipc_callid_t, aoff64_t, size_t,
@@ -63,6 +66,10 @@ static int ext4_read_file(ipc_callid_t, aoff64_t, size_t, ext4_instance_t *,
     ext4_inode_ref_t *, size_t *);
 static bool ext4_is_dots(const uint8_t *, size_t);
 static int ext4_instance_get(service_id_t, ext4_instance_t **);
+static int ext4_delalloc_sync(ext4_instance_t *, fs_index_t);
+static void ext4_delalloc_discard(ext4_instance_t *, ext4_inode_ref_t *);
+static int ext4_delalloc_write(ext4_node_t *, ipc_callid_t, aoff64_t, size_t,
+    size_t *, aoff64_t *);
 
 /* Forward declarations of ext4 libfs operations. */
 
@@ -503,6 +510,15 @@ int ext4_destroy_node(fs_node_t *fn)
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
 	
+	/* Drop data that has not been allocated yet */
+	ext4_delalloc_discard(enode->instance, inode_ref);
+	
+	/* Saved directory position refers to blocks released below */
+	fibril_mutex_lock(&enode->instance->cursor.lock);
+	if (enode->instance->cursor.index == inode_ref->index)
+		enode->instance->cursor.index = 0;
+	fibril_mutex_unlock(&enode->instance->cursor.lock);
+	
 	/* Release data blocks */
 	rc = ext4_filesystem_truncate_inode(inode_ref, 0);
 	if (rc != EOK) {
@@ -752,6 +768,12 @@ aoff64_t ext4_size_get(fs_node_t *fn)
 {
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_superblock_t *sb = enode->instance->filesystem->superblock;
+	ext4_delalloc_t *da = &enode->instance->delalloc;
+	
+	/* Account for data waiting for delayed allocation */
+	if ((da->index == enode->inode_ref->index) && (da->count > 0))
+		return da->size;
+	
 	return ext4_inode_get_size(sb, enode->inode_ref->inode);
 }
 
@@ -863,7 +885,8 @@ int ext4_free_block_count(service_id_t service_id, uint64_t *count)
 		return rc;
 
 	ext4_superblock_t *sb = inst->filesystem->superblock;
-	*count = ext4_superblock_get_free_blocks_count(sb);
+	*count = ext4_superblock_get_free_blocks_count(sb) -
+	    inst->filesystem->reserved_blocks;
 
 	return EOK;
 }
@@ -944,6 +967,13 @@ static int ext4_mounted(service_id_t service_id, const char *opts,
 	link_initialize(&inst->link);
 	inst->service_id = service_id;
 	inst->open_nodes_count = 0;
+	fibril_mutex_initialize(&inst->delalloc.lock);
+	inst->delalloc.index = 0;
+	inst->delalloc.count = 0;
+	inst->delalloc.allocated = 0;
+	inst->delalloc.data = NULL;
+	fibril_mutex_initialize(&inst->cursor.lock);
+	inst->cursor.index = 0;
 	
 	/* Initialize the filesystem */
 	aoff64_t rnsize;
@@ -980,6 +1010,11 @@ static int ext4_unmounted(service_id_t service_id)
 	if (rc != EOK)
 		return rc;
 	
+	/* Allocate blocks for the buffered data */
+	rc = ext4_delalloc_sync(inst, 0);
+	if (rc != EOK)
+		return rc;
+	
 	fibril_mutex_lock(&open_nodes_lock);
 	
 	if (inst->open_nodes_count != 0) {
@@ -1001,6 +1036,7 @@ static int ext4_unmounted(service_id_t service_id)
 		fibril_mutex_unlock(&instance_list_mutex);
 	}
 
+	free(inst->delalloc.data);
 	free(inst);
 	return EOK;
 }
@@ -1035,6 +1071,13 @@ static int ext4_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		return rc;
 	}
 	
+	/* Buffered data must reach the disk before it can be read */
+	rc = ext4_delalloc_sync(inst, index);
+	if (rc != EOK) {
+		async_answer_0(callid, rc);
+		return rc;
+	}
+	
 	/* Load i-node */
 	ext4_inode_ref_t *inode_ref;
 	rc = ext4_filesystem_get_inode_ref(inst->filesystem, index, &inode_ref);
@@ -1097,9 +1140,19 @@ bool ext4_is_dots(const uint8_t *name, size_t name_size)
 int ext4_read_directory(ipc_callid_t callid, aoff64_t pos, size_t size,
     ext4_instance_t *inst, ext4_inode_ref_t *inode_ref, size_t *rbytes)
 {
+	ext4_readdir_cursor_t *cursor = &inst->cursor;
+	uint32_t fblock = 0;
+	
+	/* Continue where the previous read of this directory stopped */
+	fibril_mutex_lock(&cursor->lock);
+	if ((cursor->index == inode_ref->index) && (cursor->pos == pos))
+		fblock = cursor->fblock;
+	fibril_mutex_unlock(&cursor->lock);
+	
 	ext4_directory_iterator_t it;
-	int rc = ext4_directory_iterator_init(&it, inode_ref, pos);
+	int rc = ext4_directory_iterator_resume(&it, inode_ref, pos, fblock);
 	if (rc != EOK) {
+		ext4_directory_iterator_fini(&it);
 		async_answer_0(callid, rc);
 		return rc;
 	}
@@ -1157,6 +1210,12 @@ skip:
 			return rc;
 		
 		next = it.current_offset;
+		
+		fibril_mutex_lock(&cursor->lock);
+		cursor->index = inode_ref->index;
+		cursor->pos = next;
+		cursor->fblock = it.current_fblock;
+		fibril_mutex_unlock(&cursor->lock);
 	}
 	
 	rc = ext4_directory_iterator_fini(&it);
@@ -1198,7 +1257,6 @@ int ext4_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 		return EOK;
 	}
 	
-	/* For now, we only read data from one block at a time */
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
 	aoff64_t file_block = pos / block_size;
 	uint32_t offset_in_block = pos % block_size;
@@ -1208,10 +1266,11 @@ int ext4_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 	if (pos + bytes > file_size)
 		bytes = file_size - pos;
 	
-	/* Get the real block number */
+	/* Get the real block number and the length of the physical run */
 	uint32_t fs_block;
-	int rc = ext4_filesystem_get_inode_data_block_index(inode_ref,
-	    file_block, &fs_block);
+	uint32_t run;
+	int rc = ext4_filesystem_get_inode_data_block_run(inode_ref,
+	    file_block, &fs_block, &run);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return rc;
@@ -1240,6 +1299,43 @@ int ext4_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 		return rc;
 	}
 	
+	/*
+	 * If the request spans more blocks of the physical run, read them
+	 * with one device request.
+	 */
+	if ((run > 1) && (size > bytes) && (pos + bytes < file_size)) {
+		aoff64_t avail = min((aoff64_t) run * block_size,
+		    EXT4_READ_RUN_MAX) - offset_in_block;
+		size_t rbytes_run = min(min(size, avail), file_size - pos);
+		size_t nblocks = (offset_in_block + rbytes_run + block_size - 1) /
+		    block_size;
+		
+		if (nblocks > 1) {
+			uint8_t *buffer = malloc(nblocks * block_size);
+			if (buffer == NULL) {
+				async_answer_0(callid, ENOMEM);
+				return ENOMEM;
+			}
+			
+			rc = block_read_range(inst->service_id, fs_block,
+			    nblocks, buffer);
+			if (rc != EOK) {
+				free(buffer);
+				async_answer_0(callid, rc);
+				return rc;
+			}
+			
+			rc = async_data_read_finalize(callid,
+			    buffer + offset_in_block, rbytes_run);
+			free(buffer);
+			if (rc != EOK)
+				return rc;
+			
+			*rbytes = rbytes_run;
+			return EOK;
+		}
+	}
+	
 	/* Usual case - we need to read a block from device */
 	block_t *block;
 	rc = block_get(&block, inst->service_id, fs_block, BLOCK_FLAGS_NONE);
@@ -1263,6 +1359,274 @@ int ext4_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 	return EOK;
 }
 
+/** Allocate blocks for data buffered by delayed allocation.
+ *
+ * The buffered blocks are allocated as few contiguous runs as possible,
+ * written out and the i-node size is updated. The reservation is released
+ * before allocating, so that the allocator may use the reserved space. On
+ * failure the blocks which have not been written out stay buffered, those
+ * not allocated yet stay reserved and those already allocated remember
+ * their physical blocks, so that the error can be reported and the flush
+ * retried.
+ *
+ * The caller must hold the delayed allocation lock.
+ *
+ * @param inst Filesystem instance
+ *
+ * @return Error code
+ *
+ */
+static int ext4_delalloc_flush(ext4_instance_t *inst)
+{
+	ext4_delalloc_t *da = &inst->delalloc;
+	ext4_filesystem_t *fs = inst->filesystem;
+	uint32_t block_size = ext4_superblock_get_block_size(fs->superblock);
+	uint32_t done = 0;
+	
+	if (da->count == 0) {
+		da->index = 0;
+		return EOK;
+	}
+	
+	fs->reserved_blocks -= da->count - da->allocated;
+	
+	fs_node_t *fn;
+	int rc = ext4_node_get_core(&fn, inst, da->index);
+	if (rc == EOK) {
+		ext4_inode_ref_t *inode_ref = EXT4_NODE(fn)->inode_ref;
+		
+		while ((rc == EOK) && (done < da->count)) {
+			if (da->allocated == 0) {
+				rc = ext4_extent_append_blocks(inode_ref,
+				    da->first + done, da->count - done,
+				    &da->fblock, &da->allocated);
+				if (rc != EOK)
+					break;
+			}
+			
+			uint32_t written = 0;
+			while (written < da->allocated) {
+				block_t *block;
+				rc = block_get(&block, inst->service_id,
+				    da->fblock + written, BLOCK_FLAGS_NOREAD);
+				if (rc != EOK)
+					break;
+				
+				memcpy(block->data,
+				    da->data + (done + written) * block_size,
+				    block_size);
+				block->dirty = true;
+				
+				rc = block_put(block);
+				if (rc != EOK)
+					break;
+				
+				written++;
+			}
+			
+			done += written;
+			da->fblock += written;
+			da->allocated -= written;
+		}
+		
+		/* Make the written part of the data visible */
+		aoff64_t size = min(da->size,
+		    (aoff64_t) (da->first + done) * block_size);
+		if (size > ext4_inode_get_size(fs->superblock,
+		    inode_ref->inode)) {
+			ext4_inode_set_size(inode_ref->inode, size);
+			inode_ref->dirty = true;
+		}
+		
+		int const rc2 = ext4_node_put(fn);
+		if (rc == EOK)
+			rc = rc2;
+	}
+	
+	if ((rc != EOK) && (done < da->count)) {
+		/* Keep the blocks which have not been written out */
+		memmove(da->data, da->data + done * block_size,
+		    (da->count - done) * block_size);
+		da->first += done;
+		da->count -= done;
+		fs->reserved_blocks += da->count - da->allocated;
+		return rc;
+	}
+	
+	da->count = 0;
+	da->allocated = 0;
+	da->index = 0;
+	
+	return rc;
+}
+
+/** Allocate blocks for data buffered by delayed allocation.
+ *
+ * @param inst  Filesystem instance
+ * @param index I-node whose data should be flushed, 0 for any i-node
+ *
+ * @return Error code
+ *
+ */
+int ext4_delalloc_sync(ext4_instance_t *inst, fs_index_t index)
+{
+	int rc = EOK;
+	
+	fibril_mutex_lock(&inst->delalloc.lock);
+	if ((index == 0) || (inst->delalloc.index == index))
+		rc = ext4_delalloc_flush(inst);
+	fibril_mutex_unlock(&inst->delalloc.lock);
+	
+	return rc;
+}
+
+/** Drop data buffered by delayed allocation for an i-node.
+ *
+ * Blocks which have already been allocated but not written out are covered
+ * by the i-node size, so that truncating the i-node releases them.
+ *
+ * @param inst      Filesystem instance
+ * @param inode_ref I-node being destroyed
+ *
+ */
+void ext4_delalloc_discard(ext4_instance_t *inst, ext4_inode_ref_t *inode_ref)
+{
+	ext4_delalloc_t *da = &inst->delalloc;
+	ext4_superblock_t *sb = inst->filesystem->superblock;
+	
+	fibril_mutex_lock(&da->lock);
+	if (da->index == inode_ref->index) {
+		aoff64_t size = (aoff64_t) (da->first + da->allocated) *
+		    ext4_superblock_get_block_size(sb);
+		if ((da->allocated > 0) &&
+		    (size > ext4_inode_get_size(sb, inode_ref->inode))) {
+			ext4_inode_set_size(inode_ref->inode, size);
+			inode_ref->dirty = true;
+		}
+		
+		inst->filesystem->reserved_blocks -= da->count - da->allocated;
+		da->count = 0;
+		da->allocated = 0;
+		da->index = 0;
+	}
+	fibril_mutex_unlock(&da->lock);
+}
+
+/** Write data to the delayed allocation buffer.
+ *
+ * Only data appended to regular files using extents is buffered. Space is
+ * reserved for every new block, the blocks themselves are allocated when
+ * the buffer is flushed, so that they can be allocated as contiguous runs.
+ *
+ * @param enode  Node to write to
+ * @param callid IPC id of the data write call
+ * @param pos    Position in file to start writing at
+ * @param len    Number of bytes offered by the client
+ * @param wbytes Output value - real number of written bytes
+ * @param nsize  Output value - new size of i-node
+ *
+ * @return ENOTSUP if the write must be done directly, otherwise error code
+ *         of the write (the call has been answered)
+ *
+ */
+static int ext4_delalloc_write(ext4_node_t *enode, ipc_callid_t callid,
+    aoff64_t pos, size_t len, size_t *wbytes, aoff64_t *nsize)
+{
+	ext4_instance_t *inst = enode->instance;
+	ext4_delalloc_t *da = &inst->delalloc;
+	ext4_filesystem_t *fs = inst->filesystem;
+	ext4_superblock_t *sb = fs->superblock;
+	ext4_inode_ref_t *inode_ref = enode->inode_ref;
+	int rc;
+	
+	if ((!ext4_superblock_has_feature_incompatible(sb,
+	    EXT4_FEATURE_INCOMPAT_EXTENTS)) ||
+	    (!ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS)) ||
+	    (!ext4_inode_is_type(sb, inode_ref->inode, EXT4_INODE_MODE_FILE)))
+		return ENOTSUP;
+	
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint32_t iblock = pos / block_size;
+	
+	fibril_mutex_lock(&da->lock);
+	
+	if (da->data == NULL) {
+		da->data = malloc(EXT4_DELALLOC_BLOCKS * block_size);
+		if (da->data == NULL) {
+			fibril_mutex_unlock(&da->lock);
+			return ENOTSUP;
+		}
+	}
+	
+	if ((da->index == inode_ref->index) &&
+	    ((iblock < da->first) || (iblock > da->first + da->count) ||
+	    (iblock == da->first + EXT4_DELALLOC_BLOCKS))) {
+		/* Write outside of the buffer */
+		rc = ext4_delalloc_flush(inst);
+		if (rc != EOK)
+			goto error;
+	}
+	
+	if (da->index != inode_ref->index) {
+		/* Only the end of the file can be buffered */
+		aoff64_t size = ext4_inode_get_size(sb, inode_ref->inode);
+		if (iblock != (size + block_size - 1) / block_size) {
+			fibril_mutex_unlock(&da->lock);
+			return ENOTSUP;
+		}
+		
+		rc = ext4_delalloc_flush(inst);
+		if (rc != EOK)
+			goto error;
+		
+		da->index = inode_ref->index;
+		da->first = iblock;
+		da->count = 0;
+		da->size = size;
+	}
+	
+	uint8_t *data = da->data + (iblock - da->first) * block_size;
+	
+	if (iblock == da->first + da->count) {
+		/* New block, reserve space for it and its metadata */
+		if (ext4_superblock_get_free_blocks_count(sb) <=
+		    fs->reserved_blocks + EXT4_DELALLOC_BLOCKS / 8) {
+			rc = ext4_delalloc_flush(inst);
+			fibril_mutex_unlock(&da->lock);
+			if (rc != EOK) {
+				async_answer_0(callid, rc);
+				return rc;
+			}
+			return ENOTSUP;
+		}
+		
+		memset(data, 0, block_size);
+		da->count++;
+		fs->reserved_blocks++;
+	}
+	
+	size_t bytes = min(len, block_size - (pos % block_size));
+	rc = async_data_write_finalize(callid, data + (pos % block_size), bytes);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&da->lock);
+		return rc;
+	}
+	
+	if (pos + bytes > da->size)
+		da->size = pos + bytes;
+	
+	*wbytes = bytes;
+	*nsize = da->size;
+	
+	fibril_mutex_unlock(&da->lock);
+	return EOK;
+	
+error:
+	fibril_mutex_unlock(&da->lock);
+	async_answer_0(callid, rc);
+	return rc;
+}
+
 /** Write bytes to file
  *
  * @param service_id Device identifier
@@ -1293,6 +1657,11 @@ static int ext4_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_filesystem_t *fs = enode->instance->filesystem;
 	
+	/* Try to buffer appended data and delay the block allocation */
+	rc = ext4_delalloc_write(enode, callid, pos, len, wbytes, nsize);
+	if (rc != ENOTSUP)
+		goto exit;
+	
 	uint32_t block_size = ext4_superblock_get_block_size(fs->superblock);
 	
 	/* Prevent writing to more than one block */
@@ -1422,7 +1791,9 @@ static int ext4_truncate(service_id_t service_id, fs_index_t index,
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
 	
-	rc = ext4_filesystem_truncate_inode(inode_ref, new_size);
+	rc = ext4_delalloc_sync(enode->instance, index);
+	if (rc == EOK)
+		rc = ext4_filesystem_truncate_inode(inode_ref, new_size);
 	int const rc2 = ext4_node_put(fn);
 	
 	return rc == EOK ? rc2 : rc;
@@ -1438,7 +1809,12 @@ static int ext4_truncate(service_id_t service_id, fs_index_t index,
  */
 static int ext4_close(service_id_t service_id, fs_index_t index)
 {
-	return EOK;
+	ext4_instance_t *inst;
+	int rc = ext4_instance_get(service_id, &inst);
+	if (rc != EOK)
+		return rc;
+	
+	return ext4_delalloc_sync(inst, index);
 }
 
 /** Destroy node specified by index.
@@ -1476,7 +1852,10 @@ static int ext4_sync(service_id_t service_id, fs_index_t index)
 	ext4_node_t *enode = EXT4_NODE(fn);
 	enode->inode_ref->dirty = true;
 	
-	return ext4_node_put(fn);
+	rc = ext4_delalloc_sync(enode->instance, index);
+	int const rc2 = ext4_node_put(fn);
+	
+	return rc == EOK ? rc2 : rc;
 }
 
 /** VFS operations
@@ -1491,7 +1870,10 @@ vfs_out_ops_t ext4_ops = {
 	.truncate = ext4_truncate,
 	.close = ext4_close,
 	.destroy = ext4_destroy,
-	.sync = ext4_sync
+	.sync = ext4_sync,
+	/* Block group bitmaps and descriptors are updated without a lock */
+	.concurrent = LIBFS_CONCURRENT_READ | LIBFS_CONCURRENT_LOOKUP |
+	    LIBFS_CONCURRENT_STAT
 };
 
 /**
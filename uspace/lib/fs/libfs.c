@@ -65,6 +65,44 @@
 
 static fs_reg_t reg;
 
+/** Lock of a file system instance with requests in progress. */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+	unsigned int refcnt;
+	fibril_rwlock_t lock;
+} libfs_instance_lock_t;
+
+/** Lock of a node with requests in progress. */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+	fs_index_t index;
+	unsigned int refcnt;
+	fibril_rwlock_t lock;
+} libfs_node_lock_t;
+
+/** Locks held by a request while it is being served. */
+typedef struct {
+	bool global;                /**< Holding libfs_lock for writing. */
+	libfs_instance_lock_t *instance;  /**< Instance lock or NULL. */
+	bool exclusive;             /**< Holding the instance lock for writing. */
+	libfs_node_lock_t *node;    /**< Node lock or NULL. */
+	bool node_write;            /**< Holding the node lock for writing. */
+} libfs_req_lock_t;
+
+/**
+ * Requests hold this lock for reading while they hold an instance lock.
+ * A request whose instance lock cannot be allocated holds it for writing
+ * instead.
+ */
+static FIBRIL_RWLOCK_INITIALIZE(libfs_lock);
+
+/** List of instance and node locks, protected by node_locks_mutex. */
+static FIBRIL_MUTEX_INITIALIZE(node_locks_mutex);
+static LIST_INITIALIZE(instance_locks);
+static LIST_INITIALIZE(node_locks);
+
 static vfs_out_ops_t *vfs_out_ops = NULL;
 static libfs_ops_t *libfs_ops = NULL;
 
@@ -277,6 +315,186 @@ static void vfs_out_is_empty(ipc_callid_t rid, ipc_call_t *req)
 	async_answer_0(rid, children ? ENOTEMPTY : EOK);
 }
 
+static libfs_instance_lock_t *instance_lock_get(service_id_t service_id)
+{
+	fibril_mutex_lock(&node_locks_mutex);
+	
+	list_foreach(instance_locks, link, libfs_instance_lock_t, cur) {
+		if (cur->service_id == service_id) {
+			cur->refcnt++;
+			fibril_mutex_unlock(&node_locks_mutex);
+			return cur;
+		}
+	}
+	
+	libfs_instance_lock_t *il = malloc(sizeof(libfs_instance_lock_t));
+	if (il != NULL) {
+		link_initialize(&il->link);
+		il->service_id = service_id;
+		il->refcnt = 1;
+		fibril_rwlock_initialize(&il->lock);
+		list_append(&il->link, &instance_locks);
+	}
+	
+	fibril_mutex_unlock(&node_locks_mutex);
+	return il;
+}
+
+static void instance_lock_put(libfs_instance_lock_t *il)
+{
+	fibril_mutex_lock(&node_locks_mutex);
+	
+	assert(il->refcnt > 0);
+	if (--il->refcnt == 0) {
+		list_remove(&il->link);
+		free(il);
+	}
+	
+	fibril_mutex_unlock(&node_locks_mutex);
+}
+
+static libfs_node_lock_t *node_lock_get(service_id_t service_id,
+    fs_index_t index)
+{
+	fibril_mutex_lock(&node_locks_mutex);
+	
+	list_foreach(node_locks, link, libfs_node_lock_t, cur) {
+		if ((cur->service_id == service_id) && (cur->index == index)) {
+			cur->refcnt++;
+			fibril_mutex_unlock(&node_locks_mutex);
+			return cur;
+		}
+	}
+	
+	libfs_node_lock_t *nl = malloc(sizeof(libfs_node_lock_t));
+	if (nl != NULL) {
+		link_initialize(&nl->link);
+		nl->service_id = service_id;
+		nl->index = index;
+		nl->refcnt = 1;
+		fibril_rwlock_initialize(&nl->lock);
+		list_append(&nl->link, &node_locks);
+	}
+	
+	fibril_mutex_unlock(&node_locks_mutex);
+	return nl;
+}
+
+static void node_lock_put(libfs_node_lock_t *nl)
+{
+	fibril_mutex_lock(&node_locks_mutex);
+	
+	assert(nl->refcnt > 0);
+	if (--nl->refcnt == 0) {
+		list_remove(&nl->link);
+		free(nl);
+	}
+	
+	fibril_mutex_unlock(&node_locks_mutex);
+}
+
+/** Acquire the locks needed to serve a request.
+ *
+ * Read, write, lookup and stat requests declared concurrent by the server
+ * run in parallel with each other as long as they concern different nodes
+ * or only read the same node. Everything else, including lookups which
+ * create or unlink, runs alone within its file system instance. Requests
+ * for different instances never wait for each other.
+ *
+ * @param call Request.
+ * @param rl   Place to store the acquired locks.
+ *
+ */
+static void libfs_request_lock(ipc_call_t *call, libfs_req_lock_t *rl)
+{
+	unsigned int concurrent = vfs_out_ops->concurrent;
+	unsigned int op = 0;
+	service_id_t service_id = IPC_GET_ARG1(*call);
+	fs_index_t index = IPC_GET_ARG2(*call);
+	bool node_write = false;
+	
+	rl->global = false;
+	rl->instance = NULL;
+	rl->exclusive = false;
+	rl->node = NULL;
+	rl->node_write = false;
+	
+	if (concurrent == 0)
+		return;
+	
+	switch (IPC_GET_IMETHOD(*call)) {
+	case VFS_OUT_READ:
+		op = LIBFS_CONCURRENT_READ;
+		break;
+	case VFS_OUT_WRITE:
+		op = LIBFS_CONCURRENT_WRITE;
+		node_write = true;
+		break;
+	case VFS_OUT_LOOKUP:
+		service_id = IPC_GET_ARG3(*call);
+		index = IPC_GET_ARG4(*call);
+		if ((IPC_GET_ARG5(*call) & (L_CREATE | L_UNLINK)) == 0)
+			op = LIBFS_CONCURRENT_LOOKUP;
+		break;
+	case VFS_OUT_STAT:
+		op = LIBFS_CONCURRENT_STAT;
+		break;
+	default:
+		break;
+	}
+	
+	libfs_instance_lock_t *il = instance_lock_get(service_id);
+	if (il == NULL) {
+		fibril_rwlock_write_lock(&libfs_lock);
+		rl->global = true;
+		return;
+	}
+	
+	fibril_rwlock_read_lock(&libfs_lock);
+	rl->instance = il;
+	
+	if ((concurrent & op) != 0) {
+		libfs_node_lock_t *nl = node_lock_get(service_id, index);
+		if (nl != NULL) {
+			fibril_rwlock_read_lock(&il->lock);
+			if (node_write)
+				fibril_rwlock_write_lock(&nl->lock);
+			else
+				fibril_rwlock_read_lock(&nl->lock);
+			
+			rl->node = nl;
+			rl->node_write = node_write;
+			return;
+		}
+	}
+	
+	fibril_rwlock_write_lock(&il->lock);
+	rl->exclusive = true;
+}
+
+static void libfs_request_unlock(libfs_req_lock_t *rl)
+{
+	if (rl->node != NULL) {
+		if (rl->node_write)
+			fibril_rwlock_write_unlock(&rl->node->lock);
+		else
+			fibril_rwlock_read_unlock(&rl->node->lock);
+		node_lock_put(rl->node);
+	}
+	
+	if (rl->instance != NULL) {
+		if (rl->exclusive)
+			fibril_rwlock_write_unlock(&rl->instance->lock);
+		else
+			fibril_rwlock_read_unlock(&rl->instance->lock);
+		instance_lock_put(rl->instance);
+		fibril_rwlock_read_unlock(&libfs_lock);
+	}
+	
+	if (rl->global)
+		fibril_rwlock_write_unlock(&libfs_lock);
+}
+
 static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 {
 	if (iid) {
@@ -295,6 +513,13 @@ static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		if (!IPC_GET_IMETHOD(call))
 			return;
 		
+		/*
+		 * Each VFS exchange has its own connection fibril, so requests
+		 * arriving on different connections are served in parallel.
+		 */
+		libfs_req_lock_t rl;
+		libfs_request_lock(&call, &rl);
+		
 		switch (IPC_GET_IMETHOD(call)) {
 		case VFS_OUT_FSPROBE:
 			vfs_out_fsprobe(callid, &call);
@@ -345,6 +570,8 @@ static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 			async_answer_0(callid, ENOTSUP);
 			break;
 		}
+		
+		libfs_request_unlock(&rl);
 	}
 }
 
@@ -428,7 +655,8 @@ int fs_register(async_sess_t *sess, vfs_info_t *info, vfs_out_ops_t *vops,
 	
 	/*
 	 * Tell the async framework that other connections are to be handled by
-	 * the same connection fibril as well.
+	 * the same connection function as well. Every connection gets its own
+	 * fibril, see libfs_request_lock() for how the requests are serialized.
 	 */
 	async_set_fallback_port_handler(vfs_connection, NULL);
 	
@@ -41,6 +41,25 @@
 #include <async.h>
 #include <loc.h>
 
+/*
+ * Requests which a file system server allows libfs to serve concurrently
+ * for different nodes. Requests outside of the mask declared in
+ * vfs_out_ops_t.concurrent are serialized against all other requests for
+ * the same file system instance. Servers which declare no mask are not
+ * serialized by libfs at all.
+ *
+ * Concurrent reads, lookups and stats of the same node share the node
+ * lock. A server may therefore only declare such a request concurrent if
+ * serving it does not modify shared node state, such as caches kept in
+ * the in-core node, or if that state has its own locking. Concurrent
+ * writes to different nodes must allocate space under the server's own
+ * locks, libfs does not serialize them.
+ */
+#define LIBFS_CONCURRENT_READ    (1 << 0)
+#define LIBFS_CONCURRENT_WRITE   (1 << 1)
+#define LIBFS_CONCURRENT_LOOKUP  (1 << 2)
+#define LIBFS_CONCURRENT_STAT    (1 << 3)
+
 typedef struct {
 	int (* fsprobe)(service_id_t, vfs_fs_probe_info_t *);
 	int (* mounted)(service_id_t, const char *, fs_index_t *, aoff64_t *);
@@ -52,6 +71,7 @@ typedef struct {
 	int (* close)(service_id_t, fs_index_t);
 	int (* destroy)(service_id_t, fs_index_t);
 	int (* sync)(service_id_t, fs_index_t);
+	unsigned int concurrent;  /**< Mask of LIBFS_CONCURRENT_* requests. */
 } vfs_out_ops_t;
 
 typedef struct {
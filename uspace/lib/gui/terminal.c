@@ -187,17 +187,8 @@ static void term_update_char(terminal_t *term, surface_t *surface,
 	
 	uint16_t glyph = fb_font_glyph(field->ch, NULL);
 	
-	for (unsigned int y = 0; y < FONT_SCANLINES; y++) {
-		pixel_t *dst = pixelmap_pixel_at(
-		    surface_pixmap_access(surface), bx, by + y);
-		pixel_t *dst_max = pixelmap_pixel_at(
-		    surface_pixmap_access(surface), bx + FONT_WIDTH - 1, by + y);
-		if (!dst || !dst_max) continue;
-		int count = FONT_WIDTH;
-		while (count-- != 0) {
-			*dst++ = (fb_font[glyph][y] & (1 << count)) ? fgcolor : bgcolor;
-		}
-	}
+	glyph_cache_draw(term->glyphs, surface_pixmap_access(surface), bx, by,
+	    glyph, fgcolor, bgcolor);
 	surface_add_damaged_region(surface, bx, by, FONT_WIDTH, FONT_SCANLINES);
 }
 
@@ -593,6 +584,9 @@ void deinit_terminal(terminal_t *term)
 	
 	if (term->backbuf)
 		chargrid_destroy(term->backbuf);
+	
+	if (term->glyphs)
+		glyph_cache_destroy(term->glyphs);
 }
 
 static void terminal_destroy(widget_t *widget)
@@ -724,6 +718,7 @@ bool init_terminal(terminal_t *term, widget_t *parent, const void *data,
 	
 	term->frontbuf = NULL;
 	term->backbuf = NULL;
+	term->glyphs = NULL;
 	
 	term->frontbuf = chargrid_create(term->cols, term->rows,
 	    CHARGRID_FLAG_NONE);
@@ -739,6 +734,12 @@ bool init_terminal(terminal_t *term, widget_t *parent, const void *data,
 		return false;
 	}
 	
+	term->glyphs = glyph_cache_create(GLYPH_CACHE_DEFAULT_BUDGET);
+	if (!term->glyphs) {
+		widget_deinit(&term->widget);
+		return false;
+	}
+	
 	chargrid_clear(term->frontbuf);
 	chargrid_clear(term->backbuf);
 	term->top_row = 0;
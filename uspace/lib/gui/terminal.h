@@ -39,6 +39,7 @@
 #include <stddef.h>
 #include <fibril_synch.h>
 #include <font.h>
+#include <glyph_cache.h>
 #include <io/chargrid.h>
 #include <io/con_srv.h>
 #include <adt/list.h>
@@ -63,6 +64,7 @@ typedef struct terminal {
 	sysarg_t rows;
 	chargrid_t *frontbuf;
 	chargrid_t *backbuf;
+	glyph_cache_t *glyphs;
 	sysarg_t top_row;
 	
 	service_id_t dsid;
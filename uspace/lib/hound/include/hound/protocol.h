@@ -127,7 +127,7 @@ typedef struct hound_server_iface {
 	int (*rem_stream)(void *, void *);
 	/** Block until the stream buffer is empty */
 	int (*drain_stream)(void *);
-	/** Write new data to the stream */
+	/** Write new data to the stream, the buffer is reused by the caller */
 	int (*stream_data_write)(void *, const void *, size_t);
 	/** Read data from the stream */
 	int (*stream_data_read)(void *, void *, size_t);
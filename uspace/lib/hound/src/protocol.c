@@ -609,15 +609,40 @@ void hound_connection_handler(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 	}
 }
 
+/**
+ * Make sure the stream transfer buffer is large enough.
+ * @param buffer Pointer to the current buffer, may be updated.
+ * @param buffer_size Pointer to the current size, may be updated.
+ * @param size Required size.
+ * @return Error code.
+ */
+static int hound_server_buffer_reserve(void **buffer, size_t *buffer_size,
+    size_t size)
+{
+	if (size <= *buffer_size)
+		return EOK;
+	void *new_buffer = realloc(*buffer, size);
+	if (!new_buffer)
+		return ENOMEM;
+	*buffer = new_buffer;
+	*buffer_size = size;
+	return EOK;
+}
+
 /**
  * Read data and push it to the stream.
  * @param stream target stream, will push data there.
+ *
+ * One transfer buffer is reused for the whole life of the stream,
+ * the server copies the data out of it.
  */
 static void hound_server_read_data(void *stream)
 {
 	ipc_callid_t callid;
 	ipc_call_t call;
 	size_t size = 0;
+	void *buffer = NULL;
+	size_t buffer_size = 0;
 	int ret_answer = EOK;
 	/* accept data write or drain */
 	while (async_data_write_receive_call(&callid, &call, &size)
@@ -637,8 +662,8 @@ static void hound_server_read_data(void *stream)
 			continue;
 		}
 
-		char *buffer = malloc(size);
-		if (!buffer) {
+		if (hound_server_buffer_reserve(&buffer, &buffer_size, size)
+		    != EOK) {
 			async_answer_0(callid, ENOMEM);
 			continue;
 		}
@@ -649,6 +674,7 @@ static void hound_server_read_data(void *stream)
 			    stream, buffer, size);
 		}
 	}
+	free(buffer);
 	const int ret = IPC_GET_IMETHOD(call) == IPC_M_HOUND_STREAM_EXIT
 	    ? EOK : EINVAL;
 
@@ -665,6 +691,8 @@ static void hound_server_write_data(void *stream)
 	ipc_callid_t callid;
 	ipc_call_t call;
 	size_t size = 0;
+	void *buffer = NULL;
+	size_t buffer_size = 0;
 	int ret_answer = EOK;
 	/* accept data read and drain */
 	while (async_data_read_receive_call(&callid, &call, &size)
@@ -682,8 +710,8 @@ static void hound_server_write_data(void *stream)
 			async_answer_0(callid, ret_answer);
 			continue;
 		}
-		char *buffer = malloc(size);
-		if (!buffer) {
+		if (hound_server_buffer_reserve(&buffer, &buffer_size, size)
+		    != EOK) {
 			async_answer_0(callid, ENOMEM);
 			continue;
 		}
@@ -693,6 +721,7 @@ static void hound_server_write_data(void *stream)
 			    async_data_read_finalize(callid, buffer, size);
 		}
 	}
+	free(buffer);
 	const int ret = IPC_GET_IMETHOD(call) == IPC_M_HOUND_STREAM_EXIT
 	    ? EOK : EINVAL;
 
@@ -167,10 +167,14 @@ int recv_char(receive_buffer_t *rb, char *c, bool consume)
 		}
 		
 		ssize_t rc = rb->receive(rb->client_data, rb->buffer + rb->in, free);
-		if (rc <= 0)
+		if (rc < 0)
 			return rc;
 		
-		rb->in = rc;
+		/* End of stream */
+		if (rc == 0)
+			return EIO;
+		
+		rb->in += rc;
 	}
 	
 	*c = rb->buffer[rb->out];
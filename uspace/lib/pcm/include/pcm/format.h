@@ -40,6 +40,13 @@
 #include <stdbool.h>
 #include <pcm/sample_format.h>
 
+/** Mixing kernel.
+ * Adds samples from the source buffer to the destination buffer.
+ * Arguments are the destination buffer, the source buffer and
+ * the number of samples (frames times channels) to mix.
+ */
+typedef void (*pcm_mix_func_t)(void *, const void *, size_t);
+
 /** Linear PCM audio parameters */
 typedef struct {
 	unsigned channels;
@@ -86,6 +93,19 @@ static inline useconds_t pcm_format_size_to_usec(size_t size,
 	    a->channels, a->sample_format);
 }
 
+/**
+ * Convert audio playback time to byte size.
+ * @param usec Number of microseconds.
+ * @param a pointer to a PCM format structure.
+ * @return Byte-size, rounded down to whole frames.
+ */
+static inline size_t pcm_format_usec_to_size(useconds_t usec,
+    const pcm_format_t *a)
+{
+	return pcm_sample_format_usec_to_size(usec, a->sampling_rate,
+	    a->channels, a->sample_format);
+}
+
 bool pcm_format_same(const pcm_format_t *a, const pcm_format_t* b);
 
 /**
@@ -101,6 +121,11 @@ void pcm_format_silence(void *dst, size_t size, const pcm_format_t *f);
 int pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
     size_t src_size, const pcm_format_t *sf, const pcm_format_t *df);
 int pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format_t *f);
+pcm_mix_func_t pcm_format_mix_func(const pcm_format_t *sf,
+    const pcm_format_t *df);
+int pcm_format_convert_and_mix_func(void *dst, size_t dst_size,
+    const void *src, size_t src_size, const pcm_format_t *sf,
+    const pcm_format_t *df, pcm_mix_func_t func);
 int pcm_format_convert(pcm_format_t a, void* srca, size_t sizea,
     pcm_format_t b, void* srcb, size_t *sizeb);
 
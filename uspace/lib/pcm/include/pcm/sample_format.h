@@ -174,6 +174,22 @@ static inline useconds_t pcm_sample_format_size_to_usec(size_t size,
 	return (frames * 1000000ULL) / sample_rate;
 }
 
+/**
+ * Convert time to byte size.
+ * @param usec Number of useconds of audio data.
+ * @param sample_rate Samples per second.
+ * @param channels Number of samples in every frame.
+ * @param format PCM sample format.
+ * @return Size of the buffer, rounded down to whole frames.
+ */
+static inline size_t pcm_sample_format_usec_to_size(useconds_t usec,
+    unsigned sample_rate, unsigned channels, pcm_sample_format_t format)
+{
+	const unsigned long long frames =
+	    ((unsigned long long)usec * sample_rate) / 1000000ULL;
+	return frames * pcm_sample_format_frame_size(channels, format);
+}
+
 /**
  * Get readable name of a sample format.
  * @param format PCM sample format.
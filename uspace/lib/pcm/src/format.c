@@ -147,6 +147,8 @@ do { \
 		SET_NULL(uint32_t, be, INT32_MIN); break;
 	case PCM_SAMPLE_SINT32_BE:
 		SET_NULL(int32_t, le, 0); break;
+	case PCM_SAMPLE_FLOAT32:
+		SET_NULL(float, le, 0.0f); break;
 	case PCM_SAMPLE_UINT24_32_LE:
 	case PCM_SAMPLE_SINT24_32_LE:
 	case PCM_SAMPLE_UINT24_32_BE:
@@ -155,7 +157,6 @@ do { \
 	case PCM_SAMPLE_SINT24_LE:
 	case PCM_SAMPLE_UINT24_BE:
 	case PCM_SAMPLE_SINT24_BE:
-	case PCM_SAMPLE_FLOAT32:
 	default: ;
 	}
 #undef SET_NULL
@@ -189,6 +190,31 @@ int pcm_format_mix(void *dst, const void *src, size_t size, const pcm_format_t *
  */
 int pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
     size_t src_size, const pcm_format_t *sf, const pcm_format_t *df)
+{
+	if (!sf || !df)
+		return EINVAL;
+	return pcm_format_convert_and_mix_func(dst, dst_size, src, src_size,
+	    sf, df, pcm_format_mix_func(sf, df));
+}
+
+/**
+ * Add and mix audio data using preselected mixing kernel.
+ * @param dst Destination audio buffer
+ * @param dst_size Size of the destination buffer
+ * @param src Source audio buffer
+ * @param src_size Size of the source buffer.
+ * @param sf Pointer to the source format descriptor.
+ * @param df Pointer to the destination format descriptor.
+ * @param func Kernel returned by pcm_format_mix_func() for @p sf and @p df,
+ *        NULL to use the generic conversion.
+ * @return Error code.
+ *
+ * Same as pcm_format_convert_and_mix(), but avoids selecting the kernel
+ * on every call.
+ */
+int pcm_format_convert_and_mix_func(void *dst, size_t dst_size,
+    const void *src, size_t src_size, const pcm_format_t *sf,
+    const pcm_format_t *df, pcm_mix_func_t func)
 {
 	if (!dst || !src || !sf || !df)
 		return EINVAL;
@@ -200,6 +226,14 @@ int pcm_format_convert_and_mix(void *dst, size_t dst_size, const void *src,
 	if ((dst_size % dst_frame_size) != 0)
 		return EINVAL;
 
+	if (func) {
+		/* Missing source frames are silence, nothing to add */
+		const size_t frames = min(dst_size / dst_frame_size,
+		    src_size / src_frame_size);
+		func(dst, src, frames * df->channels);
+		return EOK;
+	}
+
 	/* This is so ugly it eats kittens, and puppies, and ducklings,
 	 * and all little fluffy things...
 	 */
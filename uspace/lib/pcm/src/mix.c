@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup audio
+ * @{
+ */
+/** @file
+ * Specialized mixing kernels.
+ *
+ * The generic mixing code converts every sample to float and back and
+ * decides the sample format for each sample separately. The kernels here
+ * handle the common format pairs directly. They are plain loops without
+ * data dependent branches so that the compiler can vectorize them for
+ * the target architecture.
+ */
+
+#include <assert.h>
+#include <byteorder.h>
+#include <stdint.h>
+
+#include "format.h"
+
+/** Clamp 32-bit value to the signed 16-bit range. */
+static inline int16_t sat16(int32_t v)
+{
+	v = (v > INT16_MAX) ? INT16_MAX : v;
+	v = (v < INT16_MIN) ? INT16_MIN : v;
+	return v;
+}
+
+/** Clamp float value to the <-1,1> range. */
+static inline float satf(float v)
+{
+	v = (v > 1.0f) ? 1.0f : v;
+	v = (v < -1.0f) ? -1.0f : v;
+	return v;
+}
+
+/** Convert float sample in the <-1,1> range to signed 16-bit sample. */
+static inline int32_t f2s16(float v)
+{
+	v *= 32768.0f;
+	v = (v > 32767.0f) ? 32767.0f : v;
+	v = (v < -32768.0f) ? -32768.0f : v;
+	return (int32_t) v;
+}
+
+/** Mix native signed 16-bit samples with saturation. */
+static void mix_s16_s16(void *dst, const void *src, size_t count)
+{
+	int16_t *restrict d = dst;
+	const int16_t *restrict s = src;
+
+	for (size_t i = 0; i < count; ++i)
+		d[i] = sat16((int32_t) d[i] + (int32_t) s[i]);
+}
+
+/** Mix native signed 16-bit samples into float samples. */
+static void mix_s16_f32(void *dst, const void *src, size_t count)
+{
+	float *restrict d = dst;
+	const int16_t *restrict s = src;
+
+	for (size_t i = 0; i < count; ++i)
+		d[i] = satf(d[i] + (float) s[i] * (1.0f / 32768.0f));
+}
+
+/** Mix float samples into native signed 16-bit samples. */
+static void mix_f32_s16(void *dst, const void *src, size_t count)
+{
+	int16_t *restrict d = dst;
+	const float *restrict s = src;
+
+	for (size_t i = 0; i < count; ++i)
+		d[i] = sat16((int32_t) d[i] + f2s16(s[i]));
+}
+
+/** Mix float samples. */
+static void mix_f32_f32(void *dst, const void *src, size_t count)
+{
+	float *restrict d = dst;
+	const float *restrict s = src;
+
+	for (size_t i = 0; i < count; ++i)
+		d[i] = satf(d[i] + s[i]);
+}
+
+#ifdef __LE__
+#define PCM_SAMPLE_SINT16_NATIVE  PCM_SAMPLE_SINT16_LE
+#else
+#define PCM_SAMPLE_SINT16_NATIVE  PCM_SAMPLE_SINT16_BE
+#endif
+
+/**
+ * Select specialized mixing kernel for a pair of formats.
+ * @param sf Pointer to the source format descriptor.
+ * @param df Pointer to the destination format descriptor.
+ * @return Mixing kernel, NULL if the generic code has to be used.
+ *
+ * The kernel only depends on the formats so callers that mix a stream
+ * repeatedly should select it once and keep it.
+ */
+pcm_mix_func_t pcm_format_mix_func(const pcm_format_t *sf,
+    const pcm_format_t *df)
+{
+	assert(sf);
+	assert(df);
+
+	if (sf->channels != df->channels)
+		return NULL;
+
+	if (sf->sample_format == PCM_SAMPLE_SINT16_NATIVE) {
+		if (df->sample_format == PCM_SAMPLE_SINT16_NATIVE)
+			return mix_s16_s16;
+		if (df->sample_format == PCM_SAMPLE_FLOAT32)
+			return mix_s16_f32;
+	}
+
+	if (sf->sample_format == PCM_SAMPLE_FLOAT32) {
+		if (df->sample_format == PCM_SAMPLE_SINT16_NATIVE)
+			return mix_f32_s16;
+		if (df->sample_format == PCM_SAMPLE_FLOAT32)
+			return mix_f32_f32;
+	}
+
+	return NULL;
+}
+
+/**
+ * @}
+ */
@@ -37,6 +37,144 @@
 #include "filter.h"
 #include <io/pixel.h>
 
+/** Number of subpixel positions with precomputed bicubic weights. */
+#define BICUBIC_PHASES  256
+
+/** Catmull-Rom weights of the four pixels around each subpixel position.
+ *
+ * The weights are in 1.14 fixed point and sum up to 1.
+ */
+static const int16_t bicubic_weights[BICUBIC_PHASES][4] = {
+	{ 0, 16384, 0, 0 }, { -32, 16384, 32, 0 },
+	{ -63, 16381, 66, 0 }, { -94, 16379, 100, -1 },
+	{ -124, 16374, 136, -2 }, { -154, 16369, 172, -3 },
+	{ -183, 16361, 210, -4 }, { -212, 16354, 248, -6 },
+	{ -240, 16345, 287, -8 }, { -268, 16335, 327, -10 },
+	{ -295, 16322, 369, -12 }, { -322, 16309, 411, -14 },
+	{ -349, 16297, 453, -17 }, { -375, 16282, 497, -20 },
+	{ -400, 16265, 542, -23 }, { -425, 16247, 588, -26 },
+	{ -450, 16230, 634, -30 }, { -474, 16211, 681, -34 },
+	{ -498, 16191, 729, -38 }, { -521, 16169, 778, -42 },
+	{ -544, 16146, 828, -46 }, { -566, 16122, 879, -51 },
+	{ -588, 16097, 930, -55 }, { -610, 16071, 983, -60 },
+	{ -631, 16044, 1036, -65 }, { -651, 16015, 1090, -70 },
+	{ -672, 15988, 1144, -76 }, { -691, 15957, 1200, -82 },
+	{ -711, 15926, 1256, -87 }, { -730, 15894, 1313, -93 },
+	{ -748, 15861, 1370, -99 }, { -766, 15827, 1429, -106 },
+	{ -784, 15792, 1488, -112 }, { -801, 15756, 1548, -119 },
+	{ -818, 15719, 1608, -125 }, { -835, 15681, 1670, -132 },
+	{ -851, 15642, 1732, -139 }, { -866, 15602, 1794, -146 },
+	{ -882, 15562, 1858, -154 }, { -897, 15520, 1922, -161 },
+	{ -911, 15478, 1986, -169 }, { -925, 15433, 2052, -176 },
+	{ -939, 15390, 2117, -184 }, { -953, 15345, 2184, -192 },
+	{ -966, 15299, 2251, -200 }, { -978, 15252, 2319, -209 },
+	{ -991, 15205, 2387, -217 }, { -1002, 15155, 2456, -225 },
+	{ -1014, 15106, 2526, -234 }, { -1025, 15056, 2596, -243 },
+	{ -1036, 15004, 2667, -251 }, { -1047, 14953, 2738, -260 },
+	{ -1057, 14900, 2810, -269 }, { -1066, 14846, 2882, -278 },
+	{ -1076, 14793, 2955, -288 }, { -1085, 14737, 3029, -297 },
+	{ -1094, 14681, 3103, -306 }, { -1102, 14625, 3177, -316 },
+	{ -1110, 14567, 3252, -325 }, { -1118, 14509, 3328, -335 },
+	{ -1125, 14450, 3404, -345 }, { -1133, 14391, 3480, -354 },
+	{ -1139, 14330, 3557, -364 }, { -1146, 14270, 3634, -374 },
+	{ -1152, 14208, 3712, -384 }, { -1158, 14146, 3790, -394 },
+	{ -1163, 14082, 3869, -404 }, { -1169, 14019, 3948, -414 },
+	{ -1174, 13955, 4027, -424 }, { -1178, 13890, 4107, -435 },
+	{ -1182, 13823, 4188, -445 }, { -1187, 13758, 4268, -455 },
+	{ -1190, 13691, 4349, -466 }, { -1194, 13623, 4431, -476 },
+	{ -1197, 13556, 4512, -487 }, { -1200, 13486, 4595, -497 },
+	{ -1202, 13417, 4677, -508 }, { -1205, 13347, 4760, -518 },
+	{ -1207, 13277, 4843, -529 }, { -1208, 13205, 4926, -539 },
+	{ -1210, 13134, 5010, -550 }, { -1211, 13062, 5094, -561 },
+	{ -1212, 12989, 5178, -571 }, { -1213, 12916, 5263, -582 },
+	{ -1213, 12842, 5348, -593 }, { -1214, 12768, 5433, -603 },
+	{ -1214, 12694, 5518, -614 }, { -1213, 12618, 5604, -625 },
+	{ -1213, 12542, 5690, -635 }, { -1212, 12466, 5776, -646 },
+	{ -1211, 12390, 5862, -657 }, { -1210, 12312, 5949, -667 },
+	{ -1208, 12235, 6035, -678 }, { -1207, 12157, 6122, -688 },
+	{ -1205, 12079, 6209, -699 }, { -1202, 11998, 6297, -709 },
+	{ -1200, 11920, 6384, -720 }, { -1197, 11839, 6472, -730 },
+	{ -1195, 11761, 6559, -741 }, { -1192, 11680, 6647, -751 },
+	{ -1188, 11599, 6735, -762 }, { -1185, 11518, 6823, -772 },
+	{ -1181, 11436, 6911, -782 }, { -1177, 11354, 7000, -793 },
+	{ -1173, 11272, 7088, -803 }, { -1169, 11189, 7177, -813 },
+	{ -1165, 11107, 7265, -823 }, { -1160, 11023, 7354, -833 },
+	{ -1155, 10939, 7443, -843 }, { -1150, 10856, 7531, -853 },
+	{ -1145, 10772, 7620, -863 }, { -1140, 10687, 7709, -872 },
+	{ -1134, 10602, 7798, -882 }, { -1128, 10517, 7887, -892 },
+	{ -1122, 10431, 7976, -901 }, { -1116, 10346, 8065, -911 },
+	{ -1110, 10260, 8154, -920 }, { -1104, 10175, 8242, -929 },
+	{ -1097, 10088, 8331, -938 }, { -1091, 10002, 8420, -947 },
+	{ -1084, 9915, 8509, -956 }, { -1077, 9829, 8597, -965 },
+	{ -1070, 9742, 8686, -974 }, { -1062, 9653, 8775, -982 },
+	{ -1055, 9567, 8863, -991 }, { -1047, 9479, 8951, -999 },
+	{ -1040, 9392, 9040, -1008 }, { -1032, 9304, 9128, -1016 },
+	{ -1024, 9216, 9216, -1024 }, { -1016, 9128, 9304, -1032 },
+	{ -1008, 9040, 9392, -1040 }, { -999, 8951, 9479, -1047 },
+	{ -991, 8863, 9567, -1055 }, { -982, 8774, 9654, -1062 },
+	{ -974, 8687, 9741, -1070 }, { -965, 8598, 9828, -1077 },
+	{ -956, 8509, 9915, -1084 }, { -947, 8420, 10002, -1091 },
+	{ -938, 8331, 10088, -1097 }, { -929, 8243, 10174, -1104 },
+	{ -920, 8154, 10260, -1110 }, { -911, 8065, 10346, -1116 },
+	{ -901, 7975, 10432, -1122 }, { -892, 7887, 10517, -1128 },
+	{ -882, 7798, 10602, -1134 }, { -872, 7709, 10687, -1140 },
+	{ -863, 7621, 10771, -1145 }, { -853, 7532, 10855, -1150 },
+	{ -843, 7443, 10939, -1155 }, { -833, 7354, 11023, -1160 },
+	{ -823, 7266, 11106, -1165 }, { -813, 7177, 11189, -1169 },
+	{ -803, 7088, 11272, -1173 }, { -793, 7000, 11354, -1177 },
+	{ -782, 6911, 11436, -1181 }, { -772, 6823, 11518, -1185 },
+	{ -762, 6735, 11599, -1188 }, { -751, 6647, 11680, -1192 },
+	{ -741, 6560, 11760, -1195 }, { -730, 6471, 11840, -1197 },
+	{ -720, 6384, 11920, -1200 }, { -709, 6296, 11999, -1202 },
+	{ -699, 6210, 12078, -1205 }, { -688, 6122, 12157, -1207 },
+	{ -678, 6035, 12235, -1208 }, { -667, 5949, 12312, -1210 },
+	{ -657, 5863, 12389, -1211 }, { -646, 5776, 12466, -1212 },
+	{ -635, 5690, 12542, -1213 }, { -625, 5604, 12618, -1213 },
+	{ -614, 5519, 12693, -1214 }, { -603, 5433, 12768, -1214 },
+	{ -593, 5348, 12842, -1213 }, { -582, 5263, 12916, -1213 },
+	{ -571, 5178, 12989, -1212 }, { -561, 5094, 13062, -1211 },
+	{ -550, 5010, 13134, -1210 }, { -539, 4925, 13206, -1208 },
+	{ -529, 4843, 13277, -1207 }, { -518, 4760, 13347, -1205 },
+	{ -508, 4677, 13417, -1202 }, { -497, 4595, 13486, -1200 },
+	{ -487, 4513, 13555, -1197 }, { -476, 4431, 13623, -1194 },
+	{ -466, 4349, 13691, -1190 }, { -455, 4268, 13758, -1187 },
+	{ -445, 4187, 13824, -1182 }, { -435, 4107, 13890, -1178 },
+	{ -424, 4027, 13955, -1174 }, { -414, 3948, 14019, -1169 },
+	{ -404, 3868, 14083, -1163 }, { -394, 3790, 14146, -1158 },
+	{ -384, 3712, 14208, -1152 }, { -374, 3634, 14270, -1146 },
+	{ -364, 3556, 14331, -1139 }, { -354, 3480, 14391, -1133 },
+	{ -345, 3404, 14450, -1125 }, { -335, 3328, 14509, -1118 },
+	{ -325, 3252, 14567, -1110 }, { -316, 3177, 14625, -1102 },
+	{ -306, 3103, 14681, -1094 }, { -297, 3029, 14737, -1085 },
+	{ -288, 2956, 14792, -1076 }, { -278, 2882, 14846, -1066 },
+	{ -269, 2810, 14900, -1057 }, { -260, 2738, 14953, -1047 },
+	{ -251, 2666, 15005, -1036 }, { -243, 2596, 15056, -1025 },
+	{ -234, 2526, 15106, -1014 }, { -225, 2456, 15155, -1002 },
+	{ -217, 2388, 15204, -991 }, { -209, 2319, 15252, -978 },
+	{ -200, 2251, 15299, -966 }, { -192, 2184, 15345, -953 },
+	{ -184, 2117, 15390, -939 }, { -176, 2051, 15434, -925 },
+	{ -169, 1986, 15478, -911 }, { -161, 1922, 15520, -897 },
+	{ -154, 1858, 15562, -882 }, { -146, 1793, 15603, -866 },
+	{ -139, 1732, 15642, -851 }, { -132, 1670, 15681, -835 },
+	{ -125, 1608, 15719, -818 }, { -119, 1548, 15756, -801 },
+	{ -112, 1488, 15792, -784 }, { -106, 1429, 15827, -766 },
+	{ -99, 1370, 15861, -748 }, { -93, 1313, 15894, -730 },
+	{ -87, 1256, 15926, -711 }, { -82, 1200, 15957, -691 },
+	{ -76, 1145, 15987, -672 }, { -70, 1089, 16016, -651 },
+	{ -65, 1036, 16044, -631 }, { -60, 983, 16071, -610 },
+	{ -55, 930, 16097, -588 }, { -51, 879, 16122, -566 },
+	{ -46, 828, 16146, -544 }, { -42, 779, 16168, -521 },
+	{ -38, 730, 16190, -498 }, { -34, 681, 16211, -474 },
+	{ -30, 634, 16230, -450 }, { -26, 587, 16248, -425 },
+	{ -23, 541, 16266, -400 }, { -20, 497, 16282, -375 },
+	{ -17, 453, 16297, -349 }, { -14, 410, 16310, -322 },
+	{ -12, 368, 16323, -295 }, { -10, 328, 16334, -268 },
+	{ -8, 287, 16345, -240 }, { -6, 248, 16354, -212 },
+	{ -4, 209, 16362, -183 }, { -3, 172, 16369, -154 },
+	{ -2, 136, 16374, -124 }, { -1, 101, 16378, -94 },
+	{ 0, 65, 16382, -63 }, { 0, 33, 16383, -32 }
+};
+
 
 static long round(double val)
 {
@@ -60,6 +198,28 @@ static long ceil(double val)
 }
 
 
+static inline uint8_t clamp_channel(float val)
+{
+	if (val <= 0)
+		return 0;
+	
+	if (val >= 255)
+		return 255;
+	
+	return (uint8_t) val;
+}
+
+static inline uint8_t clamp_channel_fixed(int32_t val)
+{
+	if (val <= 0)
+		return 0;
+	
+	if (val >= 255)
+		return 255;
+	
+	return (uint8_t) val;
+}
+
 static inline pixel_t blend_pixels(size_t count, float *weights,
     pixel_t *pixels)
 {
@@ -71,8 +231,45 @@ static inline pixel_t blend_pixels(size_t count, float *weights,
 		blue  += weights[index] *  BLUE(pixels[index]);
 	}
 	
-	return PIXEL((uint8_t) alpha, (uint8_t) red, (uint8_t) green,
-	    (uint8_t) blue);
+	return PIXEL(clamp_channel(alpha), clamp_channel(red),
+	    clamp_channel(green), clamp_channel(blue));
+}
+
+/** Interpolate between two pixels.
+ *
+ * Two channels are processed at a time: each of them occupies a 16-bit
+ * lane of a 32-bit word, which is wide enough for a channel multiplied
+ * by a weight of at most 256.
+ *
+ * @param p1     First pixel.
+ * @param p2     Second pixel.
+ * @param weight Weight of the second pixel (0 to 256).
+ *
+ */
+static inline pixel_t lerp_pixels(pixel_t p1, pixel_t p2, uint32_t weight)
+{
+	uint32_t rb1 = p1 & 0x00ff00ff;
+	uint32_t ag1 = (p1 >> 8) & 0x00ff00ff;
+	uint32_t rb2 = p2 & 0x00ff00ff;
+	uint32_t ag2 = (p2 >> 8) & 0x00ff00ff;
+	
+	uint32_t rb = ((rb1 * (256 - weight) + rb2 * weight + 0x00800080) >> 8) &
+	    0x00ff00ff;
+	uint32_t ag = (ag1 * (256 - weight) + ag2 * weight + 0x00800080) &
+	    0xff00ff00;
+	
+	return rb | ag;
+}
+
+static void bicubic_weights_float(double t, float *weights)
+{
+	double t2 = t * t;
+	double t3 = t2 * t;
+	
+	weights[0] = (-t3 + 2 * t2 - t) / 2;
+	weights[1] = (3 * t3 - 5 * t2 + 2) / 2;
+	weights[2] = (-3 * t3 + 4 * t2 + t) / 2;
+	weights[3] = (t3 - t2) / 2;
 }
 
 pixel_t filter_nearest(pixelmap_t *pixmap, double x, double y,
@@ -115,8 +312,121 @@ pixel_t filter_bilinear(pixelmap_t *pixmap, double x, double y,
 pixel_t filter_bicubic(pixelmap_t *pixmap, double x, double y,
     pixelmap_extend_t extend)
 {
-	// TODO
-	return 0;
+	long x1 = floor(x);
+	long y1 = floor(y);
+	
+	float x_weights[4];
+	float y_weights[4];
+	bicubic_weights_float(x - x1, x_weights);
+	bicubic_weights_float(y - y1, y_weights);
+	
+	pixel_t pixels[16];
+	float weights[16];
+	for (int j = 0; j < 4; j++) {
+		for (int i = 0; i < 4; i++) {
+			pixels[j * 4 + i] = pixelmap_get_extended_pixel(pixmap,
+			    x1 - 1 + i, y1 - 1 + j, extend);
+			weights[j * 4 + i] = x_weights[i] * y_weights[j];
+		}
+	}
+	
+	return blend_pixels(16, weights, pixels);
+}
+
+pixel_t filter_nearest_fixed(pixelmap_t *pixmap, fixed_t x, fixed_t y,
+    pixelmap_extend_t extend)
+{
+	return pixelmap_get_extended_pixel(pixmap, fixed_round(x),
+	    fixed_round(y), extend);
+}
+
+pixel_t filter_bilinear_fixed(pixelmap_t *pixmap, fixed_t x, fixed_t y,
+    pixelmap_extend_t extend)
+{
+	int32_t x1 = fixed_floor(x);
+	int32_t y1 = fixed_floor(y);
+	uint32_t x_weight = fixed_frac(x) >> (FIXED_SHIFT - 8);
+	uint32_t y_weight = fixed_frac(y) >> (FIXED_SHIFT - 8);
+	
+	pixel_t top = pixelmap_get_extended_pixel(pixmap, x1, y1, extend);
+	if (x_weight > 0) {
+		top = lerp_pixels(top,
+		    pixelmap_get_extended_pixel(pixmap, x1 + 1, y1, extend),
+		    x_weight);
+	}
+	
+	if (y_weight == 0)
+		return top;
+	
+	pixel_t bottom = pixelmap_get_extended_pixel(pixmap, x1, y1 + 1, extend);
+	if (x_weight > 0) {
+		bottom = lerp_pixels(bottom,
+		    pixelmap_get_extended_pixel(pixmap, x1 + 1, y1 + 1, extend),
+		    x_weight);
+	}
+	
+	return lerp_pixels(top, bottom, y_weight);
+}
+
+pixel_t filter_bicubic_fixed(pixelmap_t *pixmap, fixed_t x, fixed_t y,
+    pixelmap_extend_t extend)
+{
+	int32_t x1 = fixed_floor(x);
+	int32_t y1 = fixed_floor(y);
+	unsigned int x_phase = fixed_frac(x) >> (FIXED_SHIFT - 8);
+	unsigned int y_phase = fixed_frac(y) >> (FIXED_SHIFT - 8);
+	
+	if ((x_phase == 0) && (y_phase == 0))
+		return pixelmap_get_extended_pixel(pixmap, x1, y1, extend);
+	
+	const int16_t *x_weights = bicubic_weights[x_phase];
+	const int16_t *y_weights = bicubic_weights[y_phase];
+	
+	int32_t alpha = 0, red = 0, green = 0, blue = 0;
+	
+	for (int j = 0; j < 4; j++) {
+		int32_t row_alpha = 0, row_red = 0, row_green = 0, row_blue = 0;
+		
+		for (int i = 0; i < 4; i++) {
+			pixel_t pixel = pixelmap_get_extended_pixel(pixmap,
+			    x1 - 1 + i, y1 - 1 + j, extend);
+			
+			row_alpha += x_weights[i] * ALPHA(pixel);
+			row_red   += x_weights[i] *   RED(pixel);
+			row_green += x_weights[i] * GREEN(pixel);
+			row_blue  += x_weights[i] *  BLUE(pixel);
+		}
+		
+		/* Keep 7 fractional bits so that the column sums fit. */
+		alpha += y_weights[j] * ((row_alpha + (1 << 6)) >> 7);
+		red   += y_weights[j] * ((row_red   + (1 << 6)) >> 7);
+		green += y_weights[j] * ((row_green + (1 << 6)) >> 7);
+		blue  += y_weights[j] * ((row_blue  + (1 << 6)) >> 7);
+	}
+	
+	return PIXEL(clamp_channel_fixed((alpha + (1 << 20)) >> 21),
+	    clamp_channel_fixed((red + (1 << 20)) >> 21),
+	    clamp_channel_fixed((green + (1 << 20)) >> 21),
+	    clamp_channel_fixed((blue + (1 << 20)) >> 21));
+}
+
+/** Find the fixed-point counterpart of a filter.
+ *
+ * @return Fixed-point filter or NULL if there is none.
+ *
+ */
+filter_fixed_t filter_get_fixed(filter_t filter)
+{
+	if (filter == filter_nearest)
+		return filter_nearest_fixed;
+	
+	if (filter == filter_bilinear)
+		return filter_bilinear_fixed;
+	
+	if (filter == filter_bicubic)
+		return filter_bicubic_fixed;
+	
+	return NULL;
 }
 
 /** @}
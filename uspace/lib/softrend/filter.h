@@ -37,13 +37,25 @@
 #define SOFTREND_FILTER_H_
 
 #include <io/pixelmap.h>
+#include "fixed.h"
 
 typedef pixel_t (*filter_t)(pixelmap_t *, double, double, pixelmap_extend_t);
+typedef pixel_t (*filter_fixed_t)(pixelmap_t *, fixed_t, fixed_t,
+    pixelmap_extend_t);
 
 extern pixel_t filter_nearest(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bilinear(pixelmap_t *, double, double, pixelmap_extend_t);
 extern pixel_t filter_bicubic(pixelmap_t *, double, double, pixelmap_extend_t);
 
+extern pixel_t filter_nearest_fixed(pixelmap_t *, fixed_t, fixed_t,
+    pixelmap_extend_t);
+extern pixel_t filter_bilinear_fixed(pixelmap_t *, fixed_t, fixed_t,
+    pixelmap_extend_t);
+extern pixel_t filter_bicubic_fixed(pixelmap_t *, fixed_t, fixed_t,
+    pixelmap_extend_t);
+
+extern filter_fixed_t filter_get_fixed(filter_t);
+
 #endif
 
 /** @}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup softrend
+ * @{
+ */
+/**
+ * @file
+ * Signed 16.16 fixed-point numbers.
+ */
+
+#ifndef SOFTREND_FIXED_H_
+#define SOFTREND_FIXED_H_
+
+#include <stdint.h>
+
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT  16
+#define FIXED_ONE    (1 << FIXED_SHIFT)
+#define FIXED_HALF   (1 << (FIXED_SHIFT - 1))
+
+/** Largest magnitude of a coordinate kept in fixed point.
+ *
+ * Leaves enough headroom for the filters to address neighbouring pixels
+ * without overflow.
+ */
+#define FIXED_COORD_MAX  16384.0
+
+static inline fixed_t fixed_from_double(double val)
+{
+	double scaled = val * FIXED_ONE;
+	return (fixed_t) ((scaled >= 0) ? (scaled + 0.5) : (scaled - 0.5));
+}
+
+static inline int32_t fixed_floor(fixed_t val)
+{
+	return val >> FIXED_SHIFT;
+}
+
+static inline uint32_t fixed_frac(fixed_t val)
+{
+	return val & (FIXED_ONE - 1);
+}
+
+/** Round to the nearest integer, halfway cases away from zero. */
+static inline int32_t fixed_round(fixed_t val)
+{
+	return (val >= 0) ? ((val + FIXED_HALF) >> FIXED_SHIFT) :
+	    -((-val + FIXED_HALF) >> FIXED_SHIFT);
+}
+
+#endif
+
+/** @}
+ */
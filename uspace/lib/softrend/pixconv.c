@@ -35,6 +35,8 @@
  */
 
 #include <byteorder.h>
+#include <mem.h>
+#include <stdint.h>
 #include "pixconv.h"
 
 /** Pixel conversion and mask functions
@@ -286,5 +288,272 @@ pixel_t gray_8_2pixel(void *src)
 	return (0xff000000 | (val << 16) | (val << 8) | (val));
 }
 
+/** Row conversion functions
+ *
+ * These functions convert a row of ARGB pixels to a visual. They are
+ * plain loops over the per-pixel functions above, which the compiler
+ * inlines and, where the target has vector instructions, vectorizes.
+ * The per-pixel functions store whole words, so a destination which is
+ * not aligned to the pixel size is written through a bounce word.
+ */
+
+#define PIXEL2VISUAL_ROW(visual, bytes) \
+	void pixel2##visual##_row(void *dst, const pixel_t *src, size_t count) \
+	{ \
+		uint8_t *pos = (uint8_t *) dst; \
+		\
+		if (((uintptr_t) pos & ((bytes) - 1)) != 0) { \
+			for (size_t i = 0; i < count; i++) { \
+				uint32_t word; \
+				pixel2##visual(&word, src[i]); \
+				memcpy(pos, &word, (bytes)); \
+				pos += (bytes); \
+			} \
+			return; \
+		} \
+		\
+		for (size_t i = 0; i < count; i++) { \
+			pixel2##visual(pos, src[i]); \
+			pos += (bytes); \
+		} \
+	}
+
+PIXEL2VISUAL_ROW(argb_8888, 4)
+PIXEL2VISUAL_ROW(abgr_8888, 4)
+PIXEL2VISUAL_ROW(rgba_8888, 4)
+PIXEL2VISUAL_ROW(bgra_8888, 4)
+PIXEL2VISUAL_ROW(rgb_0888, 4)
+PIXEL2VISUAL_ROW(bgr_0888, 4)
+PIXEL2VISUAL_ROW(rgb_8880, 4)
+PIXEL2VISUAL_ROW(bgr_8880, 4)
+PIXEL2VISUAL_ROW(rgb_555_be, 2)
+PIXEL2VISUAL_ROW(rgb_555_le, 2)
+PIXEL2VISUAL_ROW(rgb_565_be, 2)
+PIXEL2VISUAL_ROW(rgb_565_le, 2)
+PIXEL2VISUAL_ROW(bgr_323, 1)
+PIXEL2VISUAL_ROW(gray_8, 1)
+
+/** Store four packed 24-bit pixels as three 32-bit words.
+ *
+ * The pixels are held in the low three bytes of the arguments, the
+ * least significant byte being stored first.
+ */
+static inline void pack_888(uint32_t *dst, uint32_t p0, uint32_t p1,
+    uint32_t p2, uint32_t p3)
+{
+	dst[0] = host2uint32_t_le((p0 & 0xffffff) | (p1 << 24));
+	dst[1] = host2uint32_t_le(((p1 >> 8) & 0xffff) | (p2 << 16));
+	dst[2] = host2uint32_t_le(((p2 >> 16) & 0xff) | (p3 << 8));
+}
+
+/** Byte swap the color channels of a pixel for the RGB 888 layout. */
+static inline uint32_t swap_888(pixel_t pix)
+{
+	return (RED(pix) | (GREEN(pix) << 8) | (BLUE(pix) << 16));
+}
+
+/*
+ * The 24-bit visuals do not vectorize as simple loops. Instead four
+ * pixels at a time are packed into three aligned word stores, with the
+ * unaligned head and the tail of the row converted pixel by pixel.
+ */
+
+void pixel2rgb_888_row(void *dst, const pixel_t *src, size_t count)
+{
+	uint8_t *pos = (uint8_t *) dst;
+	size_t i = 0;
+
+	while ((i < count) && (((uintptr_t) pos & 3) != 0)) {
+		pixel2rgb_888(pos, src[i++]);
+		pos += 3;
+	}
+
+	while (i + 4 <= count) {
+		pack_888((uint32_t *) pos, swap_888(src[i]), swap_888(src[i + 1]),
+		    swap_888(src[i + 2]), swap_888(src[i + 3]));
+		pos += 12;
+		i += 4;
+	}
+
+	while (i < count) {
+		pixel2rgb_888(pos, src[i++]);
+		pos += 3;
+	}
+}
+
+void pixel2bgr_888_row(void *dst, const pixel_t *src, size_t count)
+{
+	uint8_t *pos = (uint8_t *) dst;
+	size_t i = 0;
+
+	while ((i < count) && (((uintptr_t) pos & 3) != 0)) {
+		pixel2bgr_888(pos, src[i++]);
+		pos += 3;
+	}
+
+	while (i + 4 <= count) {
+		pack_888((uint32_t *) pos, src[i], src[i + 1], src[i + 2],
+		    src[i + 3]);
+		pos += 12;
+		i += 4;
+	}
+
+	while (i < count) {
+		pixel2bgr_888(pos, src[i++]);
+		pos += 3;
+	}
+}
+
+/** Conversions for each visual, indexed by visual_t. */
+static const pixconv_t pixconv_table[] = {
+	[VISUAL_INDIRECT_8] = {
+		.pixel_bytes = 1,
+		.pixel2visual = pixel2bgr_323,
+		.pixel2visual_row = pixel2bgr_323_row,
+		.visual2pixel = bgr_323_2pixel,
+		.visual_mask = visual_mask_323
+	},
+	[VISUAL_RGB_5_5_5_LE] = {
+		.pixel_bytes = 2,
+		.pixel2visual = pixel2rgb_555_le,
+		.pixel2visual_row = pixel2rgb_555_le_row,
+		.visual2pixel = rgb_555_le_2pixel,
+		.visual_mask = visual_mask_555
+	},
+	[VISUAL_RGB_5_5_5_BE] = {
+		.pixel_bytes = 2,
+		.pixel2visual = pixel2rgb_555_be,
+		.pixel2visual_row = pixel2rgb_555_be_row,
+		.visual2pixel = rgb_555_be_2pixel,
+		.visual_mask = visual_mask_555
+	},
+	[VISUAL_RGB_5_6_5_LE] = {
+		.pixel_bytes = 2,
+		.pixel2visual = pixel2rgb_565_le,
+		.pixel2visual_row = pixel2rgb_565_le_row,
+		.visual2pixel = rgb_565_le_2pixel,
+		.visual_mask = visual_mask_565
+	},
+	[VISUAL_RGB_5_6_5_BE] = {
+		.pixel_bytes = 2,
+		.pixel2visual = pixel2rgb_565_be,
+		.pixel2visual_row = pixel2rgb_565_be_row,
+		.visual2pixel = rgb_565_be_2pixel,
+		.visual_mask = visual_mask_565
+	},
+	[VISUAL_BGR_8_8_8] = {
+		.pixel_bytes = 3,
+		.pixel2visual = pixel2bgr_888,
+		.pixel2visual_row = pixel2bgr_888_row,
+		.visual2pixel = bgr_888_2pixel,
+		.visual_mask = visual_mask_888
+	},
+	[VISUAL_BGR_0_8_8_8] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2bgr_0888,
+		.pixel2visual_row = pixel2bgr_0888_row,
+		.visual2pixel = bgr_0888_2pixel,
+		.visual_mask = visual_mask_0888
+	},
+	[VISUAL_BGR_8_8_8_0] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2bgr_8880,
+		.pixel2visual_row = pixel2bgr_8880_row,
+		.visual2pixel = bgr_8880_2pixel,
+		.visual_mask = visual_mask_8880
+	},
+	[VISUAL_ABGR_8_8_8_8] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2abgr_8888,
+		.pixel2visual_row = pixel2abgr_8888_row,
+		.visual2pixel = abgr_8888_2pixel,
+		.visual_mask = visual_mask_8888
+	},
+	[VISUAL_BGRA_8_8_8_8] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2bgra_8888,
+		.pixel2visual_row = pixel2bgra_8888_row,
+		.visual2pixel = bgra_8888_2pixel,
+		.visual_mask = visual_mask_8888
+	},
+	[VISUAL_RGB_8_8_8] = {
+		.pixel_bytes = 3,
+		.pixel2visual = pixel2rgb_888,
+		.pixel2visual_row = pixel2rgb_888_row,
+		.visual2pixel = rgb_888_2pixel,
+		.visual_mask = visual_mask_888
+	},
+	[VISUAL_RGB_0_8_8_8] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2rgb_0888,
+		.pixel2visual_row = pixel2rgb_0888_row,
+		.visual2pixel = rgb_0888_2pixel,
+		.visual_mask = visual_mask_0888
+	},
+	[VISUAL_RGB_8_8_8_0] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2rgb_8880,
+		.pixel2visual_row = pixel2rgb_8880_row,
+		.visual2pixel = rgb_8880_2pixel,
+		.visual_mask = visual_mask_8880
+	},
+	[VISUAL_ARGB_8_8_8_8] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2argb_8888,
+		.pixel2visual_row = pixel2argb_8888_row,
+		.visual2pixel = argb_8888_2pixel,
+		.visual_mask = visual_mask_8888
+	},
+	[VISUAL_RGBA_8_8_8_8] = {
+		.pixel_bytes = 4,
+		.pixel2visual = pixel2rgba_8888,
+		.pixel2visual_row = pixel2rgba_8888_row,
+		.visual2pixel = rgba_8888_2pixel,
+		.visual_mask = visual_mask_8888
+	}
+};
+
+/** Get the conversion functions for a visual.
+ *
+ * The result is meant to be looked up once when a mode is set, so that
+ * drawing does not have to dispatch on the visual.
+ *
+ * @param visual Visual.
+ *
+ * @return Conversion functions or NULL if the visual is not supported.
+ *
+ */
+const pixconv_t *pixconv_get(visual_t visual)
+{
+	if ((visual <= VISUAL_UNKNOWN) ||
+	    ((size_t) visual >= sizeof(pixconv_table) / sizeof(pixconv_table[0])))
+		return NULL;
+
+	return &pixconv_table[visual];
+}
+
+/** Convert a rectangle of ARGB pixels to a visual.
+ *
+ * @param conv     Conversion functions of the visual.
+ * @param dst      First pixel of the destination rectangle.
+ * @param scanline Distance between destination rows in bytes.
+ * @param src      First pixel of the source rectangle.
+ * @param stride   Distance between source rows in pixels.
+ * @param width    Width of the rectangle.
+ * @param height   Height of the rectangle.
+ *
+ */
+void pixconv_rect(const pixconv_t *conv, void *dst, size_t scanline,
+    const pixel_t *src, size_t stride, size_t width, size_t height)
+{
+	uint8_t *pos = (uint8_t *) dst;
+
+	for (size_t y = 0; y < height; y++) {
+		conv->pixel2visual_row(pos, src, width);
+		pos += scanline;
+		src += stride;
+	}
+}
+
 /** @}
  */
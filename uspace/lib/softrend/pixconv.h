@@ -37,7 +37,9 @@
 #ifndef SOFTREND_PIXCONV_H_
 #define SOFTREND_PIXCONV_H_
 
+#include <abi/fb/visuals.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <io/pixel.h>
 
 /** Function to render a pixel. */
@@ -49,6 +51,19 @@ typedef void (*visual_mask_t)(void *, bool);
 /** Function to retrieve a pixel. */
 typedef pixel_t (*visual2pixel_t)(void *);
 
+/** Function to render a row of pixels. */
+typedef void (*pixel2visual_row_t)(void *, const pixel_t *, size_t);
+
+/** Conversion functions of a visual. */
+typedef struct {
+	/** Size of a pixel in bytes */
+	size_t pixel_bytes;
+	pixel2visual_t pixel2visual;
+	pixel2visual_row_t pixel2visual_row;
+	visual2pixel_t visual2pixel;
+	visual_mask_t visual_mask;
+} pixconv_t;
+
 extern void pixel2argb_8888(void *, pixel_t);
 extern void pixel2abgr_8888(void *, pixel_t);
 extern void pixel2rgba_8888(void *, pixel_t);
@@ -92,6 +107,27 @@ extern pixel_t rgb_565_le_2pixel(void *);
 extern pixel_t bgr_323_2pixel(void *);
 extern pixel_t gray_8_2pixel(void *);
 
+extern void pixel2argb_8888_row(void *, const pixel_t *, size_t);
+extern void pixel2abgr_8888_row(void *, const pixel_t *, size_t);
+extern void pixel2rgba_8888_row(void *, const pixel_t *, size_t);
+extern void pixel2bgra_8888_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_0888_row(void *, const pixel_t *, size_t);
+extern void pixel2bgr_0888_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_8880_row(void *, const pixel_t *, size_t);
+extern void pixel2bgr_8880_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_888_row(void *, const pixel_t *, size_t);
+extern void pixel2bgr_888_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_555_be_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_555_le_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_565_be_row(void *, const pixel_t *, size_t);
+extern void pixel2rgb_565_le_row(void *, const pixel_t *, size_t);
+extern void pixel2bgr_323_row(void *, const pixel_t *, size_t);
+extern void pixel2gray_8_row(void *, const pixel_t *, size_t);
+
+extern const pixconv_t *pixconv_get(visual_t);
+extern void pixconv_rect(const pixconv_t *, void *, size_t, const pixel_t *,
+    size_t, size_t, size_t);
+
 #endif
 
 /** @}
@@ -194,5 +194,51 @@ void transform_apply_affine(const transform_t *trans, double *x, double *y)
 	    trans->matrix[1][2];
 }
 
+/** Prepare fixed-point stepping of an affine transform along a row.
+ *
+ * The transformed coordinates of the pixel at (@a x + i, @a y) are
+ * obtained by adding @a i times the step to the transformed coordinates
+ * of the first pixel, which avoids evaluating the transform in double
+ * precision for every pixel. The rounding error of the step accumulates
+ * by up to half a unit per pixel, so the rows should be kept short.
+ *
+ * @param trans Transform to apply.
+ * @param x     Horizontal coordinate of the first pixel of the row.
+ * @param y     Vertical coordinate of the row.
+ * @param count Number of pixels of the row.
+ * @param fx    Transformed horizontal coordinate of the first pixel.
+ * @param fy    Transformed vertical coordinate of the first pixel.
+ * @param dx    Horizontal step.
+ * @param dy    Vertical step.
+ *
+ * @return True on success, false if the transformed coordinates of the
+ *         row do not fit into the fixed-point range.
+ *
+ */
+bool transform_span_fixed(const transform_t *trans, double x, double y,
+    size_t count, fixed_t *fx, fixed_t *fy, fixed_t *dx, fixed_t *dy)
+{
+	double x_first = x;
+	double y_first = y;
+	transform_apply_affine(trans, &x_first, &y_first);
+	
+	double x_last = x + count;
+	double y_last = y;
+	transform_apply_affine(trans, &x_last, &y_last);
+	
+	if ((fabs(x_first) >= FIXED_COORD_MAX) ||
+	    (fabs(y_first) >= FIXED_COORD_MAX) ||
+	    (fabs(x_last) >= FIXED_COORD_MAX) ||
+	    (fabs(y_last) >= FIXED_COORD_MAX))
+		return false;
+	
+	*fx = fixed_from_double(x_first);
+	*fy = fixed_from_double(y_first);
+	*dx = fixed_from_double(trans->matrix[0][0]);
+	*dy = fixed_from_double(trans->matrix[1][0]);
+	
+	return true;
+}
+
 /** @}
  */
@@ -37,6 +37,8 @@
 #define SOFTREND_TRANSFORM_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "fixed.h"
 
 #define TRANSFORM_MATRIX_DIM  3
 
@@ -58,6 +60,9 @@ extern bool transform_is_fast(transform_t *);
 extern void transform_apply_linear(const transform_t *, double *, double *);
 extern void transform_apply_affine(const transform_t *, double *, double *);
 
+extern bool transform_span_fixed(const transform_t *, double, double, size_t,
+    fixed_t *, fixed_t *, fixed_t *, fixed_t *);
+
 #endif
 
 /** @}
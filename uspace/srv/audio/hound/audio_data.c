@@ -33,8 +33,10 @@
 /** @file
  */
 
+#include <libarch/barrier.h>
 #include <macros.h>
 #include <malloc.h>
+#include <mem.h>
 
 #include "audio_data.h"
 #include "log.h"
@@ -191,6 +193,9 @@ void audio_pipe_init(audio_pipe_t *pipe)
 	fibril_mutex_initialize(&pipe->guard);
 	pipe->frames = 0;
 	pipe->bytes = 0;
+	pipe->mix_src_format = AUDIO_FORMAT_ANY;
+	pipe->mix_dst_format = AUDIO_FORMAT_ANY;
+	pipe->mix_func = NULL;
 }
 
 /**
@@ -253,6 +258,27 @@ audio_data_t *audio_pipe_pop(audio_pipe_t *pipe)
 }
 
 
+/**
+ * Get mixing kernel for pipe data.
+ * @param pipe The audio pipe.
+ * @param sf Format of the data in the pipe.
+ * @param df Target data format.
+ * @return Mixing kernel, NULL for generic conversion.
+ *
+ * The kernel is only selected again if the formats change.
+ */
+static pcm_mix_func_t audio_pipe_mix_func(audio_pipe_t *pipe,
+    const pcm_format_t *sf, const pcm_format_t *df)
+{
+	if (!pcm_format_same(&pipe->mix_src_format, sf) ||
+	    !pcm_format_same(&pipe->mix_dst_format, df)) {
+		pipe->mix_src_format = *sf;
+		pipe->mix_dst_format = *df;
+		pipe->mix_func = pcm_format_mix_func(sf, df);
+	}
+	return pipe->mix_func;
+}
+
 /**
  * Use data store in a pipe and mix it into the provided buffer.
  * @param pipe The piep that should provide data.
@@ -288,9 +314,10 @@ ssize_t audio_pipe_mix_data(audio_pipe_t *pipe, void *data,
 		assert(src_copy_size <= audio_data_link_remain_size(alink));
 
 		/* Copy audio data */
-		pcm_format_convert_and_mix(data, dst_copy_size,
+		pcm_format_convert_and_mix_func(data, dst_copy_size,
 		    audio_data_link_start(alink), src_copy_size,
-		    &alink->adata->format, f);
+		    &alink->adata->format, f,
+		    audio_pipe_mix_func(pipe, &alink->adata->format, f));
 
 		/* Update values */
 		needed_frames -= copy_frames;
@@ -310,6 +337,135 @@ ssize_t audio_pipe_mix_data(audio_pipe_t *pipe, void *data,
 	return copied_size;
 }
 
+/* Audio Ring */
+
+/**
+ * Initialize audio ring structure.
+ * @param ring The ring structure to initialize.
+ * @param size Requested capacity in bytes, rounded down to whole frames.
+ * @param format Format of the stored audio data.
+ * @return Error code.
+ */
+int audio_ring_init(audio_ring_t *ring, size_t size, pcm_format_t format)
+{
+	assert(ring);
+	const size_t frame_size = pcm_format_frame_size(&format);
+	size -= size % frame_size;
+	if (size == 0)
+		return EINVAL;
+
+	ring->buffer = malloc(size);
+	if (!ring->buffer)
+		return ENOMEM;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->format = format;
+	ring->mix_dst_format = AUDIO_FORMAT_ANY;
+	ring->mix_func = NULL;
+	return EOK;
+}
+
+/**
+ * Release ring storage.
+ * @param ring The audio ring to clean.
+ */
+void audio_ring_fini(audio_ring_t *ring)
+{
+	assert(ring);
+	free(ring->buffer);
+	ring->buffer = NULL;
+	ring->size = 0;
+}
+
+/**
+ * Copy data into the ring, producer side.
+ * @param ring The target ring.
+ * @param data Source audio buffer in ring's format.
+ * @param size Size of the @p data buffer.
+ * @return Number of bytes stored, always a multiple of frame size.
+ *
+ * Stores as much as fits, never blocks.
+ */
+size_t audio_ring_write(audio_ring_t *ring, const void *data, size_t size)
+{
+	assert(ring);
+	const size_t frame_size = pcm_format_frame_size(&ring->format);
+	const size_t head = ring->head;
+
+	size_t count = min(size, audio_ring_free(ring));
+	count -= count % frame_size;
+	/* Make sure the consumer is done with the space we overwrite */
+	memory_barrier();
+
+	const size_t pos = head % ring->size;
+	const size_t first = min(count, ring->size - pos);
+	memcpy(ring->buffer + pos, data, first);
+	memcpy(ring->buffer, data + first, count - first);
+
+	/* Publish the data before moving head */
+	write_barrier();
+	ring->head = (head + count) % (2 * ring->size);
+	return count;
+}
+
+/**
+ * Get mixing kernel for ring data.
+ * @param ring The audio ring.
+ * @param df Target data format.
+ * @return Mixing kernel, NULL for generic conversion.
+ */
+static pcm_mix_func_t audio_ring_mix_func(audio_ring_t *ring,
+    const pcm_format_t *df)
+{
+	if (!pcm_format_same(&ring->mix_dst_format, df)) {
+		ring->mix_dst_format = *df;
+		ring->mix_func = pcm_format_mix_func(&ring->format, df);
+	}
+	return ring->mix_func;
+}
+
+/**
+ * Consume data stored in the ring and mix it into the provided buffer.
+ * @param ring The ring that should provide data.
+ * @param data Target buffer.
+ * @param size Target buffer size.
+ * @param f Target data format.
+ * @return Size of the target buffer used.
+ */
+ssize_t audio_ring_mix_data(audio_ring_t *ring, void *data, size_t size,
+    const pcm_format_t *f)
+{
+	assert(ring);
+	const size_t src_frame_size = pcm_format_frame_size(&ring->format);
+	const size_t dst_frame_size = pcm_format_frame_size(f);
+	const size_t tail = ring->tail;
+	const size_t head = ring->head;
+	/* Do not read data older than the head we have seen */
+	read_barrier();
+
+	const size_t avail = (head + 2 * ring->size - tail) % (2 * ring->size);
+	const size_t frames = min(avail / src_frame_size,
+	    size / dst_frame_size);
+	const pcm_mix_func_t func = audio_ring_mix_func(ring, f);
+
+	const size_t pos = tail % ring->size;
+	const size_t first = min(frames, (ring->size - pos) / src_frame_size);
+	pcm_format_convert_and_mix_func(data, first * dst_frame_size,
+	    ring->buffer + pos, first * src_frame_size, &ring->format, f, func);
+	if (frames > first) {
+		pcm_format_convert_and_mix_func(
+		    data + first * dst_frame_size,
+		    (frames - first) * dst_frame_size, ring->buffer,
+		    (frames - first) * src_frame_size, &ring->format, f, func);
+	}
+
+	/* Finish reading before the space is handed back */
+	memory_barrier();
+	ring->tail = (tail + frames * src_frame_size) % (2 * ring->size);
+	return frames * dst_frame_size;
+}
+
 /**
  * @}
  */
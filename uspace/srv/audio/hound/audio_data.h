@@ -41,6 +41,7 @@
 #include <errno.h>
 #include <fibril_synch.h>
 #include <pcm/format.h>
+#include <stdint.h>
 
 /** Reference counted audio buffer */
 typedef struct {
@@ -64,8 +65,38 @@ typedef struct {
 	size_t frames;
 	/** List access synchronization */
 	fibril_mutex_t guard;
+	/** Source format the mixing kernel was selected for */
+	pcm_format_t mix_src_format;
+	/** Destination format the mixing kernel was selected for */
+	pcm_format_t mix_dst_format;
+	/** Selected mixing kernel, NULL for generic conversion */
+	pcm_mix_func_t mix_func;
 } audio_pipe_t;
 
+/** Single producer single consumer audio ring buffer.
+ *
+ * The buffer is allocated once and never resized. Head and tail are byte
+ * positions kept modulo twice the size so that a full ring can be told
+ * from an empty one. The producer only ever moves head and the consumer
+ * only ever moves tail, so no lock is needed between them.
+ */
+typedef struct {
+	/** Preallocated data storage */
+	uint8_t *buffer;
+	/** Size of the storage, a multiple of frame size */
+	size_t size;
+	/** Write position, only modified by the producer */
+	volatile size_t head;
+	/** Read position, only modified by the consumer */
+	volatile size_t tail;
+	/** Format of the audio data */
+	pcm_format_t format;
+	/** Destination format the mixing kernel was selected for */
+	pcm_format_t mix_dst_format;
+	/** Selected mixing kernel, NULL for generic conversion */
+	pcm_mix_func_t mix_func;
+} audio_ring_t;
+
 audio_data_t * audio_data_create(const void *data, size_t size,
     pcm_format_t format);
 void audio_data_addref(audio_data_t *adata);
@@ -80,6 +111,13 @@ audio_data_t *audio_pipe_pop(audio_pipe_t *pipe);
 ssize_t audio_pipe_mix_data(audio_pipe_t *pipe, void *buffer, size_t size,
     const pcm_format_t *f);
 
+int audio_ring_init(audio_ring_t *ring, size_t size, pcm_format_t format);
+void audio_ring_fini(audio_ring_t *ring);
+
+size_t audio_ring_write(audio_ring_t *ring, const void *data, size_t size);
+ssize_t audio_ring_mix_data(audio_ring_t *ring, void *buffer, size_t size,
+    const pcm_format_t *f);
+
 /**
  * Total bytes getter.
  * @param pipe The audio pipe.
@@ -123,7 +161,27 @@ static inline int audio_pipe_push_data(audio_pipe_t *pipe,
 	}
 	return ENOMEM;
 }
+/**
+ * Stored bytes getter.
+ * @param ring The audio ring.
+ * @return Number of bytes waiting to be consumed.
+ */
+static inline size_t audio_ring_bytes(audio_ring_t *ring)
+{
+	assert(ring);
+	return (ring->head + 2 * ring->size - ring->tail) % (2 * ring->size);
+}
 
+/**
+ * Free space getter.
+ * @param ring The audio ring.
+ * @return Number of bytes that can be written without overwriting data.
+ */
+static inline size_t audio_ring_free(audio_ring_t *ring)
+{
+	assert(ring);
+	return ring->size - audio_ring_bytes(ring);
+}
 
 #endif
 
@@ -39,6 +39,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <loc.h>
+#include <macros.h>
 #include <str.h>
 #include <str_error.h>
 #include <as.h>
@@ -47,14 +48,19 @@
 #include "audio_device.h"
 #include "log.h"
 
-/* hardwired to provide ~21ms per fragment */
+/* Default fragmentation, provides ~21ms per fragment */
 #define BUFFER_PARTS   16
 
+/** Requested fragment length in microseconds, 0 for default */
+static useconds_t period_usec = 0;
+/** Requested device buffer length in microseconds, 0 for largest possible */
+static useconds_t buffer_usec = 0;
+
 static int device_sink_connection_callback(audio_sink_t *sink, bool new);
 static int device_source_connection_callback(audio_source_t *source, bool new);
 static void device_event_callback(ipc_callid_t iid, ipc_call_t *icall, void *arg);
 static int device_check_format(audio_sink_t* sink);
-static int get_buffer(audio_device_t *dev);
+static int get_buffer(audio_device_t *dev, const pcm_format_t *f);
 static int release_buffer(audio_device_t *dev);
 static void advance_buffer(audio_device_t *dev, size_t size);
 static inline bool is_running(audio_device_t *dev)
@@ -64,6 +70,20 @@ static inline bool is_running(audio_device_t *dev)
 	return (bool)dev->buffer.base;
 }
 
+/**
+ * Set timing parameters used for newly started devices.
+ * @param period Fragment length in microseconds, 0 for default.
+ * @param buffer Device buffer length in microseconds, 0 for default.
+ *
+ * Playback runs two fragments ahead of the hardware, so the output
+ * latency is about twice the period.
+ */
+void audio_device_set_timing(useconds_t period, useconds_t buffer)
+{
+	period_usec = period;
+	buffer_usec = buffer;
+}
+
 /**
  * Initialize audio device structure.
  * @param dev The structure to initialize.
@@ -93,6 +113,9 @@ int audio_device_init(audio_device_t *dev, service_id_t id, const char *name)
 	dev->buffer.position = NULL;
 	dev->buffer.size = 0;
 	dev->buffer.fragment_size = 0;
+	dev->mix_time.sum = 0;
+	dev->mix_time.max = 0;
+	dev->mix_time.count = 0;
 
 	log_verbose("Initialized device (%p) '%s' with id %" PRIun ".",
 	    dev, dev->name, dev->id);
@@ -155,7 +178,7 @@ static int device_sink_connection_callback(audio_sink_t* sink, bool new)
 	if (new && list_count(&sink->connections) == 1) {
 		log_verbose("First connection on device sink '%s'", sink->name);
 
-		int ret = get_buffer(dev);
+		int ret = get_buffer(dev, &dev->sink.format);
 		if (ret != EOK) {
 			log_error("Failed to get device buffer: %s",
 			    str_error(ret));
@@ -177,6 +200,14 @@ static int device_sink_connection_callback(audio_sink_t* sink, bool new)
 		const unsigned frames = dev->buffer.fragment_size /
 		    pcm_format_frame_size(&dev->sink.format);
 		log_verbose("Fragment frame count %u", frames);
+		log_info("Device '%s' output latency %" PRIu32 "us, "
+		    "buffer %" PRIu32 "us", dev->name,
+		    pcm_format_size_to_usec(size, &dev->sink.format),
+		    pcm_format_size_to_usec(dev->buffer.size,
+		    &dev->sink.format));
+		dev->mix_time.sum = 0;
+		dev->mix_time.max = 0;
+		dev->mix_time.count = 0;
 		ret = audio_pcm_start_playback_fragment(dev->sess, frames,
 		    dev->sink.format.channels, dev->sink.format.sampling_rate,
 		    dev->sink.format.sample_format);
@@ -215,7 +246,7 @@ static int device_source_connection_callback(audio_source_t *source, bool new)
 	assert(source);
 	audio_device_t *dev = source->private_data;
 	if (new && list_count(&source->connections) == 1) {
-		int ret = get_buffer(dev);
+		int ret = get_buffer(dev, &dev->source.format);
 		if (ret != EOK) {
 			log_error("Failed to get device buffer: %s",
 			    str_error(ret));
@@ -277,8 +308,11 @@ static void device_event_callback(ipc_callid_t iid, ipc_call_t *icall, void *arg
 			advance_buffer(dev, dev->buffer.fragment_size);
 			struct timeval time2;
 			getuptime(&time2);
-			log_verbose("Time to mix sources: %li\n",
-			    tv_sub_diff(&time2, &time1));
+			const suseconds_t mix_time = tv_sub_diff(&time2, &time1);
+			dev->mix_time.sum += mix_time;
+			dev->mix_time.max = max(dev->mix_time.max, mix_time);
+			++dev->mix_time.count;
+			log_verbose("Time to mix sources: %li\n", mix_time);
 			break;
 		}
 		case PCM_EVENT_CAPTURE_TERMINATED: {
@@ -294,6 +328,11 @@ static void device_event_callback(ipc_callid_t iid, ipc_call_t *icall, void *arg
 		}
 		case PCM_EVENT_PLAYBACK_TERMINATED: {
 			log_verbose("Playback Terminated");
+			if (dev->mix_time.count)
+				log_info("Device '%s' mixing time avg: %"
+				    PRIu64 "us max: %ldus", dev->name,
+				    dev->mix_time.sum / dev->mix_time.count,
+				    dev->mix_time.max);
 			dev->sink.format = AUDIO_FORMAT_ANY;
 			const int ret = release_buffer(dev);
 			if (ret != EOK) {
@@ -340,9 +379,13 @@ static int device_check_format(audio_sink_t* sink)
 /**
  * Get access to device buffer.
  * @param dev Audio device.
+ * @param f Format the buffer will be used with.
  * @return Error code.
+ *
+ * Buffer and fragment sizes follow audio_device_set_timing() if the format
+ * is known, fragment boundaries are kept frame aligned.
  */
-static int get_buffer(audio_device_t *dev)
+static int get_buffer(audio_device_t *dev, const pcm_format_t *f)
 {
 	assert(dev);
 	if (!dev->sess) {
@@ -354,17 +397,39 @@ static int get_buffer(audio_device_t *dev)
 		return EBUSY;
 	}
 
-	/* Ask for largest buffer possible */
+	const bool timed = !pcm_format_is_any(f) && f->sampling_rate;
+
+	/* Ask for largest buffer possible unless configured otherwise */
 	size_t preferred_size = 0;
+	if (timed && buffer_usec)
+		preferred_size = pcm_format_usec_to_size(buffer_usec, f);
 
 	const int ret = audio_pcm_get_buffer(dev->sess, &dev->buffer.base,
 	    &preferred_size);
-	if (ret == EOK) {
-		dev->buffer.size = preferred_size;
-		dev->buffer.fragment_size = dev->buffer.size / BUFFER_PARTS;
-		dev->buffer.position = dev->buffer.base;
+	if (ret != EOK)
+		return ret;
+
+	dev->buffer.size = preferred_size;
+	dev->buffer.position = dev->buffer.base;
+
+	size_t parts = BUFFER_PARTS;
+	if (timed && period_usec) {
+		const size_t period_size =
+		    pcm_format_usec_to_size(period_usec, f);
+		parts = period_size ? dev->buffer.size / period_size : 0;
+		/* We run two fragments ahead and need one for the device */
+		parts = max(parts, 3);
 	}
-	return ret;
+	dev->buffer.fragment_size = dev->buffer.size / parts;
+	if (timed) {
+		dev->buffer.fragment_size -= dev->buffer.fragment_size %
+		    pcm_format_frame_size(f);
+	}
+	if (dev->buffer.size % dev->buffer.fragment_size)
+		log_warning("Device buffer is not a multiple of fragment size");
+	log_verbose("Device buffer %zu bytes, fragment %zu bytes",
+	    dev->buffer.size, dev->buffer.fragment_size);
+	return EOK;
 
 }
 
@@ -41,6 +41,8 @@
 #include <fibril_synch.h>
 #include <errno.h>
 #include <ipc/loc.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include <audio_pcm_iface.h>
 
 #include "audio_source.h"
@@ -63,6 +65,12 @@ typedef struct {
 		void *position;
 		size_t fragment_size;
 	} buffer;
+	/** Time spent mixing fragments, in microseconds */
+	struct {
+		uint64_t sum;
+		suseconds_t max;
+		size_t count;
+	} mix_time;
 	/** Capture device abstraction. */
 	audio_source_t source;
 	/** Playback device abstraction. */
@@ -75,6 +83,7 @@ static inline audio_device_t * audio_device_list_instance(link_t *l)
 	return l ? list_get_instance(l, audio_device_t, link) : NULL;
 };
 
+void audio_device_set_timing(useconds_t period, useconds_t buffer);
 int audio_device_init(audio_device_t *dev, service_id_t id, const char *name);
 void audio_device_fini(audio_device_t *dev);
 audio_source_t * audio_device_get_source(audio_device_t *dev);
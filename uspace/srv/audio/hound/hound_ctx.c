@@ -37,6 +37,7 @@
 #include <malloc.h>
 #include <macros.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <str_error.h>
 
 #include "hound_ctx.h"
@@ -44,6 +45,9 @@
 #include "connection.h"
 #include "log.h"
 
+/** Ring size of streams that did not ask for a specific buffer size */
+#define STREAM_BUFFER_DEFAULT  (64 * 1024)
+
 static int update_data(audio_source_t *source, size_t size);
 static int new_data(audio_sink_t *sink);
 
@@ -158,8 +162,8 @@ bool hound_ctx_is_record(hound_ctx_t *ctx)
 typedef struct hound_ctx_stream {
 	/** Hound context streams link */
 	link_t link;
-	/** Audio data pipe */
-	audio_pipe_t fifo;
+	/** Audio data ring, the client is the producer for playback streams */
+	audio_ring_t ring;
 	/** Parent context */
 	hound_ctx_t *ctx;
 	/** Stream data format */
@@ -168,12 +172,29 @@ typedef struct hound_ctx_stream {
 	int flags;
 	/** Maximum allowed buffer size */
 	size_t allowed_size;
-	/** Fifo access synchronization */
+	/** Wait synchronization, the ring itself needs no lock */
 	fibril_mutex_t guard;
 	/** buffer status change condition */
 	fibril_condvar_t change;
+	/** Sum of buffered data latencies seen by the mixer */
+	uint64_t latency_sum;
+	/** Number of latency samples */
+	size_t latency_count;
+	/** Maximum buffered data latency seen by the mixer */
+	useconds_t latency_max;
 } hound_ctx_stream_t;
 
+/**
+ * Wake up everyone waiting for ring status change.
+ * @param stream The stream whose ring changed.
+ */
+static inline void stream_notify(hound_ctx_stream_t *stream)
+{
+	fibril_mutex_lock(&stream->guard);
+	fibril_condvar_broadcast(&stream->change);
+	fibril_mutex_unlock(&stream->guard);
+}
+
 /**
  * New stream append helper.
  * @param ctx hound context.
@@ -203,22 +224,34 @@ static int stream_push_data(hound_ctx_stream_t *stream, audio_data_t *adata)
 	assert(stream);
 	assert(adata);
 
-	if (stream->allowed_size && adata->size > stream->allowed_size)
-		return EINVAL;
-
-	fibril_mutex_lock(&stream->guard);
-	if (stream->allowed_size &&
-	    (audio_pipe_bytes(&stream->fifo) + adata->size
-	        > stream->allowed_size)) {
-		fibril_mutex_unlock(&stream->guard);
-		return EOVERFLOW;
-
+	const void *data = adata->data;
+	size_t size = adata->size;
+	void *buffer = NULL;
+
+	/* The ring stores data in stream format, convert if necessary */
+	if (!pcm_format_same(&adata->format, &stream->format)) {
+		size = pcm_format_size_to_frames(adata->size, &adata->format) *
+		    pcm_format_frame_size(&stream->format);
+		buffer = malloc(size);
+		if (!buffer)
+			return ENOMEM;
+		pcm_format_silence(buffer, size, &stream->format);
+		pcm_format_convert_and_mix(buffer, size, adata->data,
+		    adata->size, &adata->format, &stream->format);
+		data = buffer;
 	}
 
-	const int ret = audio_pipe_push(&stream->fifo, adata);
-	fibril_mutex_unlock(&stream->guard);
+	int ret = EOK;
+	if (size > stream->ring.size)
+		ret = EINVAL;
+	else if (size > audio_ring_free(&stream->ring))
+		ret = EOVERFLOW;
+	else
+		audio_ring_write(&stream->ring, data, size);
+	free(buffer);
+
 	if (ret == EOK)
-		fibril_condvar_signal(&stream->change);
+		stream_notify(stream);
 	return ret;
 }
 
@@ -250,7 +283,14 @@ hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
 	assert(ctx);
 	hound_ctx_stream_t *stream = malloc(sizeof(hound_ctx_stream_t));
 	if (stream) {
-		audio_pipe_init(&stream->fifo);
+		const int ret = audio_ring_init(&stream->ring,
+		    buffer_size ? buffer_size : STREAM_BUFFER_DEFAULT, format);
+		if (ret != EOK) {
+			log_error("Failed to allocate stream buffer: %s",
+			    str_error(ret));
+			free(stream);
+			return NULL;
+		}
 		link_initialize(&stream->link);
 		fibril_mutex_initialize(&stream->guard);
 		fibril_condvar_initialize(&stream->change);
@@ -258,6 +298,9 @@ hound_ctx_stream_t *hound_ctx_create_stream(hound_ctx_t *ctx, int flags,
 		stream->flags = flags;
 		stream->format = format;
 		stream->allowed_size = buffer_size;
+		stream->latency_sum = 0;
+		stream->latency_count = 0;
+		stream->latency_max = 0;
 		stream_append(ctx, stream);
 		log_verbose("CTX: %p added stream; flags:%#x ch: %u r:%u f:%s",
 		    ctx, flags, format.channels, format.sampling_rate,
@@ -276,15 +319,20 @@ void hound_ctx_destroy_stream(hound_ctx_stream_t *stream)
 {
 	if (stream) {
 		stream_remove(stream->ctx, stream);
-		if (audio_pipe_bytes(&stream->fifo))
+		if (audio_ring_bytes(&stream->ring))
 			log_warning("Destroying stream with non empty buffer");
 		log_verbose("CTX: %p remove stream (%zu/%zu); "
 		    "flags:%#x ch: %u r:%u f:%s",
-		    stream->ctx, audio_pipe_bytes(&stream->fifo),
-		    stream->allowed_size, stream->flags,
+		    stream->ctx, audio_ring_bytes(&stream->ring),
+		    stream->ring.size, stream->flags,
 		    stream->format.channels, stream->format.sampling_rate,
 		    pcm_sample_format_str(stream->format.sample_format));
-		audio_pipe_fini(&stream->fifo);
+		if (stream->latency_count)
+			log_info("CTX: %p stream buffer latency avg: %"
+			    PRIu64 "us max: %" PRIu32 "us", stream->ctx,
+			    stream->latency_sum / stream->latency_count,
+			    stream->latency_max);
+		audio_ring_fini(&stream->ring);
 		free(stream);
 	}
 }
@@ -295,6 +343,9 @@ void hound_ctx_destroy_stream(hound_ctx_stream_t *stream)
  * @param data audio data buffer.
  * @param size size of the @p data buffer.
  * @return Error code.
+ *
+ * Data are copied to the stream's ring, blocks while the ring is full.
+ * The caller keeps ownership of the @p data buffer.
  */
 int hound_ctx_stream_write(hound_ctx_stream_t *stream, const void *data,
     size_t size)
@@ -304,19 +355,23 @@ int hound_ctx_stream_write(hound_ctx_stream_t *stream, const void *data,
 	if (stream->allowed_size && size > stream->allowed_size)
 		return EINVAL;
 
-	fibril_mutex_lock(&stream->guard);
-	while (stream->allowed_size &&
-	    (audio_pipe_bytes(&stream->fifo) + size > stream->allowed_size)) {
-	    fibril_condvar_wait(&stream->change, &stream->guard);
-
+	const size_t overflow = size % pcm_format_frame_size(&stream->format);
+	if (overflow) {
+		log_warning("Data not a multiple of frame size, clipping.");
+		size -= overflow;
 	}
 
-	const int ret =
-	    audio_pipe_push_data(&stream->fifo, data, size, stream->format);
+	fibril_mutex_lock(&stream->guard);
+	while (size > 0) {
+		const size_t written =
+		    audio_ring_write(&stream->ring, data, size);
+		data += written;
+		size -= written;
+		if (size > 0)
+			fibril_condvar_wait(&stream->change, &stream->guard);
+	}
 	fibril_mutex_unlock(&stream->guard);
-	if (ret == EOK)
-		fibril_condvar_signal(&stream->change);
-	return ret;
+	return EOK;
 }
 
 /**
@@ -330,21 +385,20 @@ int hound_ctx_stream_read(hound_ctx_stream_t *stream, void *data, size_t size)
 {
 	assert(stream);
 
-	if (stream->allowed_size && size > stream->allowed_size)
+	if (size > stream->ring.size)
 		return EINVAL;
 
 	fibril_mutex_lock(&stream->guard);
-	while (audio_pipe_bytes(&stream->fifo) < size) {
-	    fibril_condvar_wait(&stream->change, &stream->guard);
+	while (audio_ring_bytes(&stream->ring) < size) {
+		fibril_condvar_wait(&stream->change, &stream->guard);
 	}
+	fibril_mutex_unlock(&stream->guard);
 
 	pcm_format_silence(data, size, &stream->format);
-	const int ret =
-	    audio_pipe_mix_data(&stream->fifo, data, size, &stream->format);
-	fibril_mutex_unlock(&stream->guard);
-	if (ret == EOK)
-		fibril_condvar_signal(&stream->change);
-	return ret;
+	const ssize_t copied =
+	    audio_ring_mix_data(&stream->ring, data, size, &stream->format);
+	stream_notify(stream);
+	return copied == (ssize_t)size ? EOK : EIO;
 }
 
 /**
@@ -360,10 +414,16 @@ ssize_t hound_ctx_stream_add_self(hound_ctx_stream_t *stream, void *data,
     size_t size, const pcm_format_t *f)
 {
 	assert(stream);
-	fibril_mutex_lock(&stream->guard);
-	const int ret = audio_pipe_mix_data(&stream->fifo, data, size, f);
-	fibril_condvar_signal(&stream->change);
-	fibril_mutex_unlock(&stream->guard);
+
+	/* Buffered data is how long new samples wait to be mixed */
+	const useconds_t latency = pcm_format_size_to_usec(
+	    audio_ring_bytes(&stream->ring), &stream->format);
+	stream->latency_sum += latency;
+	stream->latency_max = max(stream->latency_max, latency);
+	++stream->latency_count;
+
+	const ssize_t ret = audio_ring_mix_data(&stream->ring, data, size, f);
+	stream_notify(stream);
 	return ret;
 }
 
@@ -376,7 +436,7 @@ void hound_ctx_stream_drain(hound_ctx_stream_t *stream)
 	assert(stream);
 	log_debug("Draining stream");
 	fibril_mutex_lock(&stream->guard);
-	while (audio_pipe_bytes(&stream->fifo))
+	while (audio_ring_bytes(&stream->ring))
 		fibril_condvar_wait(&stream->change, &stream->guard);
 	fibril_mutex_unlock(&stream->guard);
 }
@@ -39,11 +39,13 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <str.h>
 #include <str_error.h>
 #include <hound/server.h>
 #include <hound/protocol.h>
 #include <task.h>
 
+#include "audio_device.h"
 #include "hound.h"
 
 #define NAMESPACE "audio"
@@ -66,10 +68,35 @@ static void scan_for_devices(void)
 	hound_server_devices_iterate(device_callback);
 }
 
+static void print_syntax(void)
+{
+	printf("Syntax: %s [-p <period_us>] [-b <buffer_us>]\n", NAME);
+	printf("\t-p <period_us>\tLength of a mixing period in microseconds\n");
+	printf("\t-b <buffer_us>\tLength of device buffer in microseconds\n");
+}
+
 int main(int argc, char **argv)
 {
 	printf("%s: HelenOS sound service\n", NAME);
 
+	uint32_t period = 0;
+	uint32_t buffer = 0;
+	for (int i = 1; i < argc; ++i) {
+		uint32_t *target = NULL;
+		if (str_cmp(argv[i], "-p") == 0)
+			target = &period;
+		else if (str_cmp(argv[i], "-b") == 0)
+			target = &buffer;
+
+		if (!target || i + 1 >= argc ||
+		    str_uint32_t(argv[i + 1], NULL, 10, true, target) != EOK) {
+			print_syntax();
+			return 1;
+		}
+		++i;
+	}
+	audio_device_set_timing(period, buffer);
+
 	if (log_init(NAME) != EOK) {
 		printf(NAME ": Failed to initialize logging.\n");
 		return 1;
@@ -37,6 +37,7 @@
  */
 
 #include <stddef.h>
+#include <as.h>
 #include <bd_srv.h>
 #include <devman.h>
 #include <errno.h>
@@ -44,6 +45,7 @@
 #include <str.h>
 #include <loc.h>
 #include <macros.h>
+#include <mem.h>
 #include <task.h>
 
 #include <ahci_iface.h>
@@ -64,6 +66,7 @@ static int sata_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 static int sata_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 static int sata_bd_get_block_size(bd_srv_t *, size_t *);
 static int sata_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+static int sata_bd_get_queue_depth(bd_srv_t *, size_t *);
 
 static bd_ops_t sata_bd_ops = {
 	.open = sata_bd_open,
@@ -71,7 +74,8 @@ static bd_ops_t sata_bd_ops = {
 	.read_blocks = sata_bd_read_blocks,
 	.write_blocks = sata_bd_write_blocks,
 	.get_block_size = sata_bd_get_block_size,
-	.get_num_blocks = sata_bd_get_num_blocks
+	.get_num_blocks = sata_bd_get_num_blocks,
+	.get_queue_depth = sata_bd_get_queue_depth
 };
 
 static sata_bd_dev_t *bd_srv_sata(bd_srv_t *bd)
@@ -105,14 +109,20 @@ static int scan_device_tree(devman_handle_t funh)
 		
 		ahci_get_num_blocks(disk[disk_count].sess, &disk[disk_count].blocks);
 		
+		if (ahci_get_queue_depth(disk[disk_count].sess,
+		    &disk[disk_count].queue_depth) != EOK)
+			disk[disk_count].queue_depth = 1;
+		
 		bd_srvs_init(&disk[disk_count].bds);
 		disk[disk_count].bds.ops = &sata_bd_ops;
 		disk[disk_count].bds.sarg = &disk[disk_count];
 		
-		printf("Device %s - %s , blocks: %lu, block_size: %lu\n", 
+		printf("Device %s - %s , blocks: %lu, block_size: %lu, "
+		    "queue_depth: %zu\n",
 		    disk[disk_count].dev_name, disk[disk_count].sata_dev_name,
 			    (long unsigned int) disk[disk_count].blocks,
-				(long unsigned int) disk[disk_count].block_size);
+				(long unsigned int) disk[disk_count].block_size,
+				disk[disk_count].queue_depth);
 
 		++disk_count;
 	}
@@ -199,16 +209,46 @@ static int sata_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
+/** Create buffer to be shared with the AHCI driver.
+ *
+ * The whole address space area containing the buffer is shared with the
+ * driver, which transfers the data at the start of the area. Requests are
+ * served concurrently, so each of them gets an area of its own.
+ *
+ * @param size Size of the buffer
+ *
+ * @return Buffer or NULL if out of memory
+ */
+static void *sata_bd_buf_create(size_t size)
+{
+	void *buf = as_area_create(AS_AREA_ANY, size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, AS_AREA_UNPAGED);
+	if (buf == AS_MAP_FAILED)
+		return NULL;
+
+	return buf;
+}
+
 /** Read blocks from partition. */
 static int sata_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt, void *buf,
     size_t size)
 {
 	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+	size_t xfer_size = cnt * sbd->block_size;
 
-	if (size < cnt * sbd->block_size)
+	if (size < xfer_size)
 		return EINVAL;
 
-	return ahci_read_blocks(sbd->sess, ba, cnt, buf);
+	void *xfer_buf = sata_bd_buf_create(xfer_size);
+	if (xfer_buf == NULL)
+		return ENOMEM;
+
+	int rc = ahci_read_blocks(sbd->sess, ba, cnt, xfer_buf);
+	if (rc == EOK)
+		memcpy(buf, xfer_buf, xfer_size);
+
+	as_area_destroy(xfer_buf);
+	return rc;
 }
 
 /** Write blocks to partition. */
@@ -216,11 +256,20 @@ static int sata_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
 	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+	size_t xfer_size = cnt * sbd->block_size;
 
-	if (size < cnt * sbd->block_size)
+	if (size < xfer_size)
 		return EINVAL;
 
-	return ahci_write_blocks(sbd->sess, ba, cnt, (void *)buf);
+	void *xfer_buf = sata_bd_buf_create(xfer_size);
+	if (xfer_buf == NULL)
+		return ENOMEM;
+
+	memcpy(xfer_buf, buf, xfer_size);
+	int rc = ahci_write_blocks(sbd->sess, ba, cnt, xfer_buf);
+
+	as_area_destroy(xfer_buf);
+	return rc;
 }
 
 /** Get device block size. */
@@ -241,6 +290,15 @@ static int sata_bd_get_num_blocks(bd_srv_t *bd, aoff64_t *rnb)
 	return EOK;
 }
 
+/** Get number of requests the device serves concurrently. */
+static int sata_bd_get_queue_depth(bd_srv_t *bd, size_t *rdepth)
+{
+	sata_bd_dev_t *sbd = bd_srv_sata(bd);
+
+	*rdepth = sbd->queue_depth;
+	return EOK;
+}
+
 
 int main(int argc, char **argv)
 {
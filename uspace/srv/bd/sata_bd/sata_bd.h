@@ -57,6 +57,8 @@ typedef struct {
 	uint64_t blocks;
 	/** Size of block. */
 	size_t block_size;
+	/** Number of commands the device processes at once. */
+	size_t queue_depth;
 	/** Block device server structure */
 	bd_srvs_t bds;
 } sata_bd_dev_t;
@@ -41,6 +41,7 @@
 #include <adt/list.h>
 #include <adt/hash_table.h>
 #include <adt/hash.h>
+#include <fibril_synch.h>
 #include <malloc.h>
 #include <mem.h>
 #include <loc.h>
@@ -61,6 +62,9 @@
 
 #define NODE_CACHE_SIZE 200
 
+/** Number of blocks fetched from the device by a single request */
+#define CDFS_READAHEAD_BLOCKS  32
+
 /** All root nodes have index 0 */
 #define CDFS_SOME_ROOT  0
 
@@ -229,6 +233,11 @@ typedef struct {
 	service_id_t service_id;  /**< Service ID of block device */
 	cdfs_enc_t enc;		  /**< Filesystem string encoding */
 	char *vol_ident;	  /**< Volume identifier */
+	
+	fibril_mutex_t ra_lock;   /**< Read-ahead window lock */
+	uint8_t *ra_buf;          /**< Read-ahead window data */
+	cdfs_lba_t ra_lba;        /**< First block of the read-ahead window */
+	size_t ra_count;          /**< Number of valid blocks in the window */
 } cdfs_t;
 
 typedef struct {
@@ -243,6 +252,8 @@ typedef struct {
 	uint32_t size;            /**< File size if type is CDFS_FILE */
 	
 	list_t cs_list;           /**< Child's siblings list */
+	cdfs_dentry_t **dentries; /**< Children indexed by readdir position */
+	size_t dentries_cnt;      /**< Number of entries in dentries */
 	cdfs_lba_t lba;           /**< LBA of data on disk */
 	bool processed;           /**< If all children have been read */
 	unsigned int opened;      /**< Opened count */
@@ -315,6 +326,8 @@ static void nodes_remove_callback(ht_link_t *item)
 			list_remove(&dentry->link);
 			free(dentry);
 		}
+		
+		free(node->dentries);
 	}
 	
 	free(node->fs_node);
@@ -366,6 +379,8 @@ static void cdfs_node_initialize(cdfs_node_t *node)
 	node->lba = 0;
 	node->processed = false;
 	node->opened = 0;
+	node->dentries = NULL;
+	node->dentries_cnt = 0;
 	
 	list_initialize(&node->cs_list);
 }
@@ -565,6 +580,100 @@ static char *cdfs_decode_vol_ident(void *data, size_t dsize, cdfs_enc_t enc)
 	return ident;
 }
 
+/** Create child nodes for the directory entries in one directory block.
+ *
+ * @param fs      File system instance
+ * @param fs_node Directory node
+ * @param lba     Address of the directory block
+ * @param data    Contents of the directory block
+ *
+ * @return True on success, false on error.
+ *
+ */
+static bool cdfs_readdir_block(cdfs_t *fs, fs_node_t *fs_node, cdfs_lba_t lba,
+    uint8_t *data)
+{
+	cdfs_dir_t *dir;
+	
+	for (size_t offset = 0; offset < BLOCK_SIZE;
+	    offset += dir->length) {
+		dir = (cdfs_dir_t *) (data + offset);
+		if (dir->length == 0)
+			break;
+		if (offset + dir->length > BLOCK_SIZE) {
+			/* XXX Incorrect FS structure */
+			break;
+		}
+		
+		cdfs_dentry_type_t dentry_type;
+		if (dir->flags & DIR_FLAG_DIRECTORY)
+			dentry_type = CDFS_DIRECTORY;
+		else
+			dentry_type = CDFS_FILE;
+		
+		/* Skip special entries */
+		
+		if (dir->name_length == 1 &&
+		    dir->name[0] == CDFS_NAME_CURDIR)
+			continue;
+		if (dir->name_length == 1 &&
+		    dir->name[0] == CDFS_NAME_PARENTDIR)
+			continue;
+		
+		// FIXME: hack - indexing by dentry byte offset on disc
+		
+		fs_node_t *fn;
+		int rc = create_node(&fn, fs, dentry_type,
+		    lba * BLOCK_SIZE + offset);
+		if ((rc != EOK) || (fn == NULL))
+			return false;
+		
+		cdfs_node_t *cur = CDFS_NODE(fn);
+		cur->lba = uint32_lb(dir->lba);
+		cur->size = uint32_lb(dir->size);
+		
+		char *name = cdfs_decode_name(dir->name,
+		    dir->name_length, fs->enc, dentry_type);
+		if (name == NULL)
+			return false;
+		
+		// FIXME: check return value
+		
+		link_node(fs_node, fn, name);
+		free(name);
+		
+		if (dentry_type == CDFS_FILE)
+			cur->processed = true;
+	}
+	
+	return true;
+}
+
+/** Build the array mapping readdir positions to directory entries.
+ *
+ * If the array cannot be allocated, readdir falls back to walking
+ * the list of children.
+ *
+ * @param node Fully processed directory node
+ *
+ */
+static void cdfs_index_dentries(cdfs_node_t *node)
+{
+	size_t cnt = list_count(&node->cs_list);
+	if (cnt == 0)
+		return;
+	
+	node->dentries = malloc(cnt * sizeof(cdfs_dentry_t *));
+	if (node->dentries == NULL)
+		return;
+	
+	size_t i = 0;
+	list_foreach(node->cs_list, link, cdfs_dentry_t, dentry)
+		node->dentries[i++] = dentry;
+	
+	node->dentries_cnt = cnt;
+}
+
 static bool cdfs_readdir(cdfs_t *fs, fs_node_t *fs_node)
 {
 	cdfs_node_t *node = CDFS_NODE(fs_node);
@@ -577,68 +686,33 @@ static bool cdfs_readdir(cdfs_t *fs, fs_node_t *fs_node)
 	if ((node->size % BLOCK_SIZE) != 0)
 		blocks++;
 	
-	for (uint32_t i = 0; i < blocks; i++) {
-		block_t *block;
-		int rc = block_get(&block, fs->service_id, node->lba + i, BLOCK_FLAGS_NONE);
-		if (rc != EOK)
+	/* Read the directory extent in as few device requests as possible */
+	size_t chunk = min(blocks, CDFS_READAHEAD_BLOCKS);
+	uint8_t *buf = malloc(chunk * BLOCK_SIZE);
+	if (buf == NULL)
+		return false;
+	
+	for (uint32_t i = 0; i < blocks; i += chunk) {
+		size_t cnt = min(blocks - i, chunk);
+		int rc = block_read_range(fs->service_id, node->lba + i, cnt,
+		    buf);
+		if (rc != EOK) {
+			free(buf);
 			return false;
+		}
 		
-		cdfs_dir_t *dir;
-		
-		for (size_t offset = 0; offset < BLOCK_SIZE;
-		    offset += dir->length) {
-			dir = (cdfs_dir_t *) (block->data + offset);
-			if (dir->length == 0)
-				break;
-			if (offset + dir->length > BLOCK_SIZE) {
-				/* XXX Incorrect FS structure */
-				break;
-			}
-			
-			cdfs_dentry_type_t dentry_type;
-			if (dir->flags & DIR_FLAG_DIRECTORY)
-				dentry_type = CDFS_DIRECTORY;
-			else
-				dentry_type = CDFS_FILE;
-			
-			/* Skip special entries */
-			
-			if (dir->name_length == 1 &&
-			    dir->name[0] == CDFS_NAME_CURDIR)
-				continue;
-			if (dir->name_length == 1 &&
-			    dir->name[0] == CDFS_NAME_PARENTDIR)
-				continue;
-			
-			// FIXME: hack - indexing by dentry byte offset on disc
-			
-			fs_node_t *fn;
-			int rc = create_node(&fn, fs, dentry_type,
-			    (node->lba + i) * BLOCK_SIZE + offset);
-			if ((rc != EOK) || (fn == NULL))
+		for (size_t j = 0; j < cnt; j++) {
+			if (!cdfs_readdir_block(fs, fs_node, node->lba + i + j,
+			    buf + j * BLOCK_SIZE)) {
+				free(buf);
 				return false;
-			
-			cdfs_node_t *cur = CDFS_NODE(fn);
-			cur->lba = uint32_lb(dir->lba);
-			cur->size = uint32_lb(dir->size);
-			
-			char *name = cdfs_decode_name(dir->name,
-			    dir->name_length, node->fs->enc, dentry_type);
-			if (name == NULL)
-				return false;
-			
-			// FIXME: check return value
-			
-			link_node(fs_node, fn, name);
-			free(name);
-			
-			if (dentry_type == CDFS_FILE)
-				cur->processed = true;
+			}
 		}
-		
-		block_put(block);
 	}
 	
+	free(buf);
+	
+	cdfs_index_dentries(node);
 	node->processed = true;
 	return true;
 }
@@ -700,9 +774,8 @@ static int cdfs_match(fs_node_t **fn, fs_node_t *pfn, const char *component)
 	cdfs_node_t *parent = CDFS_NODE(pfn);
 	
 	if (!parent->processed) {
-		int rc = cdfs_readdir(parent->fs, pfn);
-		if (rc != EOK)
-			return rc;
+		if (!cdfs_readdir(parent->fs, pfn))
+			return EIO;
 	}
 	
 	list_foreach(parent->cs_list, link, cdfs_dentry_t, dentry) {
@@ -1059,6 +1132,14 @@ static cdfs_t *cdfs_fs_create(service_id_t sid, cdfs_lba_t altroot)
 	
 	fs->service_id = sid;
 	
+	/*
+	 * The read-ahead window is optional, file reads go through
+	 * the block cache one block at a time without it.
+	 */
+	fibril_mutex_initialize(&fs->ra_lock);
+	fs->ra_buf = malloc(CDFS_READAHEAD_BLOCKS * BLOCK_SIZE);
+	fs->ra_count = 0;
+	
 	/* Create root node */
 	int rc = create_node(&rfn, fs, L_DIRECTORY, cdfs_index++);
 	
@@ -1078,6 +1159,8 @@ static cdfs_t *cdfs_fs_create(service_id_t sid, cdfs_lba_t altroot)
 	return fs;
 error:
 	// XXX destroy node
+	if (fs != NULL)
+		free(fs->ra_buf);
 	free(fs);
 	return NULL;
 }
@@ -1220,6 +1303,7 @@ static void cdfs_fs_destroy(cdfs_t *fs)
 	block_cache_fini(fs->service_id);
 	block_fini(fs->service_id);
 	free(fs->vol_ident);
+	free(fs->ra_buf);
 	free(fs);
 }
 
@@ -1245,6 +1329,60 @@ static int cdfs_unmounted(service_id_t service_id)
 	return EOK;
 }
 
+/** Read file data through the read-ahead window.
+ *
+ * When the requested block is not in the window, the window is refilled
+ * with up to CDFS_READAHEAD_BLOCKS consecutive blocks of the file extent
+ * starting at the requested block. The reply is not limited to a single
+ * block, so sequential reads are served in large chunks.
+ *
+ * @param node   File node
+ * @param pos    Position in the file, must be less than the file size
+ * @param len    Maximum number of bytes to read
+ * @param callid Call to answer
+ * @param rbytes Place to store the number of bytes read
+ *
+ * @return EOK on success or a negative error code.
+ *
+ */
+static int cdfs_read_ahead(cdfs_node_t *node, aoff64_t pos, size_t len,
+    ipc_callid_t callid, size_t *rbytes)
+{
+	cdfs_t *fs = node->fs;
+	cdfs_lba_t lba = node->lba + pos / BLOCK_SIZE;
+	size_t offset = pos % BLOCK_SIZE;
+	
+	fibril_mutex_lock(&fs->ra_lock);
+	
+	if ((fs->ra_count == 0) || (lba < fs->ra_lba) ||
+	    (lba >= fs->ra_lba + fs->ra_count)) {
+		uint32_t blocks = node->size / BLOCK_SIZE;
+		if ((node->size % BLOCK_SIZE) != 0)
+			blocks++;
+		
+		size_t cnt = min(blocks - pos / BLOCK_SIZE,
+		    CDFS_READAHEAD_BLOCKS);
+		int rc = block_read_range(fs->service_id, lba, cnt, fs->ra_buf);
+		if (rc != EOK) {
+			fs->ra_count = 0;
+			fibril_mutex_unlock(&fs->ra_lock);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+		
+		fs->ra_lba = lba;
+		fs->ra_count = cnt;
+	}
+	
+	size_t boff = (lba - fs->ra_lba) * BLOCK_SIZE + offset;
+	*rbytes = min(len, fs->ra_count * BLOCK_SIZE - boff);
+	*rbytes = min(*rbytes, node->size - pos);
+	
+	async_data_read_finalize(callid, fs->ra_buf + boff, *rbytes);
+	fibril_mutex_unlock(&fs->ra_lock);
+	return EOK;
+}
+
 static int cdfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *rbytes)
 {
@@ -1261,9 +1399,8 @@ static int cdfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	    hash_table_get_inst(link, cdfs_node_t, nh_link);
 	
 	if (!node->processed) {
-		int rc = cdfs_readdir(node->fs, FS_NODE(node));
-		if (rc != EOK)
-			return rc;
+		if (!cdfs_readdir(node->fs, FS_NODE(node)))
+			return EIO;
 	}
 	
 	ipc_callid_t callid;
@@ -1277,6 +1414,10 @@ static int cdfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		if (pos >= node->size) {
 			*rbytes = 0;
 			async_data_read_finalize(callid, NULL, 0);
+		} else if (node->fs->ra_buf != NULL) {
+			int rc = cdfs_read_ahead(node, pos, len, callid, rbytes);
+			if (rc != EOK)
+				return rc;
 		} else {
 			cdfs_lba_t lba = pos / BLOCK_SIZE;
 			size_t offset = pos % BLOCK_SIZE;
@@ -1299,15 +1440,24 @@ static int cdfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 				return rc;
 		}
 	} else {
-		link_t *link = list_nth(&node->cs_list, pos);
-		if (link == NULL) {
-			async_answer_0(callid, ENOENT);
-			return ENOENT;
+		cdfs_dentry_t *dentry;
+		if (node->dentries != NULL) {
+			if (pos >= node->dentries_cnt) {
+				async_answer_0(callid, ENOENT);
+				return ENOENT;
+			}
+			
+			dentry = node->dentries[pos];
+		} else {
+			link_t *link = list_nth(&node->cs_list, pos);
+			if (link == NULL) {
+				async_answer_0(callid, ENOENT);
+				return ENOENT;
+			}
+			
+			dentry = list_get_instance(link, cdfs_dentry_t, link);
 		}
 		
-		cdfs_dentry_t *dentry =
-		    list_get_instance(link, cdfs_dentry_t, link);
-		
 		*rbytes = 1;
 		async_data_read_finalize(callid, dentry->name,
 		    str_size(dentry->name) + 1);
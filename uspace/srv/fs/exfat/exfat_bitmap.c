@@ -43,87 +43,227 @@
 #include <byteorder.h>
 #include <align.h>
 #include <assert.h>
+#include <adt/list.h>
 #include <fibril_synch.h>
+#include <macros.h>
+#include <malloc.h>
 #include <mem.h>
 
+/** Cached number of free clusters of one file system instance. */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+	uint64_t free;
+} exfat_bitmap_count_t;
 
-int exfat_bitmap_is_free(exfat_bs_t *bs, service_id_t service_id, 
-    exfat_cluster_t clst)
+/** Mutex protecting the list of free cluster counts. */
+static FIBRIL_MUTEX_INITIALIZE(exfat_bitmap_count_lock);
+
+/** List of cached free cluster counts. */
+static LIST_INITIALIZE(exfat_bitmap_counts);
+
+static exfat_bitmap_count_t *exfat_bitmap_count_find(service_id_t service_id)
+{
+	list_foreach(exfat_bitmap_counts, link, exfat_bitmap_count_t, cnt) {
+		if (cnt->service_id == service_id)
+			return cnt;
+	}
+
+	return NULL;
+}
+
+/** Adjust the cached free cluster count, if there is one. */
+static void exfat_bitmap_count_update(service_id_t service_id, int64_t delta)
+{
+	fibril_mutex_lock(&exfat_bitmap_count_lock);
+	exfat_bitmap_count_t *cnt = exfat_bitmap_count_find(service_id);
+	if (cnt)
+		cnt->free += delta;
+	fibril_mutex_unlock(&exfat_bitmap_count_lock);
+}
+
+/** Find the first cluster in the given allocation state.
+ *
+ * The bitmap is scanned one 32-bit word at a time.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param clst		Cluster to start the search at.
+ * @param limit		Cluster at which to stop the search.
+ * @param alloc		Look for an allocated cluster rather than a free one.
+ * @param found		Output parameter for the cluster found or @a limit
+ *			if there is none.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int exfat_bitmap_find(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t clst, exfat_cluster_t limit, bool alloc,
+    exfat_cluster_t *found)
 {
 	fs_node_t *fn;
-	block_t *b = NULL;
+	block_t *b;
 	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	uint32_t bits_per_block = BPS(bs) * 8;
 	int rc;
-	bool alloc;
 
-	clst -= EXFAT_CLST_FIRST;
-	
+	limit = min(limit, DATA_CNT(bs) + EXFAT_CLST_FIRST);
+	if (clst >= limit) {
+		*found = limit;
+		return EOK;
+	}
+
 	rc = exfat_bitmap_get(&fn, service_id);
 	if (rc != EOK)
 		return rc;
 	bitmapp = EXFAT_NODE(fn);
-	
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
-	}
-	bitmap = (uint8_t *)b->data;
-	alloc = bitmap[offset % BPS(bs)] & (1 << (clst % 8));
 
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	uint32_t i = clst - EXFAT_CLST_FIRST;
+	uint32_t end = limit - EXFAT_CLST_FIRST;
+
+	while (i < end) {
+		rc = exfat_block_get(&b, bs, bitmapp, i / bits_per_block,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			return rc;
+		}
+
+		uint32_t *words = (uint32_t *) b->data;
+		uint32_t block_end = min(ALIGN_DOWN(i, bits_per_block) +
+		    bits_per_block, end);
+
+		while (i < block_end) {
+			uint32_t word = uint32_t_le2host(
+			    words[(i % bits_per_block) / 32]);
+			if (!alloc)
+				word = ~word;
+			word &= ~0U << (i % 32);
+
+			if (word != 0) {
+				i = ALIGN_DOWN(i, 32) + __builtin_ctz(word);
+				break;
+			}
+
+			i = ALIGN_DOWN(i, 32) + 32;
+		}
+
+		rc = block_put(b);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			return rc;
+		}
+
+		if (i < block_end)
+			break;
 	}
-	rc = exfat_node_put(fn);
-	if (rc != EOK)
-		return rc;
 
-	if (alloc)
-		return ENOENT;
+	*found = min(i, end) + EXFAT_CLST_FIRST;
+	return exfat_node_put(fn);
+}
 
-	return EOK;
+/** Set or clear bits in the bitmap until the end of the range or an error.
+ *
+ * Each bitmap block is fetched only once for the whole range.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param bitmapp	Bitmap node.
+ * @param pos		Relative index of the first bit to change. Updated
+ *			to the index of the first bit not processed.
+ * @param end		Relative index of the bit past the range.
+ * @param alloc		Mark the clusters allocated rather than free.
+ * @param changed	Incremented by the number of bits actually changed.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int exfat_bitmap_flip(exfat_bs_t *bs, exfat_node_t *bitmapp,
+    uint32_t *pos, uint32_t end, bool alloc, int64_t *changed)
+{
+	block_t *b;
+	uint32_t bits_per_block = BPS(bs) * 8;
+	uint32_t i = *pos;
+	int rc = EOK;
+
+	while (i < end) {
+		rc = exfat_block_get(&b, bs, bitmapp, i / bits_per_block,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			break;
+
+		uint8_t *bitmap = (uint8_t *) b->data;
+		uint32_t block_end = min(ALIGN_DOWN(i, bits_per_block) +
+		    bits_per_block, end);
+
+		for (; i < block_end; i++) {
+			uint8_t *byte = &bitmap[(i % bits_per_block) / 8];
+			uint8_t mask = 1 << (i % 8);
+
+			if (((*byte & mask) != 0) == alloc)
+				continue;
+
+			*byte ^= mask;
+			(*changed)++;
+		}
+
+		b->dirty = true;
+		rc = block_put(b);
+		if (rc != EOK)
+			break;
+	}
+
+	*pos = i;
+	return rc;
 }
 
-int exfat_bitmap_set_cluster(exfat_bs_t *bs, service_id_t service_id, 
-    exfat_cluster_t clst)
+/** Set or clear a range of bits in the bitmap.
+ *
+ * If marking the clusters allocated fails, the clusters marked so far are
+ * freed again so that they do not leak.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param firstc	First cluster of the range.
+ * @param count		Number of clusters in the range.
+ * @param alloc		Mark the clusters allocated rather than free.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int exfat_bitmap_change(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t firstc, exfat_cluster_t count, bool alloc)
 {
 	fs_node_t *fn;
-	block_t *b = NULL;
 	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	int64_t changed = 0;
 	int rc;
 
-	clst -= EXFAT_CLST_FIRST;
-	
 	rc = exfat_bitmap_get(&fn, service_id);
 	if (rc != EOK)
 		return rc;
 	bitmapp = EXFAT_NODE(fn);
-	
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+
+	uint32_t start = firstc - EXFAT_CLST_FIRST;
+	uint32_t i = start;
+
+	rc = exfat_bitmap_flip(bs, bitmapp, &i, start + count, alloc, &changed);
+	if (rc != EOK && alloc && i > start) {
+		int64_t cleared = 0;
+		uint32_t j = start;
+
+		(void) exfat_bitmap_flip(bs, bitmapp, &j, i, false, &cleared);
+		changed -= cleared;
 	}
-	bitmap = (uint8_t *)b->data;
-	bitmap[offset % BPS(bs)] |= (1 << (clst % 8));
 
-	b->dirty = true;
-	rc = block_put(b);
+	if (changed > 0)
+		exfat_bitmap_count_update(service_id, alloc ? -changed : changed);
+
 	if (rc != EOK) {
 		(void) exfat_node_put(fn);
 		return rc;
 	}
-	
+
 	return exfat_node_put(fn);
 }
 
-int exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id, 
+int exfat_bitmap_is_free(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t clst)
 {
 	fs_node_t *fn;
@@ -131,6 +271,7 @@ int exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id,
 	exfat_node_t *bitmapp;
 	uint8_t *bitmap;
 	int rc;
+	bool alloc;
 
 	clst -= EXFAT_CLST_FIRST;
 	
@@ -140,77 +281,90 @@ int exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id,
 	bitmapp = EXFAT_NODE(fn);
 	
 	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs),
-	    BLOCK_FLAGS_NONE);
+	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
 	if (rc != EOK) {
 		(void) exfat_node_put(fn);
 		return rc;
 	}
 	bitmap = (uint8_t *)b->data;
-	bitmap[offset % BPS(bs)] &= ~(1 << (clst % 8));
+	alloc = bitmap[offset % BPS(bs)] & (1 << (clst % 8));
 
-	b->dirty = true;
 	rc = block_put(b);
 	if (rc != EOK) {
 		(void) exfat_node_put(fn);
 		return rc;
 	}
-	
-	return exfat_node_put(fn);
+	rc = exfat_node_put(fn);
+	if (rc != EOK)
+		return rc;
+
+	if (alloc)
+		return ENOENT;
+
+	return EOK;
+}
+
+int exfat_bitmap_set_cluster(exfat_bs_t *bs, service_id_t service_id, 
+    exfat_cluster_t clst)
+{
+	return exfat_bitmap_change(bs, service_id, clst, 1, true);
+}
+
+int exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id, 
+    exfat_cluster_t clst)
+{
+	return exfat_bitmap_change(bs, service_id, clst, 1, false);
 }
 
 int exfat_bitmap_set_clusters(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t firstc, exfat_cluster_t count)
 {
-	int rc;
-	exfat_cluster_t clst;
-	clst = firstc;
-
-	while (clst < firstc + count ) {
-		rc = exfat_bitmap_set_cluster(bs, service_id, clst);
-		if (rc != EOK) {
-			if (clst - firstc > 0)
-				(void) exfat_bitmap_clear_clusters(bs, service_id,
-				    firstc, clst - firstc);
-			return rc;
-		}
-		clst++;
-	}
-	return EOK;
+	return exfat_bitmap_change(bs, service_id, firstc, count, true);
 }
 
 int exfat_bitmap_clear_clusters(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t firstc, exfat_cluster_t count)
 {
-	int rc;
-	exfat_cluster_t clst;
-	clst = firstc;
+	return exfat_bitmap_change(bs, service_id, firstc, count, false);
+}
 
-	while (clst < firstc + count) {
-		rc = exfat_bitmap_clear_cluster(bs, service_id, clst);
-		if (rc != EOK)
-			return rc;
-		clst++;
-	}
-	return EOK;
+int exfat_bitmap_find_free(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t clst, exfat_cluster_t *found)
+{
+	return exfat_bitmap_find(bs, service_id, clst,
+	    DATA_CNT(bs) + EXFAT_CLST_FIRST, false, found);
 }
 
 int exfat_bitmap_alloc_clusters(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t *firstc, exfat_cluster_t count)
 {
 	exfat_cluster_t startc, endc;
+	exfat_cluster_t limit = DATA_CNT(bs) + EXFAT_CLST_FIRST;
+	int rc;
+
 	startc = EXFAT_CLST_FIRST;
 
-	while (startc < DATA_CNT(bs) + 2) {
-		endc = startc;
-		while (exfat_bitmap_is_free(bs, service_id, endc) == EOK) {
-			if ((endc - startc) + 1 == count) {
-				*firstc = startc;
-				return exfat_bitmap_set_clusters(bs, service_id, startc, count);
-			} else
-				endc++;
+	while (startc < limit) {
+		/* Skip to the next free cluster and measure the free run */
+		rc = exfat_bitmap_find(bs, service_id, startc, limit, false,
+		    &startc);
+		if (rc != EOK)
+			return rc;
+		if (startc >= limit)
+			break;
+
+		rc = exfat_bitmap_find(bs, service_id, startc, startc + count,
+		    true, &endc);
+		if (rc != EOK)
+			return rc;
+
+		if (endc - startc == count) {
+			*firstc = startc;
+			return exfat_bitmap_set_clusters(bs, service_id, startc,
+			    count);
 		}
-		startc = endc+1;
+
+		startc = endc;
 	}
 	return ENOSPC;
 }
@@ -224,15 +378,18 @@ int exfat_bitmap_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep,
 		    &nodep->firstc, count);
 	} else {
 		exfat_cluster_t lastc, clst;
+		int rc;
+
 		lastc = nodep->firstc + ROUND_UP(nodep->size, BPC(bs)) / BPC(bs) - 1;
 
-		clst = lastc + 1;
-		while (exfat_bitmap_is_free(bs, nodep->idx->service_id, clst) == EOK) {
-			if (clst - lastc == count){
-				return exfat_bitmap_set_clusters(bs, nodep->idx->service_id, 
-				    lastc + 1, count);
-			} else
-				clst++;
+		rc = exfat_bitmap_find(bs, nodep->idx->service_id, lastc + 1,
+		    lastc + 1 + count, true, &clst);
+		if (rc != EOK)
+			return rc;
+
+		if (clst - lastc - 1 == count) {
+			return exfat_bitmap_set_clusters(bs, nodep->idx->service_id, 
+			    lastc + 1, count);
 		}
 		return ENOSPC;
 	}
@@ -266,7 +423,97 @@ int exfat_bitmap_replicate_clusters(exfat_bs_t *bs, exfat_node_t *nodep)
 	return exfat_set_cluster(bs, service_id, lastc, EXFAT_CLST_EOF);
 }
 
+/** Get the number of free clusters.
+ *
+ * The bitmap is counted only on the first call, afterwards the count is
+ * maintained as clusters are allocated and freed.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param count		Output parameter for the number of free clusters.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int exfat_bitmap_free_count(exfat_bs_t *bs, service_id_t service_id,
+    uint64_t *count)
+{
+	fs_node_t *fn;
+	block_t *b;
+	exfat_node_t *bitmapp;
+	exfat_bitmap_count_t *cnt;
+	uint32_t bits_per_block = BPS(bs) * 8;
+	uint32_t clusters = DATA_CNT(bs);
+	uint64_t free_count = 0;
+	int rc;
+
+	fibril_mutex_lock(&exfat_bitmap_count_lock);
+	cnt = exfat_bitmap_count_find(service_id);
+	if (cnt) {
+		*count = cnt->free;
+		fibril_mutex_unlock(&exfat_bitmap_count_lock);
+		return EOK;
+	}
+
+	rc = exfat_bitmap_get(&fn, service_id);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&exfat_bitmap_count_lock);
+		return rc;
+	}
+	bitmapp = EXFAT_NODE(fn);
+
+	for (uint32_t i = 0; i < clusters; i += bits_per_block) {
+		rc = exfat_block_get(&b, bs, bitmapp, i / bits_per_block,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			break;
+
+		uint32_t *words = (uint32_t *) b->data;
+		uint32_t nbits = min(bits_per_block, clusters - i);
+
+		for (uint32_t j = 0; j < nbits; j += 32) {
+			uint32_t word = ~uint32_t_le2host(words[j / 32]);
+			if (nbits - j < 32)
+				word &= (1U << (nbits - j)) - 1;
+			free_count += __builtin_popcount(word);
+		}
+
+		rc = block_put(b);
+		if (rc != EOK)
+			break;
+	}
+
+	(void) exfat_node_put(fn);
+
+	if (rc == EOK) {
+		cnt = malloc(sizeof(exfat_bitmap_count_t));
+		if (cnt) {
+			link_initialize(&cnt->link);
+			cnt->service_id = service_id;
+			cnt->free = free_count;
+			list_append(&cnt->link, &exfat_bitmap_counts);
+		}
+
+		*count = free_count;
+	}
+
+	fibril_mutex_unlock(&exfat_bitmap_count_lock);
+	return rc;
+}
+
+/** Drop the cached free cluster count of a file system instance.
+ *
+ * @param service_id	Service ID of the file system.
+ */
+void exfat_bitmap_fini(service_id_t service_id)
+{
+	fibril_mutex_lock(&exfat_bitmap_count_lock);
+	exfat_bitmap_count_t *cnt = exfat_bitmap_count_find(service_id);
+	if (cnt)
+		list_remove(&cnt->link);
+	fibril_mutex_unlock(&exfat_bitmap_count_lock);
 
+	free(cnt);
+}
 
 /**
  * @}
@@ -58,6 +58,12 @@ extern int exfat_bitmap_set_clusters(struct exfat_bs *, service_id_t,
     exfat_cluster_t, exfat_cluster_t);
 extern int exfat_bitmap_clear_clusters(struct exfat_bs *, service_id_t, 
     exfat_cluster_t, exfat_cluster_t);
+extern int exfat_bitmap_find_free(struct exfat_bs *, service_id_t,
+    exfat_cluster_t, exfat_cluster_t *);
+
+extern int exfat_bitmap_free_count(struct exfat_bs *, service_id_t,
+    uint64_t *);
+extern void exfat_bitmap_fini(service_id_t);
 
 
 #endif
@@ -934,61 +934,10 @@ int exfat_total_block_count(service_id_t service_id, uint64_t *count)
 
 int exfat_free_block_count(service_id_t service_id, uint64_t *count)
 {
-	fs_node_t *node = NULL;
-	exfat_node_t *bmap_node;
 	exfat_bs_t *bs;
-	uint64_t free_block_count = 0;
-	uint64_t block_count;
-	unsigned sector;
-	int rc;
-
-	rc = exfat_total_block_count(service_id, &block_count);
-	if (rc != EOK)
-		goto exit;
 
 	bs = block_bb_get(service_id);
-	rc = exfat_bitmap_get(&node, service_id);
-	if (rc != EOK)
-		goto exit;
-
-	bmap_node = (exfat_node_t *) node->data;
-
-	unsigned const bmap_sectors = ROUND_UP(bmap_node->size, BPS(bs)) /
-	    BPS(bs);
-
-	for (sector = 0; sector < bmap_sectors; ++sector) {
-
-		block_t *block;
-		uint8_t *bitmap;
-		unsigned bit;
-
-		rc = exfat_block_get(&block, bs, bmap_node, sector,
-		    BLOCK_FLAGS_NONE);
-		if (rc != EOK) {
-			free_block_count = 0;
-			goto exit;
-		}
-
-		bitmap = (uint8_t *) block->data;
-
-		for (bit = 0; bit < BPS(bs) * 8 && block_count > 0;
-		    ++bit, --block_count) {
-			if (!(bitmap[bit / 8] & (1 << (bit % 8))))
-				++free_block_count;
-		}
-
-		block_put(block);
-
-		if (block_count == 0) {
-			/* Reached the end of the bitmap */
-			goto exit;
-		}
-	}
-
-exit:
-	exfat_node_put(node);
-	*count = free_block_count;
-	return rc;
+	return exfat_bitmap_free_count(bs, service_id, count);
 }
 
 /** libfs operations */
@@ -1224,6 +1173,7 @@ static void exfat_fs_close(service_id_t service_id, fs_node_t *rfn)
 	 */
 	(void) exfat_node_fini_by_service_id(service_id);
 	exfat_idx_fini_by_service_id(service_id);
+	exfat_bitmap_fini(service_id);
 	(void) block_cache_fini(service_id);
 	block_fini(service_id);
 }
@@ -1623,6 +1573,9 @@ vfs_out_ops_t exfat_ops = {
 	.close = exfat_close,
 	.destroy = exfat_destroy,
 	.sync = exfat_sync,
+	/* The allocation bitmap is searched and updated without a lock */
+	.concurrent = LIBFS_CONCURRENT_READ | LIBFS_CONCURRENT_LOOKUP |
+	    LIBFS_CONCURRENT_STAT,
 };
 
 /**
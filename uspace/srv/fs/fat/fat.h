@@ -240,6 +240,19 @@ typedef struct fat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Map of the contiguous runs in the node's cluster chain. It covers
+	 * the first extents_clusters logical clusters of the node, is sorted
+	 * by logical cluster number and is extended lazily as the chain is
+	 * walked. Reads of the node may run concurrently, so the map and the
+	 * "current" cluster cache are protected by extents_lock.
+	 */
+	fibril_mutex_t	extents_lock;
+	fat_extent_t	*extents;
+	size_t		extents_count;
+	size_t		extents_size;
+	uint32_t	extents_clusters;
 } fat_node_t;
 
 typedef struct {
@@ -55,10 +55,39 @@
 /**
  * The fat_alloc_lock mutex protects all copies of the File Allocation Table
  * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
+ * deallocation of clusters, except for updating the free cluster map.
  */
 static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
 
+/** Number of clusters summarized by one free count of the free map. */
+#define FAT_FREE_REGION_CLUSTERS	4096
+
+/** In-memory summary of free clusters of one file system instance.
+ *
+ * The map mirrors FAT1: bit i is set iff cluster FAT_CLST_FIRST + i is free.
+ * It is built when the file system is mounted and afterwards kept up to
+ * date by cluster allocation and deallocation, so neither of them nor the
+ * free block count needs to read the FAT to find free clusters. The map is
+ * protected by fat_alloc_lock.
+ */
+typedef struct {
+	link_t link;
+	service_id_t service_id;
+	/** Free cluster bitmap. */
+	uint32_t *bits;
+	/** Number of free clusters in each region. */
+	uint32_t *region_free;
+	/** Number of data clusters covered by the map. */
+	uint32_t clusters;
+	/** Total number of free clusters. */
+	uint32_t free;
+	/** Where to start looking for the next contiguous run. */
+	uint32_t hint;
+} fat_free_map_t;
+
+/** List of free maps of mounted file systems, protected by fat_alloc_lock. */
+static LIST_INITIALIZE(fat_free_maps);
+
 /** Walk the cluster chain.
  *
  * @param bs		Buffer holding the boot sector for the file.
@@ -112,6 +141,181 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Remember the next cluster of the node's cluster chain in its extent map.
+ *
+ * @param nodep		FAT node.
+ * @param clst		Physical cluster following the last mapped cluster.
+ *
+ * @return		EOK on success, ENOMEM if the map cannot grow.
+ */
+static int fat_extent_add(fat_node_t *nodep, fat_cluster_t clst)
+{
+	fat_extent_t *ext;
+
+	if (nodep->extents_count > 0) {
+		ext = &nodep->extents[nodep->extents_count - 1];
+		if (ext->pcl + ext->count == clst) {
+			/* The cluster extends the last run. */
+			ext->count++;
+			nodep->extents_clusters++;
+			return EOK;
+		}
+	}
+
+	if (nodep->extents_count == nodep->extents_size) {
+		size_t nsize;
+
+		if (nodep->extents_size >= FAT_EXTENTS_MAX)
+			return ENOMEM;
+		nsize = nodep->extents_size ? 2 * nodep->extents_size : 4;
+		if (nsize > FAT_EXTENTS_MAX)
+			nsize = FAT_EXTENTS_MAX;
+		ext = realloc(nodep->extents, nsize * sizeof(fat_extent_t));
+		if (!ext)
+			return ENOMEM;
+		nodep->extents = ext;
+		nodep->extents_size = nsize;
+	}
+
+	ext = &nodep->extents[nodep->extents_count++];
+	ext->lcl = nodep->extents_clusters;
+	ext->pcl = clst;
+	ext->count = 1;
+	nodep->extents_clusters++;
+
+	return EOK;
+}
+
+/** Cut the node's extent map after the given physical cluster.
+ *
+ * @param nodep		FAT node.
+ * @param lcl		Last cluster which remains in the node or
+ *			FAT_CLST_RES0 if no clusters remain.
+ */
+static void fat_extents_chop(fat_node_t *nodep, fat_cluster_t lcl)
+{
+	size_t i;
+
+	fibril_mutex_lock(&nodep->extents_lock);
+
+	if (lcl == FAT_CLST_RES0) {
+		nodep->extents_count = 0;
+		nodep->extents_clusters = 0;
+		fibril_mutex_unlock(&nodep->extents_lock);
+		return;
+	}
+
+	/*
+	 * If lcl is not mapped, it lies past the mapped part of the chain
+	 * and the map stays valid.
+	 */
+	for (i = 0; i < nodep->extents_count; i++) {
+		fat_extent_t *ext = &nodep->extents[i];
+
+		if (lcl >= ext->pcl && lcl < ext->pcl + ext->count) {
+			ext->count = lcl - ext->pcl + 1;
+			nodep->extents_count = i + 1;
+			nodep->extents_clusters = ext->lcl + ext->count;
+			break;
+		}
+	}
+
+	fibril_mutex_unlock(&nodep->extents_lock);
+}
+
+/** Release the node's extent map.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_extents_fini(fat_node_t *nodep)
+{
+	free(nodep->extents);
+	nodep->extents = NULL;
+	nodep->extents_count = 0;
+	nodep->extents_size = 0;
+	nodep->extents_clusters = 0;
+}
+
+/** Translate a logical cluster number of a node to a physical one.
+ *
+ * The node's extent map is consulted first. If the cluster lies past the
+ * mapped part of the chain, the chain is walked from the last mapped
+ * cluster and the map is extended with the clusters seen on the way.
+ *
+ * The extent map lock is held for the whole walk so that concurrent
+ * readers of the node cannot append the same clusters twice.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param lcl		Logical cluster number.
+ * @param pcl		Output parameter where the physical cluster number
+ *			will be stored.
+ *
+ * @return		EOK on success, ENOMEM if the map cannot hold the
+ *			cluster, ELIMIT if the chain is too short or another
+ *			error code.
+ */
+int fat_extent_map(fat_bs_t *bs, fat_node_t *nodep, uint32_t lcl,
+    fat_cluster_t *pcl)
+{
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_cluster_t clst;
+	size_t lo, hi;
+	int rc;
+
+	fibril_mutex_lock(&nodep->extents_lock);
+
+	if (lcl >= nodep->extents_clusters) {
+		if (nodep->extents_count == 0) {
+			clst = nodep->firstc;
+		} else {
+			fat_extent_t *ext =
+			    &nodep->extents[nodep->extents_count - 1];
+			rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1,
+			    ext->pcl + ext->count - 1, &clst);
+			if (rc != EOK)
+				goto out;
+		}
+
+		while (true) {
+			if (clst < FAT_CLST_FIRST || clst >= clst_last1) {
+				rc = ELIMIT;
+				goto out;
+			}
+			rc = fat_extent_add(nodep, clst);
+			if (rc != EOK)
+				goto out;
+			if (nodep->extents_clusters > lcl)
+				break;
+			rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1,
+			    clst, &clst);
+			if (rc != EOK)
+				goto out;
+		}
+
+		*pcl = clst;
+		rc = EOK;
+		goto out;
+	}
+
+	/* Binary search for the extent containing lcl. */
+	lo = 0;
+	hi = nodep->extents_count;
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (nodep->extents[mid].lcl <= lcl)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	*pcl = nodep->extents[lo].pcl + (lcl - nodep->extents[lo].lcl);
+	rc = EOK;
+out:
+	fibril_mutex_unlock(&nodep->extents_lock);
+	return rc;
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -147,6 +351,18 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
+	rc = fat_extent_map(bs, nodep, bn / SPC(bs), &currc);
+	if (rc == EOK) {
+		return block_get(block, nodep->idx->service_id,
+		    CLBN2PBN(bs, currc, bn), flags);
+	}
+	if (rc != ENOMEM)
+		return rc;
+
+	/*
+	 * The extent map is full, fall back to walking the chain.
+	 */
+	fibril_mutex_lock(&nodep->extents_lock);
 	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
 		/*
 		 * We can start with the cluster cached by the previous call to
@@ -155,6 +371,7 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		firstc = nodep->currc_cached_value;
 		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
 	}
+	fibril_mutex_unlock(&nodep->extents_lock);
 
 fall_through:
 	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
@@ -165,9 +382,11 @@ fall_through:
 	/*
 	 * Update the "current" cluster cache.
 	 */
+	fibril_mutex_lock(&nodep->extents_lock);
 	nodep->currc_cached_valid = true;
 	nodep->currc_cached_bn = bn;
 	nodep->currc_cached_value = currc;
+	fibril_mutex_unlock(&nodep->extents_lock);
 
 	return rc;
 }
@@ -468,7 +687,6 @@ fat_set_cluster_fat12(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	if (rc != EOK)
 		return rc;
 
-	byte1 = ((uint8_t*) b->data)[offset % BPS(bs)];
 	bool border = false;
 	/* This cluster access spans a sector boundary. */
 	if ((offset % BPS(bs)) + 1 == BPS(bs)) {
@@ -496,6 +714,12 @@ fat_set_cluster_fat12(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	} else
 		byte2 = ((uint8_t*) b->data)[(offset % BPS(bs)) + 1];
 
+	/*
+	 * Read the first byte only after getting the next sector, so that no
+	 * concurrent update of the neighbouring entry can slip in between.
+	 */
+	byte1 = ((uint8_t*) b->data)[offset % BPS(bs)];
+
 	if (IS_ODD(clst)) {
 		byte1 &= 0x0f;
 		byte2 = 0;
@@ -646,7 +870,7 @@ int fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 	for (fatno = FAT1 + 1; fatno < FATCNT(bs); fatno++) {
 		for (c = 0; c < nclsts; c++) {
 			rc = fat_set_cluster(bs, service_id, fatno, lifo[c],
-			    c == 0 ? clst_last1 : lifo[c - 1]);
+			    c == nclsts - 1 ? clst_last1 : lifo[c + 1]);
 			if (rc != EOK)
 				return rc;
 		}
@@ -655,6 +879,255 @@ int fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+static fat_free_map_t *fat_free_map_find(service_id_t service_id)
+{
+	list_foreach(fat_free_maps, link, fat_free_map_t, map) {
+		if (map->service_id == service_id)
+			return map;
+	}
+
+	return NULL;
+}
+
+static void fat_free_map_mark(fat_free_map_t *map, fat_cluster_t clst,
+    bool free)
+{
+	uint32_t i = clst - FAT_CLST_FIRST;
+	uint32_t mask = 1U << (i % 32);
+
+	assert(i < map->clusters);
+
+	if (((map->bits[i / 32] & mask) != 0) == free)
+		return;
+
+	map->bits[i / 32] ^= mask;
+	if (free) {
+		map->region_free[i / FAT_FREE_REGION_CLUSTERS]++;
+		map->free++;
+	} else {
+		map->region_free[i / FAT_FREE_REGION_CLUSTERS]--;
+		map->free--;
+	}
+}
+
+/** Find the first free cluster at or after the given map position.
+ *
+ * Regions without free clusters are skipped using their free counts, the
+ * rest of the bitmap is scanned a word at a time.
+ *
+ * @param map		Free map.
+ * @param i		Map position to start at.
+ *
+ * @return		Map position of the free cluster or map->clusters
+ *			if there is none.
+ */
+static uint32_t fat_free_map_next_free(fat_free_map_t *map, uint32_t i)
+{
+	while (i < map->clusters) {
+		if (map->region_free[i / FAT_FREE_REGION_CLUSTERS] == 0) {
+			i = ALIGN_DOWN(i, FAT_FREE_REGION_CLUSTERS) +
+			    FAT_FREE_REGION_CLUSTERS;
+			continue;
+		}
+
+		uint32_t word = map->bits[i / 32] & (~0U << (i % 32));
+		if (word != 0) {
+			i = ALIGN_DOWN(i, 32) + __builtin_ctz(word);
+			break;
+		}
+
+		i = ALIGN_DOWN(i, 32) + 32;
+	}
+
+	return min(i, map->clusters);
+}
+
+/** Find the first used cluster at or after the given map position.
+ *
+ * @param map		Free map.
+ * @param i		Map position to start at.
+ * @param limit		Map position at which to stop looking.
+ *
+ * @return		Map position of the used cluster or @a limit.
+ */
+static uint32_t fat_free_map_next_used(fat_free_map_t *map, uint32_t i,
+    uint32_t limit)
+{
+	while (i < limit) {
+		uint32_t word = ~map->bits[i / 32] & (~0U << (i % 32));
+		if (word != 0) {
+			i = ALIGN_DOWN(i, 32) + __builtin_ctz(word);
+			break;
+		}
+
+		i = ALIGN_DOWN(i, 32) + 32;
+	}
+
+	return min(i, limit);
+}
+
+/** Take free clusters from the free map.
+ *
+ * A single contiguous run is preferred; it is searched for starting where
+ * the previous allocation ended. If there is no run long enough, the lowest
+ * numbered free clusters are taken.
+ *
+ * @param map		Free map.
+ * @param nclsts	Number of clusters to take.
+ * @param lifo		Output array where the taken cluster numbers will be
+ *			stored in ascending order.
+ *
+ * @return		EOK on success or ENOSPC.
+ */
+static int fat_free_map_take(fat_free_map_t *map, unsigned nclsts,
+    fat_cluster_t *lifo)
+{
+	uint32_t start, end, i;
+	unsigned found;
+
+	if (map->free < nclsts)
+		return ENOSPC;
+
+	for (unsigned pass = 0; pass < 2; pass++) {
+		start = (pass == 0) ? map->hint : 0;
+		end = (pass == 0) ? map->clusters : map->hint;
+
+		while (true) {
+			start = fat_free_map_next_free(map, start);
+			if (start >= end)
+				break;
+
+			i = fat_free_map_next_used(map, start,
+			    min(start + nclsts, map->clusters));
+			if (i - start == nclsts) {
+				for (found = 0; found < nclsts; found++) {
+					lifo[found] = FAT_CLST_FIRST + start +
+					    found;
+					fat_free_map_mark(map, lifo[found],
+					    false);
+				}
+
+				map->hint = i;
+				return EOK;
+			}
+
+			start = i;
+		}
+	}
+
+	/* No run is long enough, gather the clusters from the beginning. */
+	i = 0;
+	for (found = 0; found < nclsts; found++) {
+		i = fat_free_map_next_free(map, i);
+		assert(i < map->clusters);
+		lifo[found] = FAT_CLST_FIRST + i;
+		fat_free_map_mark(map, lifo[found], false);
+	}
+
+	map->hint = i + 1;
+	return EOK;
+}
+
+/** Build the free cluster map of a file system instance.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int fat_free_map_init(fat_bs_t *bs, service_id_t service_id)
+{
+	fat_free_map_t *map;
+	fat_cluster_t value;
+	uint32_t regions;
+	int rc;
+
+	map = malloc(sizeof(fat_free_map_t));
+	if (!map)
+		return ENOMEM;
+
+	link_initialize(&map->link);
+	map->service_id = service_id;
+	map->clusters = CC(bs);
+	map->free = 0;
+	map->hint = 0;
+
+	regions = ROUND_UP(map->clusters, FAT_FREE_REGION_CLUSTERS) /
+	    FAT_FREE_REGION_CLUSTERS;
+	map->bits = calloc(ROUND_UP(map->clusters, 32) / 32, sizeof(uint32_t));
+	map->region_free = calloc(regions, sizeof(uint32_t));
+	if (!map->bits || !map->region_free) {
+		free(map->bits);
+		free(map->region_free);
+		free(map);
+		return ENOMEM;
+	}
+
+	for (uint32_t i = 0; i < map->clusters; i++) {
+		rc = fat_get_cluster(bs, service_id, FAT1, FAT_CLST_FIRST + i,
+		    &value);
+		if (rc != EOK) {
+			free(map->bits);
+			free(map->region_free);
+			free(map);
+			return rc;
+		}
+
+		if (value == FAT_CLST_RES0)
+			fat_free_map_mark(map, FAT_CLST_FIRST + i, true);
+	}
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	list_append(&map->link, &fat_free_maps);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	return EOK;
+}
+
+/** Destroy the free cluster map of a file system instance, if it has one.
+ *
+ * @param service_id	Service ID of the file system.
+ */
+void fat_free_map_fini(service_id_t service_id)
+{
+	fat_free_map_t *map;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	map = fat_free_map_find(service_id);
+	if (map)
+		list_remove(&map->link);
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	if (map) {
+		free(map->bits);
+		free(map->region_free);
+		free(map);
+	}
+}
+
+/** Get the number of free clusters from the free cluster map.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param count		Output parameter for the number of free clusters.
+ *
+ * @return		EOK on success or ENOENT if there is no map.
+ */
+int fat_free_map_count(service_id_t service_id, uint64_t *count)
+{
+	fat_free_map_t *map;
+	int rc = ENOENT;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	map = fat_free_map_find(service_id);
+	if (map) {
+		*count = map->free;
+		rc = EOK;
+	}
+	fibril_mutex_unlock(&fat_alloc_lock);
+
+	return rc;
+}
+
 /** Allocate clusters in all copies of FAT.
  *
  * This function will attempt to allocate the requested number of clusters in
@@ -681,18 +1154,37 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 	fat_cluster_t clst;
 	fat_cluster_t value = 0;
 	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_free_map_t *map;
+	bool taken = false;
 	int rc = EOK;
 
 	lifo = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
 	if (!lifo)
 		return ENOMEM;
 	
+	fibril_mutex_lock(&fat_alloc_lock);
+	map = fat_free_map_find(service_id);
+	if (map) {
+		/*
+		 * Take the clusters from the free map and link them together
+		 * in FAT1.
+		 */
+		rc = fat_free_map_take(map, nclsts, lifo);
+		taken = (rc == EOK);
+		for (; rc == EOK && found < nclsts; found++) {
+			rc = fat_set_cluster(bs, service_id, FAT1, lifo[found],
+			    found == nclsts - 1 ? clst_last1 :
+			    lifo[found + 1]);
+			if (rc != EOK)
+				break;
+		}
+	}
+
 	/*
 	 * Search FAT1 for unused clusters.
 	 */
-	fibril_mutex_lock(&fat_alloc_lock);
-	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
-	    clst++) {
+	for (clst = FAT_CLST_FIRST;
+	    !map && clst < CC(bs) + 2 && found < nclsts; clst++) {
 		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
 		if (rc != EOK)
 			break;
@@ -704,9 +1196,21 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 			 */
 			lifo[found] = clst;
 			rc = fat_set_cluster(bs, service_id, FAT1, clst,
-			    (found == 0) ?  clst_last1 : lifo[found - 1]);
+			    clst_last1);
 			if (rc != EOK)
 				break;
+			/*
+			 * Link the chain in ascending order so that contiguous
+			 * free space yields contiguous extents.
+			 */
+			if (found > 0) {
+				rc = fat_set_cluster(bs, service_id, FAT1,
+				    lifo[found - 1], clst);
+				if (rc != EOK) {
+					found++;
+					break;
+				}
+			}
 
 			found++;
 		}
@@ -715,8 +1219,8 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 	if (rc == EOK && found == nclsts) {
 		rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
 		if (rc == EOK) {
-			*mcl = lifo[found - 1];
-			*lcl = lifo[0];
+			*mcl = lifo[0];
+			*lcl = lifo[found - 1];
 			free(lifo);
 			fibril_mutex_unlock(&fat_alloc_lock);
 			return EOK;
@@ -729,6 +1233,11 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 		    FAT_CLST_RES0);
 	}
 
+	if (taken) {
+		for (found = 0; found < nclsts; found++)
+			fat_free_map_mark(map, lifo[found], true);
+	}
+
 	free(lifo);
 	fibril_mutex_unlock(&fat_alloc_lock);
 
@@ -749,6 +1258,7 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 	unsigned fatno;
 	fat_cluster_t nextc = 0;
 	fat_cluster_t clst_bad = FAT_CLST_BAD(bs);
+	fat_free_map_t *map;
 	int rc;
 
 	/* Mark all clusters in the chain as free in all copies of FAT. */
@@ -766,6 +1276,12 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 				return rc;
 		}
 
+		fibril_mutex_lock(&fat_alloc_lock);
+		map = fat_free_map_find(service_id);
+		if (map)
+			fat_free_map_mark(map, firstc, true);
+		fibril_mutex_unlock(&fat_alloc_lock);
+
 		firstc = nextc;
 	}
 
@@ -804,14 +1320,22 @@ int fat_append_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t mcl,
 				return rc;
 		}
 
+		fibril_mutex_lock(&fat_alloc_lock);
 		for (fatno = FAT1; fatno < FATCNT(bs); fatno++) {
 			rc = fat_set_cluster(bs, nodep->idx->service_id,
 			    fatno, lastc, mcl);
-			if (rc != EOK)
+			if (rc != EOK) {
+				fibril_mutex_unlock(&fat_alloc_lock);
 				return rc;
+			}
 		}
+		fibril_mutex_unlock(&fat_alloc_lock);
 	}
 
+	/*
+	 * The extent map needs no update, the appended clusters are mapped
+	 * lazily by fat_extent_map() when they are first accessed.
+	 */
 	nodep->lastc_cached_valid = true;
 	nodep->lastc_cached_value = lcl;
 
@@ -840,6 +1364,7 @@ int fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	nodep->lastc_cached_valid = false;
 	if (nodep->currc_cached_value != lcl)
 		nodep->currc_cached_valid = false;
+	fat_extents_chop(nodep, lcl);
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
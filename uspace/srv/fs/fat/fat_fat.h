@@ -105,11 +105,28 @@ struct fat_bs;
 
 typedef uint32_t fat_cluster_t;
 
+/** Contiguous run of clusters in a node's cluster chain. */
+typedef struct {
+	/** Logical (file relative) number of the first cluster in the run. */
+	uint32_t	lcl;
+	/** Physical number of the first cluster in the run. */
+	fat_cluster_t	pcl;
+	/** Number of clusters in the run. */
+	uint32_t	count;
+} fat_extent_t;
+
+/** Maximum number of extents remembered per node. */
+#define FAT_EXTENTS_MAX		1024
+
 #define fat_clusters_get(numc, bs, sid, fc) \
     fat_cluster_walk((bs), (sid), (fc), NULL, (numc), (uint32_t) -1)
 extern int fat_cluster_walk(struct fat_bs *, service_id_t, fat_cluster_t,
     fat_cluster_t *, uint32_t *, uint32_t);
 
+extern int fat_extent_map(struct fat_bs *, struct fat_node *, uint32_t,
+    fat_cluster_t *);
+extern void fat_extents_fini(struct fat_node *);
+
 extern int fat_block_get(block_t **, struct fat_bs *, struct fat_node *,
     aoff64_t, int);
 extern int _fat_block_get(block_t **, struct fat_bs *, service_id_t,
@@ -121,6 +138,9 @@ extern int fat_chop_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t);
 extern int fat_alloc_clusters(struct fat_bs *, service_id_t, unsigned,
     fat_cluster_t *, fat_cluster_t *);
+extern int fat_free_map_init(struct fat_bs *, service_id_t);
+extern void fat_free_map_fini(service_id_t);
+extern int fat_free_map_count(service_id_t, uint64_t *);
 extern int fat_free_clusters(struct fat_bs *, service_id_t, fat_cluster_t);
 extern int fat_alloc_shadow_clusters(struct fat_bs *, service_id_t,
     fat_cluster_t *, unsigned);
@@ -111,6 +111,11 @@ static void fat_node_initialize(fat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	fibril_mutex_initialize(&node->extents_lock);
+	node->extents = NULL;
+	node->extents_count = 0;
+	node->extents_size = 0;
+	node->extents_clusters = 0;
 }
 
 static int fat_node_sync(fat_node_t *node)
@@ -192,6 +197,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,6 +236,7 @@ static int fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_extents_fini(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -238,6 +245,7 @@ static int fat_node_get_new(fat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fat_extents_fini(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 skip_cache:
@@ -476,6 +484,7 @@ int fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -569,6 +578,7 @@ int fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_extents_fini(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -870,6 +880,9 @@ int fat_free_block_count(service_id_t service_id, uint64_t *count)
 	int rc;
 	uint32_t cluster_no, clusters;
 
+	if (fat_free_map_count(service_id, count) == EOK)
+		return EOK;
+
 	block_count = 0;
 	bs = block_bb_get(service_id);
 	clusters = (SPC(bs)) ? TS(bs) / SPC(bs) : 0;
@@ -1030,6 +1043,7 @@ static void fat_fs_close(service_id_t service_id, fs_node_t *rfn)
 	(void) block_cache_fini(service_id);
 	block_fini(service_id);
 	fat_idx_fini_by_service_id(service_id);
+	fat_free_map_fini(service_id);
 }
 
 /*
@@ -1118,6 +1132,12 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 
 	fibril_mutex_unlock(&ridxp->lock);
 
+	/*
+	 * Summarize free space for the allocator. Without the map, clusters
+	 * are found by scanning the FAT instead.
+	 */
+	(void) fat_free_map_init(block_bb_get(service_id), service_id);
+
 	*index = ridxp->index;
 	*size = FAT_NODE(rfn)->size;
 
@@ -1496,8 +1516,13 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 				goto out;
 		} else {
 			fat_cluster_t lastc;
-			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
+			rc = fat_extent_map(bs, nodep, (size - 1) / BPC(bs),
+			    &lastc);
+			if (rc == ENOMEM) {
+				rc = fat_cluster_walk(bs, service_id,
+				    nodep->firstc, &lastc, NULL,
+				    (size - 1) / BPC(bs));
+			}
 			if (rc != EOK)
 				goto out;
 			rc = fat_chop_clusters(bs, nodep, lastc);
@@ -1569,6 +1594,9 @@ vfs_out_ops_t fat_ops = {
 	.close = fat_close,
 	.destroy = fat_destroy,
 	.sync = fat_sync,
+	/* Cluster allocation takes fat_alloc_lock, cluster caches extents_lock */
+	.concurrent = LIBFS_CONCURRENT_READ | LIBFS_CONCURRENT_WRITE |
+	    LIBFS_CONCURRENT_LOOKUP | LIBFS_CONCURRENT_STAT,
 };
 
 /**
@@ -43,6 +43,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <assert.h>
+#include <fibril_synch.h>
 #include <stdbool.h>
 #include <macros.h>
 #include "../../vfs/vfs.h"
@@ -114,6 +115,23 @@ struct mfs_sb_info {
 	 * is invoked.
 	 */
 	unsigned nfree_zones;
+	/* In-memory copies of the inode and zone bitmaps in host byte
+	 * order, NULL if they could not be loaded. The on-disk bitmaps
+	 * are kept in sync with them.
+	 */
+	bitchunk_t *ibmap;
+	bitchunk_t *zbmap;
+};
+
+/* Number of indirect zones cached per inode: the single indirect or
+ * second level zone, and the first level zone of the double indirect chain.
+ */
+#define MFS_IND_CACHE_SLOTS	2
+
+/* Decoded indirect zone cached in core */
+struct mfs_ind_cache {
+	uint32_t zone;
+	uint32_t *ptrs;
 };
 
 /* Generic MinixFS inode */
@@ -134,6 +152,10 @@ struct mfs_ino_info {
 	/* The following fields do not exist on disk but only in memory */
 	bool dirty;
 	fs_index_t index;
+	/* Indirect zones used by the last block mappings */
+	struct mfs_ind_cache ind_cache[MFS_IND_CACHE_SLOTS];
+	/* Serializes the lookup and use of the cached indirect zones */
+	fibril_mutex_t ind_cache_lock;
 };
 
 /* Generic MFS directory entry */
@@ -193,6 +215,12 @@ mfs_write_map(struct mfs_node *mnode, uint32_t pos, uint32_t new_zone,
 extern int
 mfs_prune_ind_zones(struct mfs_node *mnode, size_t new_size);
 
+extern void
+mfs_ind_cache_init(struct mfs_ino_info *ino_i);
+
+extern void
+mfs_ind_cache_fini(struct mfs_ino_info *ino_i);
+
 /* mfs_dentry.c */
 extern int
 mfs_read_dentry(struct mfs_node *mnode,
@@ -217,6 +245,9 @@ mfs_free_inode(struct mfs_instance *inst, uint32_t inum);
 extern int
 mfs_alloc_zone(struct mfs_instance *inst, uint32_t *zone);
 
+extern int
+mfs_alloc_zone_near(struct mfs_instance *inst, uint32_t goal, uint32_t *zone);
+
 extern int
 mfs_free_zone(struct mfs_instance *inst, uint32_t zone);
 
@@ -226,6 +257,12 @@ mfs_count_free_zones(struct mfs_instance *inst, uint32_t *zones);
 extern int
 mfs_count_free_inodes(struct mfs_instance *inst, uint32_t *inodes);
 
+extern int
+mfs_bmap_cache_init(struct mfs_instance *inst);
+
+extern void
+mfs_bmap_cache_fini(struct mfs_sb_info *sbi);
+
 
 /* mfs_utils.c */
 extern uint16_t
@@ -31,6 +31,7 @@
  */
 
 #include <stdlib.h>
+#include <align.h>
 #include "mfs.h"
 
 static int
@@ -46,6 +47,100 @@ mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid);
 static int
 mfs_count_free_bits(struct mfs_instance *inst, bmap_id_t bid, uint32_t *free);
 
+static int
+mfs_write_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid,
+    bool set);
+
+static uint32_t
+mfs_cached_find_free(const bitchunk_t *bmap, uint32_t start, uint32_t end);
+
+/**Get the in-memory copy of a bitmap.
+ *
+ * @param sbi		Pointer to the superblock info structure.
+ * @param bid		BMAP_ZONE or BMAP_INODE.
+ *
+ * @return		Pointer to the cached bitmap or NULL if the bitmap
+ * 			is not cached.
+ */
+static inline bitchunk_t *
+mfs_cached_bmap(struct mfs_sb_info *sbi, bmap_id_t bid)
+{
+	return bid == BMAP_ZONE ? sbi->zbmap : sbi->ibmap;
+}
+
+/**Load the inode and zone bitmaps in memory.
+ *
+ * Allocation and deallocation then search the in-memory copies and only
+ * write the changed bitmap chunks back to disk.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int
+mfs_bmap_cache_init(struct mfs_instance *inst)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	const bmap_id_t bids[] = { BMAP_INODE, BMAP_ZONE };
+	const unsigned chunks = sbi->block_size / sizeof(bitchunk_t);
+	unsigned i, j;
+	unsigned long block;
+	block_t *b;
+	int r;
+
+	for (i = 0; i < sizeof(bids) / sizeof(bids[0]); ++i) {
+		unsigned start_block = MFS_BMAP_START_BLOCK(sbi, bids[i]);
+		unsigned long nblocks = MFS_BMAP_SIZE_BLOCKS(sbi, bids[i]);
+
+		bitchunk_t *bmap = malloc(nblocks * sbi->block_size);
+		if (!bmap) {
+			r = ENOMEM;
+			goto out_err;
+		}
+
+		if (bids[i] == BMAP_ZONE)
+			sbi->zbmap = bmap;
+		else
+			sbi->ibmap = bmap;
+
+		for (block = 0; block < nblocks; ++block) {
+			r = block_get(&b, inst->service_id, block + start_block,
+			    BLOCK_FLAGS_NONE);
+			if (r != EOK)
+				goto out_err;
+
+			bitchunk_t *data = b->data;
+			for (j = 0; j < chunks; ++j) {
+				bmap[block * chunks + j] =
+				    conv32(sbi->native, data[j]);
+			}
+
+			r = block_put(b);
+			if (r != EOK)
+				goto out_err;
+		}
+	}
+
+	return EOK;
+
+out_err:
+	mfs_bmap_cache_fini(sbi);
+	return r;
+}
+
+/**Release the in-memory copies of the bitmaps.
+ *
+ * @param sbi		Pointer to the superblock info structure.
+ */
+void
+mfs_bmap_cache_fini(struct mfs_sb_info *sbi)
+{
+	free(sbi->ibmap);
+	free(sbi->zbmap);
+	sbi->ibmap = NULL;
+	sbi->zbmap = NULL;
+}
+
 
 /**Allocate a new inode.
  *
@@ -99,6 +194,43 @@ mfs_alloc_zone(struct mfs_instance *inst, uint32_t *zone)
 	return r;
 }
 
+/**Allocate a new zone, preferably the one following a given zone.
+ *
+ * Used when a file grows, so that its zones are laid out contiguously.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ * @param goal		Preferred zone, 0 if there is no preference.
+ * @param zone		Pointer to a 32 bit number where the index
+ * 			of the zone will be saved.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int
+mfs_alloc_zone_near(struct mfs_instance *inst, uint32_t goal, uint32_t *zone)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	uint32_t idx = goal - (sbi->firstdatazone - 1);
+	int r;
+
+	if (sbi->zbmap == NULL || goal < sbi->firstdatazone ||
+	    idx > MFS_BMAP_SIZE_BITS(sbi, BMAP_ZONE) ||
+	    mfs_cached_find_free(sbi->zbmap, idx, idx + 1) != idx)
+		return mfs_alloc_zone(inst, zone);
+
+	sbi->zbmap[idx / 32] |= 1 << (idx % 32);
+	r = mfs_write_bit(inst, idx, BMAP_ZONE, true);
+	if (r != EOK) {
+		sbi->zbmap[idx / 32] &= ~(1 << (idx % 32));
+		return r;
+	}
+
+	if (sbi->nfree_zones_valid)
+		sbi->nfree_zones--;
+
+	*zone = goal;
+	return EOK;
+}
+
 /**Free a zone.
  *
  * @param inst		Pointer to the filesystem instance.
@@ -181,6 +313,25 @@ mfs_count_free_bits(struct mfs_instance *inst, bmap_id_t bid, uint32_t *free)
 	nblocks = MFS_BMAP_SIZE_BLOCKS(sbi, bid);
 	nbits = MFS_BMAP_SIZE_BITS(sbi, bid);
 
+	bitchunk_t *bmap = mfs_cached_bmap(sbi, bid);
+	if (bmap) {
+		/* Count the zero bits of the in-memory copy */
+		for (block = 0; nbits > 0; ++block) {
+			chunk = ~bmap[block];
+			if (nbits < bitchunk_bits) {
+				chunk &= (1U << nbits) - 1;
+				nbits = 0;
+			} else {
+				nbits -= bitchunk_bits;
+			}
+
+			free_bits += __builtin_popcount(chunk);
+		}
+
+		*free = free_bits;
+		return EOK;
+	}
+
 	for (block = 0; block < nblocks; ++block) {
 		r = block_get(&b, inst->service_id, block + start_block,
 		    BLOCK_FLAGS_NONE);
@@ -232,14 +383,10 @@ mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 {
 	struct mfs_sb_info *sbi;
 	int r;
-	unsigned start_block;
 	unsigned *search;
-	block_t *b;
 
 	sbi = inst->sbi;
 
-	start_block = MFS_BMAP_START_BLOCK(sbi, bid);
-
 	if (bid == BMAP_ZONE) {
 		search = &sbi->zsearch;
 		if (idx > sbi->nzones) {
@@ -257,31 +404,89 @@ mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 		}
 	}
 
+	bitchunk_t *bmap = mfs_cached_bmap(sbi, bid);
+	if (bmap)
+		bmap[idx / 32] &= ~(1 << (idx % 32));
+
+	r = mfs_write_bit(inst, idx, bid, false);
+
+	if (*search > idx)
+		*search = idx;
+
+	return r;
+}
+
+/**Write a single bit of a bitmap to disk.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ * @param idx		Index of the bit.
+ * @param bid		BMAP_ZONE or BMAP_INODE.
+ * @param set		True to set the bit, false to clear it.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int
+mfs_write_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid,
+    bool set)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
+	block_t *b;
+	int r;
+
 	/* Compute the bitmap block */
-	uint32_t block = idx / (sbi->block_size * 8) + start_block;
+	uint32_t block = idx / (sbi->block_size * 8) +
+	    MFS_BMAP_START_BLOCK(sbi, bid);
 
 	r = block_get(&b, inst->service_id, block, BLOCK_FLAGS_NONE);
 	if (r != EOK)
-		goto out_err;
+		return r;
 
 	/* Compute the bit index in the block */
 	idx %= (sbi->block_size * 8);
 	bitchunk_t *ptr = b->data;
 	bitchunk_t chunk;
-	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
 
 	chunk = conv32(sbi->native, ptr[idx / chunk_bits]);
-	chunk &= ~(1 << (idx % chunk_bits));
+	if (set)
+		chunk |= 1 << (idx % chunk_bits);
+	else
+		chunk &= ~(1 << (idx % chunk_bits));
 	ptr[idx / chunk_bits] = conv32(sbi->native, chunk);
 
 	b->dirty = true;
-	r = block_put(b);
+	return block_put(b);
+}
 
-	if (*search > idx)
-		*search = idx;
+/**Find the first zero bit of an in-memory bitmap.
+ *
+ * The bitmap is scanned a whole chunk at a time.
+ *
+ * @param bmap		In-memory bitmap.
+ * @param start		Index of the first bit to check.
+ * @param end		Index of the bit where the search stops.
+ *
+ * @return		Index of the zero bit or @a end if there is none.
+ */
+static uint32_t
+mfs_cached_find_free(const bitchunk_t *bmap, uint32_t start, uint32_t end)
+{
+	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
 
-out_err:
-	return r;
+	while (start < end) {
+		bitchunk_t chunk = ~bmap[start / chunk_bits] &
+		    (~0U << (start % chunk_bits));
+
+		if (chunk) {
+			start = ALIGN_DOWN(start, chunk_bits) +
+			    __builtin_ctz(chunk);
+			break;
+		}
+
+		start = ALIGN_DOWN(start, chunk_bits) + chunk_bits;
+	}
+
+	return min(start, end);
 }
 
 /**Search a free bit in a bitmap and mark it as used.
@@ -318,6 +523,31 @@ mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid)
 	}
 	bits_per_block = sbi->block_size * 8;
 
+	bitchunk_t *bmap = mfs_cached_bmap(sbi, bid);
+	if (bmap) {
+		/* Search the in-memory copy from the hint, then wrap around */
+		uint32_t end = limit + 1;
+		uint32_t start = min(*search, end);
+		uint32_t bit = mfs_cached_find_free(bmap, start, end);
+
+		if (bit == end) {
+			bit = mfs_cached_find_free(bmap, 0, start);
+			if (bit == start)
+				return ENOSPC;
+		}
+
+		bmap[bit / 32] |= 1 << (bit % 32);
+		r = mfs_write_bit(inst, bit, bid, true);
+		if (r != EOK) {
+			bmap[bit / 32] &= ~(1 << (bit % 32));
+			return r;
+		}
+
+		*search = bit;
+		*idx = bit;
+		return EOK;
+	}
+
 	block_t *b;
 
 retry:
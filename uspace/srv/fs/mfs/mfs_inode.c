@@ -71,6 +71,9 @@ mfs_get_inode(struct mfs_instance *inst, struct mfs_ino_info **ino_i,
 		r = mfs2_read_inode_raw(inst, ino_i, index);
 	}
 
+	if (r == EOK)
+		mfs_ind_cache_init(*ino_i);
+
 	return r;
 }
 
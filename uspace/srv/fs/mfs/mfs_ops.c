@@ -210,6 +210,8 @@ static int mfs_read_sb(service_id_t service_id, struct mfs_sb_info **rsbi)
 	sbi->zsearch = 0;
 	sbi->nfree_zones_valid = false;
 	sbi->nfree_zones = 0;
+	sbi->ibmap = NULL;
+	sbi->zbmap = NULL;
 
 	if (version == MFS_VERSION_V3) {
 		sbi->ninodes = conv32(native, sb3->s_ninodes);
@@ -343,6 +345,11 @@ mfs_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		goto out_error;
 	}
 
+	/* Keep the bitmaps in memory, allocation falls back to reading
+	 * them from disk if there is not enough memory.
+	 */
+	(void) mfs_bmap_cache_init(instance);
+
 	mfsdebug("mount successful\n");
 
 	fs_node_t *fn;
@@ -383,6 +390,7 @@ mfs_unmounted(service_id_t service_id)
 
 	/* Remove and destroy the instance */
 	(void) fs_instance_destroy(service_id);
+	mfs_bmap_cache_fini(inst->sbi);
 	free(inst->sbi);
 	free(inst);
 	return EOK;
@@ -455,6 +463,7 @@ mfs_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 
 	ino_i->index = inum;
 	ino_i->dirty = true;
+	mfs_ind_cache_init(ino_i);
 	mnode->ino_i = ino_i;
 	mnode->instance = inst;
 	mnode->refcnt = 1;
@@ -558,6 +567,7 @@ mfs_node_put(fs_node_t *fsnode)
 		assert(mnode->instance->open_nodes_cnt > 0);
 		mnode->instance->open_nodes_cnt--;
 		rc = mfs_put_inode(mnode);
+		mfs_ind_cache_fini(mnode->ino_i);
 		free(mnode->ino_i);
 		free(mnode);
 		free(fsnode);
@@ -968,8 +978,14 @@ mfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 	if (block == 0) {
 		uint32_t dummy;
+		uint32_t goal = 0;
+
+		/* Try to place the zone right after the previous one */
+		if (pos >= bs && mfs_read_map(&goal, mnode, pos - bs) == EOK &&
+		    goal != 0)
+			goal++;
 
-		r = mfs_alloc_zone(mnode->instance, &block);
+		r = mfs_alloc_zone_near(mnode->instance, goal, &block);
 		if (r != EOK)
 			goto out_err;
 		
@@ -1265,6 +1281,9 @@ vfs_out_ops_t mfs_ops = {
 	.close = mfs_close,
 	.destroy = mfs_destroy,
 	.sync = mfs_sync,
+	/* mfs_alloc_bit() scans and updates the zone bitmap without a lock */
+	.concurrent = LIBFS_CONCURRENT_READ | LIBFS_CONCURRENT_LOOKUP |
+	    LIBFS_CONCURRENT_STAT,
 };
 
 /**
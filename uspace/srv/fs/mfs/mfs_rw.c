@@ -46,9 +46,19 @@ alloc_zone_and_clear(struct mfs_instance *inst, uint32_t *zone);
 static int
 read_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t **ind_zone);
 
+static int
+load_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t *ind_zone);
+
+static int
+get_cached_ind_zone(struct mfs_instance *inst, struct mfs_ino_info *ino_i,
+    unsigned slot, uint32_t zone, uint32_t **ind_zone);
+
 static int
 write_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t *ind_zone);
 
+static void
+invalidate_ind_zone(struct mfs_ino_info *ino_i, uint32_t zone);
+
 
 /**Given the position in the file expressed in
  *bytes, this function returns the on-disk block
@@ -105,7 +115,7 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 {
 	int nr_direct;
 	int ptrs_per_block;
-	uint32_t *ind_zone = NULL, *ind2_zone = NULL;
+	uint32_t *ind_zone, *ind2_zone;
 	int r = EOK;
 
 	struct mfs_ino_info *ino_i = mnode->ino_i;
@@ -123,6 +133,12 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 		ptrs_per_block = sbi->block_size / sizeof(uint32_t);
 	}
 
+	/*
+	 * The cached indirect zones are shared by all users of the inode and
+	 * refilling them blocks, so keep them stable until we are done.
+	 */
+	fibril_mutex_lock(&ino_i->ind_cache_lock);
+
 	/* Check if the wanted block is in the direct zones */
 	if (rblock < nr_direct) {
 		*b = ino_i->i_dzone[rblock];
@@ -153,14 +169,17 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 			}
 		}
 
-		r = read_ind_zone(inst, ino_i->i_izone[0], &ind_zone);
+		r = get_cached_ind_zone(inst, ino_i, 0, ino_i->i_izone[0],
+		    &ind_zone);
 		if (r != EOK)
 			goto out;
 
 		*b = ind_zone[rblock];
 		if (write_mode) {
 			ind_zone[rblock] = w_block;
-			write_ind_zone(inst, ino_i->i_izone[0], ind_zone);
+			r = write_ind_zone(inst, ino_i->i_izone[0], ind_zone);
+			if (r != EOK)
+				invalidate_ind_zone(ino_i, ino_i->i_izone[0]);
 		}
 
 		goto out;
@@ -187,7 +206,7 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 		}
 	}
 
-	r = read_ind_zone(inst, ino_i->i_izone[1], &ind_zone);
+	r = get_cached_ind_zone(inst, ino_i, 1, ino_i->i_izone[1], &ind_zone);
 	if (r != EOK)
 		goto out;
 
@@ -206,7 +225,12 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 				goto out;
 
 			ind_zone[ind2_off] = zone;
-			write_ind_zone(inst, ino_i->i_izone[1], ind_zone);
+			r = write_ind_zone(inst, ino_i->i_izone[1], ind_zone);
+			if (r != EOK) {
+				invalidate_ind_zone(ino_i, ino_i->i_izone[1]);
+				mfs_free_zone(inst, zone);
+				goto out;
+			}
 		} else {
 			/* Sparse block */
 			*b = 0;
@@ -214,22 +238,117 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 		}
 	}
 
-	r = read_ind_zone(inst, ind_zone[ind2_off], &ind2_zone);
+	r = get_cached_ind_zone(inst, ino_i, 0, ind_zone[ind2_off], &ind2_zone);
 	if (r != EOK)
 		goto out;
 
 	*b = ind2_zone[rblock - (ind2_off * ptrs_per_block)];
 	if (write_mode) {
 		ind2_zone[rblock - (ind2_off * ptrs_per_block)] = w_block;
-		write_ind_zone(inst, ind_zone[ind2_off], ind2_zone);
+		r = write_ind_zone(inst, ind_zone[ind2_off], ind2_zone);
+		if (r != EOK)
+			invalidate_ind_zone(ino_i, ind_zone[ind2_off]);
 	}
 
 out:
-	free(ind2_zone);
-	free(ind_zone);
+	fibril_mutex_unlock(&ino_i->ind_cache_lock);
 	return r;
 }
 
+/**Initialize the indirect zone cache of an inode.
+ *
+ * @param ino_i		Pointer to the generic MINIX inode in memory.
+ */
+void
+mfs_ind_cache_init(struct mfs_ino_info *ino_i)
+{
+	unsigned i;
+
+	fibril_mutex_initialize(&ino_i->ind_cache_lock);
+
+	for (i = 0; i < MFS_IND_CACHE_SLOTS; ++i) {
+		ino_i->ind_cache[i].zone = 0;
+		ino_i->ind_cache[i].ptrs = NULL;
+	}
+}
+
+/**Release the indirect zone cache of an inode.
+ *
+ * @param ino_i		Pointer to the generic MINIX inode in memory.
+ */
+void
+mfs_ind_cache_fini(struct mfs_ino_info *ino_i)
+{
+	unsigned i;
+
+	for (i = 0; i < MFS_IND_CACHE_SLOTS; ++i) {
+		free(ino_i->ind_cache[i].ptrs);
+		ino_i->ind_cache[i].zone = 0;
+		ino_i->ind_cache[i].ptrs = NULL;
+	}
+}
+
+/**Drop the cached copy of an indirect zone.
+ *
+ * Used when writing a modified indirect zone back fails, so that the
+ * cache does not keep pointers which are not on the disk.
+ *
+ * @param ino_i		Pointer to the generic MINIX inode in memory.
+ * @param zone		Indirect zone to drop.
+ */
+static void
+invalidate_ind_zone(struct mfs_ino_info *ino_i, uint32_t zone)
+{
+	unsigned i;
+
+	for (i = 0; i < MFS_IND_CACHE_SLOTS; ++i) {
+		if (ino_i->ind_cache[i].zone == zone)
+			ino_i->ind_cache[i].zone = 0;
+	}
+}
+
+/**Get the decoded content of an indirect zone through the inode's cache.
+ *
+ * The returned array belongs to the cache. Changes made to it must be
+ * written back with write_ind_zone(). The caller must hold the inode's
+ * ind_cache_lock while using the array.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ * @param ino_i		Pointer to the generic MINIX inode in memory.
+ * @param slot		Cache slot to use.
+ * @param zone		Indirect zone to get.
+ * @param ind_zone	Pointer where the zone pointers array will be stored.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int
+get_cached_ind_zone(struct mfs_instance *inst, struct mfs_ino_info *ino_i,
+    unsigned slot, uint32_t zone, uint32_t **ind_zone)
+{
+	struct mfs_ind_cache *cache = &ino_i->ind_cache[slot];
+	const int max_ind_zone_ptrs = (MFS_MAX_BLOCKSIZE / sizeof(uint16_t)) *
+	    sizeof(uint32_t);
+	int r;
+
+	if (cache->ptrs == NULL) {
+		cache->ptrs = malloc(max_ind_zone_ptrs);
+		if (cache->ptrs == NULL)
+			return ENOMEM;
+	} else if (cache->zone == zone) {
+		*ind_zone = cache->ptrs;
+		return EOK;
+	}
+
+	cache->zone = 0;
+	r = load_ind_zone(inst, zone, cache->ptrs);
+	if (r != EOK)
+		return r;
+
+	cache->zone = zone;
+	*ind_zone = cache->ptrs;
+	return EOK;
+}
+
 /**Free unused indirect zones from a MINIX inode according to its new size.
  *
  * @param mnode		Pointer to a generic MINIX inode in memory.
@@ -260,6 +379,12 @@ mfs_prune_ind_zones(struct mfs_node *mnode, size_t new_size)
 
 	rblock = new_size / sbi->block_size;
 
+	/* Indirect zones freed below must not be served from the cache */
+	fibril_mutex_lock(&ino_i->ind_cache_lock);
+	for (i = 0; i < MFS_IND_CACHE_SLOTS; ++i)
+		ino_i->ind_cache[i].zone = 0;
+	fibril_mutex_unlock(&ino_i->ind_cache_lock);
+
 	if (rblock < nr_direct) {
 		/* Free the single indirect zone */
 		if (ino_i->i_izone[0]) {
@@ -342,10 +467,7 @@ alloc_zone_and_clear(struct mfs_instance *inst, uint32_t *zone)
 static int
 read_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t **ind_zone)
 {
-	struct mfs_sb_info *sbi = inst->sbi;
 	int r;
-	unsigned i;
-	block_t *b;
 	const int max_ind_zone_ptrs = (MFS_MAX_BLOCKSIZE / sizeof(uint16_t)) *
 	    sizeof(uint32_t);
 
@@ -353,22 +475,37 @@ read_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t **ind_zone)
 	if (*ind_zone == NULL)
 		return ENOMEM;
 
-	r = block_get(&b, inst->service_id, zone, BLOCK_FLAGS_NONE);
+	r = load_ind_zone(inst, zone, *ind_zone);
 	if (r != EOK) {
 		free(*ind_zone);
-		return r;
+		*ind_zone = NULL;
 	}
 
+	return r;
+}
+
+static int
+load_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t *ind_zone)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	int r;
+	unsigned i;
+	block_t *b;
+
+	r = block_get(&b, inst->service_id, zone, BLOCK_FLAGS_NONE);
+	if (r != EOK)
+		return r;
+
 	if (sbi->fs_version == MFS_VERSION_V1) {
 		uint16_t *src_ptr = b->data;
 
 		for (i = 0; i < sbi->block_size / sizeof(uint16_t); ++i)
-			(*ind_zone)[i] = conv16(sbi->native, src_ptr[i]);
+			ind_zone[i] = conv16(sbi->native, src_ptr[i]);
 	} else {
 		uint32_t *src_ptr = b->data;
 
 		for (i = 0; i < sbi->block_size / sizeof(uint32_t); ++i)
-			(*ind_zone)[i] = conv32(sbi->native, src_ptr[i]);
+			ind_zone[i] = conv32(sbi->native, src_ptr[i]);
 	}
 
 	return block_put(b);
@@ -65,6 +65,12 @@
 #define SPACE_TABLE   0
 #define SPACE_BITMAP  1
 
+/** Size of the per-instance file data read-ahead window */
+#define UDF_READAHEAD_SIZE  65536
+
+/** Number of unreferenced nodes kept in the node index */
+#define UDF_NODE_CACHE_SIZE  256
+
 typedef struct udf_partition {
 	/* Partition info */
 	uint16_t number;
@@ -93,6 +99,13 @@ typedef struct {
 	uint64_t uaspace_start;
 	uint64_t uaspace_lenght;
 	uint8_t space_type;
+	
+	/* Read-ahead window for file data */
+	fibril_mutex_t ra_lock;
+	uint8_t *ra_buf;
+	size_t ra_sectors;
+	uint32_t ra_lba;
+	size_t ra_count;
 } udf_instance_t;
 
 typedef struct udf_allocator {
@@ -107,6 +120,7 @@ typedef struct udf_node {
 	
 	fs_index_t index;  /* FID logical block */
 	ht_link_t link;
+	link_t unused_link;  /* Link in the list of unreferenced nodes */
 	size_t ref_cnt;
 	size_t link_cnt;
 	
@@ -115,6 +129,10 @@ typedef struct udf_node {
 	uint8_t *data;
 	udf_allocator_t *allocators;
 	size_t alloc_size;
+	
+	/* Allocator containing the end of the last read and its file offset */
+	size_t alloc_cur;
+	aoff64_t alloc_cur_pos;
 } udf_node_t;
 
 extern vfs_out_ops_t udf_ops;
@@ -41,6 +41,7 @@
 #include <inttypes.h>
 #include <io/log.h>
 #include <mem.h>
+#include <macros.h>
 #include "udf.h"
 #include "udf_file.h"
 #include "udf_cksum.h"
@@ -564,6 +565,101 @@ int udf_get_fid_in_sector(udf_file_identifier_descriptor_t **fid,
 	return ENOENT;
 }
 
+/** Find allocator containing position in file.
+ *
+ * Search starts from the allocator of the previous read, so that
+ * sequential reads of fragmented files do not rescan all allocators.
+ *
+ * @param node UDF node
+ * @param pos  Position in file
+ * @param ext  Returned value - offset of the allocator in file
+ *
+ * @return Index of the allocator or node->alloc_size if pos lies
+ *         beyond the last allocator.
+ *
+ */
+static size_t udf_find_allocator(udf_node_t *node, aoff64_t pos,
+    aoff64_t *ext)
+{
+	size_t i = 0;
+	aoff64_t l = 0;
+	
+	fibril_mutex_lock(&node->lock);
+	
+	if ((node->alloc_cur < node->alloc_size) &&
+	    (pos >= node->alloc_cur_pos)) {
+		i = node->alloc_cur;
+		l = node->alloc_cur_pos;
+	}
+	
+	while (i < node->alloc_size) {
+		if (pos >= l + node->allocators[i].length) {
+			l += node->allocators[i].length;
+			i++;
+		} else
+			break;
+	}
+	
+	if (i < node->alloc_size) {
+		node->alloc_cur = i;
+		node->alloc_cur_pos = l;
+	}
+	
+	fibril_mutex_unlock(&node->lock);
+	
+	*ext = l;
+	return i;
+}
+
+/** Read file data through the read-ahead window of the instance.
+ *
+ * When the sector is not in the window, the window is refilled with
+ * consecutive sectors of the extent starting at the requested sector.
+ *
+ * @param read_len Returned value. Length of data which we could read.
+ * @param callid
+ * @param node     UDF node
+ * @param sector   Absolute number of the sector containing pos
+ * @param sector_pos Offset of pos in the sector
+ * @param ext_sectors Number of sectors left in the extent
+ * @param len      Length of data for reading, already limited to the extent
+ *
+ * @return EOK on success or a negative error code.
+ *
+ */
+static int udf_read_ahead(size_t *read_len, ipc_callid_t callid,
+    udf_node_t *node, uint32_t sector, size_t sector_pos, size_t ext_sectors,
+    size_t len)
+{
+	udf_instance_t *instance = node->instance;
+	
+	fibril_mutex_lock(&instance->ra_lock);
+	
+	if ((instance->ra_count == 0) || (sector < instance->ra_lba) ||
+	    (sector >= instance->ra_lba + instance->ra_count)) {
+		size_t cnt = min(ext_sectors, instance->ra_sectors);
+		int rc = block_read_range(instance->service_id, sector, cnt,
+		    instance->ra_buf);
+		if (rc != EOK) {
+			instance->ra_count = 0;
+			fibril_mutex_unlock(&instance->ra_lock);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+		
+		instance->ra_lba = sector;
+		instance->ra_count = cnt;
+	}
+	
+	size_t boff = (sector - instance->ra_lba) * instance->sector_size +
+	    sector_pos;
+	*read_len = min(len, instance->ra_count * instance->sector_size - boff);
+	
+	async_data_read_finalize(callid, instance->ra_buf + boff, *read_len);
+	fibril_mutex_unlock(&instance->ra_lock);
+	return EOK;
+}
+
 /** Read file if it is saved in allocators.
  *
  * @param read_len Returned value. Length file or part file which we could read.
@@ -578,45 +674,39 @@ int udf_get_fid_in_sector(udf_file_identifier_descriptor_t **fid,
 int udf_read_file(size_t *read_len, ipc_callid_t callid, udf_node_t *node,
     aoff64_t pos, size_t len)
 {
-	size_t i = 0;
-	size_t l = 0;
+	uint32_t sector_size = node->instance->sector_size;
 	
-	while (i < node->alloc_size) {
-		if (pos >= l + node->allocators[i].length) {
-			l += node->allocators[i].length;
-			i++;
-		} else
-			break;
+	aoff64_t l;
+	size_t i = udf_find_allocator(node, pos, &l);
+	if (i >= node->alloc_size) {
+		*read_len = 0;
+		async_data_read_finalize(callid, NULL, 0);
+		return EOK;
 	}
 	
-	size_t sector_cnt = ALL_UP(l, node->instance->sector_size);
-	size_t sector_num = pos / node->instance->sector_size;
+	aoff64_t ext_pos = pos - l;
+	uint32_t sector = node->allocators[i].position + ext_pos / sector_size;
+	size_t sector_pos = ext_pos % sector_size;
+	
+	/* Never read past the end of the extent */
+	len = min(len, node->allocators[i].length - ext_pos);
+	
+	if (node->instance->ra_buf != NULL) {
+		size_t ext_sectors = ALL_UP(node->allocators[i].length,
+		    sector_size) - ext_pos / sector_size;
+		return udf_read_ahead(read_len, callid, node, sector,
+		    sector_pos, ext_sectors, len);
+	}
 	
 	block_t *block = NULL;
-	int rc = block_get(&block, node->instance->service_id,
-	    node->allocators[i].position + (sector_num - sector_cnt),
+	int rc = block_get(&block, node->instance->service_id, sector,
 	    BLOCK_FLAGS_NONE);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return rc;
 	}
 	
-	size_t sector_pos = pos % node->instance->sector_size;
-	
-	if (sector_pos + len < node->instance->sector_size)
-		*read_len = len;
-	else
-		*read_len = node->instance->sector_size - sector_pos;
-	
-	if (ALL_UP(node->allocators[i].length, node->instance->sector_size) ==
-	    sector_num - sector_cnt + 1) {
-		if (pos + len > node->allocators[i].length + l)
-			*read_len = node->allocators[i].length -
-			    (sector_num - sector_cnt) * node->instance->sector_size -
-			    sector_pos;
-		else
-			*read_len = len;
-	}
+	*read_len = min(len, sector_size - sector_pos);
 	
 	async_data_read_finalize(callid, block->data + sector_pos, *read_len);
 	return block_put(block);
@@ -51,6 +51,14 @@ static FIBRIL_MUTEX_INITIALIZE(udf_idx_lock);
 
 static hash_table_t udf_idx;
 
+/*
+ * Nodes whose reference count dropped to zero stay in the index so that
+ * their allocation descriptors need not be read again on the next access.
+ * The least recently released node is at the head of the list.
+ */
+static LIST_INITIALIZE(udf_idx_unused);
+static size_t udf_idx_unused_cnt = 0;
+
 typedef struct {
 	service_id_t service_id;
 	fs_index_t index;
@@ -85,6 +93,26 @@ static hash_table_ops_t udf_idx_ops = {
 	.remove_callback = NULL 
 };
 
+/** Remove node from hash table and free it
+ *
+ * Must be called with udf_idx_lock held.
+ *
+ * @param node UDF node
+ *
+ */
+static void udf_idx_remove(udf_node_t *node)
+{
+	hash_table_remove_item(&udf_idx, &node->link);
+	
+	assert(node->instance->open_nodes_count > 0);
+	node->instance->open_nodes_count--;
+	
+	free(node->allocators);
+	free(node->data);
+	free(node->fs_node);
+	free(node);
+}
+
 /** Initialization of hash table
  *
  * @return EOK on success or a negative error code.
@@ -131,6 +159,11 @@ int udf_idx_get(udf_node_t **udfn, udf_instance_t *instance, fs_index_t index)
 	if (already_open) {
 		udf_node_t *node = hash_table_get_inst(already_open,
 		    udf_node_t, link);
+		if (node->ref_cnt == 0) {
+			list_remove(&node->unused_link);
+			udf_idx_unused_cnt--;
+		}
+		
 		node->ref_cnt++;
 		
 		*udfn = node;
@@ -178,6 +211,10 @@ int udf_idx_add(udf_node_t **udfn, udf_instance_t *instance, fs_index_t index)
 	udf_node->fs_node = fs_node;
 	udf_node->data = NULL;
 	udf_node->allocators = NULL;
+	udf_node->alloc_size = 0;
+	udf_node->alloc_cur = 0;
+	udf_node->alloc_cur_pos = 0;
+	link_initialize(&udf_node->unused_link);
 	
 	fibril_mutex_initialize(&udf_node->lock);
 	fs_node->data = udf_node;
@@ -203,17 +240,63 @@ int udf_idx_del(udf_node_t *node)
 	assert(node->ref_cnt == 0);
 	
 	fibril_mutex_lock(&udf_idx_lock);
+	udf_idx_remove(node);
+	fibril_mutex_unlock(&udf_idx_lock);
 	
-	hash_table_remove_item(&udf_idx, &node->link);
+	return EOK;
+}
+
+/** Drop a reference to node
+ *
+ * Unreferenced node is kept in the hash table and the oldest unreferenced
+ * node is deleted once there are more than UDF_NODE_CACHE_SIZE of them.
+ *
+ * @param node UDF node
+ *
+ */
+void udf_idx_put(udf_node_t *node)
+{
+	fibril_mutex_lock(&udf_idx_lock);
 	
-	assert(node->instance->open_nodes_count > 0);
-	node->instance->open_nodes_count--;
+	assert(node->ref_cnt > 0);
+	node->ref_cnt--;
 	
-	free(node->fs_node);
-	free(node);
+	if (node->ref_cnt == 0) {
+		list_append(&node->unused_link, &udf_idx_unused);
+		udf_idx_unused_cnt++;
+	}
+	
+	while (udf_idx_unused_cnt > UDF_NODE_CACHE_SIZE) {
+		udf_node_t *old = list_get_instance(list_first(&udf_idx_unused),
+		    udf_node_t, unused_link);
+		list_remove(&old->unused_link);
+		udf_idx_unused_cnt--;
+		udf_idx_remove(old);
+	}
+	
+	fibril_mutex_unlock(&udf_idx_lock);
+}
+
+/** Delete all unreferenced nodes of an instance
+ *
+ * @param instance UDF instance
+ *
+ */
+void udf_idx_flush(udf_instance_t *instance)
+{
+	fibril_mutex_lock(&udf_idx_lock);
+	
+	list_foreach_safe(udf_idx_unused, cur, next) {
+		udf_node_t *node = list_get_instance(cur, udf_node_t,
+		    unused_link);
+		if (node->instance == instance) {
+			list_remove(&node->unused_link);
+			udf_idx_unused_cnt--;
+			udf_idx_remove(node);
+		}
+	}
 	
 	fibril_mutex_unlock(&udf_idx_lock);
-	return EOK;
 }
 
 /**
@@ -40,6 +40,8 @@ extern int udf_idx_fini(void);
 extern int udf_idx_get(udf_node_t **, udf_instance_t *, fs_index_t);
 extern int udf_idx_add(udf_node_t **, udf_instance_t *, fs_index_t);
 extern int udf_idx_del(udf_node_t *);
+extern void udf_idx_put(udf_node_t *);
+extern void udf_idx_flush(udf_instance_t *);
 
 #endif /* UDF_IDX_H_ */
 
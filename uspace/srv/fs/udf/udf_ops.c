@@ -165,14 +165,7 @@ static int udf_node_put(fs_node_t *fn)
 	if (!node)
 		return EINVAL;
 	
-	fibril_mutex_lock(&node->lock);
-	node->ref_cnt--;
-	fibril_mutex_unlock(&node->lock);
-	
-	/* Delete node from hash table and memory */
-	if (!node->ref_cnt)
-		udf_idx_del(node);
-	
+	udf_idx_put(node);
 	return EOK;
 }
 
@@ -342,6 +335,9 @@ static int udf_mounted(service_id_t service_id, const char *opts,
 	
 	instance->service_id = service_id;
 	instance->open_nodes_count = 0;
+	fibril_mutex_initialize(&instance->ra_lock);
+	instance->ra_buf = NULL;
+	instance->ra_count = 0;
 	
 	/* Check Volume Recognition Sequence */
 	rc = udf_volume_recongnition(service_id);
@@ -396,11 +392,19 @@ static int udf_mounted(service_id_t service_id, const char *opts,
 		return rc;
 	}
 	
+	/*
+	 * The read-ahead window is optional, file data is read through
+	 * the block cache one sector at a time without it.
+	 */
+	instance->ra_sectors = UDF_READAHEAD_SIZE / instance->sector_size;
+	instance->ra_buf = malloc(instance->ra_sectors * instance->sector_size);
+	
 	fs_node_t *rfn;
 	rc = udf_node_get(&rfn, service_id, instance->volumes[DEFAULT_VOL].root_dir);
 	if (rc != EOK) {
 		log_msg(LOG_DEFAULT, LVL_NOTE, "Can't create root node");
 		fs_instance_destroy(service_id);
+		free(instance->ra_buf);
 		free(instance);
 		block_cache_fini(service_id);
 		block_fini(service_id);
@@ -439,8 +443,10 @@ static int udf_unmounted(service_id_t service_id)
 	 */
 	udf_node_put(fn);
 	udf_node_put(fn);
+	udf_idx_flush(instance);
 	
 	fs_instance_destroy(service_id);
+	free(instance->ra_buf);
 	free(instance);
 	block_cache_fini(service_id);
 	block_fini(service_id);
@@ -484,7 +490,7 @@ static int udf_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 			rc = udf_read_file(&read_len, callid, node, pos, len);
 		else {
 			/* File in allocation descriptors area */
-			read_len = (len < node->data_size) ? len : node->data_size;
+			read_len = min(len, node->data_size - pos);
 			async_data_read_finalize(callid, node->data + pos, read_len);
 			rc = EOK;
 		}
@@ -39,11 +39,14 @@
 #include <str_error.h>
 #include <byteorder.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include <libc.h>
 
 #include <align.h>
 #include <as.h>
 #include <malloc.h>
+#include <mem.h>
+#include <sys/time.h>
 
 #include <atomic.h>
 #include <fibril_synch.h>
@@ -72,6 +75,7 @@
 #include <codec/tga.h>
 
 #include "compositor.h"
+#include "region.h"
 
 #define NAME       "compositor"
 #define NAMESPACE  "comp"
@@ -82,6 +86,16 @@
 #define ANIMATE_WINDOW_TRANSFORMS 0
 #endif
 
+/** Minimal interval between frames composed from client damage (usec). */
+#define FRAME_INTERVAL  16000
+
+/** Number of rectangles the damage pending for the next frame is merged to. */
+#define DAMAGE_MAX_RECTS  8
+
+/** Width of the edge of a scaled window which the filter blends with the
+ * surroundings. */
+#define OPAQUE_MARGIN  2
+
 static char *server_name;
 static sysarg_t coord_origin;
 static pixel_t bg_color;
@@ -112,6 +126,25 @@ static LIST_INITIALIZE(window_list);
 static double scale_back_x;
 static double scale_back_y;
 
+/** Part of a window visible in the area being composed. */
+typedef struct {
+	window_t *win;
+	region_t visible;
+} comp_layer_t;
+
+/** Damage reported by clients, to be composed in the next frame. */
+static FIBRIL_MUTEX_INITIALIZE(damage_mtx);
+static region_t damage_pending;
+static fibril_timer_t *frame_timer;
+static bool frame_pending = false;
+static struct timeval last_frame;
+
+/** Frame statistics, protected by viewport_list_mtx. */
+static struct timeval stats_start;
+static unsigned int stats_frames = 0;
+static suseconds_t stats_frame_time = 0;
+static suseconds_t stats_frame_max = 0;
+
 typedef struct {
 	link_t link;
 	sysarg_t id;
@@ -377,83 +410,267 @@ static void comp_restrict_pointers(void)
 	fibril_mutex_unlock(&pointer_list_mtx);
 }
 
-static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
-    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+/** Paint the viewport background.
+ *
+ * The rectangle is given in global coordinates and must lie within
+ * the viewport.
+ *
+ */
+static void comp_paint_background(viewport_t *vp, sysarg_t x, sysarg_t y,
+    sysarg_t w, sysarg_t h)
 {
-	fibril_mutex_lock(&viewport_list_mtx);
-	fibril_mutex_lock(&window_list_mtx);
-	fibril_mutex_lock(&pointer_list_mtx);
+	pixelmap_t *pixmap = surface_pixmap_access(vp->surface);
+	
+	for (sysarg_t row = 0; row < h; row++) {
+		pixel_t *dst = pixelmap_pixel_at(pixmap, x - vp->pos.x,
+		    y - vp->pos.y + row);
+		sysarg_t count = w;
+		while (count-- != 0)
+			*dst++ = bg_color;
+	}
+	
+	surface_add_damaged_region(vp->surface, x - vp->pos.x, y - vp->pos.y,
+	    w, h);
+}
 
-	list_foreach(viewport_list, link, viewport_t, vp) {
-		/* Determine what part of the viewport must be updated. */
-		sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
-		surface_get_resolution(vp->surface, &w_dmg_vp, &h_dmg_vp);
-		bool isec_vp = rectangle_intersect(
-		    x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob,
-		    vp->pos.x, vp->pos.y, w_dmg_vp, h_dmg_vp,
-		    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
-
-		if (isec_vp) {
-
-			/* Paint background color. */
-			for (sysarg_t y = y_dmg_vp - vp->pos.y; y <  y_dmg_vp - vp->pos.y + h_dmg_vp; ++y) {
-				pixel_t *dst = pixelmap_pixel_at(
-				    surface_pixmap_access(vp->surface), x_dmg_vp - vp->pos.x, y);
-				sysarg_t count = w_dmg_vp;
-				while (count-- != 0) {
-					*dst++ = bg_color;
-				}
-			}
-			surface_add_damaged_region(vp->surface,
-			    x_dmg_vp - vp->pos.x, y_dmg_vp - vp->pos.y, w_dmg_vp, h_dmg_vp);
+/** Determine the part of the desktop hidden by a window.
+ *
+ * Windows which are only translated by whole pixels and have full
+ * opacity are copied to the viewport verbatim, so they hide everything
+ * within their bounding rectangle. Windows scaled along the axes hide
+ * what is underneath them only if the client declared the window
+ * opaque, and only apart from the margin in which the filter blends
+ * the window edge with the transparent surroundings. Rotated windows
+ * are never considered opaque.
+ *
+ * @return True if the window hides the returned rectangle.
+ *
+ */
+static bool comp_window_occluder(window_t *win, sysarg_t *x, sysarg_t *y,
+    sysarg_t *w, sysarg_t *h)
+{
+	if (win->opacity != 255)
+		return false;
+	
+	sysarg_t width, height;
+	surface_get_resolution(win->surface, &width, &height);
+	comp_coord_bounding_rect(0, 0, width, height, win->transform,
+	    x, y, w, h);
+	
+	if (transform_is_fast(&win->transform))
+		return true;
+	
+	if ((win->flags & WINDOW_OPAQUE) == 0)
+		return false;
+	
+	if ((win->transform.matrix[0][1] != 0) ||
+	    (win->transform.matrix[1][0] != 0))
+		return false;
+	
+	if ((*w <= 2 * OPAQUE_MARGIN) || (*h <= 2 * OPAQUE_MARGIN))
+		return false;
+	
+	*x += OPAQUE_MARGIN;
+	*y += OPAQUE_MARGIN;
+	*w -= 2 * OPAQUE_MARGIN;
+	*h -= 2 * OPAQUE_MARGIN;
+	return true;
+}
 
-			transform_t transform;
-			source_t source;
-			drawctx_t context;
+/** Draw a part of a window to the viewport.
+ *
+ * The rectangle is given in global coordinates and must lie within both
+ * the viewport and the bounding rectangle of the window. Windows which
+ * are only translated by whole pixels and have full opacity are copied
+ * row by row, all other windows are resampled.
+ *
+ */
+static void comp_draw_window(viewport_t *vp, drawctx_t *context,
+    source_t *source, window_t *win, sysarg_t x, sysarg_t y,
+    sysarg_t w, sysarg_t h)
+{
+	if ((win->opacity == 255) && (transform_is_fast(&win->transform))) {
+		pixelmap_t *src_pixmap = surface_pixmap_access(win->surface);
+		pixelmap_t *dst_pixmap = surface_pixmap_access(vp->surface);
+		sysarg_t x_win = x -
+		    (sysarg_t) (ssize_t) win->transform.matrix[0][2];
+		sysarg_t y_win = y -
+		    (sysarg_t) (ssize_t) win->transform.matrix[1][2];
+		
+		for (sysarg_t row = 0; row < h; row++) {
+			pixel_t *src = pixelmap_pixel_at(src_pixmap, x_win,
+			    y_win + row);
+			pixel_t *dst = pixelmap_pixel_at(dst_pixmap, x - vp->pos.x,
+			    y - vp->pos.y + row);
+			if ((src != NULL) && (dst != NULL))
+				memcpy(dst, src, w * sizeof(pixel_t));
+		}
+		
+		surface_add_damaged_region(vp->surface, x - vp->pos.x,
+		    y - vp->pos.y, w, h);
+		return;
+	}
+	
+	/* Prepare conversion from global coordinates to viewport
+	 * coordinates. */
+	transform_t transform = win->transform;
+	double_point_t pos;
+	pos.x = vp->pos.x;
+	pos.y = vp->pos.y;
+	transform_translate(&transform, -pos.x, -pos.y);
+	
+	source_set_transform(source, transform);
+	source_set_texture(source, win->surface,
+	    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
+	source_set_alpha(source, PIXEL(win->opacity, 0, 0, 0));
+	
+	drawctx_transfer(context, x - vp->pos.x, y - vp->pos.y, w, h);
+}
 
-			source_init(&source);
-			source_set_filter(&source, filter);
-			drawctx_init(&context, vp->surface);
-			drawctx_set_compose(&context, compose_over);
-			drawctx_set_source(&context, &source);
+/** Draw the background and windows into a damaged part of a viewport.
+ *
+ * Windows are first visited front to back to find out which parts of
+ * each window are not hidden by the windows above it. Windows below
+ * an area which is completely hidden are not visited at all. The
+ * visible parts are then drawn back to front, so that translucent
+ * windows are composed over what is underneath them. If there is not
+ * enough memory for the visibility computation, all windows are drawn.
+ *
+ * The rectangle is given in global coordinates and must lie within
+ * the viewport.
+ *
+ */
+static void comp_compose(viewport_t *vp, sysarg_t x, sysarg_t y,
+    sysarg_t w, sysarg_t h)
+{
+	source_t source;
+	drawctx_t context;
+	
+	source_init(&source);
+	source_set_filter(&source, filter);
+	drawctx_init(&context, vp->surface);
+	drawctx_set_compose(&context, compose_over);
+	drawctx_set_source(&context, &source);
+	
+	size_t count = list_count(&window_list);
+	comp_layer_t *layers = NULL;
+	size_t visited = 0;
+	
+	region_t visible;
+	region_init(&visible);
+	
+	bool culled = (region_add(&visible, x, y, w, h) == EOK);
+	if ((culled) && (count > 0)) {
+		layers = (comp_layer_t *) malloc(count * sizeof(comp_layer_t));
+		culled = (layers != NULL);
+	}
+	
+	if (culled) {
+		/* From the topmost window down. */
+		list_foreach(window_list, link, window_t, win) {
+			if (region_empty(&visible))
+				break;
+			
+			if (!win->surface)
+				continue;
+			
+			sysarg_t x_win, y_win, w_win, h_win;
+			surface_get_resolution(win->surface, &w_win, &h_win);
+			comp_coord_bounding_rect(0, 0, w_win, h_win, win->transform,
+			    &x_win, &y_win, &w_win, &h_win);
+			
+			comp_layer_t *layer = &layers[visited++];
+			layer->win = win;
+			region_init(&layer->visible);
+			
+			if (region_intersect(&layer->visible, &visible,
+			    x_win, y_win, w_win, h_win) != EOK) {
+				culled = false;
+				break;
+			}
+			
+			/* If this fails, the visible region is left larger than
+			 * necessary, which only causes some overdraw. */
+			if (comp_window_occluder(win, &x_win, &y_win, &w_win, &h_win))
+				(void) region_subtract(&visible, x_win, y_win, w_win, h_win);
+		}
+	}
+	
+	if (culled) {
+		for (size_t i = 0; i < visible.count; i++) {
+			region_rect_t *rect = &visible.rects[i];
+			comp_paint_background(vp, rect->x, rect->y, rect->w, rect->h);
+		}
+		
+		for (size_t i = visited; i > 0; i--) {
+			comp_layer_t *layer = &layers[i - 1];
+			
+			for (size_t j = 0; j < layer->visible.count; j++) {
+				region_rect_t *rect = &layer->visible.rects[j];
+				comp_draw_window(vp, &context, &source, layer->win,
+				    rect->x, rect->y, rect->w, rect->h);
+			}
+		}
+	} else {
+		comp_paint_background(vp, x, y, w, h);
+		
+		/* From the bottommost window up. */
+		for (link_t *link = window_list.head.prev;
+		    link != &window_list.head; link = link->prev) {
+			window_t *win = list_get_instance(link, window_t, link);
+			if (!win->surface)
+				continue;
+			
+			sysarg_t x_win, y_win, w_win, h_win;
+			surface_get_resolution(win->surface, &w_win, &h_win);
+			comp_coord_bounding_rect(0, 0, w_win, h_win, win->transform,
+			    &x_win, &y_win, &w_win, &h_win);
+			if (rectangle_intersect(x, y, w, h,
+			    x_win, y_win, w_win, h_win,
+			    &x_win, &y_win, &w_win, &h_win)) {
+				comp_draw_window(vp, &context, &source, win,
+				    x_win, y_win, w_win, h_win);
+			}
+		}
+	}
+	
+	for (size_t i = 0; i < visited; i++)
+		region_fini(&layers[i].visible);
+	
+	free(layers);
+	region_fini(&visible);
+}
 
-			/* For each window. */
-			for (link_t *link = window_list.head.prev;
-			    link != &window_list.head; link = link->prev) {
+/** Compose a frame.
+ *
+ * @param damage Damaged areas of the desktop in global coordinates.
+ *
+ */
+static void comp_render(region_t *damage)
+{
+	struct timeval start;
+	gettimeofday(&start, NULL);
+	
+	fibril_mutex_lock(&viewport_list_mtx);
+	fibril_mutex_lock(&window_list_mtx);
+	fibril_mutex_lock(&pointer_list_mtx);
 
-				/* Determine what part of the window intersects with the
-				 * updated area of the current viewport. */
-				window_t *win = list_get_instance(link, window_t, link);
-				if (!win->surface) {
-					continue;
-				}
-				sysarg_t x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win;
-				surface_get_resolution(win->surface, &w_dmg_win, &h_dmg_win);
-				comp_coord_bounding_rect(0, 0, w_dmg_win, h_dmg_win, win->transform,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-				bool isec_win = rectangle_intersect(
-				    x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp,
-				    x_dmg_win, y_dmg_win, w_dmg_win, h_dmg_win,
-				    &x_dmg_win, &y_dmg_win, &w_dmg_win, &h_dmg_win);
-
-				if (isec_win) {
-					/* Prepare conversion from global coordinates to viewport
-					 * coordinates. */
-					transform = win->transform;
-					double_point_t pos;
-					pos.x = vp->pos.x;
-					pos.y = vp->pos.y;
-					transform_translate(&transform, -pos.x, -pos.y);
-
-					source_set_transform(&source, transform);
-					source_set_texture(&source, win->surface,
-					    PIXELMAP_EXTEND_TRANSPARENT_SIDES);
-					source_set_alpha(&source, PIXEL(win->opacity, 0, 0, 0));
-
-					drawctx_transfer(&context,
-					    x_dmg_win - vp->pos.x, y_dmg_win - vp->pos.y, w_dmg_win, h_dmg_win);
-				}
-			}
+	list_foreach(viewport_list, link, viewport_t, vp) {
+		for (size_t i = 0; i < damage->count; i++) {
+			region_rect_t *rect = &damage->rects[i];
+			
+			/* Determine what part of the viewport must be updated. */
+			sysarg_t x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp;
+			surface_get_resolution(vp->surface, &w_dmg_vp, &h_dmg_vp);
+			bool isec_vp = rectangle_intersect(
+			    rect->x, rect->y, rect->w, rect->h,
+			    vp->pos.x, vp->pos.y, w_dmg_vp, h_dmg_vp,
+			    &x_dmg_vp, &y_dmg_vp, &w_dmg_vp, &h_dmg_vp);
+			
+			if (!isec_vp)
+				continue;
+			
+			comp_compose(vp, x_dmg_vp, y_dmg_vp, w_dmg_vp, h_dmg_vp);
 
 			list_foreach(pointer_list, link, pointer_t, ptr) {
 				if (ptr->ghost.surface) {
@@ -585,6 +802,127 @@ static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
 		}
 	}
 	
+	struct timeval end;
+	gettimeofday(&end, NULL);
+	
+	suseconds_t frame_time = tv_sub_diff(&end, &start);
+	stats_frames++;
+	stats_frame_time += frame_time;
+	if (frame_time > stats_frame_max)
+		stats_frame_max = frame_time;
+	
+	fibril_mutex_unlock(&viewport_list_mtx);
+}
+
+/** Compose a damaged area of the desktop immediately. */
+static void comp_damage(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
+    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+{
+	region_rect_t rect = {
+		.x = x_dmg_glob,
+		.y = y_dmg_glob,
+		.w = w_dmg_glob,
+		.h = h_dmg_glob
+	};
+	
+	region_t damage = {
+		.rects = &rect,
+		.count = 1,
+		.capacity = 1
+	};
+	
+	comp_render(&damage);
+}
+
+/** Compose all damage accumulated since the last frame. */
+static void comp_flush_damage(void)
+{
+	fibril_mutex_lock(&damage_mtx);
+	
+	region_t damage = damage_pending;
+	region_init(&damage_pending);
+	frame_pending = false;
+	gettimeofday(&last_frame, NULL);
+	
+	fibril_mutex_unlock(&damage_mtx);
+	
+	if (!region_empty(&damage))
+		comp_render(&damage);
+	
+	region_fini(&damage);
+}
+
+static void comp_frame_timeout(void *arg)
+{
+	comp_flush_damage();
+}
+
+/** Compose a damaged area of the desktop, at most once per FRAME_INTERVAL.
+ *
+ * Damage reported in the meantime is merged and composed in a single
+ * frame, so that a client updating its window in many small steps does
+ * not cause a frame to be composed for each of them.
+ *
+ */
+static void comp_damage_deferred(sysarg_t x_dmg_glob, sysarg_t y_dmg_glob,
+    sysarg_t w_dmg_glob, sysarg_t h_dmg_glob)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	
+	fibril_mutex_lock(&damage_mtx);
+	
+	int rc = region_merge(&damage_pending, x_dmg_glob, y_dmg_glob,
+	    w_dmg_glob, h_dmg_glob, DAMAGE_MAX_RECTS);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&damage_mtx);
+		comp_damage(x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob);
+		return;
+	}
+	
+	if (frame_pending) {
+		fibril_mutex_unlock(&damage_mtx);
+		return;
+	}
+	
+	suseconds_t elapsed = tv_sub_diff(&now, &last_frame);
+	if ((elapsed < 0) || (elapsed >= FRAME_INTERVAL)) {
+		fibril_mutex_unlock(&damage_mtx);
+		comp_flush_damage();
+		return;
+	}
+	
+	frame_pending = true;
+	fibril_timer_set_locked(frame_timer, FRAME_INTERVAL - elapsed,
+	    comp_frame_timeout, NULL);
+	
+	fibril_mutex_unlock(&damage_mtx);
+}
+
+/** Print and reset the frame statistics. */
+static void comp_stats_report(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	
+	fibril_mutex_lock(&viewport_list_mtx);
+	
+	suseconds_t elapsed = tv_sub_diff(&now, &stats_start);
+	if ((stats_frames > 0) && (elapsed > 0)) {
+		uint64_t fps = (uint64_t) stats_frames * 100000000 / elapsed;
+		
+		printf("%s: %u frames in %ld ms, %" PRIu64 ".%02" PRIu64
+		    " fps, frame time %ld us avg, %ld us max\n", NAME,
+		    stats_frames, elapsed / 1000, fps / 100, fps % 100,
+		    stats_frame_time / stats_frames, stats_frame_max);
+	} else
+		printf("%s: No frames composed\n", NAME);
+	
+	stats_start = now;
+	stats_frames = 0;
+	stats_frame_time = 0;
+	stats_frame_max = 0;
+	
 	fibril_mutex_unlock(&viewport_list_mtx);
 }
 
@@ -620,14 +958,14 @@ static void comp_window_damage(window_t *win, ipc_callid_t iid, ipc_call_t *ical
 	double height = IPC_GET_ARG4(*icall);
 
 	if ((width == 0) || (height == 0)) {
-		comp_damage(0, 0, UINT32_MAX, UINT32_MAX);
+		comp_damage_deferred(0, 0, UINT32_MAX, UINT32_MAX);
 	} else {
 		fibril_mutex_lock(&window_list_mtx);
 		sysarg_t x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob;
 		comp_coord_bounding_rect(x - 1, y - 1, width + 2, height + 2,
 		    win->transform, &x_dmg_glob, &y_dmg_glob, &w_dmg_glob, &h_dmg_glob);
 		fibril_mutex_unlock(&window_list_mtx);
-		comp_damage(x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob);
+		comp_damage_deferred(x_dmg_glob, y_dmg_glob, w_dmg_glob, h_dmg_glob);
 	}
 
 	async_answer_0(iid, EOK);
@@ -1840,10 +2178,11 @@ static int comp_key_press(input_t *input, kbd_event_type_t type, keycode_t key,
 	    key == KC_O || key == KC_P);
 	bool kconsole_switch = (key == KC_PAUSE) || (key == KC_BREAK);
 	bool filter_switch = (mods & KM_ALT) && (key == KC_Y);
+	bool stats_report = (mods & KM_ALT) && (key == KC_U);
 
 	bool key_filter = (type == KEY_RELEASE) && (win_transform || win_resize ||
 	    win_opacity || win_close || win_switch || viewport_move ||
-	    viewport_change || kconsole_switch || filter_switch);
+	    viewport_change || kconsole_switch || filter_switch || stats_report);
 
 	if (key_filter) {
 		/* no-op */
@@ -2115,15 +2454,20 @@ static int comp_key_press(input_t *input, kbd_event_type_t type, keycode_t key,
 			active = false;
 	} else if (filter_switch) {
 		filter_index++;
-		if (filter_index > 1)
+		if (filter_index > 2)
 			filter_index = 0;
 		if (filter_index == 0) {
 			filter = filter_nearest;
 		}
-		else {
+		else if (filter_index == 1) {
 			filter = filter_bilinear;
 		}
+		else {
+			filter = filter_bicubic;
+		}
 		comp_damage(0, 0, UINT32_MAX, UINT32_MAX);
+	} else if (stats_report) {
+		comp_stats_report();
 	} else {
 		window_event_t *event = (window_event_t *) malloc(sizeof(window_event_t));
 		if (event == NULL)
@@ -2258,6 +2602,16 @@ static int compositor_srv_init(char *input_svc, char *name)
 	
 	server_name = name;
 	
+	region_init(&damage_pending);
+	gettimeofday(&last_frame, NULL);
+	stats_start = last_frame;
+	
+	frame_timer = fibril_timer_create(&damage_mtx);
+	if (frame_timer == NULL) {
+		printf("%s: Unable to create frame timer\n", NAME);
+		return ENOMEM;
+	}
+	
 	char svc[LOC_NAME_MAXLEN + 1];
 	snprintf(svc, LOC_NAME_MAXLEN, "%s/%s", NAMESPACE, server_name);
 	
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup compositor
+ * @{
+ */
+/** @file
+ * Rectangle sets used for visibility computation and damage merging.
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <mem.h>
+#include <rectangle.h>
+#include "region.h"
+
+/** Initial number of rectangles allocated for a region. */
+#define REGION_INITIAL_CAPACITY  8
+
+void region_init(region_t *region)
+{
+	region->rects = NULL;
+	region->count = 0;
+	region->capacity = 0;
+}
+
+void region_fini(region_t *region)
+{
+	free(region->rects);
+	region_init(region);
+}
+
+void region_clear(region_t *region)
+{
+	region->count = 0;
+}
+
+bool region_empty(region_t *region)
+{
+	return (region->count == 0);
+}
+
+/** Append a rectangle to the region.
+ *
+ * Empty rectangles are ignored. No attempt is made to coalesce the
+ * rectangle with the rectangles already present.
+ *
+ * @return EOK on success or ENOMEM if out of memory.
+ *
+ */
+int region_add(region_t *region, sysarg_t x, sysarg_t y, sysarg_t w,
+    sysarg_t h)
+{
+	if ((w == 0) || (h == 0))
+		return EOK;
+	
+	if (region->count == region->capacity) {
+		size_t capacity = (region->capacity > 0) ?
+		    2 * region->capacity : REGION_INITIAL_CAPACITY;
+		region_rect_t *rects = (region_rect_t *) realloc(region->rects,
+		    capacity * sizeof(region_rect_t));
+		if (rects == NULL)
+			return ENOMEM;
+		
+		region->rects = rects;
+		region->capacity = capacity;
+	}
+	
+	region_rect_t *rect = &region->rects[region->count++];
+	rect->x = x;
+	rect->y = y;
+	rect->w = w;
+	rect->h = h;
+	
+	return EOK;
+}
+
+/** Remove a rectangle from the region.
+ *
+ * Every rectangle of the region which intersects the subtracted one
+ * is split into at most four pieces (the bands above and below the
+ * intersection and the parts to the left and to the right of it).
+ *
+ * @return EOK on success or ENOMEM if out of memory. In the latter case
+ *         the region is left unchanged.
+ *
+ */
+int region_subtract(region_t *region, sysarg_t x, sysarg_t y, sysarg_t w,
+    sysarg_t h)
+{
+	region_t result;
+	region_init(&result);
+	
+	for (size_t i = 0; i < region->count; i++) {
+		region_rect_t *rect = &region->rects[i];
+		sysarg_t ix, iy, iw, ih;
+		int rc;
+		
+		if (!rectangle_intersect(rect->x, rect->y, rect->w, rect->h,
+		    x, y, w, h, &ix, &iy, &iw, &ih)) {
+			rc = region_add(&result, rect->x, rect->y, rect->w, rect->h);
+		} else {
+			rc = region_add(&result, rect->x, rect->y, rect->w,
+			    iy - rect->y);
+			if (rc == EOK)
+				rc = region_add(&result, rect->x, iy + ih, rect->w,
+				    rect->y + rect->h - iy - ih);
+			if (rc == EOK)
+				rc = region_add(&result, rect->x, iy, ix - rect->x, ih);
+			if (rc == EOK)
+				rc = region_add(&result, ix + iw, iy,
+				    rect->x + rect->w - ix - iw, ih);
+		}
+		
+		if (rc != EOK) {
+			region_fini(&result);
+			return rc;
+		}
+	}
+	
+	free(region->rects);
+	*region = result;
+	return EOK;
+}
+
+/** Append the intersection of a region and a rectangle to another region.
+ *
+ * @param dst    Region to append to.
+ * @param src    Region to intersect.
+ * @param x      Horizontal position of the rectangle.
+ * @param y      Vertical position of the rectangle.
+ * @param w      Width of the rectangle.
+ * @param h      Height of the rectangle.
+ *
+ * @return EOK on success or ENOMEM if out of memory.
+ *
+ */
+int region_intersect(region_t *dst, region_t *src, sysarg_t x, sysarg_t y,
+    sysarg_t w, sysarg_t h)
+{
+	for (size_t i = 0; i < src->count; i++) {
+		region_rect_t *rect = &src->rects[i];
+		sysarg_t ix, iy, iw, ih;
+		
+		if (rectangle_intersect(rect->x, rect->y, rect->w, rect->h,
+		    x, y, w, h, &ix, &iy, &iw, &ih)) {
+			int rc = region_add(dst, ix, iy, iw, ih);
+			if (rc != EOK)
+				return rc;
+		}
+	}
+	
+	return EOK;
+}
+
+/** Add a rectangle to the region, coalescing overlapping rectangles.
+ *
+ * Rectangles of the region which overlap the new rectangle are replaced
+ * by their bounding box. Once the region holds @a max rectangles, the new
+ * rectangle is merged into the rectangle whose area grows the least.
+ *
+ * @return EOK on success or ENOMEM if out of memory.
+ *
+ */
+int region_merge(region_t *region, sysarg_t x, sysarg_t y, sysarg_t w,
+    sysarg_t h, size_t max)
+{
+	if ((w == 0) || (h == 0))
+		return EOK;
+	
+	size_t i = 0;
+	while (i < region->count) {
+		region_rect_t *rect = &region->rects[i];
+		sysarg_t ix, iy, iw, ih;
+		
+		if (rectangle_intersect(rect->x, rect->y, rect->w, rect->h,
+		    x, y, w, h, &ix, &iy, &iw, &ih)) {
+			rectangle_union(rect->x, rect->y, rect->w, rect->h,
+			    x, y, w, h, &x, &y, &w, &h);
+			
+			/* The grown rectangle may overlap rectangles already seen. */
+			region->rects[i] = region->rects[--region->count];
+			i = 0;
+		} else
+			i++;
+	}
+	
+	if ((region->count == 0) || (region->count < max))
+		return region_add(region, x, y, w, h);
+	
+	size_t best = 0;
+	sysarg_t best_growth = 0;
+	
+	for (i = 0; i < region->count; i++) {
+		region_rect_t *rect = &region->rects[i];
+		sysarg_t ux, uy, uw, uh;
+		
+		rectangle_union(rect->x, rect->y, rect->w, rect->h,
+		    x, y, w, h, &ux, &uy, &uw, &uh);
+		sysarg_t growth = uw * uh - rect->w * rect->h;
+		
+		if ((i == 0) || (growth < best_growth)) {
+			best = i;
+			best_growth = growth;
+		}
+	}
+	
+	region_rect_t *rect = &region->rects[best];
+	rectangle_union(rect->x, rect->y, rect->w, rect->h, x, y, w, h,
+	    &rect->x, &rect->y, &rect->w, &rect->h);
+	
+	return EOK;
+}
+
+/** @}
+ */
@@ -50,6 +50,7 @@
 #include <as.h>
 #include <task.h>
 #include <fibril_synch.h>
+#include <sys/time.h>
 #include "console.h"
 
 #define NAME       "console"
@@ -57,6 +58,9 @@
 
 #define UTF8_CHAR_BUFFER_SIZE  (STR_BOUNDS(1) + 1)
 
+/** Minimal interval between two screen updates (in microseconds) */
+#define UPDATE_INTERVAL  20000
+
 typedef struct {
 	atomic_t refcnt;      /**< Connection reference count */
 	prodcons_t input_pc;  /**< Incoming keyboard events */
@@ -79,6 +83,10 @@ typedef struct {
 	chargrid_t *frontbuf;    /**< Front buffer */
 	frontbuf_handle_t fbid;  /**< Front buffer handle */
 	con_srvs_t srvs;         /**< Console service setup */
+	
+	fibril_timer_t *update_timer;  /**< Deferred screen update */
+	bool update_pending;           /**< Deferred update is scheduled */
+	struct timeval last_update;    /**< Time of the last screen update */
 } console_t;
 
 /** Input server proxy */
@@ -166,10 +174,55 @@ static void cons_update(console_t *cons)
 		output_cursor_update(output_sess, cons->fbid);
 	}
 	
+	gettimeofday(&cons->last_update, NULL);
+	
 	fibril_mutex_unlock(&cons->mtx);
 	fibril_mutex_unlock(&switch_mtx);
 }
 
+static void cons_update_timeout(void *arg)
+{
+	console_t *cons = (console_t *) arg;
+	
+	fibril_mutex_lock(&cons->mtx);
+	cons->update_pending = false;
+	fibril_mutex_unlock(&cons->mtx);
+	
+	cons_update(cons);
+}
+
+/** Update the screen, at most once per UPDATE_INTERVAL.
+ *
+ * Changes made to the front buffer in the meantime accumulate
+ * and are sent to the output server in a single update.
+ *
+ */
+static void cons_update_deferred(console_t *cons)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	
+	fibril_mutex_lock(&cons->mtx);
+	
+	if (cons->update_pending) {
+		fibril_mutex_unlock(&cons->mtx);
+		return;
+	}
+	
+	suseconds_t elapsed = tv_sub_diff(&now, &cons->last_update);
+	if ((elapsed < 0) || (elapsed >= UPDATE_INTERVAL)) {
+		fibril_mutex_unlock(&cons->mtx);
+		cons_update(cons);
+		return;
+	}
+	
+	cons->update_pending = true;
+	fibril_timer_set_locked(cons->update_timer, UPDATE_INTERVAL - elapsed,
+	    cons_update_timeout, cons);
+	
+	fibril_mutex_unlock(&cons->mtx);
+}
+
 static void cons_update_cursor(console_t *cons)
 {
 	fibril_mutex_lock(&switch_mtx);
@@ -289,33 +342,28 @@ static int input_ev_button(input_t *input, int bnum, int bpress)
 	return EOK;
 }
 
-/** Process a character from the client (TTY emulation). */
-static void cons_write_char(console_t *cons, wchar_t ch)
+/** Process a character from the client (TTY emulation).
+ *
+ * The front buffer is only modified, the screen is updated
+ * by the caller.
+ *
+ * @return Number of rows which have been affected.
+ *
+ */
+static sysarg_t cons_write_char(console_t *cons, wchar_t ch)
 {
-	sysarg_t updated = 0;
-	
-	fibril_mutex_lock(&cons->mtx);
-	
 	switch (ch) {
 	case '\n':
-		updated = chargrid_newline(cons->frontbuf);
-		break;
+		return chargrid_newline(cons->frontbuf);
 	case '\r':
-		break;
+		return 0;
 	case '\t':
-		updated = chargrid_tabstop(cons->frontbuf, 8);
-		break;
+		return chargrid_tabstop(cons->frontbuf, 8);
 	case '\b':
-		updated = chargrid_backspace(cons->frontbuf);
-		break;
+		return chargrid_backspace(cons->frontbuf);
 	default:
-		updated = chargrid_putchar(cons->frontbuf, ch, true);
+		return chargrid_putchar(cons->frontbuf, ch, true);
 	}
-	
-	fibril_mutex_unlock(&cons->mtx);
-	
-	if (updated > 1)
-		cons_update(cons);
 }
 
 static void cons_set_cursor_vis(console_t *cons, bool visible)
@@ -384,9 +432,24 @@ static int cons_write(con_srv_t *srv, void *data, size_t size)
 {
 	console_t *cons = srv_to_console(srv);
 
+	bool rows_changed = false;
 	size_t off = 0;
-	while (off < size)
-		cons_write_char(cons, str_decode(data, &off, size));
+	
+	fibril_mutex_lock(&cons->mtx);
+	
+	while (off < size) {
+		if (cons_write_char(cons, str_decode(data, &off, size)) > 1)
+			rows_changed = true;
+	}
+	
+	fibril_mutex_unlock(&cons->mtx);
+	
+	/*
+	 * Changes within a single row are only displayed on sync,
+	 * everything else within the next update interval.
+	 */
+	if (rows_changed)
+		cons_update_deferred(cons);
 	
 	return size;
 }
@@ -395,7 +458,7 @@ static void cons_sync(con_srv_t *srv)
 {
 	console_t *cons = srv_to_console(srv);
 	
-	cons_update(cons);
+	cons_update_deferred(cons);
 }
 
 static void cons_clear(con_srv_t *srv)
@@ -612,6 +675,17 @@ static bool console_srv_init(char *input_svc, char *output_svc)
 			prodcons_initialize(&consoles[i].input_pc);
 			consoles[i].char_remains_len = 0;
 			
+			consoles[i].update_timer =
+			    fibril_timer_create(&consoles[i].mtx);
+			if (consoles[i].update_timer == NULL) {
+				printf("%s: Unable to create timer %zu\n", NAME, i);
+				return false;
+			}
+			
+			consoles[i].update_pending = false;
+			consoles[i].last_update.tv_sec = 0;
+			consoles[i].last_update.tv_usec = 0;
+			
 			consoles[i].cols = cols;
 			consoles[i].rows = rows;
 			consoles[i].ccaps = ccaps;
@@ -104,13 +104,21 @@ static void serial_char_update(outdev_t *dev, sysarg_t col, sysarg_t row)
 	draw_char(state, field, col, row);
 }
 
+static void serial_scroll(outdev_t *dev, sysarg_t rows)
+{
+	vt100_state_t *state = (vt100_state_t *) dev->data;
+	
+	vt100_scroll(state, rows);
+}
+
 static outdev_ops_t serial_ops = {
 	.yield = serial_yield,
 	.claim = serial_claim,
 	.get_dimensions = serial_get_dimensions,
 	.get_caps = serial_get_caps,
 	.cursor_update = serial_cursor_update,
-	.char_update = serial_char_update
+	.char_update = serial_char_update,
+	.scroll = serial_scroll
 };
 
 int serial_init(vt100_putchar_t putchar_fn,
@@ -263,7 +263,21 @@ static void srv_set_rgb_color(ipc_callid_t iid, ipc_call_t *icall)
 	async_answer_0(iid, EOK);
 }
 
-static bool srv_update_scroll(outdev_t *dev, chargrid_t *buf)
+/** Update the backbuffer and the device after the front buffer scrolled.
+ *
+ * If allowed and supported by the device, the existing screen contents
+ * are moved and only the rows which scrolled into view are redrawn.
+ * The caller then redraws the remaining dirty characters. Otherwise
+ * the whole screen is compared with the front buffer.
+ *
+ * @param dev  Output device.
+ * @param buf  Front buffer.
+ * @param blit Moving the screen contents is allowed.
+ *
+ * @return True if the device has been completely updated.
+ *
+ */
+static bool srv_update_scroll(outdev_t *dev, chargrid_t *buf, bool blit)
 {
 	assert(dev->ops.char_update);
 	
@@ -272,6 +286,34 @@ static bool srv_update_scroll(outdev_t *dev, chargrid_t *buf)
 	if (dev->top_row == top_row)
 		return false;
 	
+	if ((blit) && (dev->ops.scroll != NULL) &&
+	    (buf->cols == dev->cols) && (buf->rows == dev->rows)) {
+		sysarg_t rows = (top_row + dev->rows - dev->top_row) % dev->rows;
+		
+		dev->top_row = top_row;
+		dev->ops.scroll(dev, rows);
+		
+		/* The backbuffer is cyclic, scroll it the same way. */
+		dev->backbuf->top_row =
+		    (dev->backbuf->top_row + rows) % dev->rows;
+		
+		for (sysarg_t y = dev->rows - rows; y < dev->rows; y++) {
+			for (sysarg_t x = 0; x < dev->cols; x++) {
+				charfield_t *front_field =
+				    chargrid_charfield_at(buf, x, y);
+				charfield_t *back_field =
+				    chargrid_charfield_at(dev->backbuf, x, y);
+				
+				back_field->ch = front_field->ch;
+				back_field->attrs = front_field->attrs;
+				front_field->flags &= ~CHAR_FLAG_DIRTY;
+				dev->ops.char_update(dev, x, y);
+			}
+		}
+		
+		return false;
+	}
+	
 	dev->top_row = top_row;
 	
 	for (sysarg_t y = 0; y < dev->rows; y++) {
@@ -313,7 +355,7 @@ static void srv_update(ipc_callid_t iid, ipc_call_t *icall)
 	list_foreach(outdevs, link, outdev_t, dev) {
 		assert(dev->ops.char_update);
 		
-		if (srv_update_scroll(dev, buf))
+		if (srv_update_scroll(dev, buf, true))
 			continue;
 		
 		for (sysarg_t y = 0; y < dev->rows; y++) {
@@ -360,7 +402,11 @@ static void srv_damage(ipc_callid_t iid, ipc_call_t *icall)
 	list_foreach(outdevs, link, outdev_t, dev) {
 		assert(dev->ops.char_update);
 		
-		if (srv_update_scroll(dev, buf))
+		/*
+		 * Damage follows console switches, the device might
+		 * show a different buffer, so never move the contents.
+		 */
+		if (srv_update_scroll(dev, buf, false))
 			continue;
 		
 		sysarg_t col = IPC_GET_ARG2(*icall);
@@ -51,6 +51,13 @@ typedef struct {
 	void (* cursor_update)(struct outdev *dev, sysarg_t prev_col,
 	    sysarg_t prev_row, sysarg_t col, sysarg_t row, bool visible);
 	void (* char_update)(struct outdev *dev, sysarg_t col, sysarg_t row);
+	
+	/*
+	 * Move the screen contents up by the given number of rows
+	 * (optional). The contents of the rows exposed at the bottom
+	 * are undefined afterwards.
+	 */
+	void (* scroll)(struct outdev *dev, sysarg_t rows);
 } outdev_ops_t;
 
 typedef struct outdev {
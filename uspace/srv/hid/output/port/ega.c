@@ -34,6 +34,7 @@
 #include <align.h>
 #include <as.h>
 #include <ddi.h>
+#include <mem.h>
 #include <io/chargrid.h>
 #include "../output.h"
 #include "ega.h"
@@ -168,13 +169,23 @@ static void ega_char_update(outdev_t *dev, sysarg_t col, sysarg_t row)
 	draw_char(field, col, row);
 }
 
+static void ega_scroll(outdev_t *dev, sysarg_t rows)
+{
+	if (rows >= ega.rows)
+		return;
+	
+	memmove(ega.addr, ega.addr + FB_POS(0, rows),
+	    FB_POS(0, ega.rows - rows));
+}
+
 static outdev_ops_t ega_ops = {
 	.yield = ega_yield,
 	.claim = ega_claim,
 	.get_dimensions = ega_get_dimensions,
 	.get_caps = ega_get_caps,
 	.cursor_update = ega_cursor_update,
-	.char_update = ega_char_update
+	.char_update = ega_char_update,
+	.scroll = ega_scroll
 };
 
 int ega_init(void)
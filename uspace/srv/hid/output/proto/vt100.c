@@ -227,5 +227,31 @@ void vt100_putchar(vt100_state_t *state, wchar_t ch)
 	}
 }
 
+/** Move the screen contents up.
+ *
+ * Line feeds at the bottom of the scrolling region scroll the terminal
+ * by itself, which is much cheaper than redrawing the whole screen.
+ * The scrolling region is set explicitly since the terminal might have
+ * more rows than we use.
+ *
+ * @param state VT100 protocol state.
+ * @param rows  Number of rows to scroll by.
+ *
+ */
+void vt100_scroll(vt100_state_t *state, sysarg_t rows)
+{
+	char control[MAX_CONTROL];
+	
+	snprintf(control, MAX_CONTROL, "\033[1;%" PRIun "r", state->rows);
+	state->control_puts(control);
+	
+	vt100_set_pos(state, 0, state->rows - 1);
+	state->cur_col = 0;
+	state->cur_row = state->rows - 1;
+	
+	for (sysarg_t i = 0; i < rows; i++)
+		state->control_puts("\n");
+}
+
 /** @}
  */
@@ -82,35 +82,6 @@ static int rfb_handle_damage_pixels(visualizer_t *vs,
 		return EINVAL;
 	}
 	
-	/* TODO update surface_t and use it */
-	if (!rfb.damage_valid) {
-		rfb.damage_rect.x = x0;
-		rfb.damage_rect.y = y0;
-		rfb.damage_rect.width = width;
-		rfb.damage_rect.height = height;
-		rfb.damage_valid = true;
-	}
-	else {
-		if (x0 < rfb.damage_rect.x) {
-			rfb.damage_rect.width += rfb.damage_rect.x - x0;
-			rfb.damage_rect.x = x0;
-		}
-		if (y0 < rfb.damage_rect.y) {
-			rfb.damage_rect.height += rfb.damage_rect.y - y0;
-			rfb.damage_rect.y = y0;
-		}
-		sysarg_t x1 = x0 + width;
-		sysarg_t dx1 = rfb.damage_rect.x + rfb.damage_rect.width;
-		if (x1 > dx1) {
-			rfb.damage_rect.width += x1 - dx1;
-		}
-		sysarg_t y1 = y0 + height;
-		sysarg_t dy1 = rfb.damage_rect.y + rfb.damage_rect.height;
-		if (y1 > dy1) {
-			rfb.damage_rect.height += y1 - dy1;
-		}
-	}
-	
 	pixelmap_t *map = &vs->cells;
 	
 	for (sysarg_t y = y0; y < height + y0; ++y) {
@@ -121,6 +92,8 @@ static int rfb_handle_damage_pixels(visualizer_t *vs,
 		}
 	}
 	
+	rfb_damage(&rfb, x0, y0, width, height);
+	
 	fibril_mutex_unlock(&rfb.lock);
 	return EOK;
 }
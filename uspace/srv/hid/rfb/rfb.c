@@ -39,6 +39,8 @@
 #include <byteorder.h>
 #include <macros.h>
 #include <io/log.h>
+#include <deflate.h>
+#include <pixconv.h>
 
 #include "rfb.h"
 
@@ -59,6 +61,26 @@ static char rbuf[BUFFER_SIZE];
 static size_t rbuf_out;
 static size_t rbuf_in;
 
+/** Size of the tiles of the ZRLE encoding */
+#define ZRLE_TILE_SIZE  64
+
+/** Maximal number of colors of a ZRLE palette */
+#define ZRLE_MAX_PALETTE  127
+
+/** Header of the ZRLE zlib stream (deflate, 32 KiB window) */
+#define ZLIB_HEADER_CMF   0x78
+#define ZLIB_HEADER_FLG   0x01
+#define ZLIB_HEADER_SIZE  2
+
+/** Minimal number of moved rows sent as CopyRect */
+#define COPYRECT_MIN_ROWS  RFB_DAMAGE_TILE_SIZE
+
+/** Maximal number of scroll offsets tried when looking for moved rows */
+#define COPYRECT_MAX_CANDIDATES  8
+
+/** Time to wait for damage requested by an incremental update (usec) */
+#define UPDATE_TIMEOUT  1000000
+
 
 /** Receive one character (with buffering) */
 static int recv_char(tcp_conn_t *conn, char *c)
@@ -135,7 +157,7 @@ static void rfb_framebuffer_update_request_to_host(rfb_framebuffer_update_reques
     rfb_framebuffer_update_request_t *dst)
 {
 	dst->x = uint16_t_be2host(src->x);
-	dst->y = uint16_t_be2host(src->x);
+	dst->y = uint16_t_be2host(src->y);
 	dst->width = uint16_t_be2host(src->width);
 	dst->height = uint16_t_be2host(src->height);
 }
@@ -176,6 +198,7 @@ int rfb_init(rfb_t *rfb, uint16_t width, uint16_t height, const char *name)
 {
 	memset(rfb, 0, sizeof(rfb_t));
 	fibril_mutex_initialize(&rfb->lock);
+	fibril_condvar_initialize(&rfb->damage_cv);
 	
 	rfb_pixel_format_t *pf = &rfb->pixel_format;
 	pf->bpp = 32;
@@ -190,7 +213,6 @@ int rfb_init(rfb_t *rfb, uint16_t width, uint16_t height, const char *name)
 	pf->b_shift = 16;
 	
 	rfb->name = str_dup(name);
-	rfb->supports_trle = false;
 	
 	return rfb_set_size(rfb, width, height);
 }
@@ -198,9 +220,20 @@ int rfb_init(rfb_t *rfb, uint16_t width, uint16_t height, const char *name)
 int rfb_set_size(rfb_t *rfb, uint16_t width, uint16_t height)
 {
 	size_t new_size = width * height * sizeof(pixel_t);
+	size_t damage_cols = (width + RFB_DAMAGE_TILE_SIZE - 1) /
+	    RFB_DAMAGE_TILE_SIZE;
+	size_t damage_rows = (height + RFB_DAMAGE_TILE_SIZE - 1) /
+	    RFB_DAMAGE_TILE_SIZE;
+	
 	void *pixbuf = malloc(new_size);
-	if (pixbuf == NULL)
+	void *shadowbuf = malloc(new_size);
+	uint8_t *damage = malloc(damage_cols * damage_rows);
+	if (pixbuf == NULL || shadowbuf == NULL || damage == NULL) {
+		free(pixbuf);
+		free(shadowbuf);
+		free(damage);
 		return ENOMEM;
+	}
 
 	free(rfb->framebuffer.data);
 	rfb->framebuffer.data = pixbuf;
@@ -209,12 +242,58 @@ int rfb_set_size(rfb_t *rfb, uint16_t width, uint16_t height)
 	rfb->width = width;
 	rfb->height = height;
 	
+	free(rfb->shadow.data);
+	rfb->shadow.data = shadowbuf;
+	rfb->shadow.width = width;
+	rfb->shadow.height = height;
+	rfb->shadow_valid = false;
+	
+	free(rfb->damage);
+	rfb->damage = damage;
+	rfb->damage_cols = damage_cols;
+	rfb->damage_rows = damage_rows;
+	
 	/* Fill with white */
 	memset(rfb->framebuffer.data, 255, new_size);
+	rfb_damage(rfb, 0, 0, width, height);
 	
 	return EOK;
 }
 
+/** Mark a framebuffer region as damaged
+ *
+ * The damaged tiles are sent to the client with the next framebuffer
+ * update. The caller is expected to hold rfb->lock.
+ *
+ * @param rfb    RFB server.
+ * @param x      Left edge of the damaged region.
+ * @param y      Top edge of the damaged region.
+ * @param width  Width of the damaged region.
+ * @param height Height of the damaged region.
+ *
+ */
+void rfb_damage(rfb_t *rfb, sysarg_t x, sysarg_t y, sysarg_t width,
+    sysarg_t height)
+{
+	if (width == 0 || height == 0 || x >= rfb->width || y >= rfb->height)
+		return;
+	
+	sysarg_t col0 = x / RFB_DAMAGE_TILE_SIZE;
+	sysarg_t col1 = min(x + width - 1, (sysarg_t) rfb->width - 1) /
+	    RFB_DAMAGE_TILE_SIZE;
+	sysarg_t row0 = y / RFB_DAMAGE_TILE_SIZE;
+	sysarg_t row1 = min(y + height - 1, (sysarg_t) rfb->height - 1) /
+	    RFB_DAMAGE_TILE_SIZE;
+	
+	for (sysarg_t row = row0; row <= row1; row++) {
+		memset(rfb->damage + row * rfb->damage_cols + col0, 1,
+		    col1 - col0 + 1);
+	}
+	
+	rfb->damage_valid = true;
+	fibril_condvar_broadcast(&rfb->damage_cv);
+}
+
 static int recv_message(tcp_conn_t *conn, char type, void *buf, size_t size)
 {
 	memcpy(buf, &type, 1);
@@ -297,6 +376,43 @@ static void rfb_encode_pixel(rfb_t *rfb, void *buf, pixel_t pixel)
 	}
 }
 
+/** Find a pixel converter producing the client pixel format.
+ *
+ * Only true color formats with 8-bit channels correspond to a visual,
+ * other formats are encoded pixel by pixel.
+ *
+ * @param pf   Client pixel format.
+ * @param size Size of an encoded pixel (3 for compressed 32-bit pixels).
+ *
+ * @return Pixel converter or NULL if there is none for the format.
+ *
+ */
+static const pixconv_t *rfb_pixconv_get(rfb_pixel_format_t *pf, size_t size)
+{
+	if ((!pf->true_color) || (pf->bpp != 32) || (pf->r_max != 255) ||
+	    (pf->g_max != 255) || (pf->b_max != 255) || (pf->g_shift != 8))
+		return NULL;
+	
+	/* Red is the most significant channel */
+	bool rgb;
+	if ((pf->r_shift == 16) && (pf->b_shift == 0))
+		rgb = true;
+	else if ((pf->r_shift == 0) && (pf->b_shift == 16))
+		rgb = false;
+	else
+		return NULL;
+	
+	visual_t visual;
+	if (size == 3)
+		visual = (rgb != pf->big_endian) ? VISUAL_BGR_8_8_8 : VISUAL_RGB_8_8_8;
+	else if (pf->big_endian)
+		visual = rgb ? VISUAL_RGB_0_8_8_8 : VISUAL_BGR_0_8_8_8;
+	else
+		visual = rgb ? VISUAL_BGR_8_8_8_0 : VISUAL_RGB_8_8_8_0;
+	
+	return pixconv_get(visual);
+}
+
 static void rfb_set_color_map_entries_to_be(rfb_set_color_map_entries_t *src,
     rfb_set_color_map_entries_t *dst)
 {
@@ -350,6 +466,15 @@ static size_t rfb_rect_encode_raw(rfb_t *rfb, rfb_rectangle_t *rect, void *buf)
 	if (buf == NULL)
 		return size;
 	
+	const pixconv_t *conv = rfb_pixconv_get(&rfb->pixel_format, pixel_size);
+	if (conv != NULL) {
+		pixelmap_t *fb = &rfb->framebuffer;
+		pixconv_rect(conv, buf, rect->width * pixel_size,
+		    fb->data + rect->y * fb->width + rect->x, fb->width,
+		    rect->width, rect->height);
+		return size;
+	}
+	
 	for (uint16_t y = 0; y < rect->height; y++) {
 		for (uint16_t x = 0; x < rect->width; x++) {
 			pixel_t pixel = pixelmap_get_pixel(&rfb->framebuffer,
@@ -369,6 +494,8 @@ typedef enum {
 typedef struct {
 	size_t size;
 	cpixel_compress_type_t compress_type;
+	/** Row converter for the pixel format or NULL */
+	const pixconv_t *conv;
 } cpixel_ctx_t;
 
 static void cpixel_context_init(cpixel_ctx_t *ctx, rfb_pixel_format_t *pixel_format)
@@ -399,6 +526,8 @@ static void cpixel_context_init(cpixel_ctx_t *ctx, rfb_pixel_format_t *pixel_for
 			ctx->size = 3;
 		}
 	}
+	
+	ctx->conv = rfb_pixconv_get(pixel_format, ctx->size);
 }
 
 static void cpixel_encode(rfb_t *rfb, cpixel_ctx_t *cpixel, void *buf,
@@ -417,6 +546,21 @@ static void cpixel_encode(rfb_t *rfb, cpixel_ctx_t *cpixel, void *buf,
 	}
 }
 
+/** Encode a row of compressed pixels. */
+static void cpixel_encode_row(rfb_t *rfb, cpixel_ctx_t *cpixel, void *buf,
+    const pixel_t *row, size_t count)
+{
+	if (cpixel->conv != NULL) {
+		cpixel->conv->pixel2visual_row(buf, row, count);
+		return;
+	}
+	
+	for (size_t x = 0; x < count; x++) {
+		cpixel_encode(rfb, cpixel, buf, row[x]);
+		buf += cpixel->size;
+	}
+}
+
 static ssize_t rfb_tile_encode_raw(rfb_t *rfb, cpixel_ctx_t *cpixel,
     rfb_rectangle_t *tile, void *buf)
 {
@@ -424,11 +568,13 @@ static ssize_t rfb_tile_encode_raw(rfb_t *rfb, cpixel_ctx_t *cpixel,
 	if (buf == NULL)
 		return size;
 	
-	for (uint16_t y = tile->y; y < tile->y + tile->height; y++) {
-		for (uint16_t x = tile->x; x < tile->x + tile->width; x++) {
-			pixel_t pixel = pixelmap_get_pixel(&rfb->framebuffer, x, y);
-			cpixel_encode(rfb, cpixel, buf, pixel);
-		}
+	pixelmap_t *fb = &rfb->framebuffer;
+	const pixel_t *row = fb->data + tile->y * fb->width + tile->x;
+	
+	for (uint16_t y = 0; y < tile->height; y++) {
+		cpixel_encode_row(rfb, cpixel, buf, row, tile->width);
+		buf += tile->width * cpixel->size;
+		row += fb->width;
 	}
 	
 	return size;
@@ -461,8 +607,8 @@ static size_t rfb_rect_encode_trle(rfb_t *rfb, rfb_rectangle_t *rect, void *buf)
 	for (uint16_t y = 0; y < rect->height; y += 16) {
 		for (uint16_t x = 0; x < rect->width; x += 16) {
 			rfb_rectangle_t tile = {
-				.x = x,
-				.y = y,
+				.x = rect->x + x,
+				.y = rect->y + y,
 				.width = (x + 16 <= rect->width ? 16 : rect->width - x),
 				.height = (y + 16 <= rect->height ? 16 : rect->height - y)
 			};
@@ -479,6 +625,7 @@ static size_t rfb_rect_encode_trle(rfb_t *rfb, rfb_rectangle_t *rect, void *buf)
 				tile_enctype = RFB_TILE_ENCODING_RAW;
 			}
 			
+			size += tile_size;
 			if (buf) {
 				*tile_enctype_ptr = tile_enctype;
 				buf += tile_size;
@@ -488,54 +635,790 @@ static size_t rfb_rect_encode_trle(rfb_t *rfb, rfb_rectangle_t *rect, void *buf)
 	return size;
 }
 
-static int rfb_send_framebuffer_update(rfb_t *rfb, tcp_conn_t *conn,
-    bool incremental)
+/** Palette of a ZRLE tile */
+typedef struct {
+	pixel_t colors[ZRLE_MAX_PALETTE];
+	size_t count;
+	/** The tile has more colors than fit into the palette */
+	bool overflow;
+	/** Open addressing hash of palette indices (plus one) */
+	uint8_t slots[256];
+} zrle_palette_t;
+
+/** Result of the analysis of a ZRLE tile */
+typedef struct {
+	zrle_palette_t palette;
+	/** Size of the tile in plain RLE subencoding */
+	size_t plain_rle_size;
+	/** Size of the runs in palette RLE subencoding */
+	size_t palette_rle_size;
+} zrle_tile_info_t;
+
+static void zrle_palette_init(zrle_palette_t *palette)
 {
-	fibril_mutex_lock(&rfb->lock);
-	if (!incremental || !rfb->damage_valid) {
-		rfb->damage_rect.x = 0;
-		rfb->damage_rect.y = 0;
-		rfb->damage_rect.width = rfb->width;
-		rfb->damage_rect.height = rfb->height;
+	palette->count = 0;
+	palette->overflow = false;
+	memset(palette->slots, 0, sizeof(palette->slots));
+}
+
+/** Find the palette index of a color, add the color if it is missing
+ *
+ * @return Palette index or -1 if the palette is full.
+ *
+ */
+static int zrle_palette_index(zrle_palette_t *palette, pixel_t pixel)
+{
+	size_t slot = (pixel * UINT32_C(2654435761)) >> 24;
+	
+	while (palette->slots[slot] != 0) {
+		uint8_t index = palette->slots[slot] - 1;
+		if (palette->colors[index] == pixel)
+			return index;
+		
+		slot = (slot + 1) % 256;
+	}
+	
+	if (palette->count == ZRLE_MAX_PALETTE) {
+		palette->overflow = true;
+		return -1;
+	}
+	
+	palette->colors[palette->count] = pixel;
+	palette->slots[slot] = palette->count + 1;
+	return palette->count++;
+}
+
+/** Number of bytes encoding a ZRLE run length */
+static size_t zrle_run_length_size(size_t length)
+{
+	return (length - 1) / 255 + 1;
+}
+
+static void zrle_tile_add_run(zrle_tile_info_t *info, cpixel_ctx_t *cpixel,
+    size_t length)
+{
+	info->plain_rle_size += cpixel->size + zrle_run_length_size(length);
+	info->palette_rle_size += (length == 1) ?
+	    1 : 1 + zrle_run_length_size(length);
+}
+
+/** Collect the palette and the runs of a ZRLE tile
+ *
+ * Rows are compared with the previous row first. Repeated rows cannot
+ * contain new colors and repeated uniform rows just extend the current
+ * run, so only the rows which differ are scanned pixel by pixel.
+ *
+ */
+static void zrle_tile_analyze(rfb_t *rfb, cpixel_ctx_t *cpixel,
+    rfb_rectangle_t *tile, zrle_tile_info_t *info)
+{
+	pixelmap_t *fb = &rfb->framebuffer;
+	const pixel_t *row = fb->data + tile->y * fb->width + tile->x;
+	const pixel_t *prev = NULL;
+	size_t row_size = tile->width * sizeof(pixel_t);
+	
+	zrle_palette_init(&info->palette);
+	info->plain_rle_size = 0;
+	info->palette_rle_size = 0;
+	
+	pixel_t run_pixel = row[0];
+	size_t run_length = 0;
+	bool uniform = true;
+	
+	zrle_palette_index(&info->palette, run_pixel);
+	
+	for (uint16_t y = 0; y < tile->height; y++) {
+		bool repeated = (prev != NULL) && (memcmp(row, prev, row_size) == 0);
+		
+		if (repeated && uniform) {
+			run_length += tile->width;
+		} else {
+			if (!repeated)
+				uniform = true;
+			
+			for (uint16_t x = 0; x < tile->width; x++) {
+				if (row[x] == run_pixel) {
+					run_length++;
+					continue;
+				}
+				
+				zrle_tile_add_run(info, cpixel, run_length);
+				run_pixel = row[x];
+				run_length = 1;
+				
+				if (!repeated) {
+					zrle_palette_index(&info->palette, run_pixel);
+					if (x > 0)
+						uniform = false;
+				}
+			}
+		}
+		
+		prev = row;
+		row += fb->width;
+	}
+	
+	zrle_tile_add_run(info, cpixel, run_length);
+}
+
+static uint8_t *zrle_put_run_length(uint8_t *buf, size_t length)
+{
+	length--;
+	while (length >= 255) {
+		*buf++ = 255;
+		length -= 255;
+	}
+	
+	*buf++ = length;
+	return buf;
+}
+
+static uint8_t *zrle_put_palette(rfb_t *rfb, cpixel_ctx_t *cpixel,
+    zrle_palette_t *palette, uint8_t *buf)
+{
+	for (size_t i = 0; i < palette->count; i++) {
+		cpixel_encode(rfb, cpixel, buf, palette->colors[i]);
+		buf += cpixel->size;
+	}
+	
+	return buf;
+}
+
+static uint8_t *zrle_put_run(rfb_t *rfb, cpixel_ctx_t *cpixel,
+    zrle_palette_t *palette, uint8_t *buf, pixel_t pixel, size_t length)
+{
+	if (palette == NULL) {
+		cpixel_encode(rfb, cpixel, buf, pixel);
+		return zrle_put_run_length(buf + cpixel->size, length);
+	}
+	
+	uint8_t index = zrle_palette_index(palette, pixel);
+	if (length == 1) {
+		*buf++ = index;
+		return buf;
+	}
+	
+	*buf++ = index | 128;
+	return zrle_put_run_length(buf, length);
+}
+
+/** Encode a ZRLE tile using the smallest subencoding
+ *
+ * @return Size of the encoded tile.
+ *
+ */
+static size_t zrle_tile_encode(rfb_t *rfb, cpixel_ctx_t *cpixel,
+    rfb_rectangle_t *tile, uint8_t *buf)
+{
+	zrle_tile_info_t info;
+	zrle_tile_analyze(rfb, cpixel, tile, &info);
+	
+	zrle_palette_t *palette = &info.palette;
+	size_t palette_size = palette->count * cpixel->size;
+	
+	uint8_t subencoding = RFB_TILE_ENCODING_RAW;
+	size_t best_size = tile->width * tile->height * cpixel->size;
+	size_t bits = 0;
+	
+	if (info.plain_rle_size < best_size) {
+		subencoding = RFB_TILE_ENCODING_PLAIN_RLE;
+		best_size = info.plain_rle_size;
+	}
+	
+	if (!palette->overflow) {
+		if (palette->count == 1) {
+			subencoding = RFB_TILE_ENCODING_SOLID;
+			best_size = cpixel->size;
+		} else if (palette->count <= 16) {
+			size_t packed_bits = (palette->count <= 2) ? 1 :
+			    ((palette->count <= 4) ? 2 : 4);
+			size_t packed_size = palette_size + tile->height *
+			    ((tile->width * packed_bits + 7) / 8);
+			
+			if (packed_size < best_size) {
+				subencoding = palette->count;
+				best_size = packed_size;
+				bits = packed_bits;
+			}
+		}
+		
+		if ((palette->count > 1) &&
+		    (palette_size + info.palette_rle_size < best_size)) {
+			subencoding = RFB_TILE_ENCODING_PLAIN_RLE + palette->count;
+			best_size = palette_size + info.palette_rle_size;
+		}
+	}
+	
+	pixelmap_t *fb = &rfb->framebuffer;
+	const pixel_t *row = fb->data + tile->y * fb->width + tile->x;
+	uint8_t *pos = buf;
+	
+	*pos++ = subencoding;
+	
+	if (subencoding == RFB_TILE_ENCODING_RAW) {
+		for (uint16_t y = 0; y < tile->height; y++) {
+			cpixel_encode_row(rfb, cpixel, pos, row, tile->width);
+			pos += tile->width * cpixel->size;
+			row += fb->width;
+		}
+	} else if (subencoding == RFB_TILE_ENCODING_SOLID) {
+		cpixel_encode(rfb, cpixel, pos, row[0]);
+		pos += cpixel->size;
+	} else if (subencoding <= 16) {
+		pos = zrle_put_palette(rfb, cpixel, palette, pos);
+		
+		for (uint16_t y = 0; y < tile->height; y++) {
+			uint8_t byte = 0;
+			size_t nbits = 0;
+			
+			for (uint16_t x = 0; x < tile->width; x++) {
+				byte = (byte << bits) | zrle_palette_index(palette, row[x]);
+				nbits += bits;
+				if (nbits == 8) {
+					*pos++ = byte;
+					byte = 0;
+					nbits = 0;
+				}
+			}
+			
+			if (nbits > 0)
+				*pos++ = byte << (8 - nbits);
+			
+			row += fb->width;
+		}
+	} else {
+		zrle_palette_t *run_palette = NULL;
+		if (subencoding > RFB_TILE_ENCODING_PLAIN_RLE) {
+			pos = zrle_put_palette(rfb, cpixel, palette, pos);
+			run_palette = palette;
+		}
+		
+		pixel_t run_pixel = row[0];
+		size_t run_length = 0;
+		
+		for (uint16_t y = 0; y < tile->height; y++) {
+			for (uint16_t x = 0; x < tile->width; x++) {
+				if (row[x] == run_pixel) {
+					run_length++;
+					continue;
+				}
+				
+				pos = zrle_put_run(rfb, cpixel, run_palette, pos,
+				    run_pixel, run_length);
+				run_pixel = row[x];
+				run_length = 1;
+			}
+			
+			row += fb->width;
+		}
+		
+		pos = zrle_put_run(rfb, cpixel, run_palette, pos, run_pixel,
+		    run_length);
+	}
+	
+	return pos - buf;
+}
+
+/** Encode a rectangle using ZRLE
+ *
+ * The tiles are encoded into a temporary buffer which is then compressed
+ * into the common zlib stream of the connection.
+ *
+ * @param rfb  RFB server.
+ * @param rect Rectangle to encode.
+ * @param buf  Output buffer or NULL to compute the maximal size.
+ * @param size Place to store the (maximal) encoded size.
+ *
+ * @return EOK on success or an error code.
+ *
+ */
+static int rfb_rect_encode_zrle(rfb_t *rfb, rfb_rectangle_t *rect, void *buf,
+    size_t *size)
+{
+	cpixel_ctx_t cpixel;
+	cpixel_context_init(&cpixel, &rfb->pixel_format);
+	
+	size_t tiles =
+	    ((rect->width + ZRLE_TILE_SIZE - 1) / ZRLE_TILE_SIZE) *
+	    ((rect->height + ZRLE_TILE_SIZE - 1) / ZRLE_TILE_SIZE);
+	size_t data_size = tiles + rect->width * rect->height * cpixel.size;
+	size_t max_size = sizeof(uint32_t) + ZLIB_HEADER_SIZE +
+	    deflate_bound(data_size);
+	
+	if (buf == NULL) {
+		*size = max_size;
+		return EOK;
+	}
+	
+	uint8_t *data = malloc(data_size);
+	if (data == NULL)
+		return ENOMEM;
+	
+	uint8_t *pos = data;
+	for (uint16_t y = 0; y < rect->height; y += ZRLE_TILE_SIZE) {
+		for (uint16_t x = 0; x < rect->width; x += ZRLE_TILE_SIZE) {
+			rfb_rectangle_t tile = {
+				.x = rect->x + x,
+				.y = rect->y + y,
+				.width = min(ZRLE_TILE_SIZE, rect->width - x),
+				.height = min(ZRLE_TILE_SIZE, rect->height - y)
+			};
+			
+			pos += zrle_tile_encode(rfb, &cpixel, &tile, pos);
+		}
+	}
+	
+	uint8_t *zdata = (uint8_t *) buf + sizeof(uint32_t);
+	size_t zsize = 0;
+	
+	if (!rfb->zrle_started) {
+		zdata[0] = ZLIB_HEADER_CMF;
+		zdata[1] = ZLIB_HEADER_FLG;
+		zsize = ZLIB_HEADER_SIZE;
+	}
+	
+	size_t dsize;
+	int rc = deflate(data, pos - data, zdata + zsize,
+	    max_size - sizeof(uint32_t) - zsize, &dsize, false);
+	free(data);
+	
+	if (rc != EOK)
+		return rc;
+	
+	zsize += dsize;
+	rfb->zrle_started = true;
+	
+	uint32_t length = host2uint32_t_be(zsize);
+	memcpy(buf, &length, sizeof(uint32_t));
+	
+	*size = sizeof(uint32_t) + zsize;
+	return EOK;
+}
+
+static uint32_t rfb_row_hash(const pixel_t *row, size_t count)
+{
+	uint32_t hash = 0;
+	for (size_t i = 0; i < count; i++)
+		hash = hash * 31 + row[i];
+	
+	return hash;
+}
+
+/** Range of framebuffer columns and rows */
+typedef struct {
+	sysarg_t x0;
+	sysarg_t x1;
+	sysarg_t y0;
+	sysarg_t y1;
+} rfb_span_t;
+
+/** Find content moved vertically since the last update
+ *
+ * Looks for the longest run of rows of the damaged span whose contents
+ * appear in the shadow framebuffer at a constant vertical offset, such
+ * as a scrolled terminal window. Candidate offsets are found by matching
+ * the hash of the first changed non-uniform row against the hashes of
+ * the rows of the shadow framebuffer.
+ *
+ * @param rfb   RFB server.
+ * @param span  Damaged span.
+ * @param dst_y Place to store the first row of the moved content.
+ * @param src_y Place to store the first row of its previous location.
+ *
+ * @return Number of moved rows or zero.
+ *
+ */
+static sysarg_t rfb_find_scroll(rfb_t *rfb, rfb_span_t *span, sysarg_t *dst_y,
+    sysarg_t *src_y)
+{
+	sysarg_t stride = rfb->width;
+	sysarg_t count = span->x1 - span->x0;
+	size_t row_size = count * sizeof(pixel_t);
+	
+	uint32_t *hashes = malloc(2 * rfb->height * sizeof(uint32_t));
+	if (hashes == NULL)
+		return 0;
+	
+	uint32_t *fb_hash = hashes;
+	uint32_t *shadow_hash = hashes + rfb->height;
+	const pixel_t *fb = rfb->framebuffer.data + span->x0;
+	const pixel_t *shadow = rfb->shadow.data + span->x0;
+	
+	for (sysarg_t y = span->y0; y < span->y1; y++) {
+		fb_hash[y] = rfb_row_hash(fb + y * stride, count);
+		shadow_hash[y] = rfb_row_hash(shadow + y * stride, count);
+	}
+	
+	sysarg_t ref;
+	for (ref = span->y0; ref < span->y1; ref++) {
+		if (fb_hash[ref] == shadow_hash[ref])
+			continue;
+		
+		const pixel_t *row = fb + ref * stride;
+		sysarg_t x = 1;
+		while ((x < count) && (row[x] == row[0]))
+			x++;
+		
+		if (x < count)
+			break;
+	}
+	
+	sysarg_t best = 0;
+	size_t candidates = 0;
+	
+	for (sysarg_t src = span->y0; (ref < span->y1) && (src < span->y1) &&
+	    (candidates < COPYRECT_MAX_CANDIDATES); src++) {
+		if ((src == ref) || (shadow_hash[src] != fb_hash[ref]))
+			continue;
+		
+		candidates++;
+		
+		/* Extend the match from the reference row in both directions */
+		sysarg_t top = ref;
+		sysarg_t bottom = ref;
+		sysarg_t stop = span->y1 - max(ref, src);
+		
+		while (bottom - ref < stop) {
+			sysarg_t s = src + (bottom - ref);
+			if ((fb_hash[bottom] != shadow_hash[s]) ||
+			    (memcmp(fb + bottom * stride, shadow + s * stride,
+			    row_size) != 0))
+				break;
+			
+			bottom++;
+		}
+		
+		if (bottom == ref)
+			continue;
+		
+		while (top > span->y0 && src - (ref - top) > span->y0) {
+			sysarg_t s = src - (ref - top) - 1;
+			if ((fb_hash[top - 1] != shadow_hash[s]) ||
+			    (memcmp(fb + (top - 1) * stride, shadow + s * stride,
+			    row_size) != 0))
+				break;
+			
+			top--;
+		}
+		
+		if (bottom - top > best) {
+			best = bottom - top;
+			*dst_y = top;
+			*src_y = src - (ref - top);
+		}
+	}
+	
+	free(hashes);
+	return (best >= COPYRECT_MIN_ROWS) ? best : 0;
+}
+
+/** Move a rectangle of the shadow framebuffer */
+static void rfb_shadow_copy(rfb_t *rfb, rfb_rectangle_t *rect,
+    rfb_copy_rect_t *copy)
+{
+	pixel_t *shadow = rfb->shadow.data;
+	sysarg_t stride = rfb->width;
+	size_t row_size = rect->width * sizeof(pixel_t);
+	
+	for (uint16_t i = 0; i < rect->height; i++) {
+		/* Do not overwrite source rows which have not been copied yet */
+		uint16_t y = (rect->y < copy->src_y) ? i : rect->height - 1 - i;
+		
+		memcpy(shadow + (rect->y + y) * stride + rect->x,
+		    shadow + (copy->src_y + y) * stride + copy->src_x, row_size);
+	}
+}
+
+/** Update a rectangle of the shadow framebuffer from the framebuffer */
+static void rfb_shadow_update(rfb_t *rfb, rfb_rectangle_t *rect)
+{
+	sysarg_t stride = rfb->width;
+	size_t row_size = rect->width * sizeof(pixel_t);
+	
+	for (uint16_t y = rect->y; y < rect->y + rect->height; y++) {
+		memcpy(rfb->shadow.data + y * stride + rect->x,
+		    rfb->framebuffer.data + y * stride + rect->x, row_size);
+	}
+}
+
+/** Check whether a tile differs from the shadow framebuffer */
+static bool rfb_tile_changed(rfb_t *rfb, sysarg_t col, sysarg_t row)
+{
+	sysarg_t x = col * RFB_DAMAGE_TILE_SIZE;
+	sysarg_t y0 = row * RFB_DAMAGE_TILE_SIZE;
+	sysarg_t y1 = min(y0 + RFB_DAMAGE_TILE_SIZE, (sysarg_t) rfb->height);
+	size_t row_size = min(RFB_DAMAGE_TILE_SIZE, rfb->width - x) *
+	    sizeof(pixel_t);
+	
+	for (sysarg_t y = y0; y < y1; y++) {
+		size_t offset = y * rfb->width + x;
+		if (memcmp(rfb->framebuffer.data + offset,
+		    rfb->shadow.data + offset, row_size) != 0)
+			return true;
+	}
+	
+	return false;
+}
+
+/** Add a run of changed tiles to the rectangles of an update
+ *
+ * The run is merged with a rectangle ending right above it if
+ * the rectangle covers the same columns.
+ *
+ */
+static void rfb_add_rect(rfb_t *rfb, rfb_rectangle_t *rects, size_t *count,
+    sysarg_t col0, sysarg_t col1, sysarg_t row)
+{
+	uint16_t x = col0 * RFB_DAMAGE_TILE_SIZE;
+	uint16_t y = row * RFB_DAMAGE_TILE_SIZE;
+	uint16_t width = min(col1 * RFB_DAMAGE_TILE_SIZE, (sysarg_t) rfb->width) - x;
+	uint16_t height = min(y + RFB_DAMAGE_TILE_SIZE, rfb->height) - y;
+	
+	for (size_t i = 0; i < *count; i++) {
+		if ((rects[i].x == x) && (rects[i].width == width) &&
+		    (rects[i].y + rects[i].height == y)) {
+			rects[i].height += height;
+			return;
+		}
+	}
+	
+	rects[*count].x = x;
+	rects[*count].y = y;
+	rects[*count].width = width;
+	rects[*count].height = height;
+	(*count)++;
+}
+
+/** Collect the damaged tiles which differ from what the client has
+ *
+ * @return Number of rectangles stored to @a rects.
+ *
+ */
+static size_t rfb_collect_damage(rfb_t *rfb, rfb_rectangle_t *rects)
+{
+	size_t count = 0;
+	
+	for (sysarg_t row = 0; row < rfb->damage_rows; row++) {
+		uint8_t *damage = rfb->damage + row * rfb->damage_cols;
+		sysarg_t run = 0;
+		bool in_run = false;
+		
+		for (sysarg_t col = 0; col < rfb->damage_cols; col++) {
+			bool changed = damage[col] &&
+			    (!rfb->shadow_valid || rfb_tile_changed(rfb, col, row));
+			
+			if (changed && !in_run) {
+				run = col;
+				in_run = true;
+			} else if (!changed && in_run) {
+				rfb_add_rect(rfb, rects, &count, run, col, row);
+				in_run = false;
+			}
+		}
+		
+		if (in_run)
+			rfb_add_rect(rfb, rects, &count, run, rfb->damage_cols, row);
+	}
+	
+	return count;
+}
+
+/** Compute the span of the damaged tiles */
+static bool rfb_damage_span(rfb_t *rfb, rfb_span_t *span)
+{
+	sysarg_t col0 = rfb->damage_cols;
+	sysarg_t col1 = 0;
+	sysarg_t row0 = rfb->damage_rows;
+	sysarg_t row1 = 0;
+	
+	for (sysarg_t row = 0; row < rfb->damage_rows; row++) {
+		for (sysarg_t col = 0; col < rfb->damage_cols; col++) {
+			if (!rfb->damage[row * rfb->damage_cols + col])
+				continue;
+			
+			col0 = min(col0, col);
+			col1 = max(col1, col + 1);
+			row0 = min(row0, row);
+			row1 = max(row1, row + 1);
+		}
 	}
 	
+	if (col0 >= col1)
+		return false;
+	
+	span->x0 = col0 * RFB_DAMAGE_TILE_SIZE;
+	span->x1 = min(col1 * RFB_DAMAGE_TILE_SIZE, (sysarg_t) rfb->width);
+	span->y0 = row0 * RFB_DAMAGE_TILE_SIZE;
+	span->y1 = min(row1 * RFB_DAMAGE_TILE_SIZE, (sysarg_t) rfb->height);
+	return true;
+}
 
-	/* We send only single raw rectangle right now */
-	size_t buf_size = sizeof(rfb_framebuffer_update_t) +
-	    sizeof(rfb_rectangle_t) * 1 +
-	    rfb_rect_encode_raw(rfb, &rfb->damage_rect, NULL)
-	    ;
+static int rfb_rect_encode(rfb_t *rfb, rfb_rectangle_t *rect, void *buf,
+    size_t *size)
+{
+	if (rfb->supports_zrle) {
+		rect->enctype = RFB_ENCODING_ZRLE;
+		return rfb_rect_encode_zrle(rfb, rect, buf, size);
+	}
+	
+	if (rfb->supports_trle) {
+		rect->enctype = RFB_ENCODING_TRLE;
+		*size = rfb_rect_encode_trle(rfb, rect, buf);
+		return EOK;
+	}
+	
+	rect->enctype = RFB_ENCODING_RAW;
+	*size = rfb_rect_encode_raw(rfb, rect, buf);
+	return EOK;
+}
+
+/** Build a framebuffer update message
+ *
+ * Only the damaged tiles which differ from the shadow framebuffer (the
+ * contents the client already has) are sent. Content moved vertically
+ * is sent as a CopyRect rectangle if the client supports it.
+ *
+ */
+static int rfb_build_framebuffer_update(rfb_t *rfb, void **pbuf,
+    size_t *psize)
+{
+	rfb_rectangle_t copy_rect;
+	rfb_copy_rect_t copy;
+	bool copy_valid = false;
+	
+	if (rfb->shadow_valid && rfb->supports_copyrect) {
+		rfb_span_t span;
+		sysarg_t dst_y;
+		sysarg_t src_y;
+		
+		if (rfb_damage_span(rfb, &span)) {
+			sysarg_t rows = rfb_find_scroll(rfb, &span, &dst_y, &src_y);
+			if (rows > 0) {
+				copy_rect.x = span.x0;
+				copy_rect.y = dst_y;
+				copy_rect.width = span.x1 - span.x0;
+				copy_rect.height = rows;
+				copy_rect.enctype = RFB_ENCODING_COPYRECT;
+				copy.src_x = span.x0;
+				copy.src_y = src_y;
+				copy_valid = true;
+				
+				rfb_shadow_copy(rfb, &copy_rect, &copy);
+			}
+		}
+	}
+	
+	rfb_rectangle_t *rects = malloc(rfb->damage_cols * rfb->damage_rows *
+	    sizeof(rfb_rectangle_t));
+	if (rects == NULL)
+		return ENOMEM;
+	
+	size_t count = rfb_collect_damage(rfb, rects);
+	
+	size_t buf_size = sizeof(rfb_framebuffer_update_t);
+	if (copy_valid)
+		buf_size += sizeof(rfb_rectangle_t) + sizeof(rfb_copy_rect_t);
+	
+	for (size_t i = 0; i < count; i++) {
+		size_t size;
+		int rc = rfb_rect_encode(rfb, &rects[i], NULL, &size);
+		if (rc != EOK) {
+			free(rects);
+			return rc;
+		}
+		
+		buf_size += sizeof(rfb_rectangle_t) + size;
+	}
 	
 	void *buf = malloc(buf_size);
 	if (buf == NULL) {
-		fibril_mutex_unlock(&rfb->lock);
+		free(rects);
 		return ENOMEM;
 	}
-	memset(buf, 0, buf_size);
 	
 	void *pos = buf;
 	rfb_framebuffer_update_t *fbu = buf;
 	fbu->message_type = RFB_SMSG_FRAMEBUFFER_UPDATE;
-	fbu->rect_count = 1;
+	fbu->pad = 0;
+	fbu->rect_count = count + (copy_valid ? 1 : 0);
 	rfb_framebuffer_update_to_be(fbu, fbu);
 	pos += sizeof(rfb_framebuffer_update_t);
 	
-	rfb_rectangle_t *rect = pos;
-	pos += sizeof(rfb_rectangle_t);
+	if (copy_valid) {
+		rfb_rectangle_t *rect = pos;
+		*rect = copy_rect;
+		rfb_rectangle_to_be(rect, rect);
+		pos += sizeof(rfb_rectangle_t);
+		
+		rfb_copy_rect_t *cr = pos;
+		cr->src_x = host2uint16_t_be(copy.src_x);
+		cr->src_y = host2uint16_t_be(copy.src_y);
+		pos += sizeof(rfb_copy_rect_t);
+	}
 	
-	*rect = rfb->damage_rect;
+	for (size_t i = 0; i < count; i++) {
+		rfb_rectangle_t *rect = pos;
+		pos += sizeof(rfb_rectangle_t);
+		
+		*rect = rects[i];
+		
+		size_t size;
+		int rc = rfb_rect_encode(rfb, rect, pos, &size);
+		if (rc != EOK) {
+			free(buf);
+			free(rects);
+			return rc;
+		}
+		
+		rfb_rectangle_to_be(rect, rect);
+		pos += size;
+		
+		rfb_shadow_update(rfb, &rects[i]);
+	}
 	
-	if (rfb->supports_trle) {
-		rect->enctype = RFB_ENCODING_TRLE;
-		pos += rfb_rect_encode_trle(rfb, rect, pos);
+	free(rects);
+	
+	*pbuf = buf;
+	*psize = pos - buf;
+	return EOK;
+}
+
+static int rfb_send_framebuffer_update(rfb_t *rfb, tcp_conn_t *conn,
+    bool incremental)
+{
+	fibril_mutex_lock(&rfb->lock);
+	
+	if (!incremental)
+		rfb->shadow_valid = false;
+	
+	if (rfb->shadow_valid) {
+		/* Wait for something to send */
+		while (!rfb->damage_valid) {
+			int rc = fibril_condvar_wait_timeout(&rfb->damage_cv,
+			    &rfb->lock, UPDATE_TIMEOUT);
+			if (rc == ETIMEOUT)
+				break;
+		}
+	} else {
+		rfb_damage(rfb, 0, 0, rfb->width, rfb->height);
 	}
-	else {
-		rect->enctype = RFB_ENCODING_RAW;
-		pos += rfb_rect_encode_raw(rfb, rect, pos);
+	
+	bool zrle_started = rfb->zrle_started;
+	
+	void *buf;
+	size_t buf_size;
+	int rc = rfb_build_framebuffer_update(rfb, &buf, &buf_size);
+	if (rc != EOK) {
+		/* Start over with a full update */
+		rfb->zrle_started = zrle_started;
+		rfb->shadow_valid = false;
+		fibril_mutex_unlock(&rfb->lock);
+		return rc;
 	}
-	rfb_rectangle_to_be(rect, rect);
 	
+	memset(rfb->damage, 0, rfb->damage_cols * rfb->damage_rows);
 	rfb->damage_valid = false;
+	rfb->shadow_valid = true;
 	
 	size_t send_palette_size = 0;
 	void *send_palette = NULL;
@@ -544,6 +1427,7 @@ static int rfb_send_framebuffer_update(rfb_t *rfb, tcp_conn_t *conn,
 		send_palette = rfb_send_palette_message(rfb, &send_palette_size);
 		if (send_palette == NULL) {
 			free(buf);
+			rfb->shadow_valid = false;
 			fibril_mutex_unlock(&rfb->lock);
 			return ENOMEM;
 		}
@@ -553,13 +1437,14 @@ static int rfb_send_framebuffer_update(rfb_t *rfb, tcp_conn_t *conn,
 	
 	if (!rfb->pixel_format.true_color) {
 		int rc = tcp_conn_send(conn, send_palette, send_palette_size);
+		free(send_palette);
 		if (rc != EOK) {
 			free(buf);
 			return rc;
 		}
 	}
 	
-	int rc = tcp_conn_send(conn, buf, buf_size);
+	rc = tcp_conn_send(conn, buf, buf_size);
 	free(buf);
 	
 	return rc;
@@ -654,6 +1539,14 @@ static void rfb_socket_connection(rfb_t *rfb, tcp_conn_t *conn)
 	
 	/* Server init */
 	fibril_mutex_lock(&rfb->lock);
+	
+	/* The new client knows neither the framebuffer nor the zlib stream */
+	rfb->supports_trle = false;
+	rfb->supports_zrle = false;
+	rfb->supports_copyrect = false;
+	rfb->zrle_started = false;
+	rfb->shadow_valid = false;
+	
 	size_t name_length = str_length(rfb->name);
 	size_t msg_length = sizeof(rfb_server_init_t) + name_length;
 	rfb_server_init_t *server_init = malloc(msg_length);
@@ -705,17 +1598,32 @@ static void rfb_socket_connection(rfb_t *rfb, tcp_conn_t *conn)
 			recv_message(conn, message_type, &se, sizeof(se));
 			rfb_set_encodings_to_host(&se, &se);
 			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Received SetEncodings message");
+			fibril_mutex_lock(&rfb->lock);
+			rfb->supports_trle = false;
+			rfb->supports_zrle = false;
+			rfb->supports_copyrect = false;
+			fibril_mutex_unlock(&rfb->lock);
 			for (uint16_t i = 0; i < se.count; i++) {
 				int32_t encoding = 0;
 				rc = recv_chars(conn, (char *) &encoding, sizeof(int32_t));
 				if (rc != EOK)
 					return;
 				encoding = uint32_t_be2host(encoding);
+				fibril_mutex_lock(&rfb->lock);
 				if (encoding == RFB_ENCODING_TRLE) {
 					log_msg(LOG_DEFAULT, LVL_DEBUG,
 					    "Client supports TRLE encoding");
 					rfb->supports_trle = true;
+				} else if (encoding == RFB_ENCODING_ZRLE) {
+					log_msg(LOG_DEFAULT, LVL_DEBUG,
+					    "Client supports ZRLE encoding");
+					rfb->supports_zrle = true;
+				} else if (encoding == RFB_ENCODING_COPYRECT) {
+					log_msg(LOG_DEFAULT, LVL_DEBUG,
+					    "Client supports CopyRect encoding");
+					rfb->supports_copyrect = true;
 				}
+				fibril_mutex_unlock(&rfb->lock);
 			}
 			break;
 		case RFB_CMSG_FRAMEBUFFER_UPDATE_REQUEST:
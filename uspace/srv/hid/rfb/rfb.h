@@ -49,10 +49,16 @@
 #define RFB_SMSG_SERVER_CUT_TEXT 3
 
 #define RFB_ENCODING_RAW 0
+#define RFB_ENCODING_COPYRECT 1
 #define RFB_ENCODING_TRLE 15
+#define RFB_ENCODING_ZRLE 16
 
 #define RFB_TILE_ENCODING_RAW 0
 #define RFB_TILE_ENCODING_SOLID 1
+#define RFB_TILE_ENCODING_PLAIN_RLE 128
+
+/** Size of the tiles used for tracking damage */
+#define RFB_DAMAGE_TILE_SIZE 16
 
 typedef struct {
 	uint8_t bpp;
@@ -127,6 +133,11 @@ typedef struct {
 	uint8_t data[0];
 } __attribute__((packed)) rfb_rectangle_t;
 
+typedef struct {
+	uint16_t src_x;
+	uint16_t src_y;
+} __attribute__((packed)) rfb_copy_rect_t;
+
 typedef struct {
 	uint8_t message_type;
 	uint8_t pad;
@@ -154,17 +165,32 @@ typedef struct {
 	tcp_t *tcp;
 	tcp_listener_t *lst;
 	pixelmap_t framebuffer;
-	rfb_rectangle_t damage_rect;
-	bool damage_valid;
 	fibril_mutex_t lock;
+	
+	/** Damaged tiles not sent to the client yet */
+	uint8_t *damage;
+	size_t damage_cols;
+	size_t damage_rows;
+	bool damage_valid;
+	fibril_condvar_t damage_cv;
+	
+	/** Framebuffer contents as seen by the client */
+	pixelmap_t shadow;
+	bool shadow_valid;
+	
 	pixel_t *palette;
 	size_t palette_used;
 	bool supports_trle;
+	bool supports_zrle;
+	bool supports_copyrect;
+	/** The ZRLE zlib stream has been started */
+	bool zrle_started;
 } rfb_t;
 
 
 extern int rfb_init(rfb_t *, uint16_t, uint16_t, const char *);
 extern int rfb_set_size(rfb_t *, uint16_t, uint16_t);
+extern void rfb_damage(rfb_t *, sysarg_t, sysarg_t, sysarg_t, sysarg_t);
 extern int rfb_listen(rfb_t *, uint16_t);
 
 #endif
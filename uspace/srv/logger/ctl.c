@@ -58,6 +58,7 @@ static int handle_log_level_change(sysarg_t new_level)
 	log->logged_level = new_level;
 
 	log_unlock(log);
+	levels_changed();
 
 	return EOK;
 }
@@ -77,6 +78,8 @@ void logger_connection_handler_control(ipc_callid_t callid)
 		switch (IPC_GET_IMETHOD(call)) {
 		case LOGGER_CONTROL_SET_DEFAULT_LEVEL: {
 			int rc = set_default_logging_level(IPC_GET_ARG1(call));
+			if (rc == EOK)
+				levels_changed();
 			async_answer_0(callid, rc);
 			break;
 		}
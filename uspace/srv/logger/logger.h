@@ -84,9 +84,10 @@ typedef struct {
 logger_log_t *find_log_by_name_and_lock(const char *name);
 logger_log_t *find_or_create_log_and_lock(const char *, sysarg_t);
 logger_log_t *find_log_by_id_and_lock(sysarg_t);
+log_level_t get_effective_log_level(logger_log_t *);
 bool shall_log_message(logger_log_t *, log_level_t);
 void log_unlock(logger_log_t *);
-void write_to_log(logger_log_t *, log_level_t, const char *);
+void write_to_log(logger_log_t *, const char *);
 void log_release(logger_log_t *);
 
 void registered_logs_init(logger_registered_logs_t *);
@@ -99,6 +100,7 @@ int set_default_logging_level(log_level_t);
 
 void logger_connection_handler_control(ipc_callid_t);
 void logger_connection_handler_writer(ipc_callid_t);
+void levels_changed(void);
 
 void parse_initial_settings(void);
 void parse_level_settings(char *);
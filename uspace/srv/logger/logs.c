@@ -187,14 +187,19 @@ static log_level_t get_actual_log_level(logger_log_t *log)
 	return log->logged_level;
 }
 
-bool shall_log_message(logger_log_t *log, log_level_t level)
+log_level_t get_effective_log_level(logger_log_t *log)
 {
 	fibril_mutex_lock(&log_list_guard);
-	bool result = level <= get_actual_log_level(log);
+	log_level_t result = get_actual_log_level(log);
 	fibril_mutex_unlock(&log_list_guard);
 	return result;
 }
 
+bool shall_log_message(logger_log_t *log, log_level_t level)
+{
+	return level <= get_effective_log_level(log);
+}
+
 void log_unlock(logger_log_t *log)
 {
 	assert(fibril_mutex_is_locked(&log->guard));
@@ -287,7 +292,11 @@ void log_release(logger_log_t *log)
 }
 
 
-void write_to_log(logger_log_t *log, log_level_t level, const char *message)
+/** Append an already formatted line to the log file.
+ *
+ * Precondition: log is locked.
+ */
+void write_to_log(logger_log_t *log, const char *line)
 {
 	assert(fibril_mutex_is_locked(&log->guard));
 	assert(log->dest != NULL);
@@ -296,9 +305,8 @@ void write_to_log(logger_log_t *log, log_level_t level, const char *message)
 		log->dest->logfile = fopen(log->dest->filename, "a");
 
 	if (log->dest->logfile != NULL) {
-		fprintf(log->dest->logfile, "[%s] %s: %s\n",
-		    log->full_name, log_level_str(level),
-		    (const char *) message);
+		fputs(line, log->dest->logfile);
+		fputc('\n', log->dest->logfile);
 		fflush(log->dest->logfile);
 	}
 
@@ -41,13 +41,71 @@
 #include <io/logctl.h>
 #include <io/klog.h>
 #include <ns.h>
+#include <align.h>
+#include <as.h>
 #include <async.h>
+#include <libarch/barrier.h>
+#include <macros.h>
+#include <mem.h>
 #include <stdio.h>
 #include <errno.h>
 #include <str_error.h>
 #include <malloc.h>
 #include "logger.h"
 
+/** Record ring shared with a writer client. */
+typedef struct {
+	link_t link;
+	/** Shared ring, NULL if the client has not set one up. */
+	logger_ring_t *ring;
+	/** Size of the data area, not trusting the shared copy. */
+	uint32_t size;
+} logger_writer_ring_t;
+
+/** Rings of all connected writers, for level change notifications. */
+static FIBRIL_MUTEX_INITIALIZE(rings_guard);
+static LIST_INITIALIZE(rings);
+
+/** Current generation of logging levels. */
+static uint32_t level_gen;
+
+/** Notify writers that logging levels have changed.
+ *
+ * Writers cache effective levels and drop the cache once they see
+ * a new generation in their ring.
+ */
+void levels_changed(void)
+{
+	fibril_mutex_lock(&rings_guard);
+
+	level_gen++;
+	list_foreach(rings, link, logger_writer_ring_t, wring) {
+		wring->ring->level_gen = level_gen;
+	}
+
+	fibril_mutex_unlock(&rings_guard);
+}
+
+/** Write a message to the kernel log and to the log file.
+ *
+ * The message is formatted only once for both destinations.
+ *
+ * Precondition: log is locked.
+ */
+static void log_message(logger_log_t *log, log_level_t level,
+    const char *message)
+{
+	char *line;
+	int rc = asprintf(&line, "[%s] %s: %s", log->full_name,
+	    log_level_str(level), message);
+	if (rc < 0)
+		return;
+
+	klog_write(level, line, str_size(line));
+	write_to_log(log, line);
+
+	free(line);
+}
 
 static logger_log_t *handle_create_log(sysarg_t parent)
 {
@@ -69,22 +127,36 @@ static int handle_receive_message(sysarg_t log_id, sysarg_t level)
 	if (log == NULL)
 		return ENOENT;
 
-	void *message = NULL;
-	int rc = async_data_write_accept(&message, true, 1, 0, 0, NULL);
-	if (rc != EOK)
+	char *message = NULL;
+	ipc_callid_t callid;
+	size_t size;
+	int rc;
+
+	if (!async_data_write_receive(&callid, &size)) {
+		rc = EINVAL;
 		goto leave;
+	}
 
-	if (!shall_log_message(log, level)) {
+	/* Do not bother receiving messages that will not be logged. */
+	if (level >= LVL_LIMIT || !shall_log_message(log, level)) {
+		async_answer_0(callid, ENAK);
 		rc = EOK;
 		goto leave;
 	}
 
-	KLOG_PRINTF(level, "[%s] %s: %s\n",
-	    log->full_name, log_level_str(level),
-	    (const char *) message);
-	write_to_log(log, level, message);
+	message = malloc(size + 1);
+	if (message == NULL) {
+		async_answer_0(callid, ENOMEM);
+		rc = ENOMEM;
+		goto leave;
+	}
+
+	rc = async_data_write_finalize(callid, message, size);
+	if (rc != EOK)
+		goto leave;
 
-	rc = EOK;
+	message[size] = 0;
+	log_message(log, level, message);
 
 leave:
 	log_unlock(log);
@@ -93,6 +165,126 @@ leave:
 	return rc;
 }
 
+static int handle_get_level(sysarg_t log_id, log_level_t *level)
+{
+	logger_log_t *log = find_log_by_id_and_lock(log_id);
+	if (log == NULL)
+		return ENOENT;
+
+	*level = get_effective_log_level(log);
+	log_unlock(log);
+
+	return EOK;
+}
+
+static int handle_set_ring(logger_writer_ring_t *wring)
+{
+	ipc_callid_t callid;
+	size_t size;
+	unsigned int flags;
+
+	if (!async_share_out_receive(&callid, &size, &flags))
+		return EINVAL;
+
+	if (wring->ring != NULL || size < LOGGER_RING_SIZE) {
+		async_answer_0(callid, EINVAL);
+		return EINVAL;
+	}
+
+	void *area;
+	int rc = async_share_out_finalize(callid, &area);
+	if ((rc != EOK) || (area == AS_MAP_FAILED))
+		return ENOMEM;
+
+	logger_ring_t *ring = (logger_ring_t *) area;
+	uint32_t ring_size = ring->size;
+
+	if ((ring_size == 0) || (ring_size % sizeof(sysarg_t) != 0) ||
+	    (ring_size > size - sizeof(logger_ring_t))) {
+		as_area_destroy(area);
+		return EINVAL;
+	}
+
+	fibril_mutex_lock(&rings_guard);
+	wring->ring = ring;
+	wring->size = ring_size;
+	ring->level_gen = level_gen;
+	list_append(&wring->link, &rings);
+	fibril_mutex_unlock(&rings_guard);
+
+	return EOK;
+}
+
+/** Process records queued in the shared ring.
+ *
+ * The ring is shared with the client, so every record is validated
+ * before use and a corrupted ring is simply discarded.
+ */
+static void ring_drain(logger_writer_ring_t *wring)
+{
+	logger_ring_t *ring = wring->ring;
+	uint8_t *data = (uint8_t *) (ring + 1);
+	uint32_t size = wring->size;
+
+	/* Clear the request before looking at the head, see log.c. */
+	ring->kick = 0;
+	memory_barrier();
+
+	uint32_t tail = ring->tail;
+	uint32_t head = ring->head;
+	memory_barrier();
+
+	if (head - tail > size) {
+		ring->tail = head;
+		return;
+	}
+
+	while (tail != head) {
+		uint32_t offset = tail % size;
+		uint32_t left = size - offset;
+		logger_record_t *rec = (logger_record_t *) (data + offset);
+
+		if ((left < sizeof(logger_record_t)) || (rec->log == 0)) {
+			/* Padding up to the end of the data area */
+			tail += left;
+			ring->tail = tail;
+			continue;
+		}
+
+		logger_record_t hdr = *rec;
+		uint32_t avail = min(left, head - tail);
+		if ((avail < sizeof(logger_record_t)) ||
+		    (hdr.length > avail - sizeof(logger_record_t))) {
+			ring->tail = head;
+			return;
+		}
+
+		char *message = malloc(hdr.length + 1);
+		if (message != NULL) {
+			memcpy(message, rec + 1, hdr.length);
+			message[hdr.length] = 0;
+		}
+
+		tail += ALIGN_UP(sizeof(logger_record_t) + hdr.length,
+		    sizeof(sysarg_t));
+		memory_barrier();
+		ring->tail = tail;
+
+		if (message == NULL)
+			continue;
+
+		logger_log_t *log = find_log_by_id_and_lock(hdr.log);
+		if (log != NULL) {
+			if ((hdr.level < LVL_LIMIT) &&
+			    shall_log_message(log, hdr.level))
+				log_message(log, hdr.level, message);
+			log_unlock(log);
+		}
+
+		free(message);
+	}
+}
+
 void logger_connection_handler_writer(ipc_callid_t callid)
 {
 	/* Acknowledge the connection. */
@@ -103,6 +295,11 @@ void logger_connection_handler_writer(ipc_callid_t callid)
 	logger_registered_logs_t registered_logs;
 	registered_logs_init(&registered_logs);
 
+	logger_writer_ring_t wring;
+	link_initialize(&wring.link);
+	wring.ring = NULL;
+	wring.size = 0;
+
 	while (true) {
 		ipc_call_t call;
 		ipc_callid_t callid = async_get_call(&call);
@@ -132,12 +329,39 @@ void logger_connection_handler_writer(ipc_callid_t callid)
 			async_answer_0(callid, rc);
 			break;
 		}
+		case LOGGER_WRITER_GET_LEVEL: {
+			log_level_t level = LVL_FATAL;
+			int rc = handle_get_level(IPC_GET_ARG1(call), &level);
+			async_answer_1(callid, rc, level);
+			break;
+		}
+		case LOGGER_WRITER_SET_RING: {
+			int rc = handle_set_ring(&wring);
+			async_answer_0(callid, rc);
+			break;
+		}
+		case LOGGER_WRITER_DRAIN:
+			if (wring.ring != NULL)
+				ring_drain(&wring);
+			async_answer_0(callid, EOK);
+			break;
 		default:
 			async_answer_0(callid, EINVAL);
 			break;
 		}
 	}
 
+	if (wring.ring != NULL) {
+		/* Records written just before the client terminated */
+		ring_drain(&wring);
+
+		fibril_mutex_lock(&rings_guard);
+		list_remove(&wring.link);
+		fibril_mutex_unlock(&rings_guard);
+
+		as_area_destroy(wring.ring);
+	}
+
 	unregister_logs(&registered_logs);
 	logger_log("writer: client terminated.\n");
 }
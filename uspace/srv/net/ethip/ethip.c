@@ -47,6 +47,7 @@
 #include "arp.h"
 #include "ethip.h"
 #include "ethip_nic.h"
+#include "gso.h"
 #include "pdu.h"
 #include "std.h"
 
@@ -57,6 +58,7 @@ static int ethip_close(iplink_srv_t *srv);
 static int ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu);
 static int ethip_send6(iplink_srv_t *srv, iplink_sdu6_t *sdu);
 static int ethip_get_mtu(iplink_srv_t *srv, size_t *mtu);
+static int ethip_get_gso_max(iplink_srv_t *srv, size_t *size);
 static int ethip_get_mac48(iplink_srv_t *srv, addr48_t *mac);
 static int ethip_set_mac48(iplink_srv_t *srv, addr48_t *mac);
 static int ethip_addr_add(iplink_srv_t *srv, inet_addr_t *addr);
@@ -70,6 +72,7 @@ static iplink_ops_t ethip_iplink_ops = {
 	.send = ethip_send,
 	.send6 = ethip_send6,
 	.get_mtu = ethip_get_mtu,
+	.get_gso_max = ethip_get_gso_max,
 	.get_mac48 = ethip_get_mac48,
 	.set_mac48 = ethip_set_mac48,
 	.addr_add = ethip_addr_add,
@@ -188,6 +191,9 @@ static int ethip_send(iplink_srv_t *srv, iplink_sdu_t *sdu)
 	frame.data = sdu->data;
 	frame.size = sdu->size;
 	
+	if (sdu->mss != 0 && sdu->size > ETH_MTU)
+		return ethip_gso_send(nic, &frame, sdu->mss);
+	
 	void *data;
 	size_t size;
 	rc = eth_pdu_encode(&frame, &data, &size);
@@ -271,7 +277,14 @@ int ethip_received(iplink_srv_t *srv, void *data, size_t size)
 static int ethip_get_mtu(iplink_srv_t *srv, size_t *mtu)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_get_mtu()");
-	*mtu = 1500;
+	*mtu = ETH_MTU;
+	return EOK;
+}
+
+static int ethip_get_gso_max(iplink_srv_t *srv, size_t *size)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_get_gso_max()");
+	*size = ETHIP_GSO_MAX;
 	return EOK;
 }
 
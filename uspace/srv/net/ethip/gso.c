@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2026 agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup ethip
+ * @{
+ */
+/**
+ * @file
+ * @brief Software TCP segmentation offload
+ *
+ * The TCP server hands down segments larger than the link MTU together
+ * with the maximum segment size. Here such a super-segment is split into
+ * MTU-sized TCP segments, each with its own copy of the IP and TCP header.
+ * This way the data crosses the IPC boundaries between tcp, inetsrv and
+ * ethip only once.
+ */
+
+#include <bitops.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <io/log.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "ethip.h"
+#include "ethip_nic.h"
+#include "gso.h"
+#include "std.h"
+#include "../inetsrv/inet_std.h"
+#include "../tcp/std.h"
+
+/** Mask of IPv4 More Fragments flag and Fragment Offset */
+#define IP_FLAGS_FOFF_FRAG  (BIT_V(uint16_t, FF_FLAG_MF) | \
+    BIT_RANGE(uint16_t, FF_FRAGOFF_h, FF_FRAGOFF_l))
+
+/** TCP flags that may only be set in the last segment */
+#define TCP_FLAGS_LAST_SEG  (BIT_V(uint16_t, DF_PSH) | BIT_V(uint16_t, DF_FIN))
+
+/** Add data to one's complement checksum accumulator. */
+static uint32_t ethip_gso_sum(uint32_t sum, const void *data, size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *) data;
+	size_t i;
+
+	for (i = 0; i + 1 < size; i += 2)
+		sum += ((uint32_t) bdata[i] << 8) | bdata[i + 1];
+
+	if (size % 2 != 0)
+		sum += (uint32_t) bdata[size - 1] << 8;
+
+	return sum;
+}
+
+/** Fold checksum accumulator into the final 16-bit checksum. */
+static uint16_t ethip_gso_fold(uint32_t sum)
+{
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum;
+}
+
+/** Send TCP super-segment as a series of MTU-sized Ethernet frames.
+ *
+ * @param nic   NIC
+ * @param frame Ethernet frame with IPv4 packet containing a TCP segment
+ * @param mss   Maximum segment size requested by the sender
+ *
+ * @return EOK on success, EINVAL if the packet cannot be segmented,
+ *         ENOMEM if out of memory or other error code
+ */
+int ethip_gso_send(ethip_nic_t *nic, eth_frame_t *frame, size_t mss)
+{
+	ip_header_t *ihdr;
+	tcp_header_t *thdr;
+	size_t ihdr_size;
+	size_t thdr_size;
+	size_t tot_len;
+	size_t text_size;
+	size_t seg_size;
+	size_t offs;
+	uint8_t *text;
+	uint8_t *fdata;
+	eth_header_t *fhdr;
+	ip_header_t *fihdr;
+	tcp_header_t *fthdr;
+	uint32_t seq;
+	uint16_t id;
+	uint16_t flags;
+	uint32_t phsum;
+	int rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_gso_send(size=%zu, mss=%zu)",
+	    frame->size, mss);
+
+	if (frame->size < sizeof(ip_header_t))
+		return EINVAL;
+
+	ihdr = (ip_header_t *) frame->data;
+	ihdr_size = BIT_RANGE_EXTRACT(uint8_t, VI_IHL_h, VI_IHL_l,
+	    ihdr->ver_ihl) * sizeof(uint32_t);
+	tot_len = uint16_t_be2host(ihdr->tot_len);
+
+	if (BIT_RANGE_EXTRACT(uint8_t, VI_VERSION_h, VI_VERSION_l,
+	    ihdr->ver_ihl) != 4 || ihdr->proto != IP_PROTO_TCP ||
+	    ihdr_size < sizeof(ip_header_t) || tot_len > frame->size ||
+	    (uint16_t_be2host(ihdr->flags_foff) & IP_FLAGS_FOFF_FRAG) != 0 ||
+	    tot_len < ihdr_size + sizeof(tcp_header_t)) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Cannot segment packet.");
+		return EINVAL;
+	}
+
+	thdr = (tcp_header_t *) ((uint8_t *) frame->data + ihdr_size);
+	thdr_size = BIT_RANGE_EXTRACT(uint16_t, DF_DATA_OFFSET_h,
+	    DF_DATA_OFFSET_l, uint16_t_be2host(thdr->doff_flags)) *
+	    sizeof(uint32_t);
+	if (thdr_size < sizeof(tcp_header_t) ||
+	    ihdr_size + thdr_size > tot_len ||
+	    ihdr_size + thdr_size >= ETH_MTU) {
+		log_msg(LOG_DEFAULT, LVL_WARN, "Cannot segment packet.");
+		return EINVAL;
+	}
+
+	text = (uint8_t *) thdr + thdr_size;
+	text_size = tot_len - ihdr_size - thdr_size;
+	seg_size = min(mss, ETH_MTU - ihdr_size - thdr_size);
+
+	fdata = calloc(max(sizeof(eth_header_t) + ihdr_size + thdr_size +
+	    seg_size, ETH_FRAME_MIN_SIZE), 1);
+	if (fdata == NULL)
+		return ENOMEM;
+
+	fhdr = (eth_header_t *) fdata;
+	addr48(frame->src, fhdr->src);
+	addr48(frame->dest, fhdr->dest);
+	fhdr->etype_len = host2uint16_t_be(frame->etype_len);
+
+	fihdr = (ip_header_t *) (fdata + sizeof(eth_header_t));
+	fthdr = (tcp_header_t *) ((uint8_t *) fihdr + ihdr_size);
+	memcpy(fihdr, ihdr, ihdr_size + thdr_size);
+
+	seq = uint32_t_be2host(thdr->seq);
+	id = uint16_t_be2host(ihdr->id);
+	flags = uint16_t_be2host(thdr->doff_flags);
+
+	/* Pseudo-header sum without the TCP length, which varies */
+	phsum = ethip_gso_sum(0, &ihdr->src_addr, sizeof(uint32_t));
+	phsum = ethip_gso_sum(phsum, &ihdr->dest_addr, sizeof(uint32_t));
+	phsum += IP_PROTO_TCP;
+
+	rc = EOK;
+	offs = 0;
+
+	while (offs < text_size) {
+		size_t xfer = min(seg_size, text_size - offs);
+		bool last = (offs + xfer == text_size);
+		size_t seg_len = thdr_size + xfer;
+		uint32_t sum;
+
+		memcpy((uint8_t *) fthdr + thdr_size, text + offs, xfer);
+
+		fihdr->tot_len = host2uint16_t_be(ihdr_size + seg_len);
+		fihdr->id = host2uint16_t_be(id);
+		fihdr->chksum = 0;
+		fihdr->chksum = host2uint16_t_be(ethip_gso_fold(
+		    ethip_gso_sum(0, fihdr, ihdr_size)));
+
+		fthdr->seq = host2uint32_t_be(seq + offs);
+		fthdr->doff_flags = host2uint16_t_be(last ? flags :
+		    flags & ~TCP_FLAGS_LAST_SEG);
+		fthdr->checksum = 0;
+		sum = ethip_gso_sum(phsum + seg_len, fthdr, seg_len);
+		fthdr->checksum = host2uint16_t_be(ethip_gso_fold(sum));
+
+		rc = ethip_nic_send(nic, fdata, max(sizeof(eth_header_t) +
+		    ihdr_size + seg_len, ETH_FRAME_MIN_SIZE));
+		if (rc != EOK)
+			break;
+
+		offs += xfer;
+		++id;
+	}
+
+	free(fdata);
+	return rc;
+}
+
+/** @}
+ */
@@ -43,6 +43,10 @@
 #define ETH_ADDR_SIZE       6
 #define IPV4_ADDR_SIZE      4
 #define ETH_FRAME_MIN_SIZE  60
+#define ETH_MTU             1500
+
+/** Maximum size of an IPv4 packet accepted for segmentation offload */
+#define ETHIP_GSO_MAX       65535
 
 /** Ethernet frame header */
 typedef struct {
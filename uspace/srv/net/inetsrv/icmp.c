@@ -110,6 +110,7 @@ static int icmp_recv_echo_request(inet_dgram_t *dgram)
 	rdgram.tos = ICMP_TOS;
 	rdgram.data = reply;
 	rdgram.size = size;
+	rdgram.mss = 0;
 
 	rc = inet_route_packet(&rdgram, IP_PROTO_ICMP, INET_TTL_MAX, 0);
 
@@ -168,6 +169,7 @@ int icmp_ping_send(uint16_t ident, inetping_sdu_t *sdu)
 	dgram.tos = ICMP_TOS;
 	dgram.data = rdata;
 	dgram.size = rsize;
+	dgram.mss = 0;
 
 	int rc = inet_route_packet(&dgram, IP_PROTO_ICMP, INET_TTL_MAX, 0);
 
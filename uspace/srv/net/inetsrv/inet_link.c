@@ -34,6 +34,7 @@
  * @brief
  */
 
+#include <align.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <fibril_synch.h>
@@ -45,6 +46,7 @@
 #include "addrobj.h"
 #include "inetsrv.h"
 #include "inet_link.h"
+#include "inet_std.h"
 #include "pdu.h"
 
 static bool first_link = true;
@@ -196,6 +198,14 @@ int inet_link_open(service_id_t sid)
 		goto error;
 	}
 	
+	/*
+	 * Segmentation offload is optional, links which do not support it
+	 * get packets fragmented to MTU size.
+	 */
+	rc = iplink_get_gso_max(ilink->iplink, &ilink->gso_max);
+	if (rc != EOK)
+		ilink->gso_max = 0;
+	
 	/*
 	 * Get the MAC address of the link. If the link has a MAC
 	 * address, we assume that it supports NDP.
@@ -332,6 +342,7 @@ int inet_link_send_dgram(inet_link_t *ilink, addr32_t lsrc, addr32_t ldest,
 	
 	sdu.src = lsrc;
 	sdu.dest = ldest;
+	sdu.mss = 0;
 	
 	inet_packet_t packet;
 	
@@ -340,16 +351,34 @@ int inet_link_send_dgram(inet_link_t *ilink, addr32_t lsrc, addr32_t ldest,
 	packet.tos = dgram->tos;
 	packet.proto = proto;
 	packet.ttl = ttl;
+	packet.df = df;
+	packet.data = dgram->data;
+	packet.size = dgram->size;
 	
-	/* Allocate identifier */
+	size_t mtu = ilink->def_mtu;
+	uint16_t nidents = 1;
+	
+	if (dgram->mss != 0 && ilink->gso_max != 0 &&
+	    sizeof(ip_header_t) + dgram->size > mtu &&
+	    sizeof(ip_header_t) + dgram->size <= ilink->gso_max) {
+		/*
+		 * Hand the whole datagram to the link in one packet and let
+		 * it split the payload into segments. Each segment is
+		 * an atomic datagram and gets its own identifier.
+		 */
+		sdu.mss = dgram->mss;
+		packet.df = true;
+		mtu = sizeof(ip_header_t) +
+		    ALIGN_UP(dgram->size, FRAG_OFFS_UNIT);
+		nidents = (dgram->size + dgram->mss - 1) / dgram->mss;
+	}
+	
+	/* Allocate identifier(s) */
 	fibril_mutex_lock(&ip_ident_lock);
 	packet.ident = ++ip_ident;
+	ip_ident += nidents - 1;
 	fibril_mutex_unlock(&ip_ident_lock);
 	
-	packet.df = df;
-	packet.data = dgram->data;
-	packet.size = dgram->size;
-	
 	int rc;
 	size_t offs = 0;
 	
@@ -357,7 +386,7 @@ int inet_link_send_dgram(inet_link_t *ilink, addr32_t lsrc, addr32_t ldest,
 		/* Encode one fragment */
 		
 		size_t roffs;
-		rc = inet_pdu_encode(&packet, src_v4, dest_v4, offs, ilink->def_mtu,
+		rc = inet_pdu_encode(&packet, src_v4, dest_v4, offs, mtu,
 		    &sdu.data, &sdu.size, &roffs);
 		if (rc != EOK)
 			return rc;
@@ -366,6 +395,18 @@ int inet_link_send_dgram(inet_link_t *ilink, addr32_t lsrc, addr32_t ldest,
 		rc = iplink_send(ilink->iplink, &sdu);
 		
 		free(sdu.data);
+		
+		if ((rc == EINVAL) && (sdu.mss != 0)) {
+			/*
+			 * The link could not split the datagram, send it
+			 * fragmented to the link MTU instead.
+			 */
+			sdu.mss = 0;
+			packet.df = df;
+			mtu = ilink->def_mtu;
+			continue;
+		}
+		
 		offs = roffs;
 	} while (offs < packet.size);
 	
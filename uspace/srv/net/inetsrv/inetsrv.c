@@ -297,6 +297,7 @@ static void inet_send_srv(inet_client_t *client, ipc_callid_t iid,
 	
 	uint8_t ttl = IPC_GET_ARG3(*icall);
 	int df = IPC_GET_ARG4(*icall);
+	dgram.mss = IPC_GET_ARG5(*icall);
 	
 	ipc_callid_t callid;
 	size_t size;
@@ -528,6 +529,7 @@ int inet_recv_packet(inet_packet_t *packet)
 			dgram.tos = packet->tos;
 			dgram.data = packet->data;
 			dgram.size = packet->size;
+			dgram.mss = 0;
 
 			return inet_recv_dgram_local(&dgram, packet->proto);
 		} else {
@@ -108,6 +108,8 @@ typedef struct {
 	async_sess_t *sess;
 	iplink_t *iplink;
 	size_t def_mtu;
+	/** Maximum packet size for segmentation offload, zero if unsupported */
+	size_t gso_max;
 	addr48_t mac;
 	bool mac_valid;
 } inet_link_t;
@@ -479,6 +479,7 @@ int ndp_pdu_encode(ndp_packet_t *ndp, inet_dgram_t *dgram)
 	inet_addr_set6(ndp->target_proto_addr, &dgram->dest);
 	dgram->tos = 0;
 	dgram->size = sizeof(icmpv6_message_t) + sizeof(ndp_message_t);
+	dgram->mss = 0;
 	
 	dgram->data = calloc(1, dgram->size);
 	if (dgram->data == NULL)
@@ -52,6 +52,7 @@ static int loopip_close(iplink_srv_t *srv);
 static int loopip_send(iplink_srv_t *srv, iplink_sdu_t *sdu);
 static int loopip_send6(iplink_srv_t *srv, iplink_sdu6_t *sdu);
 static int loopip_get_mtu(iplink_srv_t *srv, size_t *mtu);
+static int loopip_get_gso_max(iplink_srv_t *srv, size_t *size);
 static int loopip_get_mac48(iplink_srv_t *srv, addr48_t *mac);
 static int loopip_addr_add(iplink_srv_t *srv, inet_addr_t *addr);
 static int loopip_addr_remove(iplink_srv_t *srv, inet_addr_t *addr);
@@ -64,6 +65,7 @@ static iplink_ops_t loopip_iplink_ops = {
 	.send = loopip_send,
 	.send6 = loopip_send6,
 	.get_mtu = loopip_get_mtu,
+	.get_gso_max = loopip_get_gso_max,
 	.get_mac48 = loopip_get_mac48,
 	.addr_add = loopip_addr_add,
 	.addr_remove = loopip_addr_remove
@@ -228,6 +230,18 @@ static int loopip_get_mtu(iplink_srv_t *srv, size_t *mtu)
 	return EOK;
 }
 
+/** Get maximum packet size for segmentation offload.
+ *
+ * Packets are looped back whole, so a super-segment simply arrives
+ * as one large TCP segment on the receiving side.
+ */
+static int loopip_get_gso_max(iplink_srv_t *srv, size_t *size)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "loopip_get_gso_max()");
+	*size = UINT16_MAX;
+	return EOK;
+}
+
 static int loopip_get_mac48(iplink_srv_t *src, addr48_t *mac)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "loopip_get_mac48()");
@@ -49,6 +49,15 @@
 
 #define NAME       "tcp"
 
+/** Maximum segment size passed to the link for segmentation offload.
+ *
+ * The MSS option is not negotiated yet, assume Ethernet-sized segments.
+ * Links which support segmentation offload split segments larger than
+ * their MTU into segments of at most this size, other links fragment
+ * them at the IP level.
+ */
+#define TCP_GSO_MSS 1460
+
 static int tcp_inet_ev_recv(inet_dgram_t *dgram);
 static void tcp_received_pdu(tcp_pdu_t *pdu);
 
@@ -142,6 +151,7 @@ void tcp_transmit_pdu(tcp_pdu_t *pdu)
 	dgram.tos = 0;
 	dgram.data = pdu_raw;
 	dgram.size = pdu_raw_size;
+	dgram.mss = TCP_GSO_MSS;
 
 	rc = inet_send(&dgram, INET_TTL_MAX, 0);
 	if (rc != EOK)
@@ -34,7 +34,7 @@
  * @file Global segment receive queue
  */
 
-#include <adt/prodcons.h>
+#include <adt/list.h>
 #include <errno.h>
 #include <io/log.h>
 #include <stdbool.h>
@@ -47,7 +47,12 @@
 #include "tcp_type.h"
 #include "ucall.h"
 
-static prodcons_t rqueue;
+/** Maximum size of segment text produced by coalescing queued segments */
+#define RQUEUE_COALESCE_MAX 65535
+
+static list_t rqueue;
+static fibril_mutex_t rqueue_lock;
+static fibril_condvar_t rqueue_cv;
 static bool fibril_active;
 static fibril_mutex_t lock;
 static fibril_condvar_t cv;
@@ -56,7 +61,9 @@ static tcp_rqueue_cb_t *rqueue_cb;
 /** Initialize segment receive queue. */
 void tcp_rqueue_init(tcp_rqueue_cb_t *rcb)
 {
-	prodcons_initialize(&rqueue);
+	list_initialize(&rqueue);
+	fibril_mutex_initialize(&rqueue_lock);
+	fibril_condvar_initialize(&rqueue_cv);
 	fibril_mutex_initialize(&lock);
 	fibril_condvar_initialize(&cv);
 	fibril_active = false;
@@ -77,7 +84,24 @@ void tcp_rqueue_fini(void)
 	fibril_mutex_unlock(&lock);
 }
 
+/** Determine if two endpoint pairs are the same. */
+static bool tcp_rqueue_epp_equal(inet_ep2_t *a, inet_ep2_t *b)
+{
+	return a->local_link == b->local_link &&
+	    a->local.port == b->local.port &&
+	    a->remote.port == b->remote.port &&
+	    inet_addr_compare(&a->local.addr, &b->local.addr) &&
+	    inet_addr_compare(&a->remote.addr, &b->remote.addr);
+}
+
 /** Insert segment into receive queue.
+ *
+ * If the segment continues the data of the last segment waiting in the
+ * queue for the same endpoint pair, it is coalesced with it instead
+ * of being queued separately (receive coalescing). This happens only
+ * when the receive queue fibril is falling behind, i.e. during bulk
+ * transfers, and reduces the number of segments the connection has
+ * to process.
  *
  * @param epp	Endpoint pair, oriented for reception
  * @param seg	Segment (ownership transferred to rqueue)
@@ -85,14 +109,31 @@ void tcp_rqueue_fini(void)
 void tcp_rqueue_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	tcp_rqueue_entry_t *rqe;
+	tcp_rqueue_entry_t *last;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_rqueue_insert_seg()");
 
 	if (seg != NULL)
 		tcp_segment_dump(seg);
 
+	fibril_mutex_lock(&rqueue_lock);
+
+	if (seg != NULL && !list_empty(&rqueue)) {
+		last = list_get_instance(list_last(&rqueue),
+		    tcp_rqueue_entry_t, link);
+		if (last->seg != NULL && tcp_rqueue_epp_equal(&last->epp, epp) &&
+		    tcp_segment_coalesce(last->seg, seg,
+		    RQUEUE_COALESCE_MAX) == EOK) {
+			fibril_mutex_unlock(&rqueue_lock);
+			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Segment coalesced.");
+			tcp_segment_delete(seg);
+			return;
+		}
+	}
+
 	rqe = calloc(1, sizeof(tcp_rqueue_entry_t));
 	if (rqe == NULL) {
+		fibril_mutex_unlock(&rqueue_lock);
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating RQE.");
 		return;
 	}
@@ -100,7 +141,9 @@ void tcp_rqueue_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 	rqe->epp = *epp;
 	rqe->seg = seg;
 
-	prodcons_produce(&rqueue, &rqe->link);
+	list_append(&rqe->link, &rqueue);
+	fibril_condvar_signal(&rqueue_cv);
+	fibril_mutex_unlock(&rqueue_lock);
 }
 
 /** Receive queue handler fibril. */
@@ -112,7 +155,14 @@ static int tcp_rqueue_fibril(void *arg)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_rqueue_fibril()");
 
 	while (true) {
-		link = prodcons_consume(&rqueue);
+		fibril_mutex_lock(&rqueue_lock);
+		while (list_empty(&rqueue))
+			fibril_condvar_wait(&rqueue_cv, &rqueue_lock);
+
+		link = list_first(&rqueue);
+		list_remove(link);
+		fibril_mutex_unlock(&rqueue_lock);
+
 		rqe = list_get_instance(link, tcp_rqueue_entry_t, link);
 
 		if (rqe->seg == NULL) {
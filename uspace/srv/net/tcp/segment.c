@@ -34,6 +34,7 @@
  * @file Segment processing
  */
 
+#include <errno.h>
 #include <io/log.h>
 #include <mem.h>
 #include <stdlib.h>
@@ -216,6 +217,60 @@ void tcp_segment_trim(tcp_segment_t *seg, uint32_t left, uint32_t right)
 	}
 }
 
+/** Append the following segment to a segment.
+ *
+ * This is used to coalesce in-order segments before they are processed
+ * by the connection, so that bulk data is handled in larger chunks.
+ * Only data segments which carry no control other than ACK are
+ * coalesced (the following segment can also carry FIN). The acknowledgement
+ * and window are taken from the following (more recent) segment.
+ *
+ * @param seg		Segment, will be modified in place
+ * @param nseg		Following segment (ownership retained by caller)
+ * @param max_size	Maximum size of the resulting segment text
+ *
+ * @return		EOK on success, EINVAL if the segments cannot
+ *			be coalesced, ENOMEM if out of memory
+ */
+int tcp_segment_coalesce(tcp_segment_t *seg, tcp_segment_t *nseg,
+    size_t max_size)
+{
+	size_t t_size, nt_size;
+	uint8_t *data;
+
+	if (seg->ctrl != CTL_ACK || (nseg->ctrl & ~CTL_FIN) != CTL_ACK)
+		return EINVAL;
+
+	if (seg->up != 0 || nseg->up != 0)
+		return EINVAL;
+
+	if (nseg->seq != seg->seq + seg->len)
+		return EINVAL;
+
+	t_size = tcp_segment_text_size(seg);
+	nt_size = tcp_segment_text_size(nseg);
+
+	if (t_size == 0 || nt_size == 0 || t_size + nt_size > max_size)
+		return EINVAL;
+
+	data = malloc(t_size + nt_size);
+	if (data == NULL)
+		return ENOMEM;
+
+	memcpy(data, seg->data, t_size);
+	memcpy(data + t_size, nseg->data, nt_size);
+
+	free(seg->dfptr);
+	seg->dfptr = seg->data = data;
+
+	seg->ctrl |= nseg->ctrl;
+	seg->len += nseg->len;
+	seg->ack = nseg->ack;
+	seg->wnd = nseg->wnd;
+
+	return EOK;
+}
+
 /** Copy out text data from segment.
  *
  * Data is copied from the beginning of the segment text up to @a size bytes.
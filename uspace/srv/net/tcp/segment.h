@@ -45,6 +45,7 @@ extern tcp_segment_t *tcp_segment_make_ctrl(tcp_control_t);
 extern tcp_segment_t *tcp_segment_make_rst(tcp_segment_t *);
 extern tcp_segment_t *tcp_segment_make_data(tcp_control_t, void *, size_t);
 extern void tcp_segment_trim(tcp_segment_t *, uint32_t, uint32_t);
+extern int tcp_segment_coalesce(tcp_segment_t *, tcp_segment_t *, size_t);
 extern void tcp_segment_text_copy(tcp_segment_t *, void *, size_t);
 extern size_t tcp_segment_text_size(tcp_segment_t *);
 extern void tcp_segment_dump(tcp_segment_t *);
@@ -45,6 +45,7 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <vfs/vfs.h>
 
 #include "conn.h"
 #include "service.h"
@@ -56,6 +57,9 @@
 /** Maximum amount of data transferred in one send call */
 #define MAX_MSG_SIZE DATA_XFER_LIMIT
 
+/** Size of buffer used for reading file data in sendfile */
+#define SENDFILE_BUF_SIZE 16384
+
 static void tcp_ev_data(tcp_cconn_t *);
 static void tcp_ev_connected(tcp_cconn_t *);
 static void tcp_ev_conn_failed(tcp_cconn_t *);
@@ -999,6 +1003,152 @@ static void tcp_conn_send_srv(tcp_client_t *client, ipc_callid_t iid,
 	free(data);
 }
 
+/** Send gathered data via connection.
+ *
+ * Handle client request to send data from multiple buffers via connection.
+ * The pieces are received into one contiguous buffer and queued at once
+ * so that they can share segments.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_sendv_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	ipc_callid_t callid;
+	size_t size;
+	size_t total;
+	size_t cnt;
+	size_t off;
+	size_t i;
+	sysarg_t conn_id;
+	uint8_t *data;
+	int rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sendv_srv())");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	cnt = IPC_GET_ARG2(*icall);
+	total = IPC_GET_ARG3(*icall);
+
+	if (total > MAX_MSG_SIZE) {
+		async_answer_0(iid, EINVAL);
+		return;
+	}
+
+	data = malloc(max(total, 1));
+	if (data == NULL) {
+		async_answer_0(iid, ENOMEM);
+		return;
+	}
+
+	/* Receive message data */
+
+	off = 0;
+	for (i = 0; i < cnt; i++) {
+		if (!async_data_write_receive(&callid, &size)) {
+			async_answer_0(callid, EREFUSED);
+			async_answer_0(iid, EREFUSED);
+			free(data);
+			return;
+		}
+
+		if (size > total - off) {
+			async_answer_0(callid, EINVAL);
+			async_answer_0(iid, EINVAL);
+			free(data);
+			return;
+		}
+
+		rc = async_data_write_finalize(callid, data + off, size);
+		if (rc != EOK) {
+			async_answer_0(callid, rc);
+			async_answer_0(iid, rc);
+			free(data);
+			return;
+		}
+
+		off += size;
+	}
+
+	rc = tcp_conn_send_impl(client, conn_id, data, off);
+	if (rc != EOK) {
+		async_answer_0(iid, rc);
+		free(data);
+		return;
+	}
+
+	async_answer_0(iid, EOK);
+	free(data);
+}
+
+/** Send file data via connection.
+ *
+ * Handle client request to send data from a file via connection. The file
+ * handle is passed from the client, the file is read in chunks and each
+ * chunk is queued for sending directly.
+ *
+ * @param client   TCP client
+ * @param iid      Async request ID
+ * @param icall    Async request data
+ */
+static void tcp_conn_sendfile_srv(tcp_client_t *client, ipc_callid_t iid,
+    ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	aoff64_t pos;
+	aoff64_t size;
+	aoff64_t nsent;
+	ssize_t nr;
+	void *buf;
+	int file;
+	int rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sendfile_srv())");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	pos = MERGE_LOUP32(IPC_GET_ARG2(*icall), IPC_GET_ARG3(*icall));
+	size = MERGE_LOUP32(IPC_GET_ARG4(*icall), IPC_GET_ARG5(*icall));
+
+	file = vfs_receive_handle(true);
+	if (file < 0) {
+		async_answer_2(iid, EINVAL, 0, 0);
+		return;
+	}
+
+	buf = malloc(SENDFILE_BUF_SIZE);
+	if (buf == NULL) {
+		vfs_put(file);
+		async_answer_2(iid, ENOMEM, 0, 0);
+		return;
+	}
+
+	nsent = 0;
+	rc = EOK;
+	while (nsent < size) {
+		nr = vfs_read(file, &pos, buf, (size_t) min(size - nsent,
+		    SENDFILE_BUF_SIZE));
+		if (nr == 0)
+			break;
+
+		if (nr < 0) {
+			rc = EIO;
+			break;
+		}
+
+		rc = tcp_conn_send_impl(client, conn_id, buf, nr);
+		if (rc != EOK)
+			break;
+
+		nsent += nr;
+	}
+
+	free(buf);
+	vfs_put(file);
+	async_answer_2(iid, rc, LOWER32(nsent), UPPER32(nsent));
+}
+
 /** Read received data from connection without blocking.
  *
  * Handle client request to read received data via connection without blocking.
@@ -1222,6 +1372,12 @@ static void tcp_client_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case TCP_CONN_SEND:
 			tcp_conn_send_srv(&client, callid, &call);
 			break;
+		case TCP_CONN_SENDV:
+			tcp_conn_sendv_srv(&client, callid, &call);
+			break;
+		case TCP_CONN_SENDFILE:
+			tcp_conn_sendfile_srv(&client, callid, &call);
+			break;
 		case TCP_CONN_RECV:
 			tcp_conn_recv_srv(&client, callid, &call);
 			break;
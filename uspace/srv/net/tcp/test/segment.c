@@ -26,6 +26,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
 #include <pcut/pcut.h>
 
 #include "main.h"
@@ -244,4 +245,86 @@ PCUT_TEST(data_seg_trim)
 	free(cdata);
 }
 
+/** Test coalescing in-order data segments */
+PCUT_TEST(data_seg_coalesce)
+{
+	tcp_segment_t *seg, *nseg;
+	uint8_t *data;
+	uint8_t *cdata;
+	size_t i, dsize;
+	int rc;
+
+	dsize = 15;
+	data = malloc(dsize);
+	PCUT_ASSERT_NOT_NULL(data);
+	cdata = malloc(2 * dsize);
+	PCUT_ASSERT_NOT_NULL(cdata);
+
+	for (i = 0; i < dsize; i++)
+		data[i] = (uint8_t) i;
+
+	seg = tcp_segment_make_data(CTL_ACK, data, dsize);
+	PCUT_ASSERT_NOT_NULL(seg);
+	seg->seq = 10;
+	seg->ack = 20;
+	seg->wnd = 30;
+
+	nseg = tcp_segment_make_data(CTL_ACK | CTL_FIN, data, dsize);
+	PCUT_ASSERT_NOT_NULL(nseg);
+	nseg->seq = 10 + dsize;
+	nseg->ack = 21;
+	nseg->wnd = 31;
+
+	/* Not enough room for the result */
+	rc = tcp_segment_coalesce(seg, nseg, 2 * dsize - 1);
+	PCUT_ASSERT_INT_EQUALS(EINVAL, rc);
+
+	rc = tcp_segment_coalesce(seg, nseg, 2 * dsize);
+	PCUT_ASSERT_INT_EQUALS(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(CTL_ACK | CTL_FIN, seg->ctrl);
+	PCUT_ASSERT_INT_EQUALS(10, seg->seq);
+	PCUT_ASSERT_INT_EQUALS(21, seg->ack);
+	PCUT_ASSERT_INT_EQUALS(31, seg->wnd);
+	PCUT_ASSERT_INT_EQUALS(2 * dsize + 1, seg->len);
+	PCUT_ASSERT_INT_EQUALS(2 * dsize, tcp_segment_text_size(seg));
+
+	tcp_segment_text_copy(seg, cdata, 2 * dsize);
+	for (i = 0; i < 2 * dsize; i++)
+		PCUT_ASSERT_INT_EQUALS(data[i % dsize], cdata[i]);
+
+	/* Segment with FIN cannot be followed by more data */
+	nseg->seq = seg->seq + seg->len;
+	rc = tcp_segment_coalesce(seg, nseg, 4 * dsize);
+	PCUT_ASSERT_INT_EQUALS(EINVAL, rc);
+
+	tcp_segment_delete(seg);
+	tcp_segment_delete(nseg);
+	free(data);
+	free(cdata);
+}
+
+/** Test that out-of-order segments are not coalesced */
+PCUT_TEST(data_seg_coalesce_ooo)
+{
+	tcp_segment_t *seg, *nseg;
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	int rc;
+
+	seg = tcp_segment_make_data(CTL_ACK, data, sizeof(data));
+	PCUT_ASSERT_NOT_NULL(seg);
+	seg->seq = 10;
+
+	nseg = tcp_segment_make_data(CTL_ACK, data, sizeof(data));
+	PCUT_ASSERT_NOT_NULL(nseg);
+	nseg->seq = 10 + sizeof(data) + 1;
+
+	rc = tcp_segment_coalesce(seg, nseg, 100);
+	PCUT_ASSERT_INT_EQUALS(EINVAL, rc);
+	PCUT_ASSERT_INT_EQUALS(sizeof(data), seg->len);
+
+	tcp_segment_delete(seg);
+	tcp_segment_delete(nseg);
+}
+
 PCUT_EXPORT(segment);
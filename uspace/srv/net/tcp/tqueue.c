@@ -173,6 +173,11 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 }
 
 /** Transmit data from the send buffer.
+ *
+ * All data that fits into the send window is sent as a single segment
+ * (and kept as a single entry in the retransmission queue). The segment
+ * can be larger than the MTU. It is then split into MSS-sized segments
+ * by the link if it supports segmentation offload, or fragmented by IP.
  *
  * @param conn	Connection
  */
@@ -99,6 +99,14 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 	
+	/*
+	 * Initialize the pager page cache.
+	 */
+	if (!vfs_page_cache_init()) {
+		printf("%s: Failed to initialize page cache\n", NAME);
+		return ENOMEM;
+	}
+	
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
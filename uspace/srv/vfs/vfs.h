@@ -122,6 +122,16 @@ typedef struct _vfs_node {
 	fibril_rwlock_t contents_rwlock;
 	
 	struct _vfs_node *mount;
+	
+	/** Pages of the node kept in the pager's page cache. */
+	list_t pages;
+	
+	/**
+	 * Number of open files backing pager mappings, protected by
+	 * nodes_mutex. The node cannot be written or truncated while
+	 * it is nonzero.
+	 */
+	unsigned mapped;
 } vfs_node_t;
 
 /**
@@ -143,6 +153,12 @@ typedef struct {
 
 	/** Append on write. */
 	bool append;
+	
+	/**
+	 * The file backs pager mappings of the task. It can only be used
+	 * by the pager and stays open until the task terminates.
+	 */
+	bool mapped;
 } vfs_file_t;
 
 extern fibril_mutex_t nodes_mutex;
@@ -196,6 +212,7 @@ extern void vfs_op_pass_handle(task_id_t, task_id_t, int);
 extern int vfs_wait_handle_internal(bool);
 
 extern vfs_file_t *vfs_file_get(int);
+extern vfs_file_t *vfs_file_get_mapped(int);
 extern void vfs_file_put(vfs_file_t *);
 extern int vfs_fd_assign(vfs_file_t *, int);
 extern int vfs_fd_alloc(vfs_file_t **file, bool desc);
@@ -203,10 +220,12 @@ extern int vfs_fd_free(int);
 
 extern void vfs_node_addref(vfs_node_t *);
 extern void vfs_node_delref(vfs_node_t *);
+extern bool vfs_node_is_mapped(vfs_node_t *);
 extern int vfs_open_node_remote(vfs_node_t *);
 
 extern int vfs_op_clone(int oldfd, int newfd, bool desc);
 extern int vfs_op_fsprobe(const char *, service_id_t, vfs_fs_probe_info_t *);
+extern int vfs_op_map(int fd);
 extern int vfs_op_mount(int mpfd, unsigned servid, unsigned flags, unsigned instance, const char *opts, const char *fsname, int *outfd);
 extern int vfs_op_mtab_get(void);
 extern int vfs_op_open(int fd, int flags);
@@ -225,6 +244,8 @@ extern int vfs_op_write(int fd, aoff64_t, size_t *out_bytes);
 
 extern void vfs_register(ipc_callid_t, ipc_call_t *);
 
+extern bool vfs_page_cache_init(void);
+extern void vfs_page_cache_invalidate(vfs_node_t *);
 extern void vfs_page_in(ipc_callid_t, ipc_call_t *);
 
 typedef struct {
@@ -63,7 +63,7 @@ typedef struct {
 	int permissions;
 } vfs_boxed_handle_t;
 
-static int _vfs_fd_free(vfs_client_data_t *, int);
+static int _vfs_fd_free(vfs_client_data_t *, int, bool);
 
 /** Initialize the table of open files. */
 static bool vfs_files_init(vfs_client_data_t *vfs_data)
@@ -91,7 +91,7 @@ static void vfs_files_done(vfs_client_data_t *vfs_data)
 
 	for (i = 0; i < MAX_OPEN_FILES; i++) {
 		if (vfs_data->files[i])
-			(void) _vfs_fd_free(vfs_data, i);
+			(void) _vfs_fd_free(vfs_data, i, true);
 	}
 	
 	free(vfs_data->files);
@@ -183,6 +183,11 @@ static int vfs_file_delref(vfs_client_data_t *vfs_data, vfs_file_t *file)
 			if (file->open_read || file->open_write) {
 				rc = vfs_file_close_remote(file);
 			}
+			if (file->mapped) {
+				fibril_mutex_lock(&nodes_mutex);
+				file->node->mapped--;
+				fibril_mutex_unlock(&nodes_mutex);
+			}
 			vfs_node_delref(file->node);
  		}
 		free(file);
@@ -256,7 +261,7 @@ int vfs_fd_alloc(vfs_file_t **file, bool desc)
 	return _vfs_fd_alloc(VFS_DATA, file, desc);
 }
 
-static int _vfs_fd_free(vfs_client_data_t *vfs_data, int fd)
+static int _vfs_fd_free(vfs_client_data_t *vfs_data, int fd, bool mapped)
 {
 	int rc;
 
@@ -264,7 +269,8 @@ static int _vfs_fd_free(vfs_client_data_t *vfs_data, int fd)
 		return ENOMEM;
 
 	fibril_mutex_lock(&vfs_data->lock);	
-	if ((fd < 0) || (fd >= MAX_OPEN_FILES) || !vfs_data->files[fd]) {
+	if ((fd < 0) || (fd >= MAX_OPEN_FILES) || !vfs_data->files[fd] ||
+	    (vfs_data->files[fd]->mapped && !mapped)) {
 		fibril_mutex_unlock(&vfs_data->lock);
 		return EBADF;
 	}
@@ -285,7 +291,7 @@ static int _vfs_fd_free(vfs_client_data_t *vfs_data, int fd)
  */
 int vfs_fd_free(int fd)
 {
-	return _vfs_fd_free(VFS_DATA, fd);
+	return _vfs_fd_free(VFS_DATA, fd, false);
 }
 
 /** Assign a file to a file descriptor.
@@ -328,7 +334,8 @@ static void _vfs_file_put(vfs_client_data_t *vfs_data, vfs_file_t *file)
 	fibril_mutex_unlock(&vfs_data->lock);
 }
 
-static vfs_file_t *_vfs_file_get(vfs_client_data_t *vfs_data, int fd)
+static vfs_file_t *_vfs_file_get(vfs_client_data_t *vfs_data, int fd,
+    bool mapped)
 {
 	if (!vfs_files_init(vfs_data))
 		return NULL;
@@ -341,7 +348,7 @@ static vfs_file_t *_vfs_file_get(vfs_client_data_t *vfs_data, int fd)
 			fibril_mutex_unlock(&vfs_data->lock);
 			
 			fibril_mutex_lock(&file->_lock);
-			if (file->node == NULL) {
+			if ((file->node == NULL) || (file->mapped != mapped)) {
 				_vfs_file_put(vfs_data, file);
 				return NULL;
 			}
@@ -363,7 +370,20 @@ static vfs_file_t *_vfs_file_get(vfs_client_data_t *vfs_data, int fd)
  */
 vfs_file_t *vfs_file_get(int fd)
 {
-	return _vfs_file_get(VFS_DATA, fd);
+	return _vfs_file_get(VFS_DATA, fd, false);
+}
+
+/** Find VFS file structure backing pager mappings.
+ *
+ * Files backing pager mappings are hidden from vfs_file_get().
+ *
+ * @param fd		File descriptor.
+ *
+ * @return		VFS file structure corresponding to fd.
+ */
+vfs_file_t *vfs_file_get_mapped(int fd)
+{
+	return _vfs_file_get(VFS_DATA, fd, true);
 }
 
 /** Stop using a file structure.
@@ -396,7 +416,7 @@ void vfs_op_pass_handle(task_id_t donor_id, task_id_t acceptor_id, int donor_fd)
 	if (!donor_data)
 		goto out;
 
-	donor_file = _vfs_file_get(donor_data, donor_fd);
+	donor_file = _vfs_file_get(donor_data, donor_fd, false);
 	if (!donor_file)
 		goto out;
 
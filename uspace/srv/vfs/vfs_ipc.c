@@ -109,6 +109,13 @@ out:
 	vfs_fstypes_free(&fstypes);
 }
 
+static void vfs_in_map(ipc_callid_t rid, ipc_call_t *request)
+{
+	int fd = IPC_GET_ARG1(*request);
+	int rc = vfs_op_map(fd);
+	async_answer_0(rid, rc);
+}
+
 static void vfs_in_mount(ipc_callid_t rid, ipc_call_t *request)
 {
 	int mpfd = IPC_GET_ARG1(*request);
@@ -339,6 +346,9 @@ void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case VFS_IN_FSTYPES:
 			vfs_in_fstypes(callid, &call);
 			break;
+		case VFS_IN_MAP:
+			vfs_in_map(callid, &call);
+			break;
 		case VFS_IN_MOUNT:
 			vfs_in_mount(callid, &call);
 			break;
@@ -134,10 +134,26 @@ void vfs_node_delref(vfs_node_t *node)
 		    (sysarg_t)node->index);
 		vfs_exchange_release(exch);
 
+		vfs_page_cache_invalidate(node);
 		free(node);
 	}
 }
 
+/** Check whether a node backs pager mappings.
+ *
+ * @param node	Node to be checked.
+ *
+ * @return	True if some open file of the node backs pager mappings.
+ */
+bool vfs_node_is_mapped(vfs_node_t *node)
+{
+	fibril_mutex_lock(&nodes_mutex);
+	bool mapped = (node->mapped > 0);
+	fibril_mutex_unlock(&nodes_mutex);
+	
+	return mapped;
+}
+
 /** Forget node.
  *
  * This function will remove the node from the node hash table and deallocate
@@ -150,6 +166,7 @@ void vfs_node_forget(vfs_node_t *node)
 	fibril_mutex_lock(&nodes_mutex);
 	hash_table_remove_item(&nodes, &node->nh_link);
 	fibril_mutex_unlock(&nodes_mutex);
+	vfs_page_cache_invalidate(node);
 	free(node);
 }
 
@@ -184,6 +201,7 @@ vfs_node_t *vfs_node_get(vfs_lookup_res_t *result)
 		node->size = result->size;
 		node->type = result->type;
 		fibril_rwlock_initialize(&node->contents_rwlock);
+		list_initialize(&node->pages);
 		hash_table_insert(&nodes, &node->nh_link);
 	} else {
 		node = hash_table_get_inst(tmp, vfs_node_t, nh_link);
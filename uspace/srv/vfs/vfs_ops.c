@@ -305,6 +305,42 @@ out:
 	return rc;
 }
 
+/** Reserve an open file for pager mappings.
+ *
+ * The file descriptor is afterwards only accepted by the pager and the
+ * file stays open until the task terminates. The node cannot be written
+ * or truncated while it backs pager mappings.
+ *
+ * @param fd	File descriptor of a file open for reading only.
+ *
+ * @return	EOK on success or a negative error code.
+ */
+int vfs_op_map(int fd)
+{
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+	
+	if ((!file->open_read) || (file->open_write) ||
+	    (file->node->type != VFS_NODE_FILE)) {
+		vfs_file_put(file);
+		return EINVAL;
+	}
+	
+	/* Wait for writes in progress. */
+	fibril_rwlock_write_lock(&file->node->contents_rwlock);
+	
+	fibril_mutex_lock(&nodes_mutex);
+	file->node->mapped++;
+	fibril_mutex_unlock(&nodes_mutex);
+	file->mapped = true;
+	
+	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
+	vfs_file_put(file);
+	
+	return EOK;
+}
+
 int vfs_op_open(int fd, int mode)
 {
 	if (mode == 0)
@@ -409,8 +445,8 @@ static int rdwr_ipc_internal(async_exch_t *exch, vfs_file_t *file, aoff64_t pos,
 	return (int) rc;
 }
 
-static int vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
-    void *ipc_cb_data)
+static int vfs_rdwr(int fd, bool mapped, aoff64_t pos, bool read,
+    rdwr_ipc_cb_t ipc_cb, void *ipc_cb_data)
 {
 	/*
 	 * The following code strongly depends on the fact that the files data
@@ -423,7 +459,7 @@ static int vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	 */
 	
 	/* Lookup the file structure corresponding to the file descriptor. */
-	vfs_file_t *file = vfs_file_get(fd);
+	vfs_file_t *file = mapped ? vfs_file_get_mapped(fd) : vfs_file_get(fd);
 	if (!file)
 		return EBADF;
 	
@@ -448,6 +484,16 @@ static int vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	else
 		fibril_rwlock_write_lock(&file->node->contents_rwlock);
 	
+	if ((!read) && (vfs_node_is_mapped(file->node))) {
+		/* Running programs are paged in from the node. */
+		if (rlock)
+			fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+		else
+			fibril_rwlock_write_unlock(&file->node->contents_rwlock);
+		vfs_file_put(file);
+		return EBUSY;
+	}
+	
 	if (file->node->type == VFS_NODE_DIRECTORY) {
 		/*
 		 * Make sure that no one is modifying the namespace
@@ -482,6 +528,10 @@ static int vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	
 	vfs_exchange_release(fs_exch);
 	
+	/* Pages cached by the pager no longer match the file. */
+	if (!read && rc == EOK)
+		vfs_page_cache_invalidate(file->node);
+	
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 	
@@ -502,14 +552,15 @@ static int vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	return rc;
 }
 
+/** Read or write a file backing pager mappings. */
 int vfs_rdwr_internal(int fd, aoff64_t pos, bool read, rdwr_io_chunk_t *chunk)
 {
-	return vfs_rdwr(fd, pos, read, rdwr_ipc_internal, chunk);
+	return vfs_rdwr(fd, true, pos, read, rdwr_ipc_internal, chunk);
 }
 
 int vfs_op_read(int fd, aoff64_t pos, size_t *out_bytes)
 {
-	return vfs_rdwr(fd, pos, true, rdwr_ipc_client, out_bytes);
+	return vfs_rdwr(fd, false, pos, true, rdwr_ipc_client, out_bytes);
 }
 
 int vfs_op_rename(int basefd, char *old, char *new)
@@ -621,10 +672,18 @@ int vfs_op_resize(int fd, int64_t size)
 
 	fibril_rwlock_write_lock(&file->node->contents_rwlock);
 	
+	if (vfs_node_is_mapped(file->node)) {
+		fibril_rwlock_write_unlock(&file->node->contents_rwlock);
+		vfs_file_put(file);
+		return EBUSY;
+	}
+	
 	int rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
-	if (rc == EOK)
+	if (rc == EOK) {
 		file->node->size = size;
+		vfs_page_cache_invalidate(file->node);
+	}
 	
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -917,7 +976,7 @@ int vfs_op_walk(int parentfd, int flags, char *path, int *out_fd)
 
 int vfs_op_write(int fd, aoff64_t pos, size_t *out_bytes)
 {
-	return vfs_rdwr(fd, pos, false, rdwr_ipc_client, out_bytes);
+	return vfs_rdwr(fd, false, pos, false, rdwr_ipc_client, out_bytes);
 }
 
 /**
@@ -40,29 +40,153 @@
 #include <fibril_synch.h>
 #include <errno.h>
 #include <as.h>
+#include <mem.h>
+#include <smc.h>
+#include <stdlib.h>
+#include <adt/hash_table.h>
+#include <adt/hash.h>
+#include <adt/list.h>
 
-void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
-{
-	aoff64_t offset = IPC_GET_ARG1(*request);
-	size_t page_size = IPC_GET_ARG2(*request);
-	int fd = IPC_GET_ARG3(*request);
+/** Maximal number of pages kept in the page cache. */
+#define PAGE_CACHE_MAX  1024
+
+/** Page of a file kept in the page cache.
+ *
+ * The page stays mapped in the VFS address space so that every page-in
+ * request for the same file offset is answered with the same frame and
+ * the frame is shared by all address spaces which map it.
+ */
+typedef struct {
+	/** Link in the page cache hash table. */
+	ht_link_t link;
+	/** Link in the list of cached pages of the node. */
+	link_t node_link;
+	/** Link in the LRU list. */
+	link_t lru_link;
+	
+	vfs_node_t *node;
+	aoff64_t pos;
 	void *page;
-	int rc;
+} vfs_page_t;
 
-	page = as_area_create(AS_AREA_ANY, page_size,
-	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
-	    AS_AREA_UNPAGED);
+typedef struct {
+	vfs_node_t *node;
+	aoff64_t pos;
+} vfs_page_key_t;
 
-	if (page == AS_MAP_FAILED) {
-		async_answer_0(rid, ENOMEM);
-		return;
+/** Mutex protecting the page cache and the lists of pages of nodes. */
+static FIBRIL_MUTEX_INITIALIZE(page_cache_lock);
+
+/** Page cache hash table. */
+static hash_table_t page_cache;
+
+/** Cached pages, least recently used last. */
+static LIST_INITIALIZE(page_cache_lru);
+
+static size_t page_cache_count = 0;
+
+/** Incremented whenever cached contents of some file become stale. */
+static unsigned int page_cache_gen = 0;
+
+static size_t page_key_hash(void *key)
+{
+	vfs_page_key_t *pkey = key;
+	return hash_combine((size_t) pkey->node, (size_t) pkey->pos);
+}
+
+static size_t page_hash(const ht_link_t *item)
+{
+	vfs_page_t *page = hash_table_get_inst(item, vfs_page_t, link);
+	vfs_page_key_t pkey = {
+		.node = page->node,
+		.pos = page->pos
+	};
+	
+	return page_key_hash(&pkey);
+}
+
+static bool page_key_equal(void *key, const ht_link_t *item)
+{
+	vfs_page_key_t *pkey = key;
+	vfs_page_t *page = hash_table_get_inst(item, vfs_page_t, link);
+	return (page->node == pkey->node) && (page->pos == pkey->pos);
+}
+
+static void page_remove_callback(ht_link_t *item)
+{
+	vfs_page_t *page = hash_table_get_inst(item, vfs_page_t, link);
+	
+	list_remove(&page->node_link);
+	list_remove(&page->lru_link);
+	page_cache_count--;
+	
+	/*
+	 * Address spaces which already map the frame keep their own
+	 * reference to it.
+	 */
+	as_area_destroy(page->page);
+	free(page);
+}
+
+static hash_table_ops_t page_cache_ops = {
+	.hash = page_hash,
+	.key_hash = page_key_hash,
+	.key_equal = page_key_equal,
+	.equal = NULL,
+	.remove_callback = page_remove_callback
+};
+
+/** Initialize the page cache.
+ *
+ * @return True on success, false on failure.
+ */
+bool vfs_page_cache_init(void)
+{
+	return hash_table_create(&page_cache, 0, 0, &page_cache_ops);
+}
+
+/** Drop all cached pages of a node.
+ *
+ * Must be called whenever the contents of the node change and before
+ * the node structure is freed.
+ *
+ * @param node VFS node.
+ */
+void vfs_page_cache_invalidate(vfs_node_t *node)
+{
+	fibril_mutex_lock(&page_cache_lock);
+	
+	page_cache_gen++;
+	list_foreach_safe(node->pages, cur, next) {
+		vfs_page_t *page = list_get_instance(cur, vfs_page_t, node_link);
+		hash_table_remove_item(&page_cache, &page->link);
 	}
+	
+	fibril_mutex_unlock(&page_cache_lock);
+}
 
+/** Read a page of a file into a newly created area.
+ *
+ * @param fd        File descriptor.
+ * @param offset    Position of the page in the file.
+ * @param page_size Size of the page.
+ *
+ * @return Address of the page or AS_MAP_FAILED.
+ */
+static void *vfs_page_read(int fd, aoff64_t offset, size_t page_size)
+{
+	void *page = as_area_create(AS_AREA_ANY, page_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (page == AS_MAP_FAILED)
+		return AS_MAP_FAILED;
+	
 	rdwr_io_chunk_t chunk = {
 		.buffer = page,
 		.size = page_size
 	};
-
+	
+	int rc;
 	size_t total = 0;
 	aoff64_t pos = offset;
 	do {
@@ -76,16 +200,125 @@ void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
 		chunk.buffer += chunk.size;
 		chunk.size = page_size - total;
 	} while (total < page_size);
+	
+	if (rc != EOK) {
+		as_area_destroy(page);
+		return AS_MAP_FAILED;
+	}
+	
+	/*
+	 * Zero the part past the end of file. This also makes sure the
+	 * whole page is present even if nothing could be read.
+	 */
+	memset(page + total, 0, page_size - total);
+	
+	/* The page may end up in an executable mapping. */
+	smc_coherence(page, page_size);
+	
+	return page;
+}
 
-	async_answer_1(rid, rc, (sysarg_t) page);
-
+/** Handle a page-in request of the kernel.
+ *
+ * The first three arguments are the offset of the faulting page within the
+ * address space area, the page size and the file descriptor identifying
+ * the file in the table of the task which created the area. The fourth
+ * argument is the position in the file at which the area starts.
+ *
+ * @param rid     Request ID.
+ * @param request Request data.
+ */
+void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
+{
+	aoff64_t offset = IPC_GET_ARG1(*request) + IPC_GET_ARG4(*request);
+	size_t page_size = IPC_GET_ARG2(*request);
+	int fd = IPC_GET_ARG3(*request);
+	
+	vfs_file_t *file = vfs_file_get_mapped(fd);
+	if (!file) {
+		async_answer_0(rid, EBADF);
+		return;
+	}
+	
+	vfs_node_t *node = file->node;
+	vfs_node_addref(node);
+	vfs_file_put(file);
+	
+	vfs_page_key_t pkey = {
+		.node = node,
+		.pos = offset
+	};
+	
+	bool cacheable = (page_size == PAGE_SIZE);
+	
+	fibril_mutex_lock(&page_cache_lock);
+	
+	if (cacheable) {
+		ht_link_t *item = hash_table_find(&page_cache, &pkey);
+		if (item != NULL) {
+			vfs_page_t *cached =
+			    hash_table_get_inst(item, vfs_page_t, link);
+			list_remove(&cached->lru_link);
+			list_prepend(&cached->lru_link, &page_cache_lru);
+			
+			async_answer_1(rid, EOK, (sysarg_t) cached->page);
+			
+			fibril_mutex_unlock(&page_cache_lock);
+			vfs_node_delref(node);
+			return;
+		}
+	}
+	
+	unsigned int gen = page_cache_gen;
+	fibril_mutex_unlock(&page_cache_lock);
+	
+	void *page = vfs_page_read(fd, offset, page_size);
+	if (page == AS_MAP_FAILED) {
+		async_answer_0(rid, ENOMEM);
+		vfs_node_delref(node);
+		return;
+	}
+	
+	vfs_page_t *cached = cacheable ? malloc(sizeof(vfs_page_t)) : NULL;
+	
+	fibril_mutex_lock(&page_cache_lock);
+	
+	if ((cached != NULL) && (gen == page_cache_gen) &&
+	    (hash_table_find(&page_cache, &pkey) == NULL)) {
+		link_initialize(&cached->node_link);
+		link_initialize(&cached->lru_link);
+		cached->node = node;
+		cached->pos = offset;
+		cached->page = page;
+		
+		hash_table_insert(&page_cache, &cached->link);
+		list_append(&cached->node_link, &node->pages);
+		list_prepend(&cached->lru_link, &page_cache_lru);
+		page_cache_count++;
+		
+		if (page_cache_count > PAGE_CACHE_MAX) {
+			vfs_page_t *lru = list_get_instance(
+			    list_last(&page_cache_lru), vfs_page_t, lru_link);
+			hash_table_remove_item(&page_cache, &lru->link);
+		}
+		
+		async_answer_1(rid, EOK, (sysarg_t) page);
+		
+		fibril_mutex_unlock(&page_cache_lock);
+		vfs_node_delref(node);
+		return;
+	}
+	
+	fibril_mutex_unlock(&page_cache_lock);
+	
 	/*
-	 * FIXME: 
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
+	 * The page could not be cached. The mapping created by the kernel
+	 * keeps the frame after the page is destroyed here.
 	 */
+	async_answer_1(rid, EOK, (sysarg_t) page);
 	as_area_destroy(page);
+	free(cached);
+	vfs_node_delref(node);
 }
 
 /**